@@ -88,12 +88,20 @@
 #define configUSE_IDLE_HOOK                     1
 #define configUSE_TICK_HOOK                     0
 
+/* Stop the tick while the idle task sleeps in LPM3 and step the tick count
+ * forward on wake.  Idle periods shorter than
+ * configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks are not worth the timer
+ * reprogramming and are left to the running tick. */
+#define configUSE_TICKLESS_IDLE                 1
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP   ( (portTickType) 2 )
+
 /* Clock setup from main.c in the demo application. */
 #define configCPU_CLOCK_HZ                      ( (unsigned long)7995392)
 #define configTICK_RATE_HZ                      ( (portTickType) 1024 )
 #define configMAX_PRIORITIES                    ( (unsigned portBASE_TYPE) 4 )
 #define configMINIMAL_STACK_SIZE                ( (unsigned portSHORT) 128 )
-#define configTOTAL_HEAP_SIZE                   ( (size_t)(3320) )
+/* Read, write, user and timer tasks with their semaphores and queues */
+#define configTOTAL_HEAP_SIZE                   ( (size_t)(3840) )
 #define configMAX_TASK_NAME_LEN                 ( 16 )
 #define configUSE_TRACE_FACILITY                0
 
@@ -116,6 +124,41 @@
 #define INCLUDE_vTaskSuspend                    1
 #define INCLUDE_vTaskDelayUntil                 1
 #define INCLUDE_vTaskDelay                      1
-#define INCLUDE_uxTaskGetStackHighWaterMark     0
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+
+/* Residency profiler (measurement.c): time of each task between two context
+ * switches and time slept in LPM3 by the tickless idle.  Goes with
+ * SDK_RESIDENCY_PROFILER in sdk_bluetooth_common_config.h. */
+#define configUSE_RESIDENCY_PROFILER            1
+
+#if ( configUSE_RESIDENCY_PROFILER == 1 ) && !defined( __IAR_SYSTEMS_ASM__ )
+extern void vResidencyTaskSwitchedIn(const signed char *pcTaskName);
+extern void vResidencyLowPowerIdleEnd(unsigned long ulSleptCount);
+#define traceTASK_SWITCHED_IN()                 \
+    vResidencyTaskSwitchedIn((const signed char *)pxCurrentTCB->pcTaskName)
+#define traceLOW_POWER_IDLE_END(ulSleptCount)   \
+    vResidencyLowPowerIdleEnd(ulSleptCount)
+#endif
+
+/* Check the stack of the task switched out at each context switch: its
+ * pointer and the last 16 words of the 0xA5 fill (method 2).  An overflow
+ * calls vApplicationStackOverflowHook() (stack_monitor.c), fatal. */
+#define configCHECK_FOR_STACK_OVERFLOW          2
+
+/* Stack monitor (stack_monitor.c): register each task at creation, with its
+ * stack size, for the high-water sampling.  Goes with SDK_STACK_MONITOR in
+ * sdk_bluetooth_common_config.h; stack_monitor.c does not build if only one
+ * of them is set. */
+#define configUSE_STACK_MONITOR                 1
+
+#if ( configUSE_STACK_MONITOR == 1 ) && !defined( __IAR_SYSTEMS_ASM__ )
+extern void vStackMonitorTaskCreated(void *pxTask,
+                                     const signed char *pcTaskName,
+                                     unsigned short usStackDepth);
+#define traceTASK_CREATE(pxNewTCB)              \
+    vStackMonitorTaskCreated((void *)(pxNewTCB), \
+                             (const signed char *)(pxNewTCB)->pcTaskName, \
+                             usStackDepth)
+#endif
 
 #endif /* FREERTOS_CONFIG_H */
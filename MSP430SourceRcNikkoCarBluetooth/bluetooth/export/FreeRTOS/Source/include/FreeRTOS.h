@@ -129,6 +129,14 @@ typedef portBASE_TYPE(*pdTASK_HOOK_CODE) (void *);
 #define configUSE_RECURSIVE_MUTEXES 0
 #endif
 
+#ifndef configUSE_TICKLESS_IDLE
+#define configUSE_TICKLESS_IDLE 0
+#endif
+
+#ifndef configEXPECTED_IDLE_TIME_BEFORE_SLEEP
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP 2
+#endif
+
 #ifndef configUSE_MUTEXES
 #define configUSE_MUTEXES 0
 #endif
@@ -220,6 +228,11 @@ typedef portBASE_TYPE(*pdTASK_HOOK_CODE) (void *);
 #define traceTASK_SWITCHED_OUT()
 #endif
 
+#ifndef traceLOW_POWER_IDLE_END
+    /* Called by the tickless idle on wake with the ACLK counts slept. */
+#define traceLOW_POWER_IDLE_END( ulSleptCount )
+#endif
+
 #ifndef traceBLOCKING_ON_QUEUE_RECEIVE
     /* Task is about to block because it cannot read from a
      * queue/mutex/semaphore.  pxQueue is a pointer to the
@@ -1145,6 +1145,49 @@ portBASE_TYPE xTaskCallApplicationTaskHook( xTaskHandle xTask, void *pvParameter
  */
 void vTaskIncrementTick( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS ONLY
+ * INTENDED FOR USE WHEN IMPLEMENTING A PORT OF THE SCHEDULER AND IS
+ * AN INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
+ *
+ * configUSE_TICKLESS_IDLE must be set to 1 for this function to be available.
+ *
+ * Called by the idle task with the scheduler suspended.
+ *
+ * Returns the number of ticks the idle task can sleep before a delayed task
+ * needs to be unblocked, or 0 if another task is ready to run.  When no task
+ * is delayed the time left until the tick count wraps is returned, so the
+ * delayed lists are always swapped by a real tick.
+ */
+portTickType xTaskGetExpectedIdleTime( void ) PRIVILEGED_FUNCTION;
+
+/*
+ * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS ONLY
+ * INTENDED FOR USE WHEN IMPLEMENTING A PORT OF THE SCHEDULER AND IS
+ * AN INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
+ *
+ * THIS FUNCTION MUST BE CALLED WITH INTERRUPTS DISABLED.
+ *
+ * configUSE_TICKLESS_IDLE must be set to 1 for this function to be available.
+ *
+ * Moves the tick count forward by the number of ticks that were suppressed
+ * while the processor was asleep.  xTicksToJump must not take the tick count
+ * past the value returned by xTaskGetExpectedIdleTime(), so no task is
+ * unblocked here - the final tick of a sleep period is always processed by
+ * vTaskIncrementTick().
+ */
+void vTaskStepTick( portTickType xTicksToJump ) PRIVILEGED_FUNCTION;
+
+/*
+ * THIS FUNCTION MUST BE CALLED WITH INTERRUPTS DISABLED.
+ *
+ * configUSE_TICKLESS_IDLE must be set to 1 for this function to be available.
+ *
+ * Returns the 16 bit tick count extended with the number of tick count
+ * overflows, for use by the port's timestamp counter.
+ */
+unsigned portLONG ulTaskGetTickCountFromISR( void ) PRIVILEGED_FUNCTION;
+
 /*
  * THIS FUNCTION MUST NOT BE USED FROM APPLICATION CODE.  IT IS AN
  * INTERFACE WHICH IS FOR THE EXCLUSIVE USE OF THE SCHEDULER.
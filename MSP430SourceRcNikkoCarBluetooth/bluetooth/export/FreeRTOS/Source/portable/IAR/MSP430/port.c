@@ -56,6 +56,9 @@
 
 #define portFLAGS_INT_ENABLED			( ( portSTACK_TYPE ) 0x08 )
 
+/* ACLK counts in one tick period. */
+#define portACLK_COUNTS_PER_TICK		( ( unsigned portLONG ) ( portACLK_FREQUENCY_HZ / configTICK_RATE_HZ ) )
+
 /* We require the address of the pxCurrentTCB variable, but don't want to know
  * any details of its type. */
 typedef void tskTCB;
@@ -69,6 +72,22 @@ extern volatile tskTCB *volatile pxCurrentTCB;
  * will cause problems during the startup sequence. */
 volatile unsigned portSHORT usCriticalNesting = portINITIAL_CRITICAL_NESTING;
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+/* Non-zero while the tick is stopped for a tickless sleep, until the
+ * periodic tick runs again. */
+volatile unsigned portSHORT usPortTicklessSleep = 0;
+
+/* Set by portTICKLESS_EXIT_LPM() in whichever interrupt ends the sleep. */
+volatile unsigned portSHORT usPortTicklessExit = 0;
+
+/* Timer0_A5 overflows seen during the current sleep, and the overflow in
+ * which the wake-up compare has to be armed. */
+static volatile unsigned portSHORT usTicklessOverflows = 0;
+static unsigned portSHORT usTicklessWakeOverflow = 0;
+
+#endif /* configUSE_TICKLESS_IDLE */
+
 /*-----------------------------------------------------------*/
 
 
@@ -194,6 +213,18 @@ void vPortEndScheduler(void)
  */
 void prvSetupTimerInterrupt(void)
 {
+#if ( configUSE_TICKLESS_IDLE == 1 )
+    /* Timer1_A3 is owned by the application, so the tick runs on Timer0_A5.
+     * ACLK keeps it counting in LPM3, which the tickless idle relies on to
+     * measure how long the processor slept. */
+    TA0CTL = 0;
+    TA0CTL = TASSEL_1 | TACLR;
+    TA0CCR0 = (unsigned portSHORT) (portACLK_COUNTS_PER_TICK - 1);
+    TA0CCTL0 = CCIE;
+    TA0CCTL1 = 0;
+    TA0CTL |= MC_1;
+#endif /* configUSE_TICKLESS_IDLE */
+
 #if 0
     /* Ensure the timer is stopped. */
     TA1CTL = 0;
@@ -219,3 +250,189 @@ void prvSetupTimerInterrupt(void)
 }
 
 /*-----------------------------------------------------------*/
+
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+void vPortSuppressTicksAndSleep(portTickType xExpectedIdleTime)
+{
+    unsigned portLONG ulWakeCount;
+    unsigned portLONG ulElapsedCount;
+    unsigned portSHORT usRemainder;
+    unsigned portSHORT usSleepStart;
+    portTickType xCompleteTicks;
+    portTickType xIdleTime;
+
+    /* Plain interrupt masking: portDISABLE_INTERRUPTS() would also drop RTS,
+     * which the idle hook has just set for the current eHCILL state. */
+    __disable_interrupt();
+
+    /* An interrupt may have readied a task or shortened the idle period since
+     * the idle task looked. */
+    xIdleTime = xTaskGetExpectedIdleTime();
+    if (xIdleTime < xExpectedIdleTime) {
+        xExpectedIdleTime = xIdleTime;
+    }
+    if (xExpectedIdleTime < configEXPECTED_IDLE_TIME_BEFORE_SLEEP) {
+        __enable_interrupt();
+        return;
+    }
+
+    /* Stop the tick.  TA0R holds the counts already spent in the current
+     * tick period and the timer carries on from there in continuous mode. */
+    TA0CTL &= ~MC_3;
+    TA0CCTL0 &= ~CCIE;
+
+    ulWakeCount = ((unsigned portLONG) xExpectedIdleTime *
+                   portACLK_COUNTS_PER_TICK) - 1UL;
+    /* A compare value this close to an overflow could be passed before it
+     * is armed; wake a fraction of a tick early instead. */
+    if ((ulWakeCount & 0xFFFFUL) < portACLK_COUNTS_PER_TICK) {
+        ulWakeCount -= (ulWakeCount & 0xFFFFUL) + 1UL;
+    }
+
+    usTicklessOverflows = 0;
+    usTicklessWakeOverflow = (unsigned portSHORT) (ulWakeCount >> 16);
+    TA0CCR1 = (unsigned portSHORT) ulWakeCount;
+    TA0CCTL1 = (0 == usTicklessWakeOverflow) ? CCIE : 0;
+    TA0CTL &= ~TAIFG;
+    TA0CTL |= TAIE | MC_2;
+
+    usSleepStart = TA0R;
+    usPortTicklessExit = 0;
+    usPortTicklessSleep = 1;
+    __bis_SR_register(LPM3_bits + GIE);
+
+    /* Woken by the compare below or by any interrupt calling
+     * portTICKLESS_EXIT_LPM(). */
+    __disable_interrupt();
+
+    TA0CTL &= ~(MC_3 | TAIE);
+    TA0CCTL1 = 0;
+    if (TA0CTL & TAIFG) {
+        /* Overflow raised after interrupts were masked. */
+        TA0CTL &= ~TAIFG;
+        usTicklessOverflows++;
+    }
+
+    ulElapsedCount = ((unsigned portLONG) usTicklessOverflows << 16) | TA0R;
+    traceLOW_POWER_IDLE_END(ulElapsedCount - usSleepStart);
+    if (ulElapsedCount >= ulWakeCount) {
+        xCompleteTicks = xExpectedIdleTime;
+        usRemainder = 0;
+    } else {
+        xCompleteTicks =
+            (portTickType) (ulElapsedCount / portACLK_COUNTS_PER_TICK);
+        usRemainder =
+            (unsigned portSHORT) (ulElapsedCount % portACLK_COUNTS_PER_TICK);
+    }
+
+    /* Step over the suppressed ticks and let the last one go through the
+     * normal tick processing so any task due now is unblocked.  The idle
+     * task holds the scheduler, so that last tick is only counted here and
+     * processed by xTaskResumeAll(), after the tick timer runs again. */
+    if (xCompleteTicks > 0) {
+        if (xCompleteTicks > 1) {
+            vTaskStepTick(xCompleteTicks - 1);
+        }
+        vTaskIncrementTick();
+    }
+
+    /* Restart the periodic tick, keeping the partial tick already elapsed. */
+    TA0R = usRemainder;
+    TA0CCTL0 = CCIE;
+    TA0CTL |= MC_1;
+    usPortTicklessSleep = 0;
+
+    __enable_interrupt();
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortTickHold(void)
+{
+    /* As for a tickless sleep, TA0R carries on in continuous mode from the
+     * counts already spent in the current tick period. */
+    TA0CTL &= ~MC_3;
+    TA0CCTL0 &= ~CCIE;
+    TA0CTL |= MC_2;
+}
+
+/*-----------------------------------------------------------*/
+
+void vPortTickRelease(void)
+{
+    unsigned portSHORT usElapsedCount;
+    portTickType xCompleteTicks;
+
+    TA0CTL &= ~MC_3;
+    usElapsedCount = TA0R;
+
+    /* Account each held tick through the normal tick processing: the hold is
+     * short, and this unblocks any task due and handles a tick count
+     * overflow on the way. */
+    for (xCompleteTicks = usElapsedCount / portACLK_COUNTS_PER_TICK;
+         xCompleteTicks > 0; xCompleteTicks--) {
+        vTaskIncrementTick();
+    }
+
+    TA0R = usElapsedCount % portACLK_COUNTS_PER_TICK;
+    TA0CCTL0 = CCIE;
+    TA0CTL |= MC_1;
+}
+
+/*-----------------------------------------------------------*/
+
+unsigned portLONG ulPortGetTimestamp(void)
+{
+    unsigned portLONG ulTicks;
+    unsigned portLONG ulCount;
+    unsigned portSHORT usCount;
+
+    ulTicks = ulTaskGetTickCountFromISR();
+
+    /* TA0R runs off ACLK, asynchronous to MCLK; read until stable. */
+    do {
+        usCount = TA0R;
+    } while (usCount != TA0R);
+    ulCount = usCount;
+
+    if (0 != usPortTicklessSleep) {
+        /* Tick stopped: TA0R counts from the last tick boundary in
+         * continuous mode. */
+        ulCount += ((unsigned portLONG) usTicklessOverflows) << 16;
+    } else if (TA0CCTL0 & CCIFG) {
+        /* A tick is pending behind the caller and TA0R has already
+         * wrapped. */
+        ulTicks++;
+    }
+
+    return (ulTicks * portACLK_COUNTS_PER_TICK) + ulCount;
+}
+
+/*-----------------------------------------------------------*/
+
+/* 
+ * Wake-up compare and overflow counting for the tickless idle.  Only enabled
+ * while the idle task sleeps with the tick stopped.
+ */
+#pragma vector=TIMER0_A1_VECTOR
+__interrupt void prvTicklessTimerISR(void)
+{
+    switch (TA0IV) {
+    case TA0IV_TA0CCR1:
+        /* Expected idle time reached */
+        portTICKLESS_EXIT_LPM();
+        break;
+    case TA0IV_TA0IFG:
+        usTicklessOverflows++;
+        if (usTicklessOverflows == usTicklessWakeOverflow) {
+            /* The wake-up count falls in this timer period */
+            TA0CCTL1 = CCIE;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+#endif /* configUSE_TICKLESS_IDLE */
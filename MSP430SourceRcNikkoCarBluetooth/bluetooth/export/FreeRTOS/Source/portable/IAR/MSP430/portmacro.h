@@ -125,6 +125,69 @@ extern void vPortYield(void);
 
 
 
+/*-----------------------------------------------------------*/
+
+/* Tickless idle. */
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+/* 
+ * Stops the tick, sleeps in LPM3 for up to xExpectedIdleTime ticks and then
+ * corrects the tick count.  Called from the idle task only, with the
+ * scheduler suspended.
+ */
+extern void vPortSuppressTicksAndSleep(portTickType xExpectedIdleTime);
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+
+/* 
+ * Set while the idle task sleeps with the tick stopped.  Every interrupt that
+ * can ready a task must end that sleep with portTICKLESS_EXIT_LPM().  The
+ * idle task holds the scheduler across the sleep, so a task readied by the
+ * interrupt waits on the pending ready list until the tick count has been
+ * corrected and the tick timer restarted.  usPortTicklessSleep stays set
+ * until then, as the timer is still in continuous mode.
+ */
+extern volatile unsigned portSHORT usPortTicklessSleep;
+extern volatile unsigned portSHORT usPortTicklessExit;
+#define portTICKLESS_EXIT_LPM() {\
+              if ((0 != usPortTicklessSleep) && (0 == usPortTicklessExit)) {\
+                  usPortTicklessExit = 1;\
+                  __bic_SR_register_on_exit(LPM3_bits);\
+              }\
+        }
+
+/* 
+ * Free running 32 bit timestamp in ACLK counts, derived from the tick count
+ * and Timer0_A5, valid across tickless sleeps.  Call with interrupts
+ * disabled (any ISR).
+ */
+extern unsigned portLONG ulPortGetTimestamp(void);
+#define portGET_TIMESTAMP()         ulPortGetTimestamp()
+#define portTIMESTAMP_HZ            ( 32768UL )
+
+/* 
+ * Hold the tick across a section run with interrupts disabled for longer
+ * than a tick period (less than 2 s), then account the held ticks.  Both
+ * are called with interrupts disabled.
+ */
+extern void vPortTickHold(void);
+extern void vPortTickRelease(void);
+#define portTICK_HOLD()             vPortTickHold()
+#define portTICK_RELEASE()          vPortTickRelease()
+
+#else
+
+#define portTICKLESS_EXIT_LPM()
+
+/* Ticks missed while interrupts are disabled are lost */
+#define portTICK_HOLD()
+#define portTICK_RELEASE()
+
+/* No free running tick timer without the tickless idle port */
+#define portGET_TIMESTAMP()         ( 0UL )
+#define portTIMESTAMP_HZ            ( 32768UL )
+
+#endif /* configUSE_TICKLESS_IDLE */
+
 /*-----------------------------------------------------------*/
 
 /* Hardware specifics. */
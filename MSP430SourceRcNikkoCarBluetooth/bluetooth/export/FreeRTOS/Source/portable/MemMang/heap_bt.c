@@ -10,20 +10,44 @@
 #include "FreeRTOSConfig.h"
 #include "portmacro.h"
 #include "bt_sdk_error.h"
+#include "sdk_bluetooth_common_config.h"
 #include "BT_buffer.h"
 
-/* Maximum Stack items */
+/* Maximum Stack items, also the width of the pool free bitmap */
 #define     OS_MAX_STACK_ITEMS      15
 
+/**
+ * Fill freed chunks with OS_POOL_POISON_BYTE so a use after free shows up in
+ * the data. Debug builds only, the release free path leaves the chunk as is.
+ */
+#ifdef DEBUG_TESTING
+#define OS_POOL_POISON_ON_FREE
+#endif /* DEBUG_TESTING */
+#define OS_POOL_POISON_BYTE         0xA5
+
+/**
+ * The pools are shared by the tasks and the interrupt handlers. Each pool
+ * operation masks interrupts for a few dozen cycles, far less than a byte
+ * time on the BT UART, and then restores the caller's interrupt state so it
+ * can also be called from an ISR.
+ */
+#define OS_POOL_LOCK(istate)        \
+    do { \
+        (istate) = __get_interrupt_state(); \
+        __disable_interrupt(); \
+    } while (0)
+#define OS_POOL_UNLOCK(istate)      __set_interrupt_state(istate)
+
 /* Define the max pools for the allocation */
 #define OS_MAX_POOLS                5
 
-/* Define the number of pools for each type of memory block */
+/* Define the number of pools for each type of memory block; the HCI UART
+ * receive path holds up to MAX_DATA_RX_PACKETS of the 128 and 260 blocks */
 #define BT_NUM_SIZE_BLK_8           4
 #define BT_NUM_SIZE_BLK_16          2
 #define BT_NUM_SIZE_BLK_32          4
-#define BT_NUM_SIZE_BLK_128         2
-#define BT_NUM_SIZE_BLK_260         2
+#define BT_NUM_SIZE_BLK_128         3
+#define BT_NUM_SIZE_BLK_260         3
 
 /* Maximum Heap Memory for the buffer management */
 #define     OS_MAX_HEAP_MEMORY      \
@@ -37,6 +61,32 @@
 
 static UCHAR heap_memory[OS_MAX_HEAP_MEMORY];
 
+/* Size class lookup: requests are rounded up to a multiple of 8 bytes */
+#define OS_SIZE_CLASS_SHIFT         3
+#define OS_SIZE_CLASS_ENTRIES       \
+            ((BT_MEM_SIZE_260 >> OS_SIZE_CLASS_SHIFT) + 2)
+
+/* Smallest class holding (index << OS_SIZE_CLASS_SHIFT) bytes */
+static const UINT8 os_size_class[OS_SIZE_CLASS_ENTRIES] = {
+    BT_POOL_MAX,
+    /* 1 - 8 */
+    BT_POOL_8,
+    /* 9 - 16 */
+    BT_POOL_16,
+    /* 17 - 32 */
+    BT_POOL_32, BT_POOL_32,
+    /* 33 - 128 */
+    BT_POOL_128, BT_POOL_128, BT_POOL_128, BT_POOL_128,
+    BT_POOL_128, BT_POOL_128, BT_POOL_128, BT_POOL_128,
+    BT_POOL_128, BT_POOL_128, BT_POOL_128, BT_POOL_128,
+    /* 129 - 260 */
+    BT_POOL_260, BT_POOL_260, BT_POOL_260, BT_POOL_260,
+    BT_POOL_260, BT_POOL_260, BT_POOL_260, BT_POOL_260,
+    BT_POOL_260, BT_POOL_260, BT_POOL_260, BT_POOL_260,
+    BT_POOL_260, BT_POOL_260, BT_POOL_260, BT_POOL_260,
+    BT_POOL_260
+};
+
 void sdk_error_handler(void);
 
 typedef struct os_stack {
@@ -55,9 +105,21 @@ OS_STATUS OS_stack_push(OS_STACK * stack, OS_ADDRESS item);
 /* Function to pop the item from the stack */
 OS_STATUS OS_stack_pop(OS_STACK * stack, OS_ADDRESS * item_ptr);
 
-/* Function to search the required item in the stack */
-OS_STATUS OS_stack_search_item(OS_STACK * stack, OS_ADDRESS item,
-                               OS_BOOL * result);
+/* Function to allocate from a pool, or from the next larger non empty one */
+static OS_ADDRESS OS_pool_allocate(OS_HANDLE pool, UINT16 bytes);
+
+/* Function to release a chunk to its pool */
+static OS_STATUS OS_pool_deallocate(OS_HANDLE pool, OS_ADDRESS address);
+
+#ifdef SDK_POOL_TRACE
+/* Function to record an operation in the pool trace */
+static void OS_pool_trace(UINT8 op, OS_HANDLE pool, UINT16 chunk_index,
+                          UINT16 bytes);
+#endif /* SDK_POOL_TRACE */
+
+/* Function to get the index of a chunk from its address */
+static OS_STATUS OS_pool_chunk_index(OS_HANDLE pool, OS_ADDRESS address,
+                                     UINT16 * chunk_index);
 
 OS_HANDLE EtherMind_Pool[BT_POOL_MAX];
 
@@ -79,6 +141,16 @@ typedef struct os_pool {
     OS_ADDRESS start_ptr;
     OS_STACK free_stack;
     UINT16 chunk_size;
+    /* Bit n set while chunk n is on the free stack */
+    UINT16 free_map;
+    /* Requests of this class served by a larger one, and the bytes lost */
+    UINT16 fallback_count;
+    UINT32 fallback_waste;
+    /* Requests of this class, and those no pool could serve */
+    UINT32 alloc_count;
+    UINT16 fail_count;
+    /* Most chunks of this pool allocated at once */
+    UINT8 peak_in_use;
     UINT8 num_chunks;
     UINT8 free_pools;
 } OS_POOL;
@@ -90,6 +162,14 @@ typedef struct os_pool_mgr {
 
 static OS_POOL_MGR pool_mgr;
 
+#ifdef SDK_POOL_TRACE
+/* Pool trace ring; the oldest entries are overwritten when full */
+static OS_POOL_TRACE_ENTRY pool_trace[SDK_POOL_TRACE_DEPTH];
+static UINT16 pool_trace_head = 0;
+static UINT16 pool_trace_count = 0;
+static UINT16 pool_trace_lost = 0;
+#endif /* SDK_POOL_TRACE */
+
 /* Pointer for the heap memory */
 static unsigned int heap_pointer = 0;
 
@@ -137,6 +217,8 @@ OS_HANDLE OS_create_pool(UINT16 chunk_size, UINT16 num_chunks)
         pool_mgr.pool_array[search_result].chunk_size = chunk_size;
         pool_mgr.pool_array[search_result].num_chunks = num_chunks;
         pool_mgr.pool_array[search_result].free_pools = num_chunks;
+        pool_mgr.pool_array[search_result].free_map =
+            (UINT16) ((1UL << num_chunks) - 1);
 
         if ((pool_mgr.pool_array[search_result].start_ptr =
              (void *)os_malloc(chunk_size * num_chunks))
@@ -176,6 +258,12 @@ void buffer_mgmt_init(void)
         pool_mgr.pool_array[index].chunk_size = 0;
         pool_mgr.pool_array[index].num_chunks = 0;
         pool_mgr.pool_array[index].free_pools = 0;
+        pool_mgr.pool_array[index].free_map = 0;
+        pool_mgr.pool_array[index].fallback_count = 0;
+        pool_mgr.pool_array[index].fallback_waste = 0;
+        pool_mgr.pool_array[index].alloc_count = 0;
+        pool_mgr.pool_array[index].fail_count = 0;
+        pool_mgr.pool_array[index].peak_in_use = 0;
     }
     pool_mgr.num_pools = 0;
 
@@ -187,29 +275,175 @@ void buffer_mgmt_init(void)
  *          pool. Unit size is fixed for each pool and is assigned
  *          during pool creation. Allocation of buffer is an inexpensive
  *          operation as it involves only poping an item from the pool's
- *          stack
+ *          stack. An exhausted pool falls back to the next larger non empty
+ *          one.
  * \param   pool        Handle of the pool.
  * \return  OS_ADDRESS  OK if successful, else NULL;
  */
 OS_ADDRESS OS_allocate_buffer(OS_HANDLE pool)
 {
-    OS_ADDRESS free_address = NULL;
+    OS_ADDRESS free_address;
+    unsigned short istate;
 
     /* Check if pool is valid */
     if ((pool <= OS_INVALID_HANDLE) || (pool >= OS_MAX_POOLS)) {
         return (NULL);
     }
 
+    /* The requested size is not known here */
+    OS_POOL_LOCK(istate);
+    free_address = OS_pool_allocate(pool, 0);
+    OS_POOL_UNLOCK(istate);
+
+    return (free_address);
+}
+
+/**
+ * \fn      OS_allocate_size
+ * \brief   This function allocates a buffer of "bytes" from the smallest
+ *          size class holding it, found with a lookup table, falling back
+ *          to the next larger non empty class. The buffer is released with
+ *          BT_free_mem(). Can be called from an ISR.
+ * \param   bytes       Number of bytes required
+ * \return  void *      Buffer if successful, else NULL
+ */
+void *OS_allocate_size(UINT32 bytes)
+{
+    OS_ADDRESS free_address;
+    unsigned short istate;
+    UINT8 size_class;
+
+    if ((bytes == 0) || (bytes > BT_MEM_SIZE_260)) {
+        return (NULL);
+    }
+
+    size_class = os_size_class[(bytes + ((1 << OS_SIZE_CLASS_SHIFT) - 1)) >>
+                               OS_SIZE_CLASS_SHIFT];
+
+    OS_POOL_LOCK(istate);
+    free_address =
+        OS_pool_allocate(EtherMind_Pool[size_class], (UINT16) bytes);
+    OS_POOL_UNLOCK(istate);
+
+    return (free_address);
+}
+
+/**
+ * \fn      OS_get_pool_stats
+ * \brief   This function gets the telemetry of a buffer pool: occupancy,
+ *          peak occupancy, allocations, failures and fallbacks since boot.
+ * \param   pool_type   BT_POOL_*
+ * \param   stats       Filled with the telemetry
+ * \return  OS_STATUS   OK if successful, else ERROR
+ */
+OS_STATUS OS_get_pool_stats(UINT8 pool_type, OS_POOL_STATS * stats)
+{
+    OS_POOL *os_pool;
+    OS_HANDLE pool;
+    unsigned short istate;
+
+    if ((pool_type >= BT_POOL_MAX) || (stats == NULL)) {
+        return (ERROR);
+    }
+
+    pool = EtherMind_Pool[pool_type];
+    if ((pool <= OS_INVALID_HANDLE) || (pool >= OS_MAX_POOLS)) {
+        return (ERROR);
+    }
+    os_pool = &(pool_mgr.pool_array[pool]);
+
+    OS_POOL_LOCK(istate);
+    stats->alloc_count = os_pool->alloc_count;
+    stats->fallback_waste = os_pool->fallback_waste;
+    stats->chunk_size = os_pool->chunk_size;
+    stats->fail_count = os_pool->fail_count;
+    stats->fallback_count = os_pool->fallback_count;
+    stats->num_chunks = os_pool->num_chunks;
+    stats->in_use = os_pool->num_chunks - os_pool->free_pools;
+    stats->peak_in_use = os_pool->peak_in_use;
+    stats->pool_type = pool_type;
+    OS_POOL_UNLOCK(istate);
+
+    return (OK);
+}
+
+/**
+ * \fn      OS_pool_allocate
+ * \brief   Pops a chunk from a pool, or from the next larger non empty one;
+ *          called with the pools locked
+ * \param   pool        Handle of the pool of the size class
+ * \param   bytes       Number of bytes required, for the waste count and
+ *                      the trace; 0 if not known: the chunk size of the
+ *                      class is used and the trace entries are flagged
+ * \return  OS_ADDRESS  Chunk if successful, else NULL
+ */
+static OS_ADDRESS OS_pool_allocate(OS_HANDLE pool, UINT16 bytes)
+{
+    OS_ADDRESS free_address = NULL;
+    OS_HANDLE from;
+    UINT16 chunk_index;
+#ifdef SDK_POOL_TRACE
+    UINT8 trace_flags = 0;
+#endif /* SDK_POOL_TRACE */
+
+    if ((pool <= OS_INVALID_HANDLE) || (pool >= OS_MAX_POOLS)) {
+        return (NULL);
+    }
+
     if (pool_mgr.pool_array[pool].start_ptr == NULL) {
         return (NULL);
     }
 
-    if (OS_stack_pop(&(pool_mgr.pool_array[pool].free_stack), &free_address) ==
-        ERROR) {
+    if (bytes == 0) {
+        bytes = pool_mgr.pool_array[pool].chunk_size;
+#ifdef SDK_POOL_TRACE
+        trace_flags = OS_POOL_TRACE_CLASS_SIZE;
+#endif /* SDK_POOL_TRACE */
+    }
+
+    /* Pools are created in increasing chunk size order */
+    for (from = pool; from < OS_MAX_POOLS; from++) {
+        if ((pool_mgr.pool_array[from].start_ptr == NULL) ||
+            (pool_mgr.pool_array[from].chunk_size <
+             pool_mgr.pool_array[pool].chunk_size)) {
+            continue;
+        }
+        if (OS_stack_pop(&(pool_mgr.pool_array[from].free_stack),
+                         &free_address) == OK) {
+            break;
+        }
+    }
+
+    pool_mgr.pool_array[pool].alloc_count++;
+    if (free_address == NULL) {
+        pool_mgr.pool_array[pool].fail_count++;
+#ifdef SDK_POOL_TRACE
+        OS_pool_trace(OS_POOL_TRACE_FAIL | trace_flags, pool, 0, bytes);
+#endif /* SDK_POOL_TRACE */
         return (NULL);
     }
 
-    pool_mgr.pool_array[pool].free_pools--;
+    if (from != pool) {
+        pool_mgr.pool_array[pool].fallback_count++;
+        pool_mgr.pool_array[pool].fallback_waste +=
+            (pool_mgr.pool_array[from].chunk_size - bytes);
+    }
+
+    if (OS_pool_chunk_index(from, free_address, &chunk_index) == OK) {
+        pool_mgr.pool_array[from].free_map &= ~(1 << chunk_index);
+#ifdef SDK_POOL_TRACE
+        OS_pool_trace(OS_POOL_TRACE_ALLOC | trace_flags, from, chunk_index,
+                      bytes);
+#endif /* SDK_POOL_TRACE */
+    }
+    pool_mgr.pool_array[from].free_pools--;
+    if ((pool_mgr.pool_array[from].num_chunks -
+         pool_mgr.pool_array[from].free_pools) >
+        pool_mgr.pool_array[from].peak_in_use) {
+        pool_mgr.pool_array[from].peak_in_use =
+            pool_mgr.pool_array[from].num_chunks -
+            pool_mgr.pool_array[from].free_pools;
+    }
 
     return (free_address);
 }
@@ -219,84 +453,188 @@ OS_ADDRESS OS_allocate_buffer(OS_HANDLE pool)
  * \brief  This function deallocates memory from a specified pool.
  *          Deallocation of buffer is an inexpensive operation as
  *          it involves only pushing an item onto the pool's stack.
+ *          The chunk boundary and double free checks are O(1): index
+ *          arithmetic and the pool free bitmap. Can be called from an ISR.
  * \param   pool        Handle of the pool.
  * \param   address     Address of the pool.
  * \return  OS_STATUS   OK if successful, else ERROR
  */
 OS_STATUS OS_deallocate_buffer(OS_HANDLE pool, OS_ADDRESS address)
 {
-    OS_ADDRESS start_address = 0, end_address = 0, chunk_address = 0;
-    UINT32 chunk_size, num_chunks;
+    OS_STATUS retval;
+    unsigned short istate;
+
+    OS_POOL_LOCK(istate);
+    retval = OS_pool_deallocate(pool, address);
+    OS_POOL_UNLOCK(istate);
+
+    return (retval);
+}
+
+/**
+ * \fn      OS_pool_deallocate
+ * \brief   Pushes a chunk back on the free stack of its pool; called with
+ *          the pools locked
+ * \param   pool        Handle of the pool.
+ * \param   address     Address of the chunk.
+ * \return  OS_STATUS   OK if successful, else ERROR
+ */
+static OS_STATUS OS_pool_deallocate(OS_HANDLE pool, OS_ADDRESS address)
+{
     UINT16 chunk_index;
-    OS_BOOL is_address_valid = FALSE, is_address_freed = FALSE;
 
-    /* Check if pool is valid */
-    if ((pool <= OS_INVALID_HANDLE) || (pool >= OS_MAX_POOLS)) {
+    /* Check the address is in the pool memory range and on a chunk
+     * boundary */
+    if (OS_pool_chunk_index(pool, address, &chunk_index) == ERROR) {
         return (ERROR);
     }
 
-    if (pool_mgr.pool_array[pool].start_ptr == NULL) {
-        return (ERROR);
+    /* Already on the free list: nothing to do */
+    if (pool_mgr.pool_array[pool].free_map & (1 << chunk_index)) {
+        return (OK);
     }
 
-    /* Initialise local variables */
-    start_address = pool_mgr.pool_array[pool].start_ptr;
-    chunk_size = pool_mgr.pool_array[pool].chunk_size;
-    num_chunks = pool_mgr.pool_array[pool].num_chunks;
-    end_address = (OS_ADDRESS)
-        ((UINT32) start_address + chunk_size * num_chunks);
+#ifdef OS_POOL_POISON_ON_FREE
+    memset(address, OS_POOL_POISON_BYTE, pool_mgr.pool_array[pool].chunk_size);
+#endif /* OS_POOL_POISON_ON_FREE */
 
-    /* Check if the specified address is in pool memory range */
-    if ((address < start_address) || (address >= end_address)) {
+    /* Put it in the free list */
+    if (OS_stack_push(&(pool_mgr.pool_array[pool].free_stack), address)
+        == ERROR) {
         return (ERROR);
     }
 
-    /* If yes, check if the specified address is on a chunk boundary */
-    for (chunk_index = 0; chunk_index < num_chunks; chunk_index++) {
-        chunk_address = (OS_ADDRESS)
-            ((UINT32) start_address + chunk_index * chunk_size);
+    pool_mgr.pool_array[pool].free_map |= (1 << chunk_index);
+    pool_mgr.pool_array[pool].free_pools++;
+#ifdef SDK_POOL_TRACE
+    OS_pool_trace(OS_POOL_TRACE_FREE, pool, chunk_index, 0);
+#endif /* SDK_POOL_TRACE */
+
+    return (OK);
+}
+
+#ifdef SDK_POOL_TRACE
+/**
+ * \fn      OS_pool_trace_read
+ * \brief   Pops the oldest entry of the pool trace
+ * \param   entry       Filled with the entry
+ * \return  OS_STATUS   OK if successful, ERROR if the trace is empty
+ */
+OS_STATUS OS_pool_trace_read(OS_POOL_TRACE_ENTRY * entry)
+{
+    OS_STATUS retval = ERROR;
+    unsigned short istate;
+    UINT16 tail;
+
+    OS_POOL_LOCK(istate);
+    if (pool_trace_count != 0) {
+        tail = (pool_trace_head + SDK_POOL_TRACE_DEPTH - pool_trace_count) %
+            SDK_POOL_TRACE_DEPTH;
+        memcpy(entry, &pool_trace[tail], sizeof(OS_POOL_TRACE_ENTRY));
+        pool_trace_count--;
+        retval = OK;
+    }
+    OS_POOL_UNLOCK(istate);
+
+    return (retval);
+}
+
+/**
+ * \fn      OS_pool_trace_lost
+ * \brief   Returns and clears the number of trace entries overwritten
+ *          before being read
+ * \param   void
+ * \return  UINT16      Number of entries lost
+ */
+UINT16 OS_pool_trace_lost(void)
+{
+    UINT16 lost;
+    unsigned short istate;
+
+    OS_POOL_LOCK(istate);
+    lost = pool_trace_lost;
+    pool_trace_lost = 0;
+    OS_POOL_UNLOCK(istate);
+
+    return (lost);
+}
 
-        if (chunk_address == address) {
-            is_address_valid = TRUE;
+/**
+ * \fn      OS_pool_trace
+ * \brief   Records an operation in the pool trace; called with the pools
+ *          locked
+ * \param   op          OS_POOL_TRACE_*, with OS_POOL_TRACE_CLASS_SIZE
+ * \param   pool        Handle of the pool
+ * \param   chunk_index Index of the chunk in the pool
+ * \param   bytes       Requested bytes
+ * \return  void
+ */
+static void OS_pool_trace(UINT8 op, OS_HANDLE pool, UINT16 chunk_index,
+                          UINT16 bytes)
+{
+    OS_POOL_TRACE_ENTRY *entry = &pool_trace[pool_trace_head];
+    UINT8 pool_type;
+
+    /* Report the BT_POOL_* type rather than the handle */
+    for (pool_type = 0; pool_type < BT_POOL_MAX; pool_type++) {
+        if (EtherMind_Pool[pool_type] == pool) {
             break;
         }
     }
 
-    if (is_address_valid == FALSE) {
-        return (ERROR);
+    entry->timestamp = portGET_TIMESTAMP();
+    entry->size = bytes;
+    entry->pool = pool_type;
+    entry->op_chunk = (UINT8) ((op << 4) | (chunk_index & 0x0F));
+
+    pool_trace_head = (pool_trace_head + 1) % SDK_POOL_TRACE_DEPTH;
+    if (pool_trace_count < SDK_POOL_TRACE_DEPTH) {
+        pool_trace_count++;
+    } else {
+        pool_trace_lost++;
     }
+}
+#endif /* SDK_POOL_TRACE */
 
-    /*
-     * The address belongs to the pool and is on its chunk boundary.
-     * If its not on the free list, then only we should free it.
-     * To make that check, we go down our free stack searching for this
-     * address.
-     */
-    if (OS_stack_search_item
-        (&(pool_mgr.pool_array[pool].free_stack), address,
-         &is_address_freed) == ERROR) {
+/**
+ * \fn      OS_pool_chunk_index
+ * \brief   Get the index of a chunk of a pool from its address
+ * \param   pool        Handle of the pool.
+ * \param   address     Address of the chunk
+ * \param   chunk_index Index of the chunk in the pool
+ * \return  OS_STATUS   OK if the address is a chunk of the pool, else ERROR
+ */
+static OS_STATUS OS_pool_chunk_index(OS_HANDLE pool, OS_ADDRESS address,
+                                     UINT16 * chunk_index)
+{
+    OS_POOL *os_pool;
+    UINT16 offset;
+
+    /* Check if pool is valid */
+    if ((pool <= OS_INVALID_HANDLE) || (pool >= OS_MAX_POOLS)) {
         return (ERROR);
     }
 
-    if (is_address_freed == TRUE) {
-        return (OK);
+    os_pool = &(pool_mgr.pool_array[pool]);
+    if (os_pool->start_ptr == NULL) {
+        return (ERROR);
     }
 
-    /*
-     * The specified address is a valid address of the pool and is
-     * not part of free list of addresses belonging to the pool, so we can
-     * free it.
-     */
+    /* Check if the specified address is in pool memory range */
+    if (((UCHAR *) address < (UCHAR *) os_pool->start_ptr) ||
+        ((UCHAR *) address >= ((UCHAR *) os_pool->start_ptr +
+                               (os_pool->chunk_size * os_pool->num_chunks)))) {
+        return (ERROR);
+    }
 
-    /* Zero out the memory location */
-    memset(address, 0, pool_mgr.pool_array[pool].chunk_size);
-    /* Put it in the free list */
-    if (OS_stack_push(&(pool_mgr.pool_array[pool].free_stack), address)
-        == ERROR) {
+    /* A pool spans at most OS_MAX_STACK_ITEMS chunks: the offset fits in
+     * 16 bits */
+    offset = (UINT16) ((UCHAR *) address - (UCHAR *) os_pool->start_ptr);
+    if ((offset % os_pool->chunk_size) != 0) {
         return (ERROR);
     }
 
-    pool_mgr.pool_array[pool].free_pools++;
+    *chunk_index = offset / os_pool->chunk_size;
 
     return (OK);
 }
@@ -428,38 +766,6 @@ OS_STATUS OS_stack_pop(OS_STACK * stack, OS_ADDRESS * item_ptr)
     return (OK);
 }
 
-/**
- * \fn      OS_stack_search_item
- * \brief   Searches the specified item in the stack. This function does
- *           not modify the stack.
- * \param   stack       Pointer to the stack
- * \param   item        address of the item to be searched
- * \param   result      pointer which stores the result of the search
- * \return  OS_STATUS   OK if successful, else ERROR
- */
-OS_STATUS OS_stack_search_item(OS_STACK * stack, OS_ADDRESS item,
-                               OS_BOOL * result)
-{
-    INT32 index = 0;
-    OS_BOOL found = FALSE;
-
-    /* check for valid arguments */
-    if (stack == NULL) {
-        return (ERROR);
-    }
-
-    for (index = 0; index <= stack->top; index++) {
-        if (stack->item[index] == item) {
-            found = TRUE;
-            break;
-        }
-    }
-
-    *result = found;
-
-    return (OK);
-}
-
 /**
  * \fn      init_bt_buffer_pools
  * \brief   Allocates memory for BT buffer pools
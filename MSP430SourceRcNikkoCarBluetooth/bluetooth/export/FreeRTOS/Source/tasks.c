@@ -1485,6 +1485,66 @@ void vTaskIncrementTick(void)
 
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_TICKLESS_IDLE == 1 )
+
+portTickType xTaskGetExpectedIdleTime(void)
+{
+    portTickType xReturn;
+    tskTCB *pxTCB;
+
+    /* Called by the idle task with the scheduler suspended, and again by the
+     * portable layer with interrupts disabled.  Any task other than the idle
+     * task being ready, a yield held back by the suspended scheduler, or a
+     * tick not yet applied to xTickCount means the processor must not
+     * sleep. */
+    if ((uxMissedTicks != (unsigned portBASE_TYPE)0)
+        || (xMissedYield != pdFALSE)
+        || (!listLIST_IS_EMPTY(&xPendingReadyList))
+        || (uxTopReadyPriority > tskIDLE_PRIORITY)
+        || (listCURRENT_LIST_LENGTH(&(pxReadyTasksLists[tskIDLE_PRIORITY]))
+            > (unsigned portBASE_TYPE)1)) {
+        xReturn = (portTickType) 0;
+    } else if (listLIST_IS_EMPTY(pxDelayedTaskList)) {
+        /* Tasks delayed beyond the next overflow are on the overflow list.
+         * Sleep no further than the wrap so the lists are swapped by a real
+         * tick. */
+        xReturn = portMAX_DELAY - xTickCount;
+    } else {
+        pxTCB = (tskTCB *) listGET_OWNER_OF_HEAD_ENTRY(pxDelayedTaskList);
+        xReturn =
+            listGET_LIST_ITEM_VALUE(&(pxTCB->xGenericListItem)) - xTickCount;
+    }
+
+    return xReturn;
+}
+
+/*-----------------------------------------------------------*/
+
+void vTaskStepTick(portTickType xTicksToJump)
+{
+    /* The caller never jumps past the next unblock time or the tick count
+     * overflow (see xTaskGetExpectedIdleTime()), so only the count itself
+     * needs correcting. */
+    xTickCount += xTicksToJump;
+}
+
+/*-----------------------------------------------------------*/
+
+unsigned portLONG ulTaskGetTickCountFromISR(void)
+{
+    /* Interrupts are disabled by the caller, so the overflow count and the
+     * tick count are read consistently.  Ticks taken while the scheduler is
+     * suspended, as after a tickless sleep, are only counted in
+     * uxMissedTicks until xTaskResumeAll() processes them. */
+    return ((((unsigned portLONG) xNumOfOverflows) << 16) |
+            (unsigned portLONG) xTickCount) +
+        (unsigned portLONG) uxMissedTicks;
+}
+
+#endif /* configUSE_TICKLESS_IDLE */
+
+/*-----------------------------------------------------------*/
+
 #if ( ( INCLUDE_vTaskCleanUpResources == 1 ) && ( INCLUDE_vTaskSuspend == 1 ) )
 
 void vTaskCleanUpResources(void)
@@ -1648,6 +1708,8 @@ void vTaskSwitchContext(void)
     listGET_OWNER_OF_NEXT_ENTRY(pxCurrentTCB,
                                 &(pxReadyTasksLists[uxTopReadyPriority]));
 
+    traceTASK_SWITCHED_IN();
+
     vWriteTraceToBuffer();
 }
 
@@ -1893,6 +1955,35 @@ static portTASK_FUNCTION(prvIdleTask, pvParameters)
             vApplicationIdleHook();
         }
 #endif
+
+#if ( configUSE_TICKLESS_IDLE == 1 )
+        {
+            portTickType xExpectedIdleTime;
+
+            /* Stop the tick and sleep until the next delayed task is due or
+             * an interrupt readies a task.  The first value is only a hint
+             * taken without suspending the scheduler. */
+            xExpectedIdleTime = xTaskGetExpectedIdleTime();
+
+            if (xExpectedIdleTime >= configEXPECTED_IDLE_TIME_BEFORE_SLEEP) {
+                /* A task readied by the interrupt that ends the sleep must not
+                 * run before the tick count is corrected and the tick timer
+                 * restarted: hold the scheduler across the sleep.  The
+                 * readied task goes to the pending ready list and runs from
+                 * xTaskResumeAll(). */
+                vTaskSuspendAll();
+                {
+                    xExpectedIdleTime = xTaskGetExpectedIdleTime();
+
+                    if (xExpectedIdleTime >=
+                        configEXPECTED_IDLE_TIME_BEFORE_SLEEP) {
+                        portSUPPRESS_TICKS_AND_SLEEP(xExpectedIdleTime);
+                    }
+                }
+                (void)xTaskResumeAll();
+            }
+        }
+#endif
     }
 }                               /* lint !e715 pvParameters is not accessed but
                                  * all task functions require the same
@@ -12,6 +12,9 @@
 #include "sdk_bluetooth_config.h"
 #include "vendor_specific_init.h"
 #include "bt_sdk_error.h"
+#include "appl_sniff.h"
+#include "conn_arena.h"
+#include "appl_reconnect.h"
 
 /* Extern Variables */
 
@@ -87,6 +90,9 @@ void hci_connection_complete_event_handler(UCHAR * event_data)
     UCHAR status, link_type;
     UCHAR *bd_addr, value_1;
     API_RESULT retval;
+#ifdef SDK_FAST_RECONNECT
+    UCHAR dev_index;
+#endif /* SDK_FAST_RECONNECT */
 
     sdk_display((const UCHAR *)"Received HCI_CONNECTION_COMPLETE_EVENT.\n");
 
@@ -147,6 +153,21 @@ void hci_connection_complete_event_handler(UCHAR * event_data)
     if (HCI_ACL_LINK == link_type) {
         if (status != 0x00) {
             SDK_DEBUG_PRINT_STRING("SPP Connection failed\n");
+            CONN_STATS_REASON(CONN_STATS_SRC_ACL, status);
+#ifdef SDK_FAST_RECONNECT
+            if (TRUE == appl_reconnect_acl_failed(bd_addr)) {
+                /* Cached peer not paged: release the instance, page the
+                 * next one, full discovery after the last */
+                if (API_SUCCESS ==
+                    appl_get_status_instance_bd_addr(&dev_index, bd_addr)) {
+                    SDK_SPP_CHANGE_STATE(dev_index, SDK_DISCONNECTED);
+                }
+                if (API_SUCCESS != appl_reconnect_next()) {
+                    appl_start_inquiry();
+                }
+                return;
+            }
+#endif /* SDK_FAST_RECONNECT */
             /* Try Reconnect ACL */
             BT_hci_create_connection(bd_addr, SDK_CONFIG_ACL_PKT_TYPE,
                                      rem_bt_dev[rem_dev_index].
@@ -162,6 +183,7 @@ void hci_connection_complete_event_handler(UCHAR * event_data)
                 sdk_display((const UCHAR *)"Failed to turn off visibility\n");
             } else {
                 sdk_bt_visible = SDK_DISC_OFF;
+                sdk_update_indication();
             }
 
             appl_acl_connection_complete_event(bd_addr, status,
@@ -205,13 +227,17 @@ void hci_disconnection_complete_event_handler(UCHAR * event_data)
     event_data += 1;
 
     if (0x00 == status) {
+        CONN_STATS_REASON(CONN_STATS_SRC_DISCONNECT, value_1);
         appl_get_status_instance_acl(&dev_index, connection_handle);
         SDK_SPP_CHANGE_STATE(dev_index, SDK_DISCONNECTED);
+        /* Failed or closed connection, release its setup buffers */
+        conn_arena_reset(dev_index);
 
         retval = BT_hci_write_scan_enable(0x03);
 
         if (API_SUCCESS == retval) {
             sdk_bt_visible = SDK_DISC_ON;
+            sdk_update_indication();
 
                 /**
                  * SPP reconnection not initiated if it is user (Local or
@@ -240,6 +266,9 @@ void hci_command_complete_event_handler(UCHAR * event_data)
 {
     UINT16 value_2;
     UCHAR status;
+#ifdef SDK_SNIFF_SUBRATING
+    UINT16 connection_handle;
+#endif /* SDK_SNIFF_SUBRATING */
 
     sdk_display((const UCHAR *)"Received HCI_COMMAND_COMPLETE_EVENT.\n");
 
@@ -256,6 +285,15 @@ void hci_command_complete_event_handler(UCHAR * event_data)
     sdk_display("\tCommand Status: 0x%02X\n", status);
     event_data += 1;
 
+#ifdef SDK_SNIFF_SUBRATING
+    /* Subrating is optional on the peer, a failure is not fatal */
+    if (HCI_SNIFF_SUBRATING_OPCODE == value_2) {
+        hci_unpack_2_byte_param(&connection_handle, event_data);
+        appl_sniff_ssr_cmd_complete(status, connection_handle);
+        return;
+    }
+#endif /* SDK_SNIFF_SUBRATING */
+
     if (0x00 != status) {
         sdk_error_code = SDK_WRONG_EVENT_RECEIVED;
         sdk_error_handler();
@@ -276,7 +314,6 @@ void hci_command_status_event_handler(UCHAR * event_data)
     UINT16 value_2;
     UCHAR status;
     /* UCHAR value_1; */
-    API_RESULT retval;
     sdk_display((const UCHAR *)"Received HCI_COMMAND_STATUS_EVENT.\n");
     /* Status */
     hci_unpack_1_byte_param(&status, event_data);
@@ -296,12 +333,18 @@ void hci_command_status_event_handler(UCHAR * event_data)
             sdk_display((const UCHAR *)"Sniff mode enabled successfully.\n");
         } else {
             sdk_display((const UCHAR *)"Enabling Sniff mode failed.\n");
+#ifdef SDK_ADAPTIVE_SNIFF
+            appl_sniff_ctrl_cmd_failed(value_2);
+#endif /* SDK_ADAPTIVE_SNIFF */
         }
     } else if (HCI_EXIT_SNIFF_MODE_OPCODE == value_2) {
         if (0x00 == status) {
             sdk_display((const UCHAR *)"Exiting Sniff mode successfully.\n");
         } else {
             sdk_display((const UCHAR *)"Exiting Sniff mode failed.\n");
+#ifdef SDK_ADAPTIVE_SNIFF
+            appl_sniff_ctrl_cmd_failed(value_2);
+#endif /* SDK_ADAPTIVE_SNIFF */
         }
         return;
     }
@@ -309,38 +352,12 @@ void hci_command_status_event_handler(UCHAR * event_data)
 
         /**
          * If remote name request during the inquiry fails for a device,
-         * issue remote name request for the next discovered device if any
+         * issue remote name request for the next discovered device if any,
+         * or retry after the inquiry if the controller refused to page
          */
     if ((API_SUCCESS != status)
         && (HCI_REMOTE_NAME_REQUEST_OPCODE == value_2)) {
-        rem_dev_index++;
-        if (rem_dev_index < rem_dev_num) {
-            /* Device exist for which name request has not been issued */
-            retval =
-                BT_hci_remote_name_request(rem_bt_dev[rem_dev_index].bd_addr,
-                                           rem_bt_dev[rem_dev_index].
-                                           page_scan_rep_mode, 0x00,
-                                           rem_bt_dev[rem_dev_index].
-                                           clock_offset);
-            if (retval != API_SUCCESS) {
-                sdk_display
-                    ("Remote Name Request FAILED !! Error Code = 0x%04x\n",
-                     retval);
-            }
-        } else if (rem_dev_index == rem_dev_num) {
-            /* Restart Inquiry as BlueMSP430Demo device is not found */
-            retval =
-                BT_hci_inquiry(SDK_INQUIRY_LAP, SDK_INQUIRY_LEN,
-                               SDK_NUM_RESPONSES);
-            if (retval != API_SUCCESS) {
-                sdk_display((const UCHAR *)
-                            "Failed to initiate Inquiry\n");
-            } else {
-                rem_dev_index = rem_dev_num = 0;
-                sdk_display((const UCHAR *)
-                            "Inquiry Started...Wait for Completion\n");
-            }
-        }
+        appl_inquiry_name_failed();
     }
 }
 
@@ -393,9 +410,10 @@ void hci_mode_change_event_handler(UCHAR * event_data)
             case 0x02:
                 sdk_display((const UCHAR *)" -> Sniff Mode\n");
 #ifdef SDK_ENABLE_SNIFF_MODE
+                /* Track the mode whoever requested it */
+                SDK_SPP_CHANGE_LINK_STATE(dev_index, SDK_IN_SNIFF);
                 if (TRUE == sdk_sniff_mode_requested) {
                     sdk_sniff_mode_requested = FALSE;
-                    SDK_SPP_CHANGE_LINK_STATE(dev_index, SDK_IN_SNIFF);
                     if (SDK_IS_SPP_TX_STARTED(dev_index)) {
                         /* Start Sending Data */
                         appl_send_spp_data(dev_index);
@@ -415,11 +433,52 @@ void hci_mode_change_event_handler(UCHAR * event_data)
             hci_unpack_2_byte_param(&value_2, event_data);
             sdk_display("\tInterval: 0x%04X\n", value_2);
             event_data += 2;
+#ifdef SDK_ADAPTIVE_SNIFF
+            appl_sniff_ctrl_mode_change(dev_index, value_1, value_2);
+#endif /* SDK_ADAPTIVE_SNIFF */
         }
     }
 
 }
 
+#ifdef SDK_SNIFF_SUBRATING
+/**
+ * \fn      hci_sniff_subrating_event_handler
+ * \brief   Event handler for HCI sniff subrating
+ * \param   event_data
+ * \return  void
+ * \see     common_cb.c
+ */
+void hci_sniff_subrating_event_handler(UCHAR * event_data)
+{
+    UINT16 connection_handle, tx_latency, rx_latency;
+    UCHAR dev_index, status;
+
+    sdk_display((const UCHAR *)"Received HCI_SNIFF_SUBRATING_EVENT.\n");
+    /* Status */
+    hci_unpack_1_byte_param(&status, event_data);
+    if (0x0 != status) {
+        return;
+    }
+    event_data += 1;
+    /* Connection Handle */
+    hci_unpack_2_byte_param(&connection_handle, event_data);
+    event_data += 2;
+    /* Maximum Transmit Latency */
+    hci_unpack_2_byte_param(&tx_latency, event_data);
+    event_data += 2;
+    /* Maximum Receive Latency */
+    hci_unpack_2_byte_param(&rx_latency, event_data);
+    sdk_display("\tTx Latency: 0x%04X Rx Latency: 0x%04X\n", tx_latency,
+                rx_latency);
+
+    if (API_SUCCESS ==
+        appl_get_status_instance_acl(&dev_index, connection_handle)) {
+        appl_sniff_ssr_event(dev_index, tx_latency, rx_latency);
+    }
+}
+#endif /* SDK_SNIFF_SUBRATING */
+
 /**
  * \fn      hci_inquiry_complete_event_handler
  * \brief   Event handler for HCI inquiry complete
@@ -429,40 +488,12 @@ void hci_mode_change_event_handler(UCHAR * event_data)
  */
 void hci_inquiry_complete_event_handler(UCHAR * event_data)
 {
-    API_RESULT retval;
     UCHAR status;
     /* Status */
     hci_unpack_1_byte_param(&status, event_data);
     if (0x0 == status) {
         /* Inquiry Completed */
-        if (0 == rem_dev_num) {
-            /* No remote BT device found, so restart inquiry procedure */
-            retval =
-                BT_hci_inquiry(SDK_INQUIRY_LAP, SDK_INQUIRY_LEN,
-                               SDK_NUM_RESPONSES);
-            if (retval != API_SUCCESS) {
-                sdk_display((const UCHAR *)"Failed to initiate Inquiry\n");
-            } else {
-                rem_dev_index = rem_dev_num = 0;
-                sdk_display((const UCHAR *)
-                            "Inquiry Started...Wait for Completion\n");
-            }
-        } else {
-            /* BT devices found, initiate remote name request for the first
-             * device */
-            retval =
-                BT_hci_remote_name_request(rem_bt_dev[0].bd_addr,
-                                           rem_bt_dev[0].page_scan_rep_mode,
-                                           0x00, rem_bt_dev[0].clock_offset);
-            if (retval != API_SUCCESS) {
-                sdk_display
-                    ("Remote Name Request FAILED !! Error Code = 0x%04x\n",
-                     retval);
-            } else {
-                sdk_display("Remote BT Devices List:\n");
-            }
-        }
-
+        appl_inquiry_complete();
     }
 
 }
@@ -478,7 +509,7 @@ void hci_inquiry_result_event_handler(UCHAR * event_data)
 {
 
     UINT16 value_2;
-    UCHAR *bd_addr, num_responses, count, value_1, index, flag = 0;
+    UCHAR *bd_addr, num_responses, count, value_1;
     /* Number of Responses */
     hci_unpack_1_byte_param(&num_responses, event_data);
     event_data += 1;
@@ -495,32 +526,97 @@ void hci_inquiry_result_event_handler(UCHAR * event_data)
         event_data += 6;
         /* Clock Offset */
         hci_unpack_2_byte_param(&value_2, event_data);
-        if (SDK_INQ_MAX_DEVICES == rem_dev_num) {
-            /* Max remote devices limit reached */
-            break;
-        }
+        event_data += 2;
+#ifdef SDK_FAST_RECONNECT
+        /* Keep the page parameters of a cached peer fresh */
+        appl_reconnect_page_info(bd_addr, value_1, value_2);
+#endif /* SDK_FAST_RECONNECT */
+
+        /* Store the remote device details, skipped if already noted; the
+         * next responses of the event are still looked at */
+        appl_inquiry_add_device(bd_addr, value_1, value_2);
+    }
 
-        for (index = 0; index < rem_dev_num; index++) {
-            if (!memcmp(bd_addr, rem_bt_dev[index].bd_addr, BT_BD_ADDR_SIZE)) {
-                /* Remote device already noted */
-                flag = 1;
-                break;
-            }
-        }
-        if (flag) {
-            /* Remote device noted, so skip updation */
-            break;
-        }
-        /* Store the remote device details */
-        memcpy(rem_bt_dev[rem_dev_num].bd_addr, bd_addr, BT_BD_ADDR_SIZE);
-        rem_bt_dev[rem_dev_num].page_scan_rep_mode = value_1;
-        rem_bt_dev[rem_dev_num].clock_offset = value_2;
-        /* Increase the count of number of devices discovered */
-        rem_dev_num++;
+
+}
+
+#ifdef SDK_EIR_DISCOVERY
+/**
+ * \fn      hci_inquiry_result_rssi_event_handler
+ * \brief   Event handler for HCI inquiry result with RSSI, sent for the
+ *          devices without extended inquiry response
+ * \param   event_data
+ * \return  void
+ * \see     common_cb.c
+ */
+void hci_inquiry_result_rssi_event_handler(UCHAR * event_data)
+{
+    UINT16 value_2;
+    UCHAR *bd_addr, num_responses, count, value_1, value_3;
+
+    /* Number of Responses */
+    hci_unpack_1_byte_param(&num_responses, event_data);
+    event_data += 1;
+    for (count = 0; count < num_responses; count++) {
+        /* Note the bd_addr */
+        bd_addr = event_data;
+        event_data += 6;
+        /* Page Scan Repetition Mode, Reserved, Class of Device */
+        hci_unpack_1_byte_param(&value_1, event_data);
+        event_data += 5;
+        /* Clock Offset */
+        hci_unpack_2_byte_param(&value_2, event_data);
+        event_data += 2;
+        /* RSSI */
+        hci_unpack_1_byte_param(&value_3, event_data);
+        event_data += 1;
+#ifdef SDK_FAST_RECONNECT
+        /* Keep the page parameters of a cached peer fresh */
+        appl_reconnect_page_info(bd_addr, value_1, value_2);
+#endif /* SDK_FAST_RECONNECT */
+
+        /* No EIR: the name is resolved by remote name request */
+        appl_inquiry_add_eir_device(bd_addr, value_1, value_2, (CHAR)value_3,
+                                    NULL);
     }
+}
 
+/**
+ * \fn      hci_extended_inquiry_result_event_handler
+ * \brief   Event handler for HCI extended inquiry result
+ * \param   event_data
+ * \return  void
+ * \see     common_cb.c
+ */
+void hci_extended_inquiry_result_event_handler(UCHAR * event_data)
+{
+    UINT16 value_2;
+    UCHAR *bd_addr, value_1, value_3;
 
+    /* Number of Responses, always one */
+    event_data += 1;
+    /* Note the bd_addr */
+    bd_addr = event_data;
+    event_data += 6;
+    /* Page Scan Repetition Mode, Reserved, Class of Device */
+    hci_unpack_1_byte_param(&value_1, event_data);
+    event_data += 5;
+    /* Clock Offset */
+    hci_unpack_2_byte_param(&value_2, event_data);
+    event_data += 2;
+    /* RSSI */
+    hci_unpack_1_byte_param(&value_3, event_data);
+    event_data += 1;
+#ifdef SDK_FAST_RECONNECT
+    /* Keep the page parameters of a cached peer fresh */
+    appl_reconnect_page_info(bd_addr, value_1, value_2);
+#endif /* SDK_FAST_RECONNECT */
+
+    /* The extended inquiry response follows */
+    appl_inquiry_add_eir_device(bd_addr, value_1, value_2, (CHAR)value_3,
+                                event_data);
 }
+#endif /* SDK_EIR_DISCOVERY */
 
 /**
  * \fn      hci_remote_name_request_complete_event_handler
@@ -536,7 +632,6 @@ void hci_remote_name_request_complete_event_handler(UCHAR * event_data,
 
     API_RESULT retval;
     UCHAR *bd_addr, dev_index, rem_dev_name_len, *rem_dev_name;
-    UCHAR rem_bt_dev_index;
     event_data += 1;
     /* Note the bd addr */
     bd_addr = event_data;
@@ -585,58 +680,13 @@ void hci_remote_name_request_complete_event_handler(UCHAR * event_data,
         if (0 ==
             strncmp((char *)rem_dev_name, SDK_REM_DEV_NAME_PREFIX,
                     (strlen((char *)SDK_REM_DEV_NAME_PREFIX)))) {
-            /* Allocate free spp instance if available */
-            if (API_SUCCESS != appl_get_free_status_instance(&rem_bt_dev_index)) {
-                sdk_display("No free SPP connection instance available\n");
-                return;
-            }
             /* BlueMSP430Demo Found, so initiate connection */
-            retval =
-                BT_hci_create_connection(bd_addr, SDK_CONFIG_ACL_PKT_TYPE,
-                                         rem_bt_dev[rem_dev_index].
-                                         page_scan_rep_mode, 0,
-                                         rem_bt_dev[rem_dev_index].clock_offset,
-                                         0x01);
-            /* If already connected */
-            if (HCI_STATE_ALREADY_CONNECTED == retval) {
-                /* Initiate SDP Query */
-                appl_spp_sdp_query(rem_bt_dev_index);
-                SDK_SPP_CHANGE_STATE(rem_bt_dev_index, SDK_IN_SDP_QUERY);
-            } else if (API_SUCCESS == retval) {
-                /* Populate the connection instance with bd_addr */
-                BT_mem_copy(sdk_status[rem_bt_dev_index].peer_bd_addr, bd_addr,
-                            BT_BD_ADDR_SIZE);
-                /* On Success */
-                SDK_SPP_CHANGE_STATE(rem_bt_dev_index, SDK_IN_ACL_CONNECTION);
-            }
+            appl_inquiry_name_matched();
             return;
         }
     }
     /* Start the query for next remote device discovered */
-    rem_dev_index++;
-    if (rem_dev_index < rem_dev_num) {
-        /* Device exist for which name request has not been issued */
-        retval =
-            BT_hci_remote_name_request(rem_bt_dev[rem_dev_index].bd_addr,
-                                       rem_bt_dev[rem_dev_index].
-                                       page_scan_rep_mode, 0x00,
-                                       rem_bt_dev[rem_dev_index].clock_offset);
-        if (retval != API_SUCCESS) {
-            sdk_display("Remote Name Request FAILED !! Error Code = 0x%04x\n",
-                        retval);
-        }
-    } else if (rem_dev_index == rem_dev_num) {
-        /* Restart Inquiry as BlueMSP430Demo device is not found */
-        retval =
-            BT_hci_inquiry(SDK_INQUIRY_LAP, SDK_INQUIRY_LEN, SDK_NUM_RESPONSES);
-        if (retval != API_SUCCESS) {
-            sdk_display((const UCHAR *)"Failed to initiate Inquiry\n");
-        } else {
-            rem_dev_index = rem_dev_num = 0;
-            sdk_display((const UCHAR *)
-                        "Inquiry Started...Wait for Completion\n");
-        }
-    }
+    appl_inquiry_name_done();
 }
 
 
@@ -0,0 +1,333 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    appl_dvfs.c
+ * \brief   This file contains the system clock scaling service: the clock and
+ *          VCore follow the SPP link state, and the SMCLK/MCLK derived
+ *          settings are re-derived in the same critical section as the clock
+ *          change.
+ */
+
+/* Header File Inclusion */
+#include "appl_dvfs.h"
+#include "hal_MSP430F5438.h"
+
+#ifdef SDK_DVFS
+
+/* Extern variables */
+/* spp connections status information */
+extern SDK_SPP_CONNECTION_STATUS sdk_status[];
+/* Current system clock (SYSCLK_xxMHZ) */
+extern UCHAR sys_clk_frequency;
+/* The variable is used to hold the current BT UART baud rate value */
+extern UINT32 current_bt_uart_baudrate;
+
+extern UCHAR sdk_usb_detected;
+
+/* Static variables */
+/* Statistics of one clock level, in ACLK counts */
+typedef struct {
+    UINT32 residency;
+    UINT16 switch_last;
+    UINT16 switch_max;
+    UINT16 entry_count;
+    UINT16 refused_count;
+} APPL_DVFS_STATS;
+
+static APPL_DVFS_STATS appl_dvfs_stats[APPL_DVFS_NUM_LEVELS];
+static UCHAR appl_dvfs_level = APPL_DVFS_LEVEL_BOOT;
+/* Level requested by appl_dvfs_update(), applied by appl_dvfs_poll() */
+static UCHAR appl_dvfs_target = APPL_DVFS_LEVEL_BOOT;
+/* Timestamp of the last clock change */
+static UINT32 appl_dvfs_level_start = 0;
+
+/**
+ * Typical active mode current at 3 V, code executing from flash, of the
+ * F543xA datasheet, indexed by SYSCLK_xxMHZ with the matching VCore level.
+ * A nominal figure to weigh the residencies with, not a measurement.
+ */
+static const UINT16 appl_dvfs_active_ua[SYSCLK_25MHZ + 1] = {
+    290, 1100, 2200, 3400, 4500, 5200, 5800, 7600
+};
+
+static const char *const appl_dvfs_level_name[APPL_DVFS_NUM_LEVELS] = {
+    "boot  ",
+    "idle  ",
+    "drive "
+};
+
+/* Static Function Declarations */
+static UCHAR appl_dvfs_get_sysclk(UCHAR level);
+static UINT32 appl_dvfs_to_us(UINT32 counts);
+
+
+/**
+ * \fn      appl_dvfs_update
+ * \brief   Pick the clock level from the SPP link states; the change is
+ *          applied by the user task
+ * \param   void
+ * \return  void
+ */
+void appl_dvfs_update(void)
+{
+    UCHAR target;
+    UCHAR index;
+
+    target = APPL_DVFS_LEVEL_IDLE;
+    for (index = 0; index < SPP_MAX_ENTITY; index++) {
+        if (SDK_IS_SPP_CONNECTED(index)) {
+            target = APPL_DVFS_LEVEL_DRIVE;
+            break;
+        }
+    }
+
+    if (target != appl_dvfs_target) {
+        appl_dvfs_target = target;
+        sdk_user_task_wakeup();
+    }
+}
+
+/**
+ * \fn      appl_dvfs_poll
+ * \brief   Apply a pending clock level change; called from the user task
+ * \param   void
+ * \return  void
+ */
+void appl_dvfs_poll(void)
+{
+    UCHAR target;
+
+    target = appl_dvfs_target;
+    if (target != appl_dvfs_level) {
+        if (API_SUCCESS != appl_dvfs_set_level(target)) {
+            /* Stay where we are until the link state changes again */
+            appl_dvfs_target = appl_dvfs_level;
+        }
+    }
+}
+
+/**
+ * \fn      appl_dvfs_set_level
+ * \brief   Switch the system clock and re-derive the clock consumers
+ * \param   level       APPL_DVFS_LEVEL_*
+ * \return  API_RESULT  API_SUCCESS, API_FAILURE if the level is invalid
+ *                      or not usable with the BT UART baud rate
+ */
+API_RESULT appl_dvfs_set_level(UCHAR level)
+{
+    APPL_DVFS_STATS *stats;
+    UCHAR sysclk;
+    UINT16 loops;
+    UINT32 start, now;
+
+    if (APPL_DVFS_NUM_LEVELS <= level) {
+        return API_FAILURE;
+    }
+    if (level == appl_dvfs_level) {
+        return API_SUCCESS;
+    }
+
+    stats = &appl_dvfs_stats[level];
+    sysclk = appl_dvfs_get_sysclk(level);
+
+    /* The BT UART needs divisors at the new clock for the rate in use and
+     * for the rate restored by the next bluetooth on */
+    if ((TRUE !=
+         sdk_host_uart_baudrate_supported(current_bt_uart_baudrate, sysclk))
+        || (TRUE !=
+            sdk_host_uart_baudrate_supported(BT_UART_CONFIG_BAUDRATE,
+                                             sysclk))) {
+        stats->refused_count++;
+        return API_FAILURE;
+    }
+
+    /* Hold the controller off, and give a byte already on the line ~200 us
+     * to be received. Only the idle hook asserts RTS again. */
+    UART_DISABLE_BT_UART_RTS();
+    for (loops = halBoardGetSystemClockMHz(sys_clk_frequency); loops > 0;
+         loops--) {
+        __delay_cycles(200);
+    }
+
+    __disable_interrupt();
+    start = portGET_TIMESTAMP();
+
+    /* Let the last byte leave the BT UART at the old rate */
+    while ((*(bt_uart_config.uart_reg_ucaxstat)) & UCBUSY);
+
+    /* The DCO settling time spans several ticks */
+    portTICK_HOLD();
+
+    /* VCore is raised before and lowered after the frequency change */
+    sdk_set_frequency(sysclk);
+
+    /* Re-derive everything clocked from SMCLK or timed in MCLK cycles */
+    sdk_host_uart_reclock();
+    if (TRUE == sdk_usb_detected) {
+        halUsbReclock();
+    }
+#ifdef EZ430_PLATFORM
+    halI2CInit(sys_clk_frequency);
+#endif /* EZ430_PLATFORM */
+    appl_motor_set_clock(halBoardGetSystemClockMHz(sys_clk_frequency));
+
+    portTICK_RELEASE();
+
+    now = portGET_TIMESTAMP();
+    appl_dvfs_stats[appl_dvfs_level].residency +=
+        (now - appl_dvfs_level_start);
+    appl_dvfs_level_start = now;
+    appl_dvfs_level = level;
+
+    stats->switch_last = (UINT16) (now - start);
+    if (stats->switch_last > stats->switch_max) {
+        stats->switch_max = stats->switch_last;
+    }
+    stats->entry_count++;
+
+    __enable_interrupt();
+
+    return API_SUCCESS;
+}
+
+/**
+ * \fn      appl_dvfs_get_level
+ * \brief   Returns the current clock level
+ * \param   void
+ * \return  UCHAR       APPL_DVFS_LEVEL_*
+ */
+UCHAR appl_dvfs_get_level(void)
+{
+    return appl_dvfs_level;
+}
+
+/**
+ * \fn      appl_dvfs_get_report
+ * \brief   Compute the power/latency report of a clock level
+ * \param   level       APPL_DVFS_LEVEL_*
+ * \param   report      Filled with the report
+ * \return  API_RESULT  API_SUCCESS/API_FAILURE
+ */
+API_RESULT appl_dvfs_get_report(UCHAR level, APPL_DVFS_REPORT * report)
+{
+    APPL_DVFS_STATS stats;
+    UCHAR sysclk;
+
+    if ((APPL_DVFS_NUM_LEVELS <= level) || (NULL == report)) {
+        return API_FAILURE;
+    }
+
+    __disable_interrupt();
+    memcpy(&stats, &appl_dvfs_stats[level], sizeof(stats));
+    if (level == appl_dvfs_level) {
+        stats.residency += (portGET_TIMESTAMP() - appl_dvfs_level_start);
+    }
+    __enable_interrupt();
+
+    sysclk = appl_dvfs_get_sysclk(level);
+
+    /* 32768 counts per second: whole seconds first to stay within 32 bits */
+    report->residency_ms = ((stats.residency >> 15) * 1000) +
+        (((stats.residency & 0x7FFF) * 1000) >> 15);
+    report->active_ua = appl_dvfs_active_ua[sysclk];
+    report->switch_last_us = (UINT16) appl_dvfs_to_us(stats.switch_last);
+    report->switch_max_us = (UINT16) appl_dvfs_to_us(stats.switch_max);
+    report->entry_count = stats.entry_count;
+    report->refused_count = stats.refused_count;
+    report->mhz = halBoardGetSystemClockMHz(sysclk);
+
+    /* F5438 runs at a fixed VCore level 2 */
+    report->vcore = PMMCOREV_2;
+    if (Get_Device_Type() == F5438A) {
+        switch (sysclk) {
+        case SYSCLK_25MHZ:
+            report->vcore = VCORE_25MHZ;
+            break;
+        case SYSCLK_20MHZ:
+            report->vcore = VCORE_20MHZ;
+            break;
+        case SYSCLK_18MHZ:
+            report->vcore = VCORE_18MHZ;
+            break;
+        case SYSCLK_16MHZ:
+            report->vcore = VCORE_16MHZ;
+            break;
+        case SYSCLK_12MHZ:
+            report->vcore = VCORE_12MHZ;
+            break;
+        default:
+            report->vcore = VCORE_8MHZ;
+            break;
+        }
+    }
+
+    return API_SUCCESS;
+}
+
+/**
+ * \fn      appl_dvfs_dump
+ * \brief   Print the report of all the levels on the USB serial port
+ * \param   void
+ * \return  void
+ */
+void appl_dvfs_dump(void)
+{
+    APPL_DVFS_REPORT report;
+    UCHAR level;
+
+    if (TRUE != sdk_usb_detected) {
+        return;
+    }
+
+    halUsbSendString("\nClock levels\n");
+    for (level = 0; level < APPL_DVFS_NUM_LEVELS; level++) {
+        (void)appl_dvfs_get_report(level, &report);
+        halUsbSendString((const UCHAR *)appl_dvfs_level_name[level]);
+        halUsbSendNumber((const UCHAR *)" MHz=", report.mhz);
+        halUsbSendNumber((const UCHAR *)" vcore=", report.vcore);
+        halUsbSendNumber((const UCHAR *)" uA=", report.active_ua);
+        halUsbSendNumber((const UCHAR *)" ms=", report.residency_ms);
+        halUsbSendNumber((const UCHAR *)" n=", report.entry_count);
+        halUsbSendNumber((const UCHAR *)" switch_us=", report.switch_last_us);
+        halUsbSendNumber((const UCHAR *)" max_us=", report.switch_max_us);
+        halUsbSendNumber((const UCHAR *)" refused=", report.refused_count);
+        halUsbSendChar('\n');
+    }
+}
+
+
+/**
+ * \fn      appl_dvfs_get_sysclk
+ * \brief   Returns the system clock of a level
+ * \param   level       APPL_DVFS_LEVEL_*
+ * \return  UCHAR       SYSCLK_xxMHZ
+ */
+static UCHAR appl_dvfs_get_sysclk(UCHAR level)
+{
+    switch (level) {
+    case APPL_DVFS_LEVEL_IDLE:
+        return SDK_DVFS_IDLE_CLK;
+    case APPL_DVFS_LEVEL_DRIVE:
+        /* VCore of the F5438 stays at level 2: 25 MHz is out of reach */
+        if ((Get_Device_Type() != F5438A) &&
+            (SDK_DVFS_DRIVE_CLK > SYSCLK_18MHZ)) {
+            return SYSCLK_18MHZ;
+        }
+        return SDK_DVFS_DRIVE_CLK;
+    default:
+        return SYSTEM_CLK;
+    }
+}
+
+/**
+ * \fn      appl_dvfs_to_us
+ * \brief   Convert ACLK counts to microseconds
+ * \param   counts      Duration in ACLK counts
+ * \return  UINT32      Duration in microseconds
+ */
+static UINT32 appl_dvfs_to_us(UINT32 counts)
+{
+    /* 1000000 / 32768 = 15625 / 512 */
+    return (counts * 15625UL) / 512;
+}
+
+#endif /* SDK_DVFS */
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    appl_dvfs.h
+ * \brief   This file contains the declarations of the system clock scaling
+ *          service.
+ *
+ *          The MSP430 boots at SYSTEM_CLK, runs at SDK_DVFS_IDLE_CLK with
+ *          VCore lowered while no SPP link is connected and at
+ *          SDK_DVFS_DRIVE_CLK during a drive session. Every clock change
+ *          re-derives the settings of the SMCLK/MCLK consumers with
+ *          interrupts disabled: BT UART divisors, USB UART divisors, I2C
+ *          divider and motor pulse lengths. Timer1_A3 and the RTOS tick run
+ *          on ACLK and are left untouched.
+ */
+
+#ifndef _H_APPL_DVFS_
+#define _H_APPL_DVFS_
+
+/* Header File Inclusion */
+#include "appl_sdk.h"
+
+#ifdef SDK_DVFS
+
+/* Clock levels */
+/* SYSTEM_CLK, until the controller is up */
+#define APPL_DVFS_LEVEL_BOOT            0x00
+/* SDK_DVFS_IDLE_CLK, no SPP link */
+#define APPL_DVFS_LEVEL_IDLE            0x01
+/* SDK_DVFS_DRIVE_CLK, SPP link connected */
+#define APPL_DVFS_LEVEL_DRIVE           0x02
+#define APPL_DVFS_NUM_LEVELS            0x03
+
+/* Power/latency report of one clock level */
+typedef struct {
+    /* Time spent at the level (ms) */
+    UINT32 residency_ms;
+    /* Nominal active mode current at the level (uA, datasheet typical) */
+    UINT16 active_ua;
+    /* Switch into the level: interrupts disabled, UARTs held (us) */
+    UINT16 switch_last_us;
+    UINT16 switch_max_us;
+    /* Number of switches into the level */
+    UINT16 entry_count;
+    /* Switches refused: a clock consumer has no settings at the level */
+    UINT16 refused_count;
+    /* Clock frequency (MHz) and VCore level (PMMCOREV_x) */
+    UCHAR mhz;
+    UCHAR vcore;
+} APPL_DVFS_REPORT;
+
+#endif /* SDK_DVFS */
+
+/* ----------------------------------------------- Functions */
+#ifdef SDK_DVFS
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * \fn      appl_dvfs_update
+     * \brief   Pick the clock level from the SPP link states; the change is
+     *          applied by the user task
+     * \param   void
+     * \return  void
+     */
+    void appl_dvfs_update(void);
+
+    /**
+     * \fn      appl_dvfs_poll
+     * \brief   Apply a pending clock level change; called from the user task
+     * \param   void
+     * \return  void
+     */
+    void appl_dvfs_poll(void);
+
+    /**
+     * \fn      appl_dvfs_set_level
+     * \brief   Switch the system clock and re-derive the clock consumers
+     * \param   level       APPL_DVFS_LEVEL_*
+     * \return  API_RESULT  API_SUCCESS, API_FAILURE if the level is invalid
+     *                      or not usable with the BT UART baud rate
+     */
+    API_RESULT appl_dvfs_set_level(UCHAR level);
+
+    /**
+     * \fn      appl_dvfs_get_level
+     * \brief   Returns the current clock level
+     * \param   void
+     * \return  UCHAR       APPL_DVFS_LEVEL_*
+     */
+    UCHAR appl_dvfs_get_level(void);
+
+    /**
+     * \fn      appl_dvfs_get_report
+     * \brief   Compute the power/latency report of a clock level
+     * \param   level       APPL_DVFS_LEVEL_*
+     * \param   report      Filled with the report
+     * \return  API_RESULT  API_SUCCESS/API_FAILURE
+     */
+    API_RESULT appl_dvfs_get_report(UCHAR level, APPL_DVFS_REPORT * report);
+
+    /**
+     * \fn      appl_dvfs_dump
+     * \brief   Print the report of all the levels on the USB serial port
+     * \param   void
+     * \return  void
+     */
+    void appl_dvfs_dump(void);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* SDK_DVFS */
+
+#endif /* _H_APPL_DVFS_ */
@@ -0,0 +1,338 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    appl_peer.c
+ * \brief   This file contains the multi-peer SPP mode: the driving token and
+ *          the telemetry stream to the observers, with per-peer TX flow
+ *          control.
+ */
+
+/* Header File Inclusion */
+#include "appl_peer.h"
+#include "appl_spp.h"
+#include "l2cap.h"
+#include "task.h"
+
+#ifdef SDK_MULTI_PEER
+
+/* No peer holds the token */
+#define APPL_PEER_NONE                  SPP_MAX_ENTITY
+
+/* Lock/unlock: the queues are used by the BT read task and the user task */
+#define appl_peer_lock(state)           \
+    { (state) = __get_interrupt_state(); __disable_interrupt(); }
+#define appl_peer_unlock(state)         __set_interrupt_state(state)
+
+/* Extern variables */
+/* spp connections status information */
+extern SDK_SPP_CONNECTION_STATUS sdk_status[];
+/* Based on the L2CAP Tx Buffer Flow this state will be set */
+extern UCHAR appl_l2cap_tx_buf_state;
+
+/* Telemetry queue of an observer */
+typedef struct {
+    /* Frame handed to SPP, kept until SPP_SEND_CNF */
+    APPL_PEER_TELEMETRY sent;
+
+    /* Newest frame not sent yet */
+    APPL_PEER_TELEMETRY next;
+
+    /* TRUE if next is valid */
+    UCHAR waiting;
+
+    /* TRUE until SPP_SEND_CNF for sent */
+    UCHAR in_flight;
+
+    /* Other sends queued on the link before sent (role replies, reports):
+     * their SPP_SEND_CNF come first */
+    UCHAR ahead;
+
+} APPL_PEER_TX;
+
+/* Static variables */
+/* sdk_status[] index of the driver, APPL_PEER_NONE if the token is free */
+static UCHAR appl_peer_driver = APPL_PEER_NONE;
+static APPL_PEER_TX appl_peer_tx[SPP_MAX_ENTITY];
+static UINT16 appl_peer_seq;
+/* Token reply, written once per command */
+static UCHAR appl_peer_role[SPP_MAX_ENTITY];
+
+/* Static Function Declarations */
+static UCHAR appl_peer_is_drive_command(UCHAR command);
+static void appl_peer_reply_role(UCHAR index);
+static void appl_peer_tx_kick(UCHAR index);
+
+
+/**
+ * \fn      appl_peer_init
+ * \brief   Free the token and clear the telemetry queues
+ * \param   void
+ * \return  void
+ */
+void appl_peer_init(void)
+{
+    unsigned short state;
+
+    appl_peer_lock(state);
+    appl_peer_driver = APPL_PEER_NONE;
+    memset(appl_peer_tx, 0, sizeof(appl_peer_tx));
+    appl_peer_seq = 0;
+    appl_peer_unlock(state);
+}
+
+/**
+ * \fn      appl_peer_connected
+ * \brief   SPP connected: the peer drives if the token is free
+ * \param   index       sdk_status[] index
+ * \return  void
+ */
+void appl_peer_connected(UCHAR index)
+{
+    unsigned short state;
+
+    appl_peer_lock(state);
+    appl_peer_tx[index].waiting = FALSE;
+    appl_peer_tx[index].in_flight = FALSE;
+    if ((APPL_PEER_NONE == appl_peer_driver) ||
+        (!SDK_IS_SPP_CONNECTED(appl_peer_driver))) {
+        appl_peer_driver = index;
+    }
+    appl_peer_unlock(state);
+
+    sdk_display("Peer %d connected as %s\n", index,
+                (index == appl_peer_driver) ? "driver" : "observer");
+}
+
+/**
+ * \fn      appl_peer_disconnected
+ * \brief   SPP disconnected: free the token if held, drop the telemetry
+ * \param   index       sdk_status[] index
+ * \return  void
+ */
+void appl_peer_disconnected(UCHAR index)
+{
+    unsigned short state;
+
+    appl_peer_lock(state);
+    appl_peer_tx[index].waiting = FALSE;
+    appl_peer_tx[index].in_flight = FALSE;
+    if (index == appl_peer_driver) {
+        /* Not passed on: an observer has to take it with 'g' */
+        appl_peer_driver = APPL_PEER_NONE;
+    }
+    appl_peer_unlock(state);
+}
+
+/**
+ * \fn      appl_peer_command
+ * \brief   Arbitrate a command received from a peer
+ * \param   index       sdk_status[] index
+ * \param   command     First byte of the received data
+ * \return  UCHAR       TRUE: execute it, FALSE: drop it
+ */
+UCHAR appl_peer_command(UCHAR index, UCHAR command)
+{
+    unsigned short state;
+
+    switch (command) {
+    case APPL_PEER_CMD_GRAB:
+        appl_peer_lock(state);
+        if ((APPL_PEER_NONE == appl_peer_driver) ||
+            (!SDK_IS_SPP_CONNECTED(appl_peer_driver))) {
+            appl_peer_driver = index;
+        }
+        appl_peer_unlock(state);
+        appl_peer_reply_role(index);
+        return FALSE;
+
+    case APPL_PEER_CMD_RELEASE:
+        appl_peer_lock(state);
+        if (index == appl_peer_driver) {
+            appl_peer_driver = APPL_PEER_NONE;
+        }
+        appl_peer_unlock(state);
+        appl_peer_reply_role(index);
+        return FALSE;
+
+    default:
+        /* Only the driver drives, everyone may ask for the reports */
+        if ((TRUE == appl_peer_is_drive_command(command)) &&
+            (index != appl_peer_driver)) {
+            sdk_display("Drive command from observer %d dropped\n", index);
+            return FALSE;
+        }
+        return TRUE;
+    }
+}
+
+/**
+ * \fn      appl_peer_telemetry
+ * \brief   Stream an executed drive command to the observers
+ * \param   index       sdk_status[] index of the sender
+ * \param   command     Drive command
+ * \return  void
+ */
+void appl_peer_telemetry(UCHAR index, UCHAR command)
+{
+    APPL_PEER_TX *tx;
+    unsigned short state;
+    UCHAR peer;
+
+    if ((index != appl_peer_driver) ||
+        (TRUE != appl_peer_is_drive_command(command))) {
+        return;
+    }
+
+    appl_peer_lock(state);
+    appl_peer_seq++;
+    for (peer = 0; peer < SPP_MAX_ENTITY; peer++) {
+        if ((peer == index) || (!SDK_IS_SPP_CONNECTED(peer))) {
+            continue;
+        }
+        tx = &appl_peer_tx[peer];
+        /* The newest frame replaces the one still waiting */
+        if ((TRUE == tx->waiting) && (0xFF != tx->next.dropped)) {
+            tx->next.dropped++;
+        }
+        tx->next.type = APPL_PEER_TELEMETRY_TYPE;
+        tx->next.command = command;
+        tx->next.driver = index;
+        tx->next.seq = appl_peer_seq;
+        tx->next.tick = (UINT16) xTaskGetTickCount();
+        tx->waiting = TRUE;
+    }
+    appl_peer_unlock(state);
+
+    for (peer = 0; peer < SPP_MAX_ENTITY; peer++) {
+        appl_peer_tx_kick(peer);
+    }
+}
+
+/**
+ * \fn      appl_peer_send_cnf
+ * \brief   SPP data sent to a peer: if it was the telemetry frame, send the
+ *          waiting one
+ * \param   index       sdk_status[] index
+ * \return  void
+ */
+void appl_peer_send_cnf(UCHAR index)
+{
+    APPL_PEER_TX *tx = &appl_peer_tx[index];
+    unsigned short state;
+
+    appl_peer_lock(state);
+    if (TRUE == tx->in_flight) {
+        if (0 == tx->ahead) {
+            tx->in_flight = FALSE;
+        } else {
+            tx->ahead--;
+        }
+    }
+    appl_peer_unlock(state);
+
+    appl_peer_tx_kick(index);
+}
+
+/**
+ * \fn      appl_peer_flow_on
+ * \brief   L2CAP TX queue flow on: send the waiting telemetry frames
+ * \param   void
+ * \return  void
+ */
+void appl_peer_flow_on(void)
+{
+    UCHAR peer;
+
+    for (peer = 0; peer < SPP_MAX_ENTITY; peer++) {
+        appl_peer_tx_kick(peer);
+    }
+}
+
+/**
+ * \fn      appl_peer_menu_index
+ * \brief   Connection the buttons act on: the driver, else a free instance to
+ *          connect a new driver, else the first peer
+ * \param   void
+ * \return  UCHAR       sdk_status[] index
+ */
+UCHAR appl_peer_menu_index(void)
+{
+    UCHAR index;
+
+    if ((APPL_PEER_NONE != appl_peer_driver) &&
+        (!SDK_IS_DISCONNECTED(appl_peer_driver))) {
+        return appl_peer_driver;
+    }
+
+    if (API_SUCCESS == appl_get_free_status_instance(&index)) {
+        return index;
+    }
+
+    return 0;
+}
+
+
+/**
+ * \fn      appl_peer_is_drive_command
+ * \brief   Is the command one of the motor commands ?
+ * \param   command     First byte of the received data
+ * \return  UCHAR       TRUE/FALSE
+ */
+static UCHAR appl_peer_is_drive_command(UCHAR command)
+{
+    return (((command >= 'a') && (command <= 'd')) ||
+            ((command >= '0') && (command <= '3')) ||
+            ((command >= 'x') && (command <= 'z'))) ? TRUE : FALSE;
+}
+
+/**
+ * \fn      appl_peer_reply_role
+ * \brief   Answer a token command with the role of the peer
+ * \param   index       sdk_status[] index
+ * \return  void
+ */
+static void appl_peer_reply_role(UCHAR index)
+{
+    appl_peer_role[index] = (index == appl_peer_driver) ?
+        APPL_PEER_ROLE_DRIVER : APPL_PEER_ROLE_OBSERVER;
+    (void)appl_spp_write(index, &appl_peer_role[index], 1);
+}
+
+/**
+ * \fn      appl_peer_tx_kick
+ * \brief   Send the waiting telemetry frame of an observer if it has none in
+ *          the L2CAP queue and the queue is not flowed off
+ * \param   index       sdk_status[] index
+ * \return  void
+ */
+static void appl_peer_tx_kick(UCHAR index)
+{
+    APPL_PEER_TX *tx = &appl_peer_tx[index];
+    unsigned short state;
+
+    appl_peer_lock(state);
+    if ((TRUE != tx->waiting) || (TRUE == tx->in_flight) ||
+        (L2CAP_TX_QUEUE_FLOW_ON != appl_l2cap_tx_buf_state) ||
+        (!SDK_IS_SPP_CONNECTED(index))) {
+        appl_peer_unlock(state);
+        return;
+    }
+    tx->sent = tx->next;
+    tx->next.dropped = 0;
+    tx->waiting = FALSE;
+    tx->in_flight = TRUE;
+    tx->ahead = appl_spp_tx_pending(index);
+    appl_peer_unlock(state);
+
+    if (API_SUCCESS != appl_spp_write(index, (UCHAR *)&tx->sent,
+                                      sizeof(APPL_PEER_TELEMETRY))) {
+        appl_peer_lock(state);
+        tx->in_flight = FALSE;
+        /* Counted in the next frame */
+        if (0xFF != tx->next.dropped) {
+            tx->next.dropped++;
+        }
+        appl_peer_unlock(state);
+    }
+}
+
+#endif /* SDK_MULTI_PEER */
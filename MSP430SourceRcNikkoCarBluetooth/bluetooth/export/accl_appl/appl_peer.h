@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    appl_peer.h
+ * \brief   This file contains the declarations of the multi-peer SPP mode.
+ *
+ *          One SPP peer holds the driving token, the other connected peers
+ *          are observers. Drive commands are only executed for the driver;
+ *          each one accepted is streamed as a telemetry frame to the
+ *          observers. The first peer to connect while the token is free
+ *          becomes the driver. The token is then only passed explicitly: the
+ *          driver releases it with 'r' or by disconnecting, a peer takes a
+ *          free token with 'g'. Both commands are answered with the role of
+ *          the peer.
+ *
+ *          An observer has at most one telemetry frame in the L2CAP queue
+ *          and one waiting; newer frames replace the waiting one. The
+ *          waiting frames are sent from SPP_SEND_CNF and from the L2CAP TX
+ *          queue flow callback, so a slow observer never holds buffers the
+ *          driver needs and never delays the drive command path.
+ */
+
+#ifndef _H_APPL_PEER_
+#define _H_APPL_PEER_
+
+/* Header File Inclusion */
+#include "appl_sdk.h"
+
+#ifdef SDK_MULTI_PEER
+
+/* Token commands, and the role sent back in reply */
+#define APPL_PEER_CMD_GRAB              'g'
+#define APPL_PEER_CMD_RELEASE           'r'
+#define APPL_PEER_ROLE_DRIVER           'D'
+#define APPL_PEER_ROLE_OBSERVER         'O'
+
+/* First byte of a telemetry frame */
+#define APPL_PEER_TELEMETRY_TYPE        'T'
+
+/* Telemetry frame, sent to the observers for each drive command executed */
+typedef struct {
+    /* APPL_PEER_TELEMETRY_TYPE */
+    UCHAR type;
+
+    /* Drive command */
+    UCHAR command;
+
+    /* sdk_status[] index of the driver */
+    UCHAR driver;
+
+    /* Frames this observer missed, saturating */
+    UCHAR dropped;
+
+    /* Frame sequence number, a gap tells the frames missed */
+    UINT16 seq;
+
+    /* RTOS tick of the command */
+    UINT16 tick;
+
+} APPL_PEER_TELEMETRY;
+
+#endif /* SDK_MULTI_PEER */
+
+/* ----------------------------------------------- Functions */
+#ifdef SDK_MULTI_PEER
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * \fn      appl_peer_init
+     * \brief   Free the token and clear the telemetry queues
+     * \param   void
+     * \return  void
+     */
+    void appl_peer_init(void);
+
+    /**
+     * \fn      appl_peer_connected
+     * \brief   SPP connected: the peer drives if the token is free
+     * \param   index       sdk_status[] index
+     * \return  void
+     */
+    void appl_peer_connected(UCHAR index);
+
+    /**
+     * \fn      appl_peer_disconnected
+     * \brief   SPP disconnected: free the token if held, drop the telemetry
+     * \param   index       sdk_status[] index
+     * \return  void
+     */
+    void appl_peer_disconnected(UCHAR index);
+
+    /**
+     * \fn      appl_peer_command
+     * \brief   Arbitrate a command received from a peer
+     * \param   index       sdk_status[] index
+     * \param   command     First byte of the received data
+     * \return  UCHAR       TRUE: execute it, FALSE: drop it
+     */
+    UCHAR appl_peer_command(UCHAR index, UCHAR command);
+
+    /**
+     * \fn      appl_peer_telemetry
+     * \brief   Stream an executed drive command to the observers
+     * \param   index       sdk_status[] index of the sender
+     * \param   command     Drive command
+     * \return  void
+     */
+    void appl_peer_telemetry(UCHAR index, UCHAR command);
+
+    /**
+     * \fn      appl_peer_send_cnf
+     * \brief   SPP data sent to a peer: send its waiting telemetry frame
+     * \param   index       sdk_status[] index
+     * \return  void
+     */
+    void appl_peer_send_cnf(UCHAR index);
+
+    /**
+     * \fn      appl_peer_flow_on
+     * \brief   L2CAP TX queue flow on: send the waiting telemetry frames
+     * \param   void
+     * \return  void
+     */
+    void appl_peer_flow_on(void);
+
+    /**
+     * \fn      appl_peer_menu_index
+     * \brief   Connection the buttons act on: the driver, else a free
+     *          instance to connect a new driver, else the first peer
+     * \param   void
+     * \return  UCHAR       sdk_status[] index
+     */
+    UCHAR appl_peer_menu_index(void);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* SDK_MULTI_PEER */
+
+#endif /* _H_APPL_PEER_ */
@@ -0,0 +1,461 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    appl_reconnect.c
+ * \brief   This file contains the fast reconnect cache: the last BlueMSP
+ *          peers are paged directly with their cached page parameters and
+ *          SPP server channel, the inquiry and SDP only run when this fails.
+ *
+ *          The cache is kept in the information memory segment A, so it
+ *          survives a power cycle. The segment holds a few copies of the
+ *          cache one after the other: a new copy goes in the first blank
+ *          slot, the segment is erased when they are all used. The last
+ *          copy with a valid magic and checksum is the current one; a copy
+ *          cut by a reset is skipped. The cache is only written when it
+ *          changed and a connection came up, not on every inquiry result.
+ */
+
+/* Header File Inclusion */
+#include "appl_reconnect.h"
+#include "hal_MSP430F5438.h"
+
+#ifdef SDK_FAST_RECONNECT
+
+/* Marks a cache written by this firmware */
+#define APPL_RECONNECT_MAGIC            0x5243
+/* Clock offset valid flag of HCI_Create_Connection */
+#define APPL_RECONNECT_CLOCK_OFFSET_VALID   0x8000
+/* Page scan repetition mode when the peer was not found by inquiry: R1 */
+#define APPL_RECONNECT_DEFAULT_PSRM     0x01
+
+/* Information memory segment A */
+#define APPL_RECONNECT_FLASH_START      0x1980
+#define APPL_RECONNECT_SEGMENT_SIZE     128
+/* Copies of the cache in the segment */
+#define APPL_RECONNECT_NUM_SLOTS        \
+    (APPL_RECONNECT_SEGMENT_SIZE / sizeof(APPL_RECONNECT_CACHE))
+#define APPL_RECONNECT_SLOT(slot)       \
+    ((volatile UINT16 *)(APPL_RECONNECT_FLASH_START + \
+                         (slot) * sizeof(APPL_RECONNECT_CACHE)))
+
+/* Erased flash word */
+#define APPL_RECONNECT_ERASED           0xFFFF
+
+/**
+ * Program one flash word, erase segment A. LOCKA toggles when written with
+ * 1: it is cleared for the operation and set again after it.
+ */
+#define APPL_RECONNECT_FLASH_PROGRAM(address, word) \
+    { \
+        FCTL3 = FWKEY + (FCTL3 & LOCKA); \
+        FCTL1 = FWKEY + WRT; \
+        *(address) = (word); \
+        FCTL1 = FWKEY; \
+        FCTL3 = FWKEY + LOCK + LOCKA; \
+    }
+#define APPL_RECONNECT_FLASH_ERASE(address) \
+    { \
+        FCTL3 = FWKEY + (FCTL3 & LOCKA); \
+        FCTL1 = FWKEY + ERASE; \
+        *(address) = 0; \
+        FCTL1 = FWKEY; \
+        FCTL3 = FWKEY + LOCK + LOCKA; \
+    }
+
+/* Extern variables */
+/* spp connections status information */
+extern SDK_SPP_CONNECTION_STATUS sdk_status[];
+/* Inquiry results */
+extern SDK_REM_BD_DEVICES rem_bt_dev[];
+extern UCHAR rem_dev_num;
+
+/* Cache, most recent peer first; a whole number of flash words */
+typedef struct {
+    UINT16 magic;
+    UCHAR num;
+    UCHAR reserved;
+    APPL_RECONNECT_ENTRY entry[SDK_RECONNECT_CACHE_SIZE];
+    UINT16 checksum;
+} APPL_RECONNECT_CACHE;
+
+/* Static variables */
+/* RAM copy of the cache */
+static APPL_RECONNECT_CACHE appl_reconnect_cache;
+/* Has the RAM copy changed since it was written to flash ? */
+static UCHAR appl_reconnect_dirty = FALSE;
+
+/* Fast reconnect page in progress, its peer and its cache index */
+static UCHAR appl_reconnect_pending = FALSE;
+static UCHAR appl_reconnect_pending_addr[BT_BD_ADDR_SIZE];
+static UCHAR appl_reconnect_try;
+
+/* Static Function Declarations */
+static API_RESULT appl_reconnect_page(void);
+static UINT16 appl_reconnect_checksum(APPL_RECONNECT_CACHE * cache);
+static UCHAR appl_reconnect_find(UCHAR * bd_addr);
+static void appl_reconnect_store(void);
+static UCHAR appl_reconnect_slot_is_blank(UCHAR slot);
+
+
+/**
+ * \fn      appl_reconnect_init
+ * \brief   Load the last valid cache from the information memory
+ * \param   void
+ * \return  void
+ */
+void appl_reconnect_init(void)
+{
+    APPL_RECONNECT_CACHE *copy;
+    UCHAR slot;
+
+    appl_reconnect_cache.magic = APPL_RECONNECT_MAGIC;
+    appl_reconnect_cache.num = 0;
+    appl_reconnect_cache.reserved = 0;
+
+    for (slot = APPL_RECONNECT_NUM_SLOTS; slot > 0; slot--) {
+        copy = (APPL_RECONNECT_CACHE *) APPL_RECONNECT_SLOT(slot - 1);
+        if ((APPL_RECONNECT_MAGIC == copy->magic) &&
+            (copy->num <= SDK_RECONNECT_CACHE_SIZE) &&
+            (appl_reconnect_checksum(copy) == copy->checksum)) {
+            appl_reconnect_cache = *copy;
+            break;
+        }
+    }
+
+    appl_reconnect_cache.checksum =
+        appl_reconnect_checksum(&appl_reconnect_cache);
+    appl_reconnect_dirty = FALSE;
+    appl_reconnect_pending = FALSE;
+}
+
+/**
+ * \fn      appl_reconnect_start
+ * \brief   Page the cached peers, most recent first
+ * \param   void
+ * \return  API_RESULT  API_SUCCESS if the page was started, API_FAILURE if
+ *                      the caller has to run the full discovery
+ */
+API_RESULT appl_reconnect_start(void)
+{
+    appl_reconnect_try = 0;
+
+    return appl_reconnect_page();
+}
+
+/**
+ * \fn      appl_reconnect_next
+ * \brief   The page failed: page the next cached peer
+ * \param   void
+ * \return  API_RESULT  API_SUCCESS if the page was started, API_FAILURE if
+ *                      the caller has to run the full discovery
+ */
+API_RESULT appl_reconnect_next(void)
+{
+    appl_reconnect_try++;
+
+    return appl_reconnect_page();
+}
+
+/**
+ * \fn      appl_reconnect_acl_complete
+ * \brief   ACL connection up: is it the fast reconnect page ?
+ * \param   bd_addr     Peer address
+ * \param   server_ch   [OUT] Cached SPP server channel
+ * \return  UCHAR       TRUE: open SPP on server_ch, FALSE: run SDP
+ */
+UCHAR appl_reconnect_acl_complete(UCHAR * bd_addr, UCHAR * server_ch)
+{
+    APPL_RECONNECT_ENTRY entry;
+    UCHAR index;
+
+    if ((FALSE == appl_reconnect_pending) ||
+        (0 != memcmp(appl_reconnect_pending_addr, bd_addr, BT_BD_ADDR_SIZE))) {
+        return FALSE;
+    }
+    appl_reconnect_pending = FALSE;
+
+    index = appl_reconnect_find(bd_addr);
+    if (index == appl_reconnect_cache.num) {
+        return FALSE;
+    }
+    *server_ch = appl_reconnect_cache.entry[index].server_ch;
+
+    /* The peer becomes the most recent one */
+    if (index > 0) {
+        entry = appl_reconnect_cache.entry[index];
+        for (; index > 0; index--) {
+            appl_reconnect_cache.entry[index] =
+                appl_reconnect_cache.entry[index - 1];
+        }
+        appl_reconnect_cache.entry[0] = entry;
+        appl_reconnect_dirty = TRUE;
+    }
+    appl_reconnect_store();
+
+    return TRUE;
+}
+
+/**
+ * \fn      appl_reconnect_acl_failed
+ * \brief   ACL connection failed: was it the fast reconnect page ?
+ * \param   bd_addr     Peer address
+ * \return  UCHAR       TRUE: page the next cached peer with
+ *                      appl_reconnect_next()
+ */
+UCHAR appl_reconnect_acl_failed(UCHAR * bd_addr)
+{
+    if ((FALSE == appl_reconnect_pending) ||
+        (0 != memcmp(appl_reconnect_pending_addr, bd_addr, BT_BD_ADDR_SIZE))) {
+        return FALSE;
+    }
+    appl_reconnect_pending = FALSE;
+
+    sdk_display("Cached peer not reachable\n");
+    return TRUE;
+}
+
+/**
+ * \fn      appl_reconnect_page_info
+ * \brief   Refresh the page parameters of a cached peer from an inquiry result
+ * \param   bd_addr     Peer address
+ * \param   page_scan_rep_mode  Page scan repetition mode
+ * \param   clock_offset        Clock offset
+ * \return  void
+ */
+void appl_reconnect_page_info(UCHAR * bd_addr, UCHAR page_scan_rep_mode,
+                              UINT16 clock_offset)
+{
+    UCHAR index;
+
+    index = appl_reconnect_find(bd_addr);
+    if (index < appl_reconnect_cache.num) {
+        appl_reconnect_cache.entry[index].page_scan_rep_mode =
+            page_scan_rep_mode;
+        appl_reconnect_cache.entry[index].clock_offset = clock_offset;
+        /* Written to flash with the next connection */
+        appl_reconnect_dirty = TRUE;
+    }
+}
+
+/**
+ * \fn      appl_reconnect_save
+ * \brief   Cache a peer as the most recent one, with the SPP server channel
+ *          found by SDP
+ * \param   bd_addr     Peer address
+ * \param   server_ch   SPP server channel
+ * \return  void
+ */
+void appl_reconnect_save(UCHAR * bd_addr, UCHAR server_ch)
+{
+    APPL_RECONNECT_ENTRY entry;
+    UCHAR index;
+    UCHAR dev;
+
+    BT_mem_copy(entry.bd_addr, bd_addr, BT_BD_ADDR_SIZE);
+    entry.server_ch = server_ch;
+    entry.page_scan_rep_mode = APPL_RECONNECT_DEFAULT_PSRM;
+    entry.clock_offset = 0;
+
+    index = appl_reconnect_find(bd_addr);
+    if (index < appl_reconnect_cache.num) {
+        /* Keep the page parameters already cached for the peer */
+        entry.page_scan_rep_mode =
+            appl_reconnect_cache.entry[index].page_scan_rep_mode;
+        entry.clock_offset = appl_reconnect_cache.entry[index].clock_offset;
+    } else {
+        /* New peer: take a free entry, or the least recent peer goes */
+        if (appl_reconnect_cache.num < SDK_RECONNECT_CACHE_SIZE) {
+            appl_reconnect_cache.num++;
+        }
+        index = appl_reconnect_cache.num - 1;
+    }
+
+    /* Take the fresh page parameters if the peer was found by inquiry */
+    for (dev = 0; dev < rem_dev_num; dev++) {
+        if (0 == memcmp(rem_bt_dev[dev].bd_addr, bd_addr, BT_BD_ADDR_SIZE)) {
+            entry.page_scan_rep_mode = rem_bt_dev[dev].page_scan_rep_mode;
+            entry.clock_offset = rem_bt_dev[dev].clock_offset;
+            break;
+        }
+    }
+
+    /* Move the more recent peers one down, the peer goes first */
+    for (; index > 0; index--) {
+        appl_reconnect_cache.entry[index] =
+            appl_reconnect_cache.entry[index - 1];
+    }
+    appl_reconnect_cache.entry[0] = entry;
+
+    appl_reconnect_dirty = TRUE;
+    appl_reconnect_store();
+}
+
+/**
+ * \fn      appl_reconnect_page
+ * \brief   Page the cached peer appl_reconnect_try
+ * \param   void
+ * \return  API_RESULT  API_SUCCESS if the page was started
+ */
+static API_RESULT appl_reconnect_page(void)
+{
+    APPL_RECONNECT_ENTRY *entry;
+    API_RESULT retval;
+    UCHAR dev_index;
+
+    if (appl_reconnect_try >= appl_reconnect_cache.num) {
+        return API_FAILURE;
+    }
+
+    if (API_SUCCESS != appl_get_free_status_instance(&dev_index)) {
+        return API_FAILURE;
+    }
+
+    entry = &appl_reconnect_cache.entry[appl_reconnect_try];
+    sdk_display("Paging cached peer %02X:%02X:%02X:%02X:%02X:%02X ... ",
+                entry->bd_addr[0], entry->bd_addr[1], entry->bd_addr[2],
+                entry->bd_addr[3], entry->bd_addr[4], entry->bd_addr[5]);
+
+    retval =
+        BT_hci_create_connection(entry->bd_addr, SDK_CONFIG_ACL_PKT_TYPE,
+                                 entry->page_scan_rep_mode, 0,
+                                 entry->clock_offset |
+                                 APPL_RECONNECT_CLOCK_OFFSET_VALID, 0x01);
+    if (API_SUCCESS != retval) {
+        sdk_display("** FAILED ** !! Reason Code = 0x%04X\n", retval);
+        return API_FAILURE;
+    }
+    sdk_display("OK.\n");
+
+    /* Populate the connection instance with bd_addr */
+    appl_set_status_bd_addr(dev_index, entry->bd_addr);
+    SDK_SPP_CHANGE_STATE(dev_index, SDK_IN_ACL_CONNECTION);
+
+    BT_mem_copy(appl_reconnect_pending_addr, entry->bd_addr, BT_BD_ADDR_SIZE);
+    appl_reconnect_pending = TRUE;
+
+    return API_SUCCESS;
+}
+
+/**
+ * \fn      appl_reconnect_find
+ * \brief   Find a cached peer
+ * \param   bd_addr     Peer address
+ * \return  UCHAR       Cache index, appl_reconnect_cache.num if not cached
+ */
+static UCHAR appl_reconnect_find(UCHAR * bd_addr)
+{
+    UCHAR index;
+
+    for (index = 0; index < appl_reconnect_cache.num; index++) {
+        if (0 == memcmp(appl_reconnect_cache.entry[index].bd_addr, bd_addr,
+                        BT_BD_ADDR_SIZE)) {
+            break;
+        }
+    }
+
+    return index;
+}
+
+/**
+ * \fn      appl_reconnect_store
+ * \brief   Write the cache to the first blank slot of segment A if it
+ *          changed, erasing the segment when no slot is left
+ * \param   void
+ * \return  void
+ */
+static void appl_reconnect_store(void)
+{
+    volatile UINT16 *address;
+    UINT16 *word;
+    unsigned short state;
+    UCHAR slot;
+    UCHAR index;
+
+    if (FALSE == appl_reconnect_dirty) {
+        return;
+    }
+    appl_reconnect_dirty = FALSE;
+    appl_reconnect_cache.checksum =
+        appl_reconnect_checksum(&appl_reconnect_cache);
+
+    for (slot = 0; slot < APPL_RECONNECT_NUM_SLOTS; slot++) {
+        if (TRUE == appl_reconnect_slot_is_blank(slot)) {
+            break;
+        }
+    }
+
+    if (APPL_RECONNECT_NUM_SLOTS == slot) {
+        /* The CPU is held while the segment is erased (~25 ms) */
+        state = __get_interrupt_state();
+        __disable_interrupt();
+        UART_DISABLE_BT_UART_RTS();
+
+        APPL_RECONNECT_FLASH_ERASE(APPL_RECONNECT_SLOT(0));
+
+        __set_interrupt_state(state);
+        slot = 0;
+    }
+
+    address = APPL_RECONNECT_SLOT(slot);
+    word = (UINT16 *) & appl_reconnect_cache;
+    for (index = 0; index < (sizeof(APPL_RECONNECT_CACHE) / 2); index++) {
+        /* The CPU is held while the word is programmed (~85 us) */
+        state = __get_interrupt_state();
+        __disable_interrupt();
+        UART_DISABLE_BT_UART_RTS();
+
+        APPL_RECONNECT_FLASH_PROGRAM(&address[index], word[index]);
+
+        __set_interrupt_state(state);
+    }
+
+    if (0 != memcmp((const void *)address, &appl_reconnect_cache,
+                    sizeof(APPL_RECONNECT_CACHE))) {
+        /* Left invalid in flash: the previous copy stays the current one */
+        sdk_display("Reconnect cache not saved\n");
+    }
+}
+
+/**
+ * \fn      appl_reconnect_slot_is_blank
+ * \brief   Check that a slot of segment A is erased
+ * \param   slot        Slot index
+ * \return  UCHAR       TRUE if erased
+ */
+static UCHAR appl_reconnect_slot_is_blank(UCHAR slot)
+{
+    volatile UINT16 *address;
+    UCHAR index;
+
+    address = APPL_RECONNECT_SLOT(slot);
+    for (index = 0; index < (sizeof(APPL_RECONNECT_CACHE) / 2); index++) {
+        if (APPL_RECONNECT_ERASED != address[index]) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * \fn      appl_reconnect_checksum
+ * \brief   Checksum of a copy of the cache, the checksum field excluded
+ * \param   cache       Copy of the cache, in RAM or in flash
+ * \return  UINT16      Checksum
+ */
+static UINT16 appl_reconnect_checksum(APPL_RECONNECT_CACHE * cache)
+{
+    UCHAR *p;
+    UINT16 sum;
+    UINT16 index;
+
+    p = (UCHAR *) cache;
+    sum = 0;
+    for (index = 0;
+         index < (UINT16) ((UCHAR *) & cache->checksum - p); index++) {
+        sum = (UINT16) ((sum << 1) | (sum >> 15)) + p[index];
+    }
+
+    return sum;
+}
+
+#endif /* SDK_FAST_RECONNECT */
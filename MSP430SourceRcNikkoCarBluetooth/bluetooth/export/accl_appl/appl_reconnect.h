@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    appl_reconnect.h
+ * \brief   This file contains the declarations of the fast reconnect cache.
+ *
+ *          The page parameters and the SPP server channel of the last
+ *          SDK_RECONNECT_CACHE_SIZE BlueMSP peers are kept in the information
+ *          memory, across power cycles. A connection attempt first pages the
+ *          cached peers directly, most recent first, and opens RFCOMM on the
+ *          cached channel, skipping the inquiry, the remote name requests
+ *          and the SDP query. If no cached peer answers the page the full
+ *          discovery runs; if the SPP connection fails the SDP query runs on
+ *          the open ACL link and refreshes the channel.
+ */
+
+#ifndef _H_APPL_RECONNECT_
+#define _H_APPL_RECONNECT_
+
+/* Header File Inclusion */
+#include "appl_sdk.h"
+
+#ifdef SDK_FAST_RECONNECT
+
+/* Cached peer */
+typedef struct {
+    /* Remote Device Bluetooth address */
+    UCHAR bd_addr[BT_BD_ADDR_SIZE];
+
+    /* Remote Device Clock offset, as in the inquiry result */
+    UINT16 clock_offset;
+
+    /* Remote Device page scan mode */
+    UCHAR page_scan_rep_mode;
+
+    /* Remote SPP server channel */
+    UCHAR server_ch;
+
+} APPL_RECONNECT_ENTRY;
+
+#endif /* SDK_FAST_RECONNECT */
+
+/* ----------------------------------------------- Functions */
+#ifdef SDK_FAST_RECONNECT
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * \fn      appl_reconnect_init
+     * \brief   Load the last valid cache from the information memory
+     * \param   void
+     * \return  void
+     */
+    void appl_reconnect_init(void);
+
+    /**
+     * \fn      appl_reconnect_start
+     * \brief   Page the cached peers, most recent first
+     * \param   void
+     * \return  API_RESULT  API_SUCCESS if the page was started, API_FAILURE
+     *                      if the caller has to run the full discovery
+     */
+    API_RESULT appl_reconnect_start(void);
+
+    /**
+     * \fn      appl_reconnect_next
+     * \brief   The page failed: page the next cached peer
+     * \param   void
+     * \return  API_RESULT  API_SUCCESS if the page was started, API_FAILURE
+     *                      if the caller has to run the full discovery
+     */
+    API_RESULT appl_reconnect_next(void);
+
+    /**
+     * \fn      appl_reconnect_acl_complete
+     * \brief   ACL connection up: is it the fast reconnect page ?
+     * \param   bd_addr     Peer address
+     * \param   server_ch   [OUT] Cached SPP server channel
+     * \return  UCHAR       TRUE: open SPP on server_ch, FALSE: run SDP
+     */
+    UCHAR appl_reconnect_acl_complete(UCHAR * bd_addr, UCHAR * server_ch);
+
+    /**
+     * \fn      appl_reconnect_acl_failed
+     * \brief   ACL connection failed: was it the fast reconnect page ?
+     * \param   bd_addr     Peer address
+     * \return  UCHAR       TRUE: page the next cached peer with
+     *                      appl_reconnect_next()
+     */
+    UCHAR appl_reconnect_acl_failed(UCHAR * bd_addr);
+
+    /**
+     * \fn      appl_reconnect_page_info
+     * \brief   Refresh the page parameters of a cached peer from an inquiry
+     *          result
+     * \param   bd_addr     Peer address
+     * \param   page_scan_rep_mode  Page scan repetition mode
+     * \param   clock_offset        Clock offset
+     * \return  void
+     */
+    void appl_reconnect_page_info(UCHAR * bd_addr, UCHAR page_scan_rep_mode,
+                                  UINT16 clock_offset);
+
+    /**
+     * \fn      appl_reconnect_save
+     * \brief   Cache a peer as the most recent one, with the SPP server
+     *          channel found by SDP
+     * \param   bd_addr     Peer address
+     * \param   server_ch   SPP server channel
+     * \return  void
+     */
+    void appl_reconnect_save(UCHAR * bd_addr, UCHAR server_ch);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* SDK_FAST_RECONNECT */
+
+#endif /* _H_APPL_RECONNECT_ */
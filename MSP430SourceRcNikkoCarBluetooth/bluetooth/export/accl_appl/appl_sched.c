@@ -0,0 +1,298 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    appl_sched.c
+ * \brief   This file contains the application job scheduler: the periodic
+ *          and one-shot application jobs share Timer1_A3, whose compare
+ *          match is programmed for the nearest deadline.
+ */
+
+/* Header File Inclusion */
+#include "appl_sched.h"
+#include "bt_sdk_error.h"
+
+/* Extern variables */
+extern UINT32 sdk_error_code;
+
+/**
+ * Longest compare distance, scheduler counts. The 32 bit scheduler time is
+ * extended from TA1R on each interrupt and API call, so while a job is
+ * active the timer is read before it wraps (16 s).
+ */
+#define APPL_SCHED_MAX_DELTA            0xC000
+/* Shortest compare distance, so the compare is not set behind TA1R */
+#define APPL_SCHED_MIN_DELTA            2
+
+/* Lock/unlock: the jobs are started and stopped from nested interrupts */
+#define appl_sched_lock(state)          \
+    { (state) = __get_interrupt_state(); __disable_interrupt(); }
+#define appl_sched_unlock(state)        __set_interrupt_state(state)
+
+/* Static variables */
+/* Jobs started at least once */
+static APPL_SCHED_JOB *appl_sched_jobs[APPL_SCHED_MAX_JOBS];
+static UCHAR appl_sched_num_jobs = 0;
+/* Scheduler time, and the TA1R value it was last extended from */
+static UINT32 appl_sched_time = 0;
+static UINT16 appl_sched_last_tar = 0;
+
+/* Static Function Declarations */
+static UINT32 appl_sched_now(void);
+static void appl_sched_program(void);
+
+
+/**
+ * \fn      appl_sched_init
+ * \brief   Start Timer1_A3 for the scheduler, with no job due
+ * \param   void
+ * \return  void
+ */
+void appl_sched_init(void)
+{
+    TA1CCTL0 = 0;
+    TA1CTL = TASSEL_1 + ID_3 + MC_2 + TACLR;
+
+    appl_sched_time = 0;
+    appl_sched_last_tar = 0;
+}
+
+/**
+ * \fn      appl_sched_job_init
+ * \brief   Set up a job, stopped
+ * \param   job         Job, owned by the caller
+ * \param   callback    Called in the Timer1 interrupt when the job is due
+ * \return  void
+ */
+void appl_sched_job_init(APPL_SCHED_JOB * job,
+                         void (*callback) (signed portBASE_TYPE *))
+{
+    job->callback = callback;
+    job->due = 0;
+    job->period = 0;
+    job->active = FALSE;
+}
+
+/**
+ * \fn      appl_sched_start
+ * \brief   Start a job, or restart it if it is active
+ * \param   job         Job set up by appl_sched_job_init()
+ * \param   delay       Scheduler counts to the first deadline
+ * \param   period      Scheduler counts between deadlines, 0: one-shot
+ * \return  void
+ */
+void appl_sched_start(APPL_SCHED_JOB * job, UINT32 delay, UINT32 period)
+{
+    unsigned short state;
+    UCHAR index;
+
+    appl_sched_lock(state);
+
+    for (index = 0; index < appl_sched_num_jobs; index++) {
+        if (job == appl_sched_jobs[index]) {
+            break;
+        }
+    }
+    if (index == appl_sched_num_jobs) {
+        if (APPL_SCHED_MAX_JOBS == appl_sched_num_jobs) {
+            appl_sched_unlock(state);
+            sdk_error_code = SDK_SCHED_FULL;
+            sdk_error_handler();
+            return;
+        }
+        appl_sched_jobs[appl_sched_num_jobs++] = job;
+    }
+
+    job->due = appl_sched_now() + delay;
+    job->period = period;
+    job->active = TRUE;
+    appl_sched_program();
+
+    appl_sched_unlock(state);
+}
+
+/**
+ * \fn      appl_sched_stop
+ * \brief   Stop a job; it is not called until started again
+ * \param   job         Job
+ * \return  void
+ */
+void appl_sched_stop(APPL_SCHED_JOB * job)
+{
+    unsigned short state;
+
+    appl_sched_lock(state);
+    job->active = FALSE;
+    appl_sched_program();
+    appl_sched_unlock(state);
+}
+
+/**
+ * \fn      appl_sched_suspend
+ * \brief   Halt the scheduler clock on entering LPM; the jobs keep their
+ *          remaining time
+ * \param   void
+ * \return  void
+ */
+void appl_sched_suspend(void)
+{
+    unsigned short state;
+
+    appl_sched_lock(state);
+    /* Account for the time up to the halt, TA1R then stays put */
+    (void)appl_sched_now();
+    TA1CTL &= ~MC_3;
+    appl_sched_unlock(state);
+}
+
+/**
+ * \fn      appl_sched_resume
+ * \brief   Restart the scheduler clock on exiting LPM
+ * \param   void
+ * \return  void
+ */
+void appl_sched_resume(void)
+{
+    unsigned short state;
+
+    appl_sched_lock(state);
+    TA1CTL |= MC_2;
+    appl_sched_program();
+    appl_sched_unlock(state);
+}
+
+/**
+ * \fn      appl_sched_now
+ * \brief   Extend TA1R to the 32 bit scheduler time. Called with the
+ *          interrupts disabled.
+ * \param   void
+ * \return  UINT32      Scheduler time
+ */
+static UINT32 appl_sched_now(void)
+{
+    UINT16 tar;
+
+    /* ACLK is asynchronous to MCLK: read until two reads agree */
+    do {
+        tar = TA1R;
+    } while (tar != TA1R);
+
+    appl_sched_time += (UINT16)(tar - appl_sched_last_tar);
+    appl_sched_last_tar = tar;
+
+    return appl_sched_time;
+}
+
+/**
+ * \fn      appl_sched_program
+ * \brief   Set the Timer1 compare match for the nearest deadline, or turn
+ *          it off if no job is active. Called with the interrupts disabled.
+ * \param   void
+ * \return  void
+ */
+static void appl_sched_program(void)
+{
+    UINT32 now;
+    UINT32 delta;
+    UINT32 nearest;
+    UCHAR index;
+
+    now = appl_sched_now();
+    nearest = APPL_SCHED_MAX_DELTA;
+
+    for (index = 0; index < appl_sched_num_jobs; index++) {
+        if (TRUE == appl_sched_jobs[index]->active) {
+            if ((INT32)(appl_sched_jobs[index]->due - now) <= 0) {
+                nearest = 0;
+                break;
+            }
+            delta = appl_sched_jobs[index]->due - now;
+            if (delta < nearest) {
+                nearest = delta;
+            }
+        }
+    }
+
+    if (index == appl_sched_num_jobs) {
+        /* No job due now: is any job active at all ? */
+        for (index = 0; index < appl_sched_num_jobs; index++) {
+            if (TRUE == appl_sched_jobs[index]->active) {
+                break;
+            }
+        }
+        if (index == appl_sched_num_jobs) {
+            TA1CCTL0 = 0;
+            return;
+        }
+    }
+
+    if (nearest < APPL_SCHED_MIN_DELTA) {
+        nearest = APPL_SCHED_MIN_DELTA;
+    }
+    TA1CCR0 = appl_sched_last_tar + (UINT16)nearest;
+    TA1CCTL0 = CCIE;
+}
+
+/**
+ * \fn      TIMER1_A0_ISR
+ * \brief   Interrupt routine for Timer1_A3: run the due jobs and set the
+ *          compare match for the next deadline
+ * \param   void
+ * \return  void
+ */
+#ifndef __IAR_SYSTEMS_ICC__
+#pragma CODE_SECTION(TIMER1_A0_ISR, ".text:_isr");
+#endif /* __IAR_SYSTEMS_ICC__ */
+#pragma vector=TIMER1_A0_VECTOR
+__interrupt void TIMER1_A0_ISR(void)
+{
+    signed portBASE_TYPE xHigherPriorityTaskWoken;
+    APPL_SCHED_JOB *job;
+    unsigned short state;
+    UINT32 now;
+    UCHAR index;
+    UCHAR due;
+
+    UART_DISABLE_BT_UART_RTS();
+    xHigherPriorityTaskWoken = pdFALSE;
+
+    /* The compare is set again below */
+    TA1CCTL0 = 0;
+    __bis_SR_register(GIE);
+
+    for (index = 0; index < appl_sched_num_jobs; index++) {
+        job = appl_sched_jobs[index];
+        due = FALSE;
+
+        appl_sched_lock(state);
+        now = appl_sched_now();
+        if ((TRUE == job->active) && ((INT32)(job->due - now) <= 0)) {
+            due = TRUE;
+            if (0 == job->period) {
+                job->active = FALSE;
+            } else {
+                job->due += job->period;
+                /* Late by more than a period (LPM exit): no burst */
+                if ((INT32)(job->due - now) <= 0) {
+                    job->due = now + job->period;
+                }
+            }
+        }
+        appl_sched_unlock(state);
+
+        /* The callback may start or stop any job, itself included */
+        if (TRUE == due) {
+            job->callback(&xHigherPriorityTaskWoken);
+        }
+    }
+
+    appl_sched_lock(state);
+    appl_sched_program();
+    appl_sched_unlock(state);
+
+    /* End a tickless idle sleep so the tick count is corrected */
+    portTICKLESS_EXIT_LPM();
+
+    /* Force a context switch if xHigherPriorityTaskWoken was set to true */
+    if (xHigherPriorityTaskWoken) {
+        portYIELD();
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    appl_sched.h
+ * \brief   This file contains the declarations of the application job
+ *          scheduler.
+ *
+ *          Timer1_A3 counts ACLK/8 in continuous mode and CCR0 is set to the
+ *          nearest job deadline, so the processor is only woken when a job is
+ *          due and not at all while no job is active. A job is periodic or
+ *          one-shot, its callback runs in the Timer1 interrupt. Start and
+ *          stop may be called from tasks and interrupts.
+ */
+
+#ifndef _H_APPL_SCHED_
+#define _H_APPL_SCHED_
+
+/* Header File Inclusion */
+#include "appl_sdk.h"
+
+/* Scheduler clock: ACLK / 8 */
+#define APPL_SCHED_HZ                   4096UL
+
+/* Delays and periods to scheduler counts, rounded up */
+#define APPL_SCHED_MS(ms)               \
+    ((((UINT32)(ms) * APPL_SCHED_HZ) + 999) / 1000)
+#define APPL_SCHED_SEC(s)               ((UINT32)(s) * APPL_SCHED_HZ)
+
+/* Number of jobs the scheduler can hold */
+#define APPL_SCHED_MAX_JOBS             6
+
+/* Job */
+typedef struct {
+    /* Called in the Timer1 interrupt when the job is due */
+    void (*callback) (signed portBASE_TYPE * pxHigherPriorityTaskWoken);
+    /* Deadline, scheduler counts */
+    UINT32 due;
+    /* Period, scheduler counts, 0 for a one-shot job */
+    UINT32 period;
+    /* Is the job waiting for its deadline ? */
+    volatile UCHAR active;
+} APPL_SCHED_JOB;
+
+/* ----------------------------------------------- Functions */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * \fn      appl_sched_init
+     * \brief   Start Timer1_A3 for the scheduler, with no job due
+     * \param   void
+     * \return  void
+     */
+    void appl_sched_init(void);
+
+    /**
+     * \fn      appl_sched_job_init
+     * \brief   Set up a job, stopped
+     * \param   job         Job, owned by the caller
+     * \param   callback    Called in the Timer1 interrupt when the job is due
+     * \return  void
+     */
+    void appl_sched_job_init(APPL_SCHED_JOB * job,
+                             void (*callback) (signed portBASE_TYPE *));
+
+    /**
+     * \fn      appl_sched_start
+     * \brief   Start a job, or restart it if it is active
+     * \param   job         Job set up by appl_sched_job_init()
+     * \param   delay       Scheduler counts to the first deadline
+     * \param   period      Scheduler counts between deadlines, 0: one-shot
+     * \return  void
+     */
+    void appl_sched_start(APPL_SCHED_JOB * job, UINT32 delay, UINT32 period);
+
+    /**
+     * \fn      appl_sched_stop
+     * \brief   Stop a job; it is not called until started again
+     * \param   job         Job
+     * \return  void
+     */
+    void appl_sched_stop(APPL_SCHED_JOB * job);
+
+    /**
+     * \fn      appl_sched_suspend
+     * \brief   Halt the scheduler clock on entering LPM; the jobs keep their
+     *          remaining time
+     * \param   void
+     * \return  void
+     */
+    void appl_sched_suspend(void);
+
+    /**
+     * \fn      appl_sched_resume
+     * \brief   Restart the scheduler clock on exiting LPM
+     * \param   void
+     * \return  void
+     */
+    void appl_sched_resume(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* _H_APPL_SCHED_ */
@@ -11,6 +11,11 @@
 #include "appl_sdk.h"
 #include "l2cap.h"
 #include "appl_bt_rf.h"
+#include "appl_dvfs.h"
+#include "conn_arena.h"
+#include "appl_reconnect.h"
+#include "appl_peer.h"
+#include "wake_latency.h"
 
 /* Extern Variables */
 
@@ -25,6 +30,10 @@ extern UCHAR sdk_bt_power;
 
 /* BT Discovery On/Off Status */
 extern UCHAR sdk_bt_visible;
+#ifdef SDK_EIR_DISCOVERY
+/* Local device name */
+extern CHAR sdk_local_name[];
+#endif /* SDK_EIR_DISCOVERY */
 /* Static Variables */
 static UCHAR appl_spp_data_buffer[4];
 
@@ -40,6 +49,48 @@ SDK_REM_BD_DEVICES rem_bt_dev[SDK_INQ_MAX_DEVICES];
 /* Flag to indicate sniff mode is requested after the SPP connection */
 UCHAR sdk_sniff_mode_requested = FALSE;
 
+/* Discovery state */
+/* No discovery, or stopped on a match */
+#define APPL_INQUIRY_IDLE               0x00
+/* Inquiry running, names resolved as the results come in */
+#define APPL_INQUIRY_RUNNING            0x01
+/* Inquiry over, names of the remaining devices resolved */
+#define APPL_INQUIRY_RESOLVING          0x02
+
+static UCHAR appl_inquiry_state = APPL_INQUIRY_IDLE;
+/* Remote name request outstanding for rem_bt_dev[rem_dev_index] */
+static UCHAR appl_inquiry_name_pending = FALSE;
+/* Cleared when the controller refuses a name request during the inquiry */
+static UCHAR appl_inquiry_name_early = TRUE;
+/* rem_bt_dev[] index + 1 by BD_ADDR hash, 0 for a free slot */
+static UCHAR appl_inquiry_hash[SDK_INQ_HASH_SIZE];
+
+#ifdef SDK_EIR_DISCOVERY
+/* Inquiry mode: results with RSSI or with extended inquiry response */
+#define APPL_INQUIRY_MODE_EIR           0x02
+#define APPL_INQUIRY_LEN                SDK_EIR_INQUIRY_LEN
+/* RSSI of a standard inquiry result */
+#define APPL_INQUIRY_RSSI_MIN           (-127)
+
+/* rem_bt_dev[] index of the strongest BlueMSP430Demo device */
+static UCHAR appl_inquiry_best;
+#else /* SDK_EIR_DISCOVERY */
+#define APPL_INQUIRY_LEN                SDK_INQUIRY_LEN
+#endif /* SDK_EIR_DISCOVERY */
+
+/* Static Function Declarations */
+static UCHAR appl_inquiry_find(UCHAR * bd_addr);
+static UCHAR appl_inquiry_store(UCHAR slot, UCHAR * bd_addr,
+                                UCHAR page_scan_rep_mode,
+                                UINT16 clock_offset);
+static void appl_inquiry_next_name(void);
+static void appl_inquiry_connect(UCHAR dev);
+#ifdef SDK_EIR_DISCOVERY
+static void appl_inquiry_eir_init(void);
+static UCHAR appl_inquiry_eir_name(UCHAR * eir);
+static UCHAR appl_inquiry_rank(UCHAR dev);
+#endif /* SDK_EIR_DISCOVERY */
+
 void appl_specific_init(void)
 {
     /* Creating User Task */
@@ -58,6 +109,11 @@ void sdk_appl_init(void)
 {
     UCHAR index;
 
+#ifdef SDK_CONN_STATS
+    /* Before the first connection state change is timed */
+    conn_stats_init();
+#endif /* SDK_CONN_STATS */
+
     /* Bluetooth Power On/Off Status Flag */
     sdk_bt_power = SDK_BT_OFF;
 
@@ -67,6 +123,7 @@ void sdk_appl_init(void)
     for (index = 0; index < SPP_MAX_ENTITY; index++) {
         /* Initialize the spp connection state */
         SDK_SPP_CHANGE_STATE(index, SDK_DISCONNECTED);
+        conn_arena_reset(index);
         /* Initialize the spp data transfer state */
         SDK_SPP_CHANGE_TX_STATE(index, SDK_SPP_TX_OFF);
 #ifdef SDK_ENABLE_SNIFF_MODE
@@ -79,6 +136,15 @@ void sdk_appl_init(void)
 #ifdef SDK_EHCILL_MODE
     init_ehcill_params();
 #endif /* SDK_EHCILL_MODE */
+#ifdef SDK_WAKE_LATENCY_STATS
+    wake_latency_init();
+#endif /* SDK_WAKE_LATENCY_STATS */
+#ifdef SDK_FAST_RECONNECT
+    appl_reconnect_init();
+#endif /* SDK_FAST_RECONNECT */
+#ifdef SDK_MULTI_PEER
+    appl_peer_init();
+#endif /* SDK_MULTI_PEER */
 
 }
 
@@ -92,6 +158,14 @@ void sdk_appl_init(void)
 void sdk_bluetooth_menu_handler(UCHAR input)
 {
     API_RESULT retval;
+    UCHAR index;
+
+#ifdef SDK_MULTI_PEER
+    /* The buttons act on the driver's link, never on an observer's */
+    index = appl_peer_menu_index();
+#else /* SDK_MULTI_PEER */
+    index = 0;
+#endif /* SDK_MULTI_PEER */
 
     /**
      * Only option will be SPP Connect, Which initiates Inquiry looks for
@@ -101,31 +175,29 @@ void sdk_bluetooth_menu_handler(UCHAR input)
     case OP_PEER_CONNECT:      /* Connect/Disconnect Button Pressed */
         if (SDK_IS_BT_POWERED_ON()) {
             /* Check if SPP is already connected */
-            if (SDK_IS_DISCONNECTED(0)) {
+            if (SDK_IS_DISCONNECTED(index)) {
                 /* SPP not connected, so initiate connection */
                 /* Set the initiator flag */
                 sdk_initiator = TRUE;
                 /* SPP Connection started, set the flag */
                 sdk_connect_in_progress = TRUE;
-                /* Initiate Inquiry */
-                retval =
-                    BT_hci_inquiry(SDK_INQUIRY_LAP, SDK_INQUIRY_LEN,
-                                   SDK_NUM_RESPONSES);
-                if (retval != API_SUCCESS) {
-                    sdk_display((const UCHAR *)"Failed to initiate Inquiry\n");
-                } else {
-                    rem_dev_index = rem_dev_num = 0;
-                    sdk_display((const UCHAR *)
-                                "Inquiry Started...Wait for Completion\n");
+                sdk_update_indication();
+#ifdef SDK_FAST_RECONNECT
+                /* Page the last known peer, inquire only if there is none */
+                if (API_SUCCESS != appl_reconnect_start())
+#endif /* SDK_FAST_RECONNECT */
+                {
+                    /* Initiate Inquiry */
+                    appl_start_inquiry();
                 }
-            } else if (SDK_IS_SPP_CONNECTED(0)) {
+            } else if (SDK_IS_SPP_CONNECTED(index)) {
                 /* SPP connected, so initiate disconnection */
 #ifdef SDK_ENABLE_SNIFF_MODE
                 /* Check if sniff mode is active */
-                if (SDK_IS_IN_SNIFF_MODE(0)) {
+                if (SDK_IS_IN_SNIFF_MODE(index)) {
                     /* Exit the sniff mode for disconnection */
                     retval =
-                        BT_hci_exit_sniff_mode(sdk_status[0].
+                        BT_hci_exit_sniff_mode(sdk_status[index].
                                                acl_connection_handle);
                     if (retval != API_SUCCESS) {
                         sdk_display((const UCHAR *)
@@ -134,31 +206,31 @@ void sdk_bluetooth_menu_handler(UCHAR input)
                         sdk_display((const UCHAR *)"Exiting sniff mode\n");
 
                         /* Change spp connection state */
-                        SDK_SPP_CHANGE_STATE(0, SDK_IN_SPP_DISCONNECTION);
+                        SDK_SPP_CHANGE_STATE(index, SDK_IN_SPP_DISCONNECTION);
                         break;
                     }
                 }
 #endif /* SDK_ENABLE_SNIFF_MODE */
                 /* Initiate Disconnection */
-                appl_spp_disconnect(0);
+                appl_spp_disconnect(index);
 
                 /* On Success */
-                SDK_SPP_CHANGE_STATE(0, SDK_IN_SPP_DISCONNECTION);
+                SDK_SPP_CHANGE_STATE(index, SDK_IN_SPP_DISCONNECTION);
             }
         }
         break;
     case OP_PEER_DATASEND:
     {
         /* Dtasend stop and pause toggle button presses */
-        if (SDK_IS_SPP_CONNECTED(0)) {
-            if (SDK_IS_SPP_TX_STARTED(0)) {
+        if (SDK_IS_SPP_CONNECTED(index)) {
+            if (SDK_IS_SPP_TX_STARTED(index)) {
                 /* Stop Sending Data */
-                SDK_SPP_CHANGE_TX_STATE(0, SDK_SPP_TX_OFF);
+                SDK_SPP_CHANGE_TX_STATE(index, SDK_SPP_TX_OFF);
 
             } else {
                 /* Start Sending Data */
-                SDK_SPP_CHANGE_TX_STATE(0, SDK_SPP_TX_ON);
-                appl_send_spp_data(0);
+                SDK_SPP_CHANGE_TX_STATE(index, SDK_SPP_TX_ON);
+                appl_send_spp_data(index);
             }
 
         } else {
@@ -170,6 +242,482 @@ void sdk_bluetooth_menu_handler(UCHAR input)
 
 }
 
+/**
+ * \fn      appl_start_inquiry
+ * \brief   Start the inquiry for the BlueMSP430Demo device
+ * \param   void
+ * \return  void
+ */
+void appl_start_inquiry(void)
+{
+    API_RESULT retval;
+
+    retval =
+        BT_hci_inquiry(SDK_INQUIRY_LAP, APPL_INQUIRY_LEN, SDK_NUM_RESPONSES);
+    if (retval != API_SUCCESS) {
+        appl_inquiry_state = APPL_INQUIRY_IDLE;
+        sdk_display((const UCHAR *)"Failed to initiate Inquiry\n");
+    } else {
+        rem_dev_index = rem_dev_num = 0;
+        memset(appl_inquiry_hash, 0, sizeof(appl_inquiry_hash));
+        appl_inquiry_state = APPL_INQUIRY_RUNNING;
+        appl_inquiry_name_pending = FALSE;
+        appl_inquiry_name_early = TRUE;
+#ifdef SDK_EIR_DISCOVERY
+        appl_inquiry_best = SDK_INQ_MAX_DEVICES;
+#endif /* SDK_EIR_DISCOVERY */
+        sdk_display((const UCHAR *)"Inquiry Started...Wait for Completion\n");
+    }
+}
+
+/**
+ * \fn      appl_inquiry_add_device
+ * \brief   Note a device from an inquiry result, unless already noted, and
+ *          resolve its name if no name request is outstanding
+ * \param   bd_addr     Device address
+ * \param   page_scan_rep_mode  Page scan repetition mode
+ * \param   clock_offset        Clock offset
+ * \return  UCHAR       TRUE if the device is new
+ */
+UCHAR appl_inquiry_add_device(UCHAR * bd_addr, UCHAR page_scan_rep_mode,
+                              UINT16 clock_offset)
+{
+    UCHAR slot;
+
+    /* Late result after the cancel on a match */
+    if (APPL_INQUIRY_RUNNING != appl_inquiry_state) {
+        return FALSE;
+    }
+
+    slot = appl_inquiry_find(bd_addr);
+    if (0 != appl_inquiry_hash[slot]) {
+        /* Remote device already noted */
+        return FALSE;
+    }
+
+    if (SDK_INQ_MAX_DEVICES ==
+        appl_inquiry_store(slot, bd_addr, page_scan_rep_mode, clock_offset)) {
+        return FALSE;
+    }
+
+    appl_inquiry_next_name();
+
+    return TRUE;
+}
+
+#ifdef SDK_EIR_DISCOVERY
+/**
+ * \fn      appl_inquiry_add_eir_device
+ * \brief   Note a device from an inquiry result with RSSI or an extended
+ *          inquiry result. A BlueMSP430Demo name in the EIR ranks the device
+ *          at once; without a name it is resolved by remote name request.
+ * \param   bd_addr     Device address
+ * \param   page_scan_rep_mode  Page scan repetition mode
+ * \param   clock_offset        Clock offset
+ * \param   rssi        RSSI, dBm
+ * \param   eir         Extended inquiry response, NULL if none
+ * \return  UCHAR       TRUE if the device is new
+ */
+UCHAR appl_inquiry_add_eir_device(UCHAR * bd_addr, UCHAR page_scan_rep_mode,
+                                  UINT16 clock_offset, CHAR rssi, UCHAR * eir)
+{
+    UCHAR slot;
+    UCHAR dev;
+
+    /* Late result after the cancel on a match */
+    if (APPL_INQUIRY_RUNNING != appl_inquiry_state) {
+        return FALSE;
+    }
+
+    slot = appl_inquiry_find(bd_addr);
+    if (0 != appl_inquiry_hash[slot]) {
+        /* Remote device already noted: take the fresh RSSI */
+        dev = appl_inquiry_hash[slot] - 1;
+        rem_bt_dev[dev].rssi = rssi;
+        if (SDK_REM_NAME_MATCH == rem_bt_dev[dev].name_state) {
+            appl_inquiry_rank(dev);
+        }
+        return FALSE;
+    }
+
+    dev = appl_inquiry_store(slot, bd_addr, page_scan_rep_mode, clock_offset);
+    if (SDK_INQ_MAX_DEVICES == dev) {
+        return FALSE;
+    }
+    rem_bt_dev[dev].rssi = rssi;
+    rem_bt_dev[dev].name_state =
+        (NULL == eir) ? SDK_REM_NAME_UNKNOWN : appl_inquiry_eir_name(eir);
+
+    sdk_display("%02X %02X %02X %02X %02X %02X --> %d dBm%s\n", bd_addr[0],
+                bd_addr[1], bd_addr[2], bd_addr[3], bd_addr[4], bd_addr[5],
+                rssi, (SDK_REM_NAME_MATCH == rem_bt_dev[dev].name_state) ?
+                " " SDK_REM_DEV_NAME_PREFIX : "");
+
+    if ((SDK_REM_NAME_MATCH == rem_bt_dev[dev].name_state) &&
+        (TRUE == appl_inquiry_rank(dev))) {
+        /* Near enough, connection started */
+        return TRUE;
+    }
+
+    appl_inquiry_next_name();
+
+    return TRUE;
+}
+#endif /* SDK_EIR_DISCOVERY */
+
+/**
+ * \fn      appl_inquiry_complete
+ * \brief   Inquiry over: resolve the names not resolved yet, or restart the
+ *          inquiry if no device was found
+ * \param   void
+ * \return  void
+ */
+void appl_inquiry_complete(void)
+{
+    /* Stopped on a match, the cancel raced with the end of the inquiry */
+    if (APPL_INQUIRY_RUNNING != appl_inquiry_state) {
+        return;
+    }
+
+    if (0 == rem_dev_num) {
+        /* No remote BT device found, so restart inquiry procedure */
+        appl_start_inquiry();
+        return;
+    }
+
+    appl_inquiry_state = APPL_INQUIRY_RESOLVING;
+#ifdef SDK_EIR_DISCOVERY
+    /* BlueMSP430Demo devices all send their name in the EIR: the devices
+     * left to resolve are not ranked above the strongest match */
+    if (SDK_INQ_MAX_DEVICES != appl_inquiry_best) {
+        appl_inquiry_connect(appl_inquiry_best);
+        return;
+    }
+#endif /* SDK_EIR_DISCOVERY */
+    appl_inquiry_next_name();
+}
+
+/**
+ * \fn      appl_inquiry_name_matched
+ * \brief   The name request found rem_bt_dev[rem_dev_index] to be a
+ *          BlueMSP430Demo device: connect, or rank it by RSSI with EIR
+ *          discovery
+ * \param   void
+ * \return  void
+ */
+void appl_inquiry_name_matched(void)
+{
+    appl_inquiry_name_pending = FALSE;
+
+    /* Discovery already stopped on a match */
+    if (APPL_INQUIRY_IDLE == appl_inquiry_state) {
+        return;
+    }
+
+#ifdef SDK_EIR_DISCOVERY
+    rem_bt_dev[rem_dev_index].name_state = SDK_REM_NAME_MATCH;
+    if (TRUE == appl_inquiry_rank(rem_dev_index)) {
+        return;
+    }
+    rem_dev_index++;
+    appl_inquiry_next_name();
+#else /* SDK_EIR_DISCOVERY */
+    appl_inquiry_connect(rem_dev_index);
+#endif /* SDK_EIR_DISCOVERY */
+}
+
+/**
+ * \fn      appl_inquiry_name_done
+ * \brief   rem_bt_dev[rem_dev_index] is not the device looked for: resolve
+ *          the next name, or restart the inquiry once all are resolved
+ * \param   void
+ * \return  void
+ */
+void appl_inquiry_name_done(void)
+{
+    appl_inquiry_name_pending = FALSE;
+    rem_dev_index++;
+    appl_inquiry_next_name();
+}
+
+/**
+ * \fn      appl_inquiry_name_failed
+ * \brief   The name request of rem_bt_dev[rem_dev_index] failed. During the
+ *          inquiry the controller may refuse to page: the names are then
+ *          resolved after the inquiry, this device included.
+ * \param   void
+ * \return  void
+ */
+void appl_inquiry_name_failed(void)
+{
+    appl_inquiry_name_pending = FALSE;
+
+    if (APPL_INQUIRY_RUNNING == appl_inquiry_state) {
+        appl_inquiry_name_early = FALSE;
+        return;
+    }
+
+    rem_dev_index++;
+    appl_inquiry_next_name();
+}
+
+/**
+ * \fn      appl_inquiry_next_name
+ * \brief   Request the name of the next discovered device
+ * \param   void
+ * \return  void
+ */
+static void appl_inquiry_next_name(void)
+{
+    API_RESULT retval;
+
+    if ((APPL_INQUIRY_IDLE == appl_inquiry_state) ||
+        (TRUE == appl_inquiry_name_pending)) {
+        return;
+    }
+    if ((APPL_INQUIRY_RUNNING == appl_inquiry_state) &&
+        (FALSE == appl_inquiry_name_early)) {
+        return;
+    }
+
+    while (rem_dev_index < rem_dev_num) {
+#ifdef SDK_EIR_DISCOVERY
+        /* Name already known from the extended inquiry response */
+        if (SDK_REM_NAME_UNKNOWN != rem_bt_dev[rem_dev_index].name_state) {
+            rem_dev_index++;
+            continue;
+        }
+#endif /* SDK_EIR_DISCOVERY */
+        retval =
+            BT_hci_remote_name_request(rem_bt_dev[rem_dev_index].bd_addr,
+                                       rem_bt_dev[rem_dev_index].
+                                       page_scan_rep_mode, 0x00,
+                                       rem_bt_dev[rem_dev_index].clock_offset);
+        if (API_SUCCESS == retval) {
+            appl_inquiry_name_pending = TRUE;
+            return;
+        }
+        sdk_display("Remote Name Request FAILED !! Error Code = 0x%04x\n",
+                    retval);
+        if (APPL_INQUIRY_RUNNING == appl_inquiry_state) {
+            appl_inquiry_name_early = FALSE;
+            return;
+        }
+        rem_dev_index++;
+    }
+
+    if (APPL_INQUIRY_RESOLVING == appl_inquiry_state) {
+#ifdef SDK_EIR_DISCOVERY
+        /* All names resolved: connect the strongest BlueMSP430Demo device */
+        if (SDK_INQ_MAX_DEVICES != appl_inquiry_best) {
+            appl_inquiry_connect(appl_inquiry_best);
+            return;
+        }
+#endif /* SDK_EIR_DISCOVERY */
+        /* Restart Inquiry as BlueMSP430Demo device is not found */
+        appl_start_inquiry();
+    }
+}
+
+/**
+ * \fn      appl_inquiry_find
+ * \brief   Look a discovered device up in the BD_ADDR hash
+ * \param   bd_addr     Device address
+ * \return  UCHAR       Hash slot holding the device, or the free slot to
+ *                      store it in
+ */
+static UCHAR appl_inquiry_find(UCHAR * bd_addr)
+{
+    UCHAR slot;
+
+    /* Linear probing; the table is larger than SDK_INQ_MAX_DEVICES */
+    slot = SDK_BD_ADDR_HASH(bd_addr, SDK_INQ_HASH_SIZE);
+    while (0 != appl_inquiry_hash[slot]) {
+        if (!memcmp(bd_addr, rem_bt_dev[appl_inquiry_hash[slot] - 1].bd_addr,
+                    BT_BD_ADDR_SIZE)) {
+            break;
+        }
+        slot = (slot + 1) & (SDK_INQ_HASH_SIZE - 1);
+    }
+
+    return slot;
+}
+
+/**
+ * \fn      appl_inquiry_store
+ * \brief   Store a new discovered device
+ * \param   slot        Free hash slot from appl_inquiry_find()
+ * \param   bd_addr     Device address
+ * \param   page_scan_rep_mode  Page scan repetition mode
+ * \param   clock_offset        Clock offset
+ * \return  UCHAR       rem_bt_dev[] index, SDK_INQ_MAX_DEVICES if full
+ */
+static UCHAR appl_inquiry_store(UCHAR slot, UCHAR * bd_addr,
+                                UCHAR page_scan_rep_mode,
+                                UINT16 clock_offset)
+{
+    if (SDK_INQ_MAX_DEVICES == rem_dev_num) {
+        /* Max remote devices limit reached */
+        return SDK_INQ_MAX_DEVICES;
+    }
+
+    /* Store the remote device details */
+    memcpy(rem_bt_dev[rem_dev_num].bd_addr, bd_addr, BT_BD_ADDR_SIZE);
+    rem_bt_dev[rem_dev_num].page_scan_rep_mode = page_scan_rep_mode;
+    rem_bt_dev[rem_dev_num].clock_offset = clock_offset;
+#ifdef SDK_EIR_DISCOVERY
+    /* Set by the caller when the result carries them */
+    rem_bt_dev[rem_dev_num].rssi = APPL_INQUIRY_RSSI_MIN;
+    rem_bt_dev[rem_dev_num].name_state = SDK_REM_NAME_UNKNOWN;
+#endif /* SDK_EIR_DISCOVERY */
+    /* Increase the count of number of devices discovered */
+    rem_dev_num++;
+    appl_inquiry_hash[slot] = rem_dev_num;
+
+    return rem_dev_num - 1;
+}
+
+/**
+ * \fn      appl_inquiry_connect
+ * \brief   Stop the discovery, cancelling the inquiry if it still runs, and
+ *          connect a BlueMSP430Demo device
+ * \param   dev         rem_bt_dev[] index
+ * \return  void
+ */
+static void appl_inquiry_connect(UCHAR dev)
+{
+    API_RESULT retval;
+    UCHAR dev_index;
+
+    if (APPL_INQUIRY_RUNNING == appl_inquiry_state) {
+        if (API_SUCCESS != BT_hci_inquiry_cancel()) {
+            sdk_display((const UCHAR *)"Failed to cancel Inquiry\n");
+        }
+    }
+    appl_inquiry_state = APPL_INQUIRY_IDLE;
+
+    /* Allocate free spp instance if available */
+    if (API_SUCCESS != appl_get_free_status_instance(&dev_index)) {
+        sdk_display("No free SPP connection instance available\n");
+        return;
+    }
+
+    retval =
+        BT_hci_create_connection(rem_bt_dev[dev].bd_addr,
+                                 SDK_CONFIG_ACL_PKT_TYPE,
+                                 rem_bt_dev[dev].page_scan_rep_mode, 0,
+                                 rem_bt_dev[dev].clock_offset, 0x01);
+    /* If already connected */
+    if (HCI_STATE_ALREADY_CONNECTED == retval) {
+        /* Initiate SDP Query */
+        appl_spp_sdp_query(dev_index);
+        SDK_SPP_CHANGE_STATE(dev_index, SDK_IN_SDP_QUERY);
+    } else if (API_SUCCESS == retval) {
+        /* Populate the connection instance with bd_addr */
+        appl_set_status_bd_addr(dev_index, rem_bt_dev[dev].bd_addr);
+        /* On Success */
+        SDK_SPP_CHANGE_STATE(dev_index, SDK_IN_ACL_CONNECTION);
+    }
+}
+
+#ifdef SDK_EIR_DISCOVERY
+/**
+ * \fn      appl_inquiry_eir_init
+ * \brief   Ask the controller for inquiry results with RSSI and EIR, and
+ *          send the local name in the local EIR
+ * \param   void
+ * \return  void
+ */
+static void appl_inquiry_eir_init(void)
+{
+    HCI_EIR_DATA eir_name;
+
+    if (API_SUCCESS != BT_hci_write_inquiry_mode(APPL_INQUIRY_MODE_EIR)) {
+        sdk_display((const UCHAR *)"Failed to set the inquiry mode\n");
+    }
+
+    eir_name.eir_data = (UCHAR *)sdk_local_name;
+    eir_name.eir_data_len = (UCHAR)strlen((char *)sdk_local_name);
+    eir_name.eir_data_type = HCI_EIR_DATA_TYPE_COMPLETE_LOCAL_NAME;
+    if (API_SUCCESS != BT_hci_write_extended_inquiry_response(0x00, &eir_name,
+                                                              1)) {
+        sdk_display((const UCHAR *)"Failed to write the EIR\n");
+    }
+}
+
+/**
+ * \fn      appl_inquiry_eir_name
+ * \brief   Check the local name field of an extended inquiry response
+ *          against SDK_REM_DEV_NAME_PREFIX
+ * \param   eir         Extended inquiry response, HCI_EIR_MAX_DATA_LEN bytes
+ * \return  UCHAR       SDK_REM_NAME_MATCH, SDK_REM_NAME_OTHER, or
+ *                      SDK_REM_NAME_UNKNOWN if the name is not in the EIR or
+ *                      shortened below the prefix
+ */
+static UCHAR appl_inquiry_eir_name(UCHAR * eir)
+{
+    UINT16 offset;
+    UCHAR field_len;
+    UCHAR name_len;
+    UCHAR prefix_len;
+
+    prefix_len = (UCHAR)strlen((char *)SDK_REM_DEV_NAME_PREFIX);
+
+    /* Fields: length, type, data; a zero length ends the significant part */
+    offset = 0;
+    while (offset < HCI_EIR_MAX_DATA_LEN - 1) {
+        field_len = eir[offset];
+        if ((0 == field_len) ||
+            ((offset + 1 + field_len) > HCI_EIR_MAX_DATA_LEN)) {
+            break;
+        }
+
+        if ((HCI_EIR_DATA_TYPE_COMPLETE_LOCAL_NAME == eir[offset + 1]) ||
+            (HCI_EIR_DATA_TYPE_SHORTENED_LOCAL_NAME == eir[offset + 1])) {
+            name_len = field_len - 1;
+            if (name_len >= prefix_len) {
+                return (0 == memcmp(&eir[offset + 2], SDK_REM_DEV_NAME_PREFIX,
+                                    prefix_len)) ?
+                    SDK_REM_NAME_MATCH : SDK_REM_NAME_OTHER;
+            }
+            if ((HCI_EIR_DATA_TYPE_COMPLETE_LOCAL_NAME == eir[offset + 1]) ||
+                (0 != memcmp(&eir[offset + 2], SDK_REM_DEV_NAME_PREFIX,
+                             name_len))) {
+                return SDK_REM_NAME_OTHER;
+            }
+            /* Shortened below the prefix: the name request decides */
+            return SDK_REM_NAME_UNKNOWN;
+        }
+
+        offset += field_len + 1;
+    }
+
+    return SDK_REM_NAME_UNKNOWN;
+}
+
+/**
+ * \fn      appl_inquiry_rank
+ * \brief   Rank a BlueMSP430Demo device by RSSI, and connect it at once if
+ *          it is nearer than SDK_EIR_NEAR_RSSI
+ * \param   dev         rem_bt_dev[] index
+ * \return  UCHAR       TRUE if the connection was started
+ */
+static UCHAR appl_inquiry_rank(UCHAR dev)
+{
+    if ((SDK_INQ_MAX_DEVICES == appl_inquiry_best) ||
+        (rem_bt_dev[dev].rssi > rem_bt_dev[appl_inquiry_best].rssi)) {
+        appl_inquiry_best = dev;
+    }
+
+    if (rem_bt_dev[dev].rssi >= SDK_EIR_NEAR_RSSI) {
+        appl_inquiry_connect(dev);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+#endif /* SDK_EIR_DISCOVERY */
+
 /**
  * \fn      appl_bluetooth_on_complete_event_handler
  * \brief   Function to handle BT on complete event.
@@ -190,6 +738,10 @@ void appl_bluetooth_on_complete_event_handler(void)
 
     sdk_display((const UCHAR *)"Bluetooth ON Initialization Completed.\n");
 
+#ifdef SDK_EIR_DISCOVERY
+    appl_inquiry_eir_init();
+#endif /* SDK_EIR_DISCOVERY */
+
     retval = BT_hci_write_scan_enable(0x03);
 
     if (API_SUCCESS != retval) {
@@ -201,10 +753,16 @@ void appl_bluetooth_on_complete_event_handler(void)
          * flashing of LED2 (Red)
          */
         sdk_bt_visible = SDK_DISC_ON;
+        sdk_update_indication();
     }
 
     /* Start the SPP Profile */
     appl_spp_start();
+
+#ifdef SDK_DVFS
+    /* Controller UART set up: drop to the idle clock until a drive session */
+    appl_dvfs_update();
+#endif /* SDK_DVFS */
 }
 
 /**
@@ -220,6 +778,9 @@ void appl_acl_connection_complete_event(UCHAR * bd_addr, UCHAR status,
 {
     UCHAR dev_index;
     API_RESULT retval;
+#ifdef SDK_FAST_RECONNECT
+    UCHAR server_ch;
+#endif /* SDK_FAST_RECONNECT */
 
     /* Check if the connection is initiated from local device */
     /* If locally initiated, check if the status is success */
@@ -233,13 +794,21 @@ void appl_acl_connection_complete_event(UCHAR * bd_addr, UCHAR status,
 
             if (SDK_IS_IN_ACL_CONNECTION(dev_index)) {
                 /* Store the ACL Handle */
-                sdk_status[dev_index].acl_connection_handle = connection_handle;
+                appl_set_status_acl_handle(dev_index, connection_handle);
 
 #ifdef SDK_ENABLE_SNIFF_MODE
-                SDK_SPP_CHANGE_LINK_STATE(dev_index, SDK_ACTIVE)
+                SDK_SPP_CHANGE_LINK_STATE(dev_index, SDK_ACTIVE);
 #endif /* SDK_ENABLE_SNIFF_MODE */
-                    /* Start the SDP Query */
-                    appl_spp_sdp_query(dev_index);
+#ifdef SDK_FAST_RECONNECT
+                /* Cached peer: open SPP on its channel, no SDP query */
+                if (TRUE == appl_reconnect_acl_complete(bd_addr, &server_ch)) {
+                    SDK_SPP_CHANGE_STATE(dev_index, SDK_ACL_CONNECTED);
+                    appl_spp_connect(bd_addr, server_ch);
+                    return;
+                }
+#endif /* SDK_FAST_RECONNECT */
+                /* Start the SDP Query */
+                appl_spp_sdp_query(dev_index);
 
                 SDK_SPP_CHANGE_STATE(dev_index, SDK_IN_SDP_QUERY);
             }
@@ -252,10 +821,8 @@ void appl_acl_connection_complete_event(UCHAR * bd_addr, UCHAR status,
              * available */
             peer_initiated_acl_connection = TRUE;
             appl_get_free_status_instance(&dev_index);
-            BT_mem_copy(sdk_status[dev_index].peer_bd_addr, bd_addr,
-                        BT_BD_ADDR_SIZE);
-
-            sdk_status[dev_index].acl_connection_handle = connection_handle;
+            appl_set_status_bd_addr(dev_index, bd_addr);
+            appl_set_status_acl_handle(dev_index, connection_handle);
             SDK_SPP_CHANGE_STATE(dev_index, SDK_ACL_CONNECTED);
 #ifdef SDK_ENABLE_SNIFF_MODE
             SDK_SPP_CHANGE_LINK_STATE(dev_index, SDK_ACTIVE);
@@ -19,8 +19,6 @@
 #include "appl_spp.h"
 #include "sdk_common.h"
 
-#define MAX_USER_BUF            20
-
 /* ----------------------------------------- Macros */
 /* Unit key types */
 #define COMBINATION_KEY         0x00
@@ -31,6 +29,13 @@
 #define MASTER_ROLE             0x00
 #define SLAVE_ROLE              0x01
 
+#ifdef SDK_EIR_DISCOVERY
+/* Remote device name state */
+#define SDK_REM_NAME_UNKNOWN    0x00
+#define SDK_REM_NAME_MATCH      0x01
+#define SDK_REM_NAME_OTHER      0x02
+#endif /* SDK_EIR_DISCOVERY */
+
 /* ----------------------------------------- Structures/Data Types */
 /* Structure to store remote bluetooth devices info found during inquiry */
 typedef struct {
@@ -43,6 +48,14 @@ typedef struct {
     /* Remote Device page scan mode */
     UCHAR page_scan_rep_mode;
 
+#ifdef SDK_EIR_DISCOVERY
+    /* Remote Device RSSI, dBm */
+    CHAR rssi;
+
+    /* Remote Device name from the EIR: SDK_REM_NAME_* */
+    UCHAR name_state;
+#endif /* SDK_EIR_DISCOVERY */
+
 } SDK_REM_BD_DEVICES;
 
 /* Structure which stores the status of the SPP Connections if any */
@@ -94,6 +107,23 @@ extern "C" {
 
     void sdk_bluetooth_menu_handler(UCHAR input);
 
+    /* Start the inquiry for the BlueMSP430Demo device */
+    void appl_start_inquiry(void);
+
+    /* Discovery: inquiry result, inquiry complete, remote name outcome */
+    UCHAR appl_inquiry_add_device(UCHAR * bd_addr, UCHAR page_scan_rep_mode,
+                                  UINT16 clock_offset);
+#ifdef SDK_EIR_DISCOVERY
+    UCHAR appl_inquiry_add_eir_device(UCHAR * bd_addr,
+                                      UCHAR page_scan_rep_mode,
+                                      UINT16 clock_offset, CHAR rssi,
+                                      UCHAR * eir);
+#endif /* SDK_EIR_DISCOVERY */
+    void appl_inquiry_complete(void);
+    void appl_inquiry_name_matched(void);
+    void appl_inquiry_name_done(void);
+    void appl_inquiry_name_failed(void);
+
     /* Function to read from sensor and send over SPP */
     void appl_send_spp_data(UCHAR rem_bt_dev_index);
 
@@ -115,12 +145,25 @@ extern "C" {
     /* Function to handle mode change event handler */
     void hci_mode_change_event_handler(UCHAR * event_data);
 
+#ifdef SDK_SNIFF_SUBRATING
+    /* Function to handle sniff subrating event handler */
+    void hci_sniff_subrating_event_handler(UCHAR * event_data);
+#endif /* SDK_SNIFF_SUBRATING */
+
     /* Function to handle inquiry complete event handler */
     void hci_inquiry_complete_event_handler(UCHAR * event_data);
 
     /* Function to handle inquiry result complete event handler */
     void hci_inquiry_result_event_handler(UCHAR * event_data);
 
+#ifdef SDK_EIR_DISCOVERY
+    /* Function to handle inquiry result with RSSI event handler */
+    void hci_inquiry_result_rssi_event_handler(UCHAR * event_data);
+
+    /* Function to handle extended inquiry result event handler */
+    void hci_extended_inquiry_result_event_handler(UCHAR * event_data);
+#endif /* SDK_EIR_DISCOVERY */
+
     /* Function to handle remote name request complete event handler */
     void hci_remote_name_request_complete_event_handler(UCHAR * event_data,
                                                         UCHAR event_datalen);
@@ -0,0 +1,532 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    appl_sniff.c
+ * \brief   This file contains the adaptive sniff mode controller: sniff is
+ *          left as soon as drive commands arrive and re-entered after an idle
+ *          period, with an interval derived from the command rate, and the
+ *          sniff subrating policy applied on top of it.
+ */
+
+/* Header File Inclusion */
+#include "appl_sniff.h"
+#include "task.h"
+#ifdef SDK_SNIFF_MEASUREMENT
+#include "hal_usb.h"
+#endif /* SDK_SNIFF_MEASUREMENT */
+
+#ifdef SDK_ADAPTIVE_SNIFF
+
+/* Idle timeout in ticks */
+#define APPL_SNIFF_IDLE_TICKS   APPL_SNIFF_MS_TO_TICKS(SDK_SNIFF_IDLE_TIMEOUT_MS)
+
+/* Extern variables */
+/* spp connections status information */
+extern SDK_SPP_CONNECTION_STATUS sdk_status[];
+/* Flag to indicate sniff mode is requested after the SPP connection */
+extern UCHAR sdk_sniff_mode_requested;
+
+extern UCHAR sdk_usb_detected;
+
+/* Static variables */
+static APPL_SNIFF_CTRL appl_sniff_ctrl[SPP_MAX_ENTITY];
+
+#ifdef SDK_SNIFF_SUBRATING
+static APPL_SSR_POLICY appl_ssr_policy = {
+    SDK_SSR_MAX_LATENCY,
+    SDK_SSR_MIN_REMOTE_TIMEOUT,
+    SDK_SSR_MIN_LOCAL_TIMEOUT
+};
+#endif /* SDK_SNIFF_SUBRATING */
+
+#ifdef SDK_SNIFF_MEASUREMENT
+static APPL_SNIFF_LOG_ENTRY appl_sniff_log[SDK_SNIFF_MEASUREMENT_LOG_SIZE];
+static UCHAR appl_sniff_log_wr = 0;
+static UCHAR appl_sniff_log_count = 0;
+#endif /* SDK_SNIFF_MEASUREMENT */
+
+/* Static Function Declarations */
+static UINT16 appl_sniff_pick_interval(const APPL_SNIFF_CTRL * ctrl);
+static void appl_sniff_enter(UCHAR dev_index);
+static void appl_sniff_exit(UCHAR dev_index);
+#ifdef SDK_SNIFF_SUBRATING
+static void appl_sniff_ssr_apply(UCHAR dev_index);
+#endif /* SDK_SNIFF_SUBRATING */
+#ifdef SDK_SNIFF_MEASUREMENT
+static void appl_sniff_log_add(UCHAR dev_index, UCHAR mode, UINT16 interval,
+                               UINT16 rx_latency);
+#endif /* SDK_SNIFF_MEASUREMENT */
+
+
+/**
+ * \fn      appl_sniff_ctrl_start
+ * \brief   Start managing the sniff mode of a connected SPP link
+ * \param   dev_index   Index of the peer BT device
+ * \return  void
+ */
+void appl_sniff_ctrl_start(UCHAR dev_index)
+{
+    APPL_SNIFF_CTRL *ctrl = &appl_sniff_ctrl[dev_index];
+
+    taskENTER_CRITICAL();
+    ctrl->last_activity = xTaskGetTickCount();
+    ctrl->mode_change_time = ctrl->last_activity;
+    ctrl->cmd_period = 0;
+    ctrl->interval = 0;
+    ctrl->pending = APPL_SNIFF_PENDING_NONE;
+#ifdef SDK_SNIFF_SUBRATING
+    ctrl->ssr_state = APPL_SSR_STATE_NONE;
+    ctrl->ssr_rx_latency = 0;
+    ctrl->ssr_tx_latency = 0;
+#endif /* SDK_SNIFF_SUBRATING */
+    ctrl->enabled = TRUE;
+    taskEXIT_CRITICAL();
+
+    /* Let the user task pick up the idle deadline */
+    sdk_user_task_wakeup();
+}
+
+/**
+ * \fn      appl_sniff_ctrl_stop
+ * \brief   Stop managing a link on disconnection
+ * \param   dev_index   Index of the peer BT device
+ * \return  void
+ */
+void appl_sniff_ctrl_stop(UCHAR dev_index)
+{
+    appl_sniff_ctrl[dev_index].enabled = FALSE;
+    appl_sniff_ctrl[dev_index].pending = APPL_SNIFF_PENDING_NONE;
+}
+
+/**
+ * \fn      appl_sniff_ctrl_activity
+ * \brief   Record SPP data received on a link; leaves sniff if needed
+ * \param   dev_index   Index of the peer BT device
+ * \return  void
+ */
+void appl_sniff_ctrl_activity(UCHAR dev_index)
+{
+    APPL_SNIFF_CTRL *ctrl = &appl_sniff_ctrl[dev_index];
+    portTickType now, delta;
+    UINT16 period;
+    UCHAR do_exit;
+
+    now = xTaskGetTickCount();
+
+    taskENTER_CRITICAL();
+    /* Only commands of a burst count for the command period */
+    delta = now - ctrl->last_activity;
+    if (delta < APPL_SNIFF_IDLE_TICKS) {
+        period = APPL_SNIFF_TICKS_TO_MS(delta);
+        if (0 == ctrl->cmd_period) {
+            ctrl->cmd_period = period;
+        } else {
+            ctrl->cmd_period = (UINT16) (((UINT32) ctrl->cmd_period * 3 +
+                                          period) >> 2);
+        }
+    }
+    ctrl->last_activity = now;
+
+    do_exit = FALSE;
+    if ((TRUE == ctrl->enabled) && (SDK_IS_IN_SNIFF_MODE(dev_index))
+        && (APPL_SNIFF_PENDING_NONE == ctrl->pending)) {
+        ctrl->pending = APPL_SNIFF_PENDING_EXIT;
+        do_exit = TRUE;
+    }
+    taskEXIT_CRITICAL();
+
+    if (TRUE == do_exit) {
+        appl_sniff_exit(dev_index);
+    }
+}
+
+/**
+ * \fn      appl_sniff_ctrl_mode_change
+ * \brief   Track the link mode reported by HCI_MODE_CHANGE_EVENT
+ * \param   dev_index   Index of the peer BT device
+ * \param   mode        Current mode (APPL_SNIFF_HCI_MODE_*)
+ * \param   interval    Sniff interval in slots
+ * \return  void
+ */
+void appl_sniff_ctrl_mode_change(UCHAR dev_index, UCHAR mode, UINT16 interval)
+{
+    APPL_SNIFF_CTRL *ctrl = &appl_sniff_ctrl[dev_index];
+    UCHAR do_exit = FALSE;
+
+#ifdef SDK_SNIFF_MEASUREMENT
+    appl_sniff_log_add(dev_index, mode, interval, 0);
+#endif /* SDK_SNIFF_MEASUREMENT */
+
+    taskENTER_CRITICAL();
+    ctrl->pending = APPL_SNIFF_PENDING_NONE;
+    ctrl->mode_change_time = xTaskGetTickCount();
+#ifdef SDK_SNIFF_SUBRATING
+    /* Subrating ends with the sniff mode */
+    ctrl->ssr_rx_latency = 0;
+    ctrl->ssr_tx_latency = 0;
+#endif /* SDK_SNIFF_SUBRATING */
+    if (APPL_SNIFF_HCI_MODE_SNIFF == mode) {
+        ctrl->interval = interval;
+        ctrl->enter_count++;
+        /* Commands arrived while the sniff request was in flight */
+        if ((TRUE == ctrl->enabled) &&
+            ((portTickType) (xTaskGetTickCount() - ctrl->last_activity) <
+             APPL_SNIFF_IDLE_TICKS)) {
+            ctrl->pending = APPL_SNIFF_PENDING_EXIT;
+            do_exit = TRUE;
+        }
+    } else if (APPL_SNIFF_HCI_MODE_ACTIVE == mode) {
+        ctrl->exit_count++;
+    }
+    taskEXIT_CRITICAL();
+
+    if (TRUE == do_exit) {
+        appl_sniff_exit(dev_index);
+    } else if ((APPL_SNIFF_HCI_MODE_ACTIVE == mode) && (TRUE == ctrl->enabled)) {
+        /* Active again, the user task has to arm the idle deadline */
+        sdk_user_task_wakeup();
+    }
+#ifdef SDK_SNIFF_SUBRATING
+    else if ((APPL_SNIFF_HCI_MODE_SNIFF == mode) && (TRUE == ctrl->enabled)
+             && (APPL_SSR_STATE_NONE == ctrl->ssr_state)) {
+        /* First sniff entry with this policy: configure subrating */
+        appl_sniff_ssr_apply(dev_index);
+    }
+#endif /* SDK_SNIFF_SUBRATING */
+}
+
+/**
+ * \fn      appl_sniff_ctrl_cmd_failed
+ * \brief   Clear the pending sniff/exit sniff command after a failed
+ *          command status
+ * \param   opcode      HCI opcode of the failed command
+ * \return  void
+ */
+void appl_sniff_ctrl_cmd_failed(UINT16 opcode)
+{
+    UCHAR index;
+
+    for (index = 0; index < SPP_MAX_ENTITY; index++) {
+        if ((HCI_SNIFF_MODE_OPCODE == opcode) &&
+            (APPL_SNIFF_PENDING_ENTER == appl_sniff_ctrl[index].pending)) {
+            /* Retry after another idle period */
+            appl_sniff_ctrl[index].last_activity = xTaskGetTickCount();
+            appl_sniff_ctrl[index].pending = APPL_SNIFF_PENDING_NONE;
+        } else if ((HCI_EXIT_SNIFF_MODE_OPCODE == opcode) &&
+                   (APPL_SNIFF_PENDING_EXIT ==
+                    appl_sniff_ctrl[index].pending)) {
+            /* Retried on the next command */
+            appl_sniff_ctrl[index].pending = APPL_SNIFF_PENDING_NONE;
+        }
+    }
+    sdk_sniff_mode_requested = FALSE;
+}
+
+/**
+ * \fn      appl_sniff_ctrl_poll
+ * \brief   Put idle links in sniff; called from the user task
+ * \param   void
+ * \return  portTickType    Ticks until the next idle deadline,
+ *                          portMAX_DELAY if none
+ */
+portTickType appl_sniff_ctrl_poll(void)
+{
+    APPL_SNIFF_CTRL *ctrl;
+    portTickType idle, wait, next;
+    UCHAR index, do_enter;
+
+    next = portMAX_DELAY;
+    for (index = 0; index < SPP_MAX_ENTITY; index++) {
+        ctrl = &appl_sniff_ctrl[index];
+        do_enter = FALSE;
+
+        taskENTER_CRITICAL();
+        if ((TRUE == ctrl->enabled) && (SDK_IS_SPP_CONNECTED(index))
+            && (SDK_IS_IN_ACTIVE_MODE(index))
+            && (APPL_SNIFF_PENDING_NONE == ctrl->pending)) {
+            idle = xTaskGetTickCount() - ctrl->last_activity;
+            if (idle >= APPL_SNIFF_IDLE_TICKS) {
+                ctrl->pending = APPL_SNIFF_PENDING_ENTER;
+                do_enter = TRUE;
+            } else {
+                wait = APPL_SNIFF_IDLE_TICKS - idle;
+                if (wait < next) {
+                    next = wait;
+                }
+            }
+        }
+        taskEXIT_CRITICAL();
+
+        if (TRUE == do_enter) {
+            appl_sniff_enter(index);
+        }
+    }
+
+    return next;
+}
+
+/**
+ * \fn      appl_sniff_ctrl_get
+ * \brief   Returns the adaptive sniff state of a link
+ * \param   dev_index   Index of the peer BT device
+ * \return  const APPL_SNIFF_CTRL *
+ */
+const APPL_SNIFF_CTRL *appl_sniff_ctrl_get(UCHAR dev_index)
+{
+    return &appl_sniff_ctrl[dev_index];
+}
+
+#ifdef SDK_SNIFF_SUBRATING
+/**
+ * \fn      appl_sniff_ssr_set_policy
+ * \brief   Change the sniff subrating policy; applied to the connected
+ *          links on their next sniff entry
+ * \param   policy      New policy
+ * \return  API_RESULT  API_SUCCESS, API_FAILURE for an invalid policy
+ */
+API_RESULT appl_sniff_ssr_set_policy(const APPL_SSR_POLICY * policy)
+{
+    UCHAR index;
+
+    /* A budget below two minimum intervals can never subrate; the spec
+     * limits the timeouts to 0xFFFE slots */
+    if ((NULL == policy) ||
+        (policy->max_latency < (2 * SDK_SNIFF_ADAPTIVE_MIN_INTERVAL)) ||
+        (0xFFFE < policy->min_remote_timeout) ||
+        (0xFFFE < policy->min_local_timeout)) {
+        return API_FAILURE;
+    }
+
+    taskENTER_CRITICAL();
+    appl_ssr_policy = *policy;
+    for (index = 0; index < SPP_MAX_ENTITY; index++) {
+        if (APPL_SSR_STATE_CONFIGURED == appl_sniff_ctrl[index].ssr_state) {
+            appl_sniff_ctrl[index].ssr_state = APPL_SSR_STATE_NONE;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return API_SUCCESS;
+}
+
+/**
+ * \fn      appl_sniff_ssr_cmd_complete
+ * \brief   Handle the command complete of HCI_Sniff_Subrating
+ * \param   status              Command status
+ * \param   connection_handle   ACL connection handle
+ * \return  void
+ */
+void appl_sniff_ssr_cmd_complete(UCHAR status, UINT16 connection_handle)
+{
+    UCHAR dev_index;
+
+    if (API_SUCCESS !=
+        appl_get_status_instance_acl(&dev_index, connection_handle)) {
+        return;
+    }
+
+    if (0x00 == status) {
+        appl_sniff_ctrl[dev_index].ssr_state = APPL_SSR_STATE_CONFIGURED;
+    } else {
+        /* Not supported by the controller or the peer: plain sniff */
+        sdk_display("Sniff subrating rejected: 0x%02X\n", status);
+        appl_sniff_ctrl[dev_index].ssr_state = APPL_SSR_STATE_UNSUPPORTED;
+    }
+}
+
+/**
+ * \fn      appl_sniff_ssr_event
+ * \brief   Record the latencies reported by HCI_SNIFF_SUBRATING_EVENT
+ * \param   dev_index   Index of the peer BT device
+ * \param   tx_latency  Maximum transmit latency (slots)
+ * \param   rx_latency  Maximum receive latency (slots)
+ * \return  void
+ */
+void appl_sniff_ssr_event(UCHAR dev_index, UINT16 tx_latency,
+                          UINT16 rx_latency)
+{
+    appl_sniff_ctrl[dev_index].ssr_tx_latency = tx_latency;
+    appl_sniff_ctrl[dev_index].ssr_rx_latency = rx_latency;
+
+#ifdef SDK_SNIFF_MEASUREMENT
+    appl_sniff_log_add(dev_index, APPL_SNIFF_LOG_SUBRATING,
+                       appl_sniff_ctrl[dev_index].interval, rx_latency);
+#endif /* SDK_SNIFF_MEASUREMENT */
+}
+#endif /* SDK_SNIFF_SUBRATING */
+
+#ifdef SDK_SNIFF_MEASUREMENT
+/**
+ * \fn      appl_sniff_log_dump
+ * \brief   Print the logged mode changes on the USB serial port
+ * \param   void
+ * \return  void
+ */
+void appl_sniff_log_dump(void)
+{
+    APPL_SNIFF_LOG_ENTRY *entry;
+    UCHAR i, rd;
+
+    if (TRUE != sdk_usb_detected) {
+        return;
+    }
+
+    halUsbSendString("\nSniff log\n");
+    rd = (appl_sniff_log_wr - appl_sniff_log_count) &
+        (SDK_SNIFF_MEASUREMENT_LOG_SIZE - 1);
+    for (i = 0; i < appl_sniff_log_count; i++) {
+        entry = &appl_sniff_log[rd];
+        halUsbSendNumber((const UCHAR *)"t=", entry->time);
+        halUsbSendNumber((const UCHAR *)" dev=", entry->dev_index);
+        halUsbSendNumber((const UCHAR *)" mode=", entry->mode);
+        halUsbSendNumber((const UCHAR *)" dwell_ms=", entry->dwell);
+        halUsbSendNumber((const UCHAR *)" interval_us=", (UINT32) entry->interval * 625);
+        if (APPL_SNIFF_LOG_SUBRATING == entry->mode) {
+            halUsbSendNumber((const UCHAR *)" rx_latency_us=",
+                             (UINT32) entry->rx_latency * 625);
+        }
+        halUsbSendChar('\n');
+        rd = (rd + 1) & (SDK_SNIFF_MEASUREMENT_LOG_SIZE - 1);
+    }
+}
+#endif /* SDK_SNIFF_MEASUREMENT */
+
+
+/**
+ * \fn      appl_sniff_pick_interval
+ * \brief   Pick the sniff interval from the observed command period
+ * \param   ctrl        Adaptive sniff state of the link
+ * \return  UINT16      Sniff interval in slots (0.625 ms)
+ */
+static UINT16 appl_sniff_pick_interval(const APPL_SNIFF_CTRL * ctrl)
+{
+    UINT32 slots;
+
+    if (0 == ctrl->cmd_period) {
+        return SDK_SNIFF_ADAPTIVE_MAX_INTERVAL;
+    }
+
+    /* One anchor point every half command period, so that a command sent at
+     * the usual rate waits at most half a period; ms / 0.625 / 2 */
+    slots = ((UINT32) ctrl->cmd_period * 4) / 5;
+    if (slots < SDK_SNIFF_ADAPTIVE_MIN_INTERVAL) {
+        slots = SDK_SNIFF_ADAPTIVE_MIN_INTERVAL;
+    } else if (slots > SDK_SNIFF_ADAPTIVE_MAX_INTERVAL) {
+        slots = SDK_SNIFF_ADAPTIVE_MAX_INTERVAL;
+    }
+
+    /* Sniff intervals are an even number of slots */
+    return (UINT16) (slots & ~1UL);
+}
+
+/**
+ * \fn      appl_sniff_enter
+ * \brief   Request sniff mode on an idle link
+ * \param   dev_index   Index of the peer BT device
+ * \return  void
+ */
+static void appl_sniff_enter(UCHAR dev_index)
+{
+    API_RESULT retval;
+    UINT16 interval;
+
+    interval = appl_sniff_pick_interval(&appl_sniff_ctrl[dev_index]);
+    sdk_sniff_mode_requested = TRUE;
+    retval = BT_hci_sniff_mode(sdk_status[dev_index].acl_connection_handle,
+                               interval, interval, SDK_CONFIG_SNIFF_ATTEMPT,
+                               SDK_CONFIG_SNIFF_TIMEOUT);
+    if (API_SUCCESS != retval) {
+        sdk_display("Sniff mode request FAILED: 0x%04X\n", retval);
+        sdk_sniff_mode_requested = FALSE;
+        appl_sniff_ctrl[dev_index].last_activity = xTaskGetTickCount();
+        appl_sniff_ctrl[dev_index].pending = APPL_SNIFF_PENDING_NONE;
+    } else {
+        sdk_display("Requested sniff mode, interval 0x%04X\n", interval);
+    }
+}
+
+/**
+ * \fn      appl_sniff_exit
+ * \brief   Request the exit of sniff mode on a link with command activity
+ * \param   dev_index   Index of the peer BT device
+ * \return  void
+ */
+static void appl_sniff_exit(UCHAR dev_index)
+{
+    API_RESULT retval;
+
+    retval =
+        BT_hci_exit_sniff_mode(sdk_status[dev_index].acl_connection_handle);
+    if (API_SUCCESS != retval) {
+        sdk_display("Exit sniff mode request FAILED: 0x%04X\n", retval);
+        appl_sniff_ctrl[dev_index].pending = APPL_SNIFF_PENDING_NONE;
+    }
+}
+
+#ifdef SDK_SNIFF_SUBRATING
+/**
+ * \fn      appl_sniff_ssr_apply
+ * \brief   Send the sniff subrating policy for a link in sniff
+ * \param   dev_index   Index of the peer BT device
+ * \return  void
+ */
+static void appl_sniff_ssr_apply(UCHAR dev_index)
+{
+    APPL_SNIFF_CTRL *ctrl = &appl_sniff_ctrl[dev_index];
+    API_RESULT retval;
+
+    /* Below two intervals the budget allows no subrate; re-evaluated on the
+     * next sniff entry, the interval may be shorter then */
+    if (appl_ssr_policy.max_latency < (2 * ctrl->interval)) {
+        return;
+    }
+
+    ctrl->ssr_state = APPL_SSR_STATE_REQUESTED;
+    retval =
+        BT_hci_sniff_subrating(sdk_status[dev_index].acl_connection_handle,
+                               appl_ssr_policy.max_latency,
+                               appl_ssr_policy.min_remote_timeout,
+                               appl_ssr_policy.min_local_timeout);
+    if (API_SUCCESS != retval) {
+        sdk_display("Sniff subrating request FAILED: 0x%04X\n", retval);
+        ctrl->ssr_state = APPL_SSR_STATE_NONE;
+    }
+}
+#endif /* SDK_SNIFF_SUBRATING */
+
+#ifdef SDK_SNIFF_MEASUREMENT
+/**
+ * \fn      appl_sniff_log_add
+ * \brief   Record a mode change in the measurement log
+ * \param   dev_index       Index of the peer BT device
+ * \param   mode            HCI mode or APPL_SNIFF_LOG_SUBRATING
+ * \param   interval        Sniff interval (slots)
+ * \param   rx_latency      Maximum receive latency of a sniff subrating
+ *                          event (slots), 0 for a mode change
+ * \return  void
+ */
+static void appl_sniff_log_add(UCHAR dev_index, UCHAR mode, UINT16 interval,
+                               UINT16 rx_latency)
+{
+    APPL_SNIFF_LOG_ENTRY *entry;
+    portTickType now;
+
+    now = xTaskGetTickCount();
+    entry = &appl_sniff_log[appl_sniff_log_wr];
+    entry->time = now;
+    entry->dwell = APPL_SNIFF_TICKS_TO_MS(now -
+                                          appl_sniff_ctrl[dev_index].
+                                          mode_change_time);
+    entry->interval = interval;
+    entry->rx_latency = rx_latency;
+    entry->dev_index = dev_index;
+    entry->mode = mode;
+
+    appl_sniff_log_wr =
+        (appl_sniff_log_wr + 1) & (SDK_SNIFF_MEASUREMENT_LOG_SIZE - 1);
+    if (appl_sniff_log_count < SDK_SNIFF_MEASUREMENT_LOG_SIZE) {
+        appl_sniff_log_count++;
+    }
+}
+#endif /* SDK_SNIFF_MEASUREMENT */
+
+#endif /* SDK_ADAPTIVE_SNIFF */
@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    appl_sniff.h
+ * \brief   This file contains the declarations of the adaptive sniff mode
+ *          controller.
+ *
+ *          The link is kept active while drive commands flow and put back in
+ *          sniff after SDK_SNIFF_IDLE_TIMEOUT_MS without SPP data. The sniff
+ *          interval is picked from the observed command period.
+ *
+ *          With SDK_SNIFF_SUBRATING, sniff subrating is configured on the
+ *          first sniff entry of a link so a parked car skips anchor points
+ *          up to the latency budget; the first drive command then exits
+ *          sniff as usual.
+ */
+
+#ifndef _H_APPL_SNIFF_
+#define _H_APPL_SNIFF_
+
+/* Header File Inclusion */
+#include "appl_sdk.h"
+
+#ifdef SDK_ADAPTIVE_SNIFF
+
+/* Convert milliseconds to RTOS ticks */
+#define APPL_SNIFF_MS_TO_TICKS(ms)  \
+    ((portTickType)(((UINT32)(ms) * configTICK_RATE_HZ) / 1000))
+/* Convert RTOS ticks to milliseconds */
+#define APPL_SNIFF_TICKS_TO_MS(ticks)  \
+    ((UINT16)(((UINT32)(ticks) * 1000) / configTICK_RATE_HZ))
+
+/* Sniff command in progress for a link */
+#define APPL_SNIFF_PENDING_NONE         0x00
+#define APPL_SNIFF_PENDING_ENTER        0x01
+#define APPL_SNIFF_PENDING_EXIT         0x02
+
+/* HCI mode change current mode values */
+#define APPL_SNIFF_HCI_MODE_ACTIVE      0x00
+#define APPL_SNIFF_HCI_MODE_SNIFF       0x02
+
+/* Sniff subrating state of a link */
+#define APPL_SSR_STATE_NONE             0x00
+/* HCI_Sniff_Subrating sent, waiting for the command complete */
+#define APPL_SSR_STATE_REQUESTED        0x01
+/* Parameters accepted by the controller */
+#define APPL_SSR_STATE_CONFIGURED       0x02
+/* Controller or peer rejected the command; not retried on this link */
+#define APPL_SSR_STATE_UNSUPPORTED      0x03
+
+/* Sniff subrating policy; all values in slots (0.625 ms) */
+typedef struct {
+    /* Latency budget: the longest time between two anchor points */
+    UINT16 max_latency;
+    /* Time in sniff before subrating starts, on each side */
+    UINT16 min_remote_timeout;
+    UINT16 min_local_timeout;
+} APPL_SSR_POLICY;
+
+/* Mode change or sniff subrating event recorded in measurement mode */
+typedef struct {
+    /* Tick of the event */
+    portTickType time;
+    /* Time spent in the previous mode (ms) */
+    UINT16 dwell;
+    /* Sniff interval (slots) */
+    UINT16 interval;
+    /* Maximum receive latency granted by sniff subrating (slots), 0 for a
+     * mode change. The anchor points themselves are not visible above HCI */
+    UINT16 rx_latency;
+    UCHAR dev_index;
+    /* HCI mode, APPL_SNIFF_LOG_SUBRATING for a sniff subrating event */
+    UCHAR mode;
+} APPL_SNIFF_LOG_ENTRY;
+
+/* Mode value of a logged sniff subrating event */
+#define APPL_SNIFF_LOG_SUBRATING        0x80
+
+/* Adaptive sniff state of one SPP link */
+typedef struct {
+    /* Tick of the last SPP data received */
+    portTickType last_activity;
+    /* Tick of the last mode change */
+    portTickType mode_change_time;
+    /* Smoothed period between commands of a burst (ms), 0 if unknown */
+    UINT16 cmd_period;
+    /* Sniff interval (slots) granted by the last mode change */
+    UINT16 interval;
+    /* Number of sniff entries and exits on the link */
+    UINT16 enter_count;
+    UINT16 exit_count;
+#ifdef SDK_SNIFF_SUBRATING
+    /* Max receive/transmit latency granted by the last subrating event */
+    UINT16 ssr_rx_latency;
+    UINT16 ssr_tx_latency;
+    /* APPL_SSR_STATE_* */
+    UCHAR ssr_state;
+#endif /* SDK_SNIFF_SUBRATING */
+    /* APPL_SNIFF_PENDING_* */
+    UCHAR pending;
+    /* TRUE while the link is managed by the controller */
+    UCHAR enabled;
+} APPL_SNIFF_CTRL;
+
+#endif /* SDK_ADAPTIVE_SNIFF */
+
+/* ----------------------------------------------- Functions */
+#ifdef SDK_ADAPTIVE_SNIFF
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * \fn      appl_sniff_ctrl_start
+     * \brief   Start managing the sniff mode of a connected SPP link
+     * \param   dev_index   Index of the peer BT device
+     * \return  void
+     */
+    void appl_sniff_ctrl_start(UCHAR dev_index);
+
+    /**
+     * \fn      appl_sniff_ctrl_stop
+     * \brief   Stop managing a link on disconnection
+     * \param   dev_index   Index of the peer BT device
+     * \return  void
+     */
+    void appl_sniff_ctrl_stop(UCHAR dev_index);
+
+    /**
+     * \fn      appl_sniff_ctrl_activity
+     * \brief   Record SPP data received on a link; leaves sniff if needed
+     * \param   dev_index   Index of the peer BT device
+     * \return  void
+     */
+    void appl_sniff_ctrl_activity(UCHAR dev_index);
+
+    /**
+     * \fn      appl_sniff_ctrl_mode_change
+     * \brief   Track the link mode reported by HCI_MODE_CHANGE_EVENT
+     * \param   dev_index   Index of the peer BT device
+     * \param   mode        Current mode (APPL_SNIFF_HCI_MODE_*)
+     * \param   interval    Sniff interval in slots
+     * \return  void
+     */
+    void appl_sniff_ctrl_mode_change(UCHAR dev_index, UCHAR mode,
+                                     UINT16 interval);
+
+    /**
+     * \fn      appl_sniff_ctrl_cmd_failed
+     * \brief   Clear the pending sniff/exit sniff command after a failed
+     *          command status
+     * \param   opcode      HCI opcode of the failed command
+     * \return  void
+     */
+    void appl_sniff_ctrl_cmd_failed(UINT16 opcode);
+
+    /**
+     * \fn      appl_sniff_ctrl_poll
+     * \brief   Put idle links in sniff; called from the user task
+     * \param   void
+     * \return  portTickType    Ticks until the next idle deadline,
+     *                          portMAX_DELAY if none
+     */
+    portTickType appl_sniff_ctrl_poll(void);
+
+    /**
+     * \fn      appl_sniff_ctrl_get
+     * \brief   Returns the adaptive sniff state of a link
+     * \param   dev_index   Index of the peer BT device
+     * \return  const APPL_SNIFF_CTRL *
+     */
+    const APPL_SNIFF_CTRL *appl_sniff_ctrl_get(UCHAR dev_index);
+
+#ifdef SDK_SNIFF_SUBRATING
+    /**
+     * \fn      appl_sniff_ssr_set_policy
+     * \brief   Change the sniff subrating policy; applied to the connected
+     *          links on their next sniff entry
+     * \param   policy      New policy
+     * \return  API_RESULT  API_SUCCESS, API_FAILURE for an invalid policy
+     */
+    API_RESULT appl_sniff_ssr_set_policy(const APPL_SSR_POLICY * policy);
+
+    /**
+     * \fn      appl_sniff_ssr_cmd_complete
+     * \brief   Handle the command complete of HCI_Sniff_Subrating
+     * \param   status              Command status
+     * \param   connection_handle   ACL connection handle
+     * \return  void
+     */
+    void appl_sniff_ssr_cmd_complete(UCHAR status, UINT16 connection_handle);
+
+    /**
+     * \fn      appl_sniff_ssr_event
+     * \brief   Record the latencies reported by HCI_SNIFF_SUBRATING_EVENT
+     * \param   dev_index   Index of the peer BT device
+     * \param   tx_latency  Maximum transmit latency (slots)
+     * \param   rx_latency  Maximum receive latency (slots)
+     * \return  void
+     */
+    void appl_sniff_ssr_event(UCHAR dev_index, UINT16 tx_latency,
+                              UINT16 rx_latency);
+#endif /* SDK_SNIFF_SUBRATING */
+
+#ifdef SDK_SNIFF_MEASUREMENT
+    /**
+     * \fn      appl_sniff_log_dump
+     * \brief   Print the logged mode changes on the USB serial port
+     * \param   void
+     * \return  void
+     */
+    void appl_sniff_log_dump(void);
+#endif /* SDK_SNIFF_MEASUREMENT */
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* SDK_ADAPTIVE_SNIFF */
+
+#endif /* _H_APPL_SNIFF_ */
@@ -11,6 +11,15 @@
 #include "appl_sdk.h"
 #include "task.h"
 #include "appl_bt_rf.h"
+#include "wake_latency.h"
+#include "appl_sniff.h"
+#include "appl_dvfs.h"
+#include "BT_buffer.h"
+#include "stack_monitor.h"
+#include "conn_arena.h"
+#include "appl_sched.h"
+#include "appl_reconnect.h"
+#include "appl_peer.h"
 
 /* Extern variables */
 /* spp connections status information */
@@ -28,9 +37,6 @@ extern UCHAR appl_spp_local_server_ch;
 /* Based on the L2CAP Tx Buffer Flow this state will be set */
 extern UCHAR appl_l2cap_tx_buf_state;
 
-#ifdef SDK_EHCILL_MODE
-extern volatile UINT32 ehcill_data;
-#endif /* #ifdef SDK_EHCILL_MODE */
 extern volatile UCHAR lpm_mode;
 extern volatile UINT32 inactivity_counter;
 extern volatile UCHAR LED_STATUS;
@@ -62,6 +68,49 @@ typedef enum {
     INDEX_6
 } PACKET_INDEX;
 
+/**
+ * Motor drive pulse lengths, in iterations of the busy loops driving P7.
+ * Tuned at APPL_MOTOR_REF_MHZ and rescaled by appl_motor_set_clock() so the
+ * pulses keep their duration when the system clock changes.
+ */
+#define APPL_MOTOR_REF_MHZ          18
+#define APPL_MOTOR_PULSE_SHORT      0x0FFF
+#define APPL_MOTOR_PULSE_MID        0x1FFF
+#define APPL_MOTOR_PULSE_LONG       0x2FFF
+
+static UINT16 appl_motor_pulse_short = APPL_MOTOR_PULSE_SHORT;
+static UINT16 appl_motor_pulse_mid = APPL_MOTOR_PULSE_MID;
+static UINT16 appl_motor_pulse_long = APPL_MOTOR_PULSE_LONG;
+
+/* Report sent back on a link ('p', 'M', 'H') */
+typedef union {
+#ifdef SDK_RESIDENCY_PROFILER
+    residencyMeasurement_t residency;
+#endif /* SDK_RESIDENCY_PROFILER */
+    OS_POOL_STATS pool_stats[BT_POOL_MAX];
+#ifdef SDK_CONN_STATS
+    CONN_STATS conn_stats;
+#endif /* SDK_CONN_STATS */
+} APPL_SPP_REPORT;
+
+/**
+ * Report being sent on each link, held until its SPP_SEND_CNF; a new report
+ * request on the link is refused until then. The confirmations of a link
+ * come in the order of the sends: appl_spp_report_ahead counts the sends
+ * queued before the report, confirmed first.
+ */
+static APPL_SPP_REPORT appl_spp_report[SPP_MAX_ENTITY];
+static UCHAR appl_spp_report_in_flight[SPP_MAX_ENTITY];
+static UCHAR appl_spp_report_ahead[SPP_MAX_ENTITY];
+/* Sends handed to SPP on each link, not confirmed yet */
+static UCHAR appl_spp_tx_queued[SPP_MAX_ENTITY];
+
+/* Static Function Declarations */
+static void appl_spp_report_command(UCHAR rem_bt_dev_index, UCHAR command);
+static void appl_spp_report_send(UCHAR rem_bt_dev_index, UINT16 length);
+static void appl_spp_tx_reset(UCHAR rem_bt_dev_index);
+static void appl_spp_tx_done(UCHAR rem_bt_dev_index);
+
 /* Functions */
 
 /**
@@ -100,6 +149,9 @@ void appl_spp_sdp_query(UCHAR rem_bt_dev_index)
                    sdk_status[rem_bt_dev_index].peer_bd_addr,
                    appl_spp_sdp_callback);
 
+    /* New connection attempt, the buffers of the previous one are done */
+    conn_arena_reset(rem_bt_dev_index);
+
     /* Set the Peer Server Channel with invalid value */
     appl_spp_remote_server_ch = 0xFF;
 
@@ -143,6 +195,7 @@ void appl_spp_sdp_callback(UINT8 command, UINT8 * data, UINT16 length,
     UINT16 attrib_id[1];
     UINT16 num_attribute_ids;
     API_RESULT retval;
+    UCHAR dev_index;
 
     /** Buffer to hold SPP SDP Attribute Data */
     UCHAR *appl_spp_attrib_data;
@@ -151,6 +204,7 @@ void appl_spp_sdp_callback(UINT8 command, UINT8 * data, UINT16 length,
     /* Handle failures */
     if (status != API_SUCCESS) {
         sdk_display("*** SDP Command 0x%02X: 0x%04X\n", command, status);
+        CONN_STATS_REASON(CONN_STATS_SRC_SDP, status);
 
         if (SDP_ServiceSearchAttributeResponse == command) {
             /* Close SDP Connection */
@@ -171,12 +225,21 @@ void appl_spp_sdp_callback(UINT8 command, UINT8 * data, UINT16 length,
         attrib_id[0] = PROTOCOL_DESC_LIST;
         num_attribute_ids = 0x01;
 
-        /* Allocate Memory */
+        /* Allocate Memory from the arena of the connection attempt */
+        appl_spp_attrib_data = NULL;
         appl_spp_attrib_data_len = SDK_SPP_ATTRIB_DATA_LEN;
-        appl_spp_attrib_data = BT_alloc_mem(appl_spp_attrib_data_len);
+        if (API_SUCCESS ==
+            appl_get_status_instance_bd_addr(&dev_index,
+                                             appl_spp_sdp_handle.bd_addr)) {
+            appl_spp_attrib_data =
+                conn_arena_alloc(dev_index, appl_spp_attrib_data_len);
+        }
 
         if (NULL == appl_spp_attrib_data) {
             sdk_display("SPP Open Failed, reason %04X\n", status);
+
+            /* Close SDP Connection */
+            BT_sdp_close(&appl_spp_sdp_handle);
         } else {
 
             /* Initiate SDP Service Search Attribute Request for SPP */
@@ -192,9 +255,6 @@ void appl_spp_sdp_callback(UINT8 command, UINT8 * data, UINT16 length,
             if (retval != API_SUCCESS) {
                 sdk_display("** FAILED ** !! Reason Code = 0x%04X\n", retval);
 
-                /* Free Memory */
-                BT_free_mem(appl_spp_attrib_data);
-
                 /* Close SDP Connection */
                 BT_sdp_close(&appl_spp_sdp_handle);
             } else {
@@ -213,10 +273,16 @@ void appl_spp_sdp_callback(UINT8 command, UINT8 * data, UINT16 length,
         if (retval != API_SUCCESS) {
             sdk_display("*** FAILED to Get Server Channel Value: 0x%04X\n",
                         retval);
+            CONN_STATS_REASON(CONN_STATS_SRC_SDP, retval);
         } else {
             sdk_display("OK.\n");
             sdk_display("SPP Server Channel: 0x%02X\n",
                         appl_spp_remote_server_ch);
+#ifdef SDK_FAST_RECONNECT
+            /* Reconnect to this peer without inquiry and SDP next time */
+            appl_reconnect_save(appl_spp_sdp_handle.bd_addr,
+                                appl_spp_remote_server_ch);
+#endif /* SDK_FAST_RECONNECT */
 
             /*
              * Mark flag to Initiate SPP Connection
@@ -231,8 +297,7 @@ void appl_spp_sdp_callback(UINT8 command, UINT8 * data, UINT16 length,
              */
         }
 
-        /* Free Memory */
-        BT_free_mem(data);
+        /* data is the arena buffer, released with the connection attempt */
 
         /* Close SDP Connection */
         BT_sdp_close(&appl_spp_sdp_handle);
@@ -390,8 +455,16 @@ API_RESULT appl_spp_notify_cb(IN SPP_HANDLE handle, IN SPP_EVENTS event_type,
         sdk_display("\nSPP Failure\n");
 
         if (SPP_CONNECT_CNF == event_type) {
-            /* Try Reconnect SPP */
+            CONN_STATS_REASON(CONN_STATS_SRC_SPP, result);
+            /* Try Reconnect SPP; a failed query sets its own state */
+            SDK_SPP_CHANGE_STATE(rem_bt_dev_index, SDK_IN_SDP_QUERY);
             appl_spp_sdp_query(rem_bt_dev_index);
+        } else if (SPP_SEND_CNF == event_type) {
+            /* A failed send is confirmed all the same */
+            appl_spp_tx_done(rem_bt_dev_index);
+#ifdef SDK_MULTI_PEER
+            appl_peer_send_cnf(rem_bt_dev_index);
+#endif /* SDK_MULTI_PEER */
         }
         return API_FAILURE;
     }
@@ -408,14 +481,29 @@ API_RESULT appl_spp_notify_cb(IN SPP_HANDLE handle, IN SPP_EVENTS event_type,
 
         if (API_SUCCESS == result) {
             /* Save SPP Handle and Change State to SPP Connected */
-            sdk_status[rem_bt_dev_index].spp_connection_handle = handle;
+            appl_set_status_spp_handle(rem_bt_dev_index, (UINT16) handle);
             SDK_SPP_CHANGE_STATE(rem_bt_dev_index, SDK_SPP_CONNECTED);
+            appl_spp_tx_reset(rem_bt_dev_index);
+#ifdef SDK_MULTI_PEER
+            appl_peer_connected(rem_bt_dev_index);
+#endif /* SDK_MULTI_PEER */
+            /* Connection setup done, release its buffers */
+            conn_arena_reset(rem_bt_dev_index);
             /* Start sending the data */
             SDK_SPP_CHANGE_TX_STATE(rem_bt_dev_index, SDK_SPP_TX_ON);
             /* SPP Connection complete so reset the flag */
             sdk_connect_in_progress = FALSE;
-
-#ifdef SDK_ENABLE_SNIFF_MODE
+            sdk_update_indication();
+#ifdef SDK_DVFS
+            /* Drive session: full speed */
+            appl_dvfs_update();
+#endif /* SDK_DVFS */
+
+#ifdef SDK_ADAPTIVE_SNIFF
+            /* Sniff is entered once the link goes idle */
+            appl_sniff_ctrl_start(rem_bt_dev_index);
+            appl_send_spp_data(rem_bt_dev_index);
+#elif defined SDK_ENABLE_SNIFF_MODE
             if (!SDK_IS_IN_SNIFF_MODE(rem_bt_dev_index)) {
                 sdk_sniff_mode_requested = TRUE;
                 retval =
@@ -446,10 +534,24 @@ API_RESULT appl_spp_notify_cb(IN SPP_HANDLE handle, IN SPP_EVENTS event_type,
 
         if (API_SUCCESS == result) {
             /* Save SPP Handle and Change State to SPP Connected */
-            sdk_status[rem_bt_dev_index].spp_connection_handle = handle;
+            appl_set_status_spp_handle(rem_bt_dev_index, (UINT16) handle);
             SDK_SPP_CHANGE_STATE(rem_bt_dev_index, SDK_SPP_CONNECTED);
+            appl_spp_tx_reset(rem_bt_dev_index);
+#ifdef SDK_MULTI_PEER
+            appl_peer_connected(rem_bt_dev_index);
+#endif /* SDK_MULTI_PEER */
+            /* Connection setup done, release its buffers */
+            conn_arena_reset(rem_bt_dev_index);
             /* Start sending the data */
             SDK_SPP_CHANGE_TX_STATE(rem_bt_dev_index, SDK_SPP_TX_ON);
+#ifdef SDK_ADAPTIVE_SNIFF
+            /* Sniff is entered once the link goes idle */
+            appl_sniff_ctrl_start(rem_bt_dev_index);
+#endif /* SDK_ADAPTIVE_SNIFF */
+#ifdef SDK_DVFS
+            /* Drive session: full speed */
+            appl_dvfs_update();
+#endif /* SDK_DVFS */
         }
 
         appl_send_spp_data(rem_bt_dev_index);
@@ -465,11 +567,20 @@ API_RESULT appl_spp_notify_cb(IN SPP_HANDLE handle, IN SPP_EVENTS event_type,
                     l_data[5]);
 
         SDK_SPP_CHANGE_STATE(rem_bt_dev_index, SDK_SPP_DISCONNECTED);
+#ifdef SDK_MULTI_PEER
+        appl_peer_disconnected(rem_bt_dev_index);
+#endif /* SDK_MULTI_PEER */
 
         SDK_SPP_CHANGE_TX_STATE(rem_bt_dev_index, SDK_SPP_TX_OFF);
 #ifdef SDK_ENABLE_SNIFF_MODE
         SDK_SPP_CHANGE_LINK_STATE(rem_bt_dev_index, SDK_OFF);
 #endif /* SDK_ENABLE_SNIFF_MODE */
+#ifdef SDK_ADAPTIVE_SNIFF
+        appl_sniff_ctrl_stop(rem_bt_dev_index);
+#endif /* SDK_ADAPTIVE_SNIFF */
+#ifdef SDK_DVFS
+        appl_dvfs_update();
+#endif /* SDK_DVFS */
         /* Initiate acl disconnection */
         sdk_display("Initiating ACL disconnection\n");
         retval =
@@ -487,11 +598,20 @@ API_RESULT appl_spp_notify_cb(IN SPP_HANDLE handle, IN SPP_EVENTS event_type,
                     l_data[5]);
 
         SDK_SPP_CHANGE_STATE(rem_bt_dev_index, SDK_SPP_DISCONNECTED);
+#ifdef SDK_MULTI_PEER
+        appl_peer_disconnected(rem_bt_dev_index);
+#endif /* SDK_MULTI_PEER */
         /* To reflect the changes in the SPP cionnection to the user */
         SDK_SPP_CHANGE_TX_STATE(rem_bt_dev_index, SDK_SPP_TX_OFF);
 #ifdef SDK_ENABLE_SNIFF_MODE
         SDK_SPP_CHANGE_LINK_STATE(rem_bt_dev_index, SDK_OFF);
 #endif /* SDK_ENABLE_SNIFF_MODE */
+#ifdef SDK_ADAPTIVE_SNIFF
+        appl_sniff_ctrl_stop(rem_bt_dev_index);
+#endif /* SDK_ADAPTIVE_SNIFF */
+#ifdef SDK_DVFS
+        appl_dvfs_update();
+#endif /* SDK_DVFS */
         break;
 
     case SPP_STOP_CNF:
@@ -500,6 +620,11 @@ API_RESULT appl_spp_notify_cb(IN SPP_HANDLE handle, IN SPP_EVENTS event_type,
 
     case SPP_SEND_CNF:
         sdk_display("SPP_SEND_CNF -> Sent successfully\n");
+        appl_spp_tx_done(rem_bt_dev_index);
+#ifdef SDK_MULTI_PEER
+        /* Next telemetry frame of this peer only, the others are not held */
+        appl_peer_send_cnf(rem_bt_dev_index);
+#endif /* SDK_MULTI_PEER */
 
         if (SDK_IS_SPP_CONNECTED(rem_bt_dev_index)
             && SDK_IS_SPP_TX_STARTED(rem_bt_dev_index)) {
@@ -515,125 +640,143 @@ API_RESULT appl_spp_notify_cb(IN SPP_HANDLE handle, IN SPP_EVENTS event_type,
         sdk_display("SPP_RECVD_DATA_IND -> Data received successfully\n");
         sdk_display("\n----------------HEX DUMP------------------------\n");
 
+#ifdef SDK_ADAPTIVE_SNIFF
+        /* Drive command: keep the link out of sniff */
+        appl_sniff_ctrl_activity(rem_bt_dev_index);
+#endif /* SDK_ADAPTIVE_SNIFF */
+
         P7DIR |= BIT4;
         P7DIR |= BIT5;
         P7DIR |= BIT6;
         P7DIR |= BIT7;
+
+        /* Report commands; the USB dumps are left to the user task */
+        appl_spp_report_command(rem_bt_dev_index, l_data[0]);
         
-        if (l_data[0]=='a') { // Down
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x1FFF; i++) 
-            {P7OUT |= BIT7;P7OUT |= BIT7;}
-
-            for (int i = 0; i < 0x0FFF; i++) 
-              P7OUT &= ~ BIT7;
-          }
-        } 
-        if (l_data[0]=='c') {//UP
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x1FFF; i++) 
-            {P7OUT |= BIT5;P7OUT |= BIT5;}
-
-            for (int i = 0; i < 0x0FFF; i++) 
-              P7OUT &= ~ BIT5;
-          }
-        }
+#ifdef SDK_MULTI_PEER
+        /* Token commands and observer drive commands stop here */
+        if (TRUE == appl_peer_command(rem_bt_dev_index, l_data[0]))
+#endif /* SDK_MULTI_PEER */
+        {
+            if (l_data[0]=='a') { // Down
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                {P7OUT |= BIT7;P7OUT |= BIT7;}
+
+                for (int i = 0; i < appl_motor_pulse_short; i++) 
+                  P7OUT &= ~ BIT7;
+              }
+            } 
+            if (l_data[0]=='c') {//UP
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                {P7OUT |= BIT5;P7OUT |= BIT5;}
+
+                for (int i = 0; i < appl_motor_pulse_short; i++) 
+                  P7OUT &= ~ BIT5;
+              }
+            }
           
-        if (l_data[0]=='d') {//Right
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x2FFF; i++) 
-              P7OUT |= BIT4;
+            if (l_data[0]=='d') {//Right
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_long; i++) 
+                  P7OUT |= BIT4;
 
-            for (int i = 0; i < 0x1FFF; i++) 
-              P7OUT |= BIT4;
-          }
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                  P7OUT |= BIT4;
+              }
 
-        }          
-        if (l_data[0]=='b') {//left
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x1FFF; i++) 
-              P7OUT |= BIT6;
+            }          
+            if (l_data[0]=='b') {//left
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                  P7OUT |= BIT6;
 
-            for (int i = 0; i < 0x1FFF; i++) 
-              P7OUT |= BIT6;
-          }
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                  P7OUT |= BIT6;
+              }
 
-        }
+            }
 
-        if (l_data[0]=='0') { // Down 'a' DWLeft
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x1FFF; i++) 
-            {P7OUT |= BIT7;P7OUT |= BIT6;}
-
-            for (int i = 0; i < 0x0FFF; i++) 
-            {P7OUT &= ~ BIT7;P7OUT |= BIT6;}
-          }
-        } 
-        if (l_data[0]=='1') { // Down 'a' DWRight
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x1FFF; i++) 
-            {P7OUT |= BIT7;P7OUT |= BIT4;}
-
-            for (int i = 0; i < 0x0FFF; i++) 
-              {P7OUT &= ~ BIT7;P7OUT |= BIT4;}
-          }
-        } 
+            if (l_data[0]=='0') { // Down 'a' DWLeft
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                {P7OUT |= BIT7;P7OUT |= BIT6;}
+
+                for (int i = 0; i < appl_motor_pulse_short; i++) 
+                {P7OUT &= ~ BIT7;P7OUT |= BIT6;}
+              }
+            } 
+            if (l_data[0]=='1') { // Down 'a' DWRight
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                {P7OUT |= BIT7;P7OUT |= BIT4;}
+
+                for (int i = 0; i < appl_motor_pulse_short; i++) 
+                  {P7OUT &= ~ BIT7;P7OUT |= BIT4;}
+              }
+            } 
 
         
-        if (l_data[0]=='2') {//UP left
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x1FFF; i++) 
-            {P7OUT |= BIT5;P7OUT |= BIT6;}
-
-            for (int i = 0; i < 0x0FFF; i++) 
-            {P7OUT &= ~ BIT5;P7OUT |= BIT6;}
-          }
-        }
+            if (l_data[0]=='2') {//UP left
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                {P7OUT |= BIT5;P7OUT |= BIT6;}
+
+                for (int i = 0; i < appl_motor_pulse_short; i++) 
+                {P7OUT &= ~ BIT5;P7OUT |= BIT6;}
+              }
+            }
           
-        if (l_data[0]=='3') {//UP right
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x1FFF; i++) 
-            {P7OUT |= BIT5;P7OUT |= BIT4;}
-
-            for (int i = 0; i < 0x0FFF; i++) 
-            {P7OUT &= ~ BIT5;P7OUT |= BIT4;}
-          }
-        }
+            if (l_data[0]=='3') {//UP right
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                {P7OUT |= BIT5;P7OUT |= BIT4;}
+
+                for (int i = 0; i < appl_motor_pulse_short; i++) 
+                {P7OUT &= ~ BIT5;P7OUT |= BIT4;}
+              }
+            }
 
-        if (l_data[0]=='z') {//UP turbo
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x1FFF; i++) 
-            {P7OUT |= BIT5;P7OUT |= BIT5;}
+            if (l_data[0]=='z') {//UP turbo
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                {P7OUT |= BIT5;P7OUT |= BIT5;}
 
-            for (int i = 0; i < 0x1FFF; i++) 
-             {P7OUT |= BIT5;P7OUT |= BIT5;}
-          }
-        }
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                 {P7OUT |= BIT5;P7OUT |= BIT5;}
+              }
+            }
 
-        if (l_data[0]=='x') {//UP left Turbo
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x1FFF; i++) 
-            {P7OUT |= BIT5;P7OUT |= BIT6;}
+            if (l_data[0]=='x') {//UP left Turbo
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                {P7OUT |= BIT5;P7OUT |= BIT6;}
 
-            for (int i = 0; i < 0x1FFF; i++) 
-              {P7OUT |= BIT5;P7OUT |= BIT6;}
-          }
-        }
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                  {P7OUT |= BIT5;P7OUT |= BIT6;}
+              }
+            }
           
-        if (l_data[0]=='y') {//UP right Turbo
-          for (int j = 0; j < 10; j++) {
-            for (int i = 0; i < 0x1FFF; i++) 
-            {P7OUT |= BIT5;P7OUT |= BIT4;}
-
-            for (int i = 0; i < 0x1FFF; i++) 
-             {P7OUT |= BIT5;P7OUT |= BIT4;}
-          }
-        }
+            if (l_data[0]=='y') {//UP right Turbo
+              for (int j = 0; j < 10; j++) {
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                {P7OUT |= BIT5;P7OUT |= BIT4;}
+
+                for (int i = 0; i < appl_motor_pulse_mid; i++) 
+                 {P7OUT |= BIT5;P7OUT |= BIT4;}
+              }
+            }
     
-        P7OUT &= ~ BIT4;
-        P7OUT &= ~ BIT5;
-        P7OUT &= ~ BIT6;
-        P7OUT &= ~ BIT7;
+            P7OUT &= ~ BIT4;
+            P7OUT &= ~ BIT5;
+            P7OUT &= ~ BIT6;
+            P7OUT &= ~ BIT7;
+        }
+#ifdef SDK_MULTI_PEER
+        /* Motors done, the observers are served after the driver */
+        appl_peer_telemetry(rem_bt_dev_index, l_data[0]);
+#endif /* SDK_MULTI_PEER */
         
         for (index = 0; index < datalen; index++) {
             sdk_display("%02X ", l_data[index]);
@@ -665,6 +808,22 @@ API_RESULT appl_spp_notify_cb(IN SPP_HANDLE handle, IN SPP_EVENTS event_type,
     return API_SUCCESS;
 }
 
+/**
+ * \fn      appl_motor_set_clock
+ * \brief   Rescale the motor drive pulses to the system clock
+ * \param   mhz     System clock frequency in MHz
+ * \return  void
+ */
+void appl_motor_set_clock(UCHAR mhz)
+{
+    appl_motor_pulse_short =
+        (UINT16) (((UINT32) APPL_MOTOR_PULSE_SHORT * mhz) / APPL_MOTOR_REF_MHZ);
+    appl_motor_pulse_mid =
+        (UINT16) (((UINT32) APPL_MOTOR_PULSE_MID * mhz) / APPL_MOTOR_REF_MHZ);
+    appl_motor_pulse_long =
+        (UINT16) (((UINT32) APPL_MOTOR_PULSE_LONG * mhz) / APPL_MOTOR_REF_MHZ);
+}
+
 /**
  * \fn      appl_spp_write
  * \brief   Function to write data on a SPP connection
@@ -675,8 +834,210 @@ API_RESULT appl_spp_notify_cb(IN SPP_HANDLE handle, IN SPP_EVENTS event_type,
  */
 API_RESULT appl_spp_write(UCHAR rem_bt_dev_index, UCHAR * data, UINT16 data_len)
 {
-    return BT_spp_send(sdk_status[rem_bt_dev_index].spp_connection_handle, data,
-                       data_len);
+    API_RESULT retval;
+
+    /* Counted first: the confirmation may come before the send returns */
+    appl_spp_tx_queued[rem_bt_dev_index]++;
+    retval = BT_spp_send(sdk_status[rem_bt_dev_index].spp_connection_handle,
+                         data, data_len);
+    if (API_SUCCESS != retval) {
+        appl_spp_tx_queued[rem_bt_dev_index]--;
+    }
+
+    return retval;
+}
+
+/**
+ * \fn      appl_spp_tx_pending
+ * \brief   Number of sends handed to SPP on a link and not confirmed yet
+ * \param   rem_bt_dev_index Index of peer BT device
+ * \return  UCHAR   Number of sends
+ */
+UCHAR appl_spp_tx_pending(UCHAR rem_bt_dev_index)
+{
+    return appl_spp_tx_queued[rem_bt_dev_index];
+}
+
+/**
+ * \fn      appl_spp_tx_reset
+ * \brief   SPP connected: nothing is queued on the link
+ * \param   rem_bt_dev_index Index of peer BT device
+ * \return  void
+ */
+static void appl_spp_tx_reset(UCHAR rem_bt_dev_index)
+{
+    appl_spp_tx_queued[rem_bt_dev_index] = 0;
+    appl_spp_report_in_flight[rem_bt_dev_index] = FALSE;
+}
+
+/**
+ * \fn      appl_spp_tx_done
+ * \brief   SPP_SEND_CNF: the oldest send of the link is confirmed, release
+ *          the report buffer if it was the report
+ * \param   rem_bt_dev_index Index of peer BT device
+ * \return  void
+ */
+static void appl_spp_tx_done(UCHAR rem_bt_dev_index)
+{
+    if (0 != appl_spp_tx_queued[rem_bt_dev_index]) {
+        appl_spp_tx_queued[rem_bt_dev_index]--;
+    }
+
+    if (TRUE == appl_spp_report_in_flight[rem_bt_dev_index]) {
+        if (0 == appl_spp_report_ahead[rem_bt_dev_index]) {
+            appl_spp_report_in_flight[rem_bt_dev_index] = FALSE;
+        } else {
+            appl_spp_report_ahead[rem_bt_dev_index]--;
+        }
+    }
+}
+
+/**
+ * \fn      appl_spp_report_command
+ * \brief   Handle a report command received on a link. The reports sent
+ *          back on the link are taken here; the ones printed on the USB
+ *          serial port are posted to the user task, the read task does not
+ *          wait on the USB writes.
+ * \param   rem_bt_dev_index Index of peer BT device
+ * \param   command First byte of the received data
+ * \return  void
+ */
+static void appl_spp_report_command(UCHAR rem_bt_dev_index, UCHAR command)
+{
+    APPL_SPP_REPORT *report = &appl_spp_report[rem_bt_dev_index];
+    UCHAR pool;
+
+    /* The reports sent back share the buffer of the link */
+    if ((('p' == command) || ('P' == command) || ('M' == command) ||
+         ('H' == command)) &&
+        (TRUE == appl_spp_report_in_flight[rem_bt_dev_index])) {
+        sdk_display("Report '%c' refused, previous one not sent yet\n",
+                    command);
+        return;
+    }
+
+    switch (command) {
+#ifdef SDK_WAKE_LATENCY_STATS
+    case 'w':
+#endif /* SDK_WAKE_LATENCY_STATS */
+#ifdef SDK_SNIFF_MEASUREMENT
+    case 's':
+#endif /* SDK_SNIFF_MEASUREMENT */
+#ifdef SDK_DVFS
+    case 'f':
+#endif /* SDK_DVFS */
+#ifdef SDK_POOL_TRACE
+    case 't':
+#endif /* SDK_POOL_TRACE */
+#ifdef SDK_STACK_MONITOR
+    case 'k':
+#endif /* SDK_STACK_MONITOR */
+#ifdef SDK_CONN_STATS
+    case 'h':
+#endif /* SDK_CONN_STATS */
+    case 'm':
+        if (TRUE == sdk_user_event_post(USER_EVENT_REPORT, command)) {
+            sdk_user_task_wakeup();
+        }
+        break;
+
+#ifdef SDK_RESIDENCY_PROFILER
+    case 'p':
+    case 'P':
+        /* 'P' also starts a new session */
+        residencySnapshot(&report->residency);
+        if ('P' == command) {
+            residencyReset();
+        }
+        appl_spp_report_send(rem_bt_dev_index, sizeof(report->residency));
+        break;
+#endif /* SDK_RESIDENCY_PROFILER */
+
+    case 'M':
+        for (pool = 0; pool < BT_POOL_MAX; pool++) {
+            (void)OS_get_pool_stats(pool, &report->pool_stats[pool]);
+        }
+        appl_spp_report_send(rem_bt_dev_index, sizeof(report->pool_stats));
+        break;
+
+#ifdef SDK_CONN_STATS
+    case 'H':
+        conn_stats_get(&report->conn_stats);
+        appl_spp_report_send(rem_bt_dev_index, sizeof(report->conn_stats));
+        break;
+#endif /* SDK_CONN_STATS */
+
+    default:
+        break;
+    }
+}
+
+/**
+ * \fn      appl_spp_report_send
+ * \brief   Send the report buffer of a link, held until its SPP_SEND_CNF
+ * \param   rem_bt_dev_index Index of peer BT device
+ * \param   length Report length
+ * \return  void
+ */
+static void appl_spp_report_send(UCHAR rem_bt_dev_index, UINT16 length)
+{
+    appl_spp_report_ahead[rem_bt_dev_index] =
+        appl_spp_tx_queued[rem_bt_dev_index];
+    if (API_SUCCESS ==
+        appl_spp_write(rem_bt_dev_index,
+                       (UCHAR *)&appl_spp_report[rem_bt_dev_index], length)) {
+        appl_spp_report_in_flight[rem_bt_dev_index] = TRUE;
+    }
+}
+
+/**
+ * \fn      appl_spp_report_dump
+ * \brief   Print a report on the USB serial port, for a report command
+ *          posted by the read task (USER_EVENT_REPORT)
+ * \param   command 'w' wake latency, 's' sniff log, 'f' clock levels, 't'
+ *          pool trace, 'k' task stacks, 'h' connection statistics, 'm'
+ *          buffer pools
+ * \return  void
+ */
+void appl_spp_report_dump(UCHAR command)
+{
+    switch (command) {
+#ifdef SDK_WAKE_LATENCY_STATS
+    case 'w':
+        wake_latency_dump();
+        break;
+#endif /* SDK_WAKE_LATENCY_STATS */
+#ifdef SDK_SNIFF_MEASUREMENT
+    case 's':
+        appl_sniff_log_dump();
+        break;
+#endif /* SDK_SNIFF_MEASUREMENT */
+#ifdef SDK_DVFS
+    case 'f':
+        appl_dvfs_dump();
+        break;
+#endif /* SDK_DVFS */
+#ifdef SDK_POOL_TRACE
+    case 't':
+        sdk_pool_trace_dump();
+        break;
+#endif /* SDK_POOL_TRACE */
+#ifdef SDK_STACK_MONITOR
+    case 'k':
+        stack_monitor_dump();
+        break;
+#endif /* SDK_STACK_MONITOR */
+#ifdef SDK_CONN_STATS
+    case 'h':
+        conn_stats_dump();
+        break;
+#endif /* SDK_CONN_STATS */
+    case 'm':
+        sdk_pool_stats_dump();
+        break;
+    default:
+        break;
+    }
 }
 
 /**
@@ -793,6 +1154,10 @@ API_RESULT appl_spp_l2cap_tx_queue_flow_cb(UCHAR state, UINT16 count)
                 SDK_SPP_CHANGE_DATA_STATE(index, FALSE);
             }
         }
+#ifdef SDK_MULTI_PEER
+        /* Then the telemetry held back while the queue was flowed off */
+        appl_peer_flow_on();
+#endif /* SDK_MULTI_PEER */
     }
     /* Flow Off - Don't send data */
     else {
@@ -868,7 +1233,7 @@ void vApplicationIdleHook(void)
 
 #ifdef SDK_EHCILL_MODE
     __disable_interrupt();
-    if (0x0FFFF == ehcill_data) {
+    if (EHCILL_SM_IS_ASLEEP()) {
         UART_DISABLE_BT_UART_RTS();
     } else {
         UART_ENABLE_BT_UART_RTS();
@@ -883,9 +1248,12 @@ void vApplicationIdleHook(void)
     UART_ENABLE_BT_UART_RTS();
 #endif /* SDK_EHCILL_MODE */
 
+#ifdef SDK_STACK_MONITOR
+    stack_monitor_poll();
+#endif /* SDK_STACK_MONITOR */
 
 #ifdef MSP430_LPM_ENABLE
-    if (inactivity_timeout == inactivity_counter) {
+    if ((FALSE == lpm_mode) && (inactivity_timeout == inactivity_counter)) {
         __disable_interrupt();
         lpm_mode = TRUE;
         /* Save the LED pins status */
@@ -900,14 +1268,20 @@ void vApplicationIdleHook(void)
 #else /* MSP-EXP430F5438 Platform */
         halAccelerometerShutDown();
 #endif
-        /* Halting the Timer1_A3 */
-        TA1CTL &= ~MC_3;
+        /* Halting the Timer1_A3 jobs */
+        appl_sched_suspend();
         for (index = 0; index < (SPP_MAX_ENTITY - 1); index++) {
             SDK_SPP_CHANGE_TX_STATE(index, SDK_SPP_TX_OFF);
         }
         /* Turn OFF UART1 which is used as USB serial port */
         halUsbShutDown();
+#if ( configUSE_TICKLESS_IDLE == 1 )
+        /* The idle task sleeps in LPM3 with the tick stopped once this hook
+         * returns; the peripherals stay off until an ISR sees lpm_mode */
+        __enable_interrupt();
+#else
         ENTER_MSP430_LPM();
+#endif /* configUSE_TICKLESS_IDLE */
     }
 #endif /* MSP430_LPM_ENABLE */
 
@@ -42,6 +42,14 @@ extern "C" {
     API_RESULT appl_spp_write(UCHAR rem_bt_dev_index, UCHAR * data,
                               UINT16 data_len);
 
+    /* Number of sends handed to SPP on a link and not confirmed yet */
+    UCHAR appl_spp_tx_pending(UCHAR rem_bt_dev_index);
+
+    /* Print a report on the USB serial port (USER_EVENT_REPORT) */
+    void appl_spp_report_dump(UCHAR command);
+
+    void appl_motor_set_clock(UCHAR mhz);
+
     API_RESULT appl_sm_service_cb(UCHAR event_type, UCHAR * bd_addr,
                                   UCHAR * event_data);
 
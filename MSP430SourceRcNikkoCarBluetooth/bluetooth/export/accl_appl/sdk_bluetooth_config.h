@@ -44,6 +44,76 @@
 /* Sniff timeout value */
 #define SDK_CONFIG_SNIFF_TIMEOUT                1
 
+/**
+ * Flag to enable the adaptive sniff controller: sniff is left when drive
+ * commands arrive and re-entered after SDK_SNIFF_IDLE_TIMEOUT_MS without SPP
+ * data. Needs SDK_ENABLE_SNIFF_MODE.
+ */
+#define SDK_ADAPTIVE_SNIFF
+/* Idle time before the link is put back in sniff (ms) */
+#define SDK_SNIFF_IDLE_TIMEOUT_MS               500
+/* Bounds of the sniff interval picked from the command rate (slots) */
+#define SDK_SNIFF_ADAPTIVE_MIN_INTERVAL         0x0050
+#define SDK_SNIFF_ADAPTIVE_MAX_INTERVAL         SDK_CONFIG_SNIFF_MAX_INTERVAL
+
+/**
+ * Flag to enable sniff subrating on idle links (needs BT_SSR and
+ * SDK_ADAPTIVE_SNIFF). A parked car wakes once per latency budget instead of
+ * once per sniff interval.
+ */
+#define SDK_SNIFF_SUBRATING
+/* Latency budget: longest time between two anchor points (slots, 1 s) */
+#define SDK_SSR_MAX_LATENCY                     0x0640
+/* Time in sniff before subrating starts (slots, 2 s) */
+#define SDK_SSR_MIN_REMOTE_TIMEOUT              0x0C80
+#define SDK_SSR_MIN_LOCAL_TIMEOUT               0x0C80
+
+/* Flag to log the mode changes and the sniff subrating latencies */
+#define SDK_SNIFF_MEASUREMENT
+/* Number of logged mode changes (power of 2) */
+#define SDK_SNIFF_MEASUREMENT_LOG_SIZE          8
+
+/**
+ * Flag to enable the system clock scaling: the MSP430 runs at
+ * SDK_DVFS_IDLE_CLK with VCore lowered while no SPP link is connected and at
+ * SDK_DVFS_DRIVE_CLK during a drive session. Needs configUSE_TICKLESS_IDLE
+ * for the tick to survive the DCO settling time.
+ */
+#define SDK_DVFS
+/* System clock without SPP link (SYSCLK_xxMHZ) */
+#define SDK_DVFS_IDLE_CLK                       SYSCLK_8MHZ
+/* System clock during a drive session; limited to SYSCLK_18MHZ on F5438 */
+#define SDK_DVFS_DRIVE_CLK                      SYSCLK_25MHZ
+
+/**
+ * Flag to enable the fast reconnect cache: the last peers are paged directly
+ * and SPP opened on their cached server channel, without inquiry and SDP.
+ */
+#define SDK_FAST_RECONNECT
+/* Number of cached peers */
+#define SDK_RECONNECT_CACHE_SIZE                2
+
+/**
+ * Flag to enable the discovery on extended inquiry results (needs BT_EIR):
+ * the local name is sent in the EIR, the peer names are taken from the EIR
+ * and the BlueMSP430Demo devices are ranked by RSSI. The strongest one is
+ * connected at the end of the inquiry, or at once if nearer than
+ * SDK_EIR_NEAR_RSSI. Devices without a name in their EIR are still resolved
+ * by remote name request.
+ */
+#define SDK_EIR_DISCOVERY
+/* Inquiry length with EIR discovery (x 1.28 s) */
+#define SDK_EIR_INQUIRY_LEN                     0x04
+/* RSSI from which a BlueMSP430Demo device is connected at once (dBm) */
+#define SDK_EIR_NEAR_RSSI                       (-45)
+
+/**
+ * Flag to enable the multi-peer mode: one peer holds the driving token, the
+ * other connected peers only get the telemetry stream of the drive commands.
+ * The number of peers is SPP_MAX_ENTITY of the stack library.
+ */
+#define SDK_MULTI_PEER
+
 /* Flag to enable insertion of application data into a basic
  * Header+Payload+Checksum packet format */
 #define PACKETISE_USB_DATA
@@ -15,11 +15,16 @@
 #include "vendor_specific_init.h"
 #include "hal_MSP430F5438.h"
 #include "bt_sdk_error.h"
+#include "wake_latency.h"
+#include "appl_sched.h"
 
 /* external Variables */
 /* This variable holds the value of configured BT UART baud rate */
 extern UINT32 configured_bt_uart_baudrate;
 extern UCHAR sdk_bt_power;      /* Bluetooth Power On/Off status */
+/* Current system clock, changed at run time with SDK_DVFS */
+extern UCHAR sys_clk_frequency;
+extern UINT32 sdk_error_code;
 
 
 #ifdef __IAR_SYSTEMS_ICC__      /* Toolchain Specific Code */
@@ -155,7 +160,7 @@ void sdk_update_reconnect_error_status(void)
 void sensor_init(void)
 {
 #ifdef EZ430_PLATFORM
-    halI2CInit(SYSTEM_CLK);
+    halI2CInit(sys_clk_frequency);
     halAccStart();
 #else /* MSP-EXP430F5438 Platform */
     halAccelerometerInit();
@@ -172,19 +177,22 @@ void sensor_init(void)
 void restore_peripheral_status(void)
 {
     UCHAR temp = 0x00;
+
+    WAKE_LATENCY_MARK(WAKE_LATENCY_MARK_LPM_EXIT);
     temp = LED_STATUS;
     /* Restore the LED status */
     LED_PORT_OUT |= temp;
     /* Initilize the Sensors */
     sensor_init();
-    /* ResumeTimer1_A3 */
-    TA1CTL |= MC_1;
+    /* Resume the Timer1_A3 jobs */
+    appl_sched_resume();
 
 
     if (TRUE == sdk_usb_detected) {
         /* Initialize the UART port which is used as USB serial port */
         halUsbInit();
     }
+    WAKE_LATENCY_MARK(WAKE_LATENCY_MARK_LPM_RESTORED);
 }
 
 
@@ -197,6 +205,11 @@ void restore_peripheral_status(void)
 void sdk_error_handler()
 {
     __disable_interrupt();
+    /* Leave the pool history behind an allocation failure */
+    if ((SDK_POOL_MEM_ALLOC_FAIL == sdk_error_code) ||
+        (SDK_BT_MEM_ALLOC_FAIL == sdk_error_code)) {
+        sdk_pool_stats_dump();
+    }
     BT_RF_NSHUTDOWN_PIN_LOW();
     LED_OFF();
     while (1) {
@@ -28,23 +28,48 @@
 #define SWITCH_S2         0x10
 #endif /* EZ430_PLATFORM */
 
-#define POWER_ON_RESET    0x11
 #define SWITCH_INTERRUPT (SWITCH_S1 | SWITCH_S2)
 
+/* User task events (sdk_user_event_post) */
+/* Turn on Bluetooth, posted once at start */
+#define USER_EVENT_POWER_ON_RESET   0x01
+/* Discoverable LED blink, Timer1 job */
+#define USER_EVENT_DISCOVERABLE     0x02
+/* Button press, data: P2IV value (SWITCH_S1 or SWITCH_S2) */
+#define USER_EVENT_SWITCH           0x03
+/* Report to print on the USB serial port, data: the SPP report command */
+#define USER_EVENT_REPORT           0x04
+#define USER_EVENT_NUM_TYPES        4
+
+/* Event ring size, a power of two dividing 256 (free running UCHAR index) */
+#define USER_EVENT_RING_SIZE        16
+
+/* Time the switches are ignored after a press (ms) */
+#define SWITCH_DEBOUNCE_TIME        20
+
 /* define the timeout for LCD contrast adjusting */
 #define SET_CONTRAST_TIMEOUT 60
 
 #define sdk_start_scheduler() vTaskStartScheduler()
 
-#define UPDATE_USER_BUFFER(data) \
-      { \
-        circular_user_buffer[circular_user_buf_wt] = data;\
-        circular_user_buf_wt++;\
-        if (circular_user_buf_wt == MAX_USER_BUF) {\
-                circular_user_buf_wt = 0;\
-        }\
-        bytes_to_be_processed_in_user_buf++;\
-      }
+/* ----------------------------------------------- Structures/Data Types */
+/* User task event */
+typedef struct {
+    /* USER_EVENT_* */
+    UCHAR type;
+    /* Event parameter */
+    UCHAR data;
+} SDK_USER_EVENT;
+
+/* User task event ring statistics */
+typedef struct {
+    /* Events queued */
+    UINT16 posted;
+    /* Events dropped with the ring full, per type (USER_EVENT_* - 1) */
+    UINT16 overflows[USER_EVENT_NUM_TYPES];
+    /* Most events queued at once */
+    UCHAR peak;
+} SDK_USER_EVENT_STATS;
 
 /* ----------------------------------------------- Functions */
 #ifdef __cplusplus
@@ -83,9 +108,21 @@ extern "C" {
 
     void *user_task_routine(void);
 
+    /* Unblock the user task to re-evaluate its timeouts */
+    void sdk_user_task_wakeup(void);
+
+    /* Queue an event for the user task, from an ISR or a task */
+    UCHAR sdk_user_event_post(UCHAR type, UCHAR data);
+
+    /* Copy the user task event ring statistics */
+    void sdk_user_event_get_stats(SDK_USER_EVENT_STATS * stats);
+
     /* Configuring MSP430 Timers */
     void sdk_config_timer(void);
 
+    /* Discoverable or connection in progress state changed: update the LED */
+    void sdk_update_indication(void);
+
     /* This function does the uart initilizations of MSP430 */
     void uart_setup(void);
 
@@ -11,9 +11,9 @@
 #include "appl_sdk.h"
 #include "task.h"
 #include "BT_task.h"
-
-/* Extern Fucntion Declaration */
-extern void configTimer1_A3(void);
+#include "appl_sniff.h"
+#include "appl_dvfs.h"
+#include "appl_sched.h"
 
 /* Extern variables */
 extern volatile UINT32 inactivity_counter;
@@ -25,17 +25,48 @@ extern UCHAR sdk_usb_detected;
 /* Global variables */
 /* Flag to indicate that SPP connection is in progress */
 UCHAR sdk_connect_in_progress = FALSE;
-UCHAR circular_user_buffer[MAX_USER_BUF];
-INT16 circular_user_buf_wt = 0;
-UCHAR inactivity_timeout = INACTIVITY_TIMEOUT;
+/**
+ * Quiet check periods before LPM: the first period after an activity may be
+ * partial, so LPM is entered after INACTIVITY_TIMEOUT to INACTIVITY_TIMEOUT +
+ * INACTIVITY_CHECK_PERIOD seconds without activity
+ */
+UCHAR inactivity_timeout = (INACTIVITY_TIMEOUT / INACTIVITY_CHECK_PERIOD) + 1;
 
-static INT16 circular_user_buf_rd = 0;
-static UCHAR debounce = 0;
-static volatile UCHAR bytes_to_be_processed_in_user_buf = 0;
+static volatile UCHAR debounce = 0;
+
+/* Timer1 jobs */
+/* Discoverable LED blink, only while discoverable */
+static APPL_SCHED_JOB user_blink_job;
+/* Inactivity count for LPM */
+static APPL_SCHED_JOB user_inactivity_job;
+/* USB presence, until USB is detected */
+static APPL_SCHED_JOB user_usb_job;
+/* Switch debounce, one-shot */
+static APPL_SCHED_JOB user_debounce_job;
+
+/**
+ * User task events, posted by Timer1 and PORT2 (which run nested, with GIE
+ * set again), by the BT read task and by the user task, drained by the user
+ * task. The indices
+ * run free and are only changed with the interrupts disabled; the ring
+ * holds user_event_wr - user_event_rd events.
+ */
+static SDK_USER_EVENT user_event_ring[USER_EVENT_RING_SIZE];
+static volatile UCHAR user_event_wr = 0;
+static volatile UCHAR user_event_rd = 0;
+static SDK_USER_EVENT_STATS user_event_stats;
 
 /* User Semaphore */
 static xSemaphoreHandle xUserSemaphore;
 
+/* Static Function Declarations */
+static UCHAR user_event_take(SDK_USER_EVENT * batch);
+static void user_event_handle(const SDK_USER_EVENT * event);
+static void user_blink_expired(signed portBASE_TYPE * woken);
+static void user_inactivity_expired(signed portBASE_TYPE * woken);
+static void user_usb_expired(signed portBASE_TYPE * woken);
+static void user_debounce_expired(signed portBASE_TYPE * woken);
+
 /**
  * \fn      init_user_task
  * \brief   Create the user task
@@ -67,143 +98,293 @@ void init_user_task(void)
  */
 void *user_task_routine(void)
 {
-    API_RESULT retval;
+    portTickType wait;
+    SDK_USER_EVENT batch[USER_EVENT_RING_SIZE];
+    UCHAR count, index;
 
-    UPDATE_USER_BUFFER(POWER_ON_RESET);
-    bytes_to_be_processed_in_user_buf = 1;
-    xSemaphoreGive(xUserSemaphore);
+    if (TRUE == sdk_user_event_post(USER_EVENT_POWER_ON_RESET, 0)) {
+        xSemaphoreGive(xUserSemaphore);
+    }
 
     while (1) {
-        if (pdPASS == xSemaphoreTake(xUserSemaphore, 0xFFFF)) {
-            while (bytes_to_be_processed_in_user_buf > 0) {
-                bytes_to_be_processed_in_user_buf--;
-                switch (circular_user_buffer[circular_user_buf_rd]) {
-                case BT_DISCOVERABLE_STATE:
-                    TOGGLE_LED2();
-                    break;
-                case SWITCH_S1:
-                    /*
-                     * Switch SW1 is mapped to SPP connection/disconnection
-                     * request. SW1 is a toggle switch.
-                     */
-                    sdk_bluetooth_menu_handler(OP_PEER_CONNECT);
-                    break;
-                case SWITCH_S2:
-                    /* Switch SW2 is mapped to contol datasend stop and pause
-                     * functionality */
-                    sdk_bluetooth_menu_handler(OP_PEER_DATASEND);
-                    break;
-                case POWER_ON_RESET:
-                    /* Turn ON the bluetooth */
-                    retval = sdk_bluetooth_on();
-                    if (retval != API_SUCCESS) {
-                        sdk_display((const UCHAR *)
-                                    "Failed to turn on Bluetooth\n");
-                    }
-                    break;
-                default:
-                    sdk_error_handler();
-                    break;
-                }
-                circular_user_buf_rd++;
-                if (MAX_USER_BUF == circular_user_buf_rd) {
-                    circular_user_buf_rd = 0;
+#ifdef SDK_DVFS
+        /* Clock changes are applied here, between two user buffer events,
+         * so no sensor access or menu handling is cut in two */
+        appl_dvfs_poll();
+#endif /* SDK_DVFS */
+#ifdef SDK_ADAPTIVE_SNIFF
+        /* Block until the next link idle deadline at most */
+        wait = appl_sniff_ctrl_poll();
+#else
+        wait = 0xFFFF;
+#endif /* SDK_ADAPTIVE_SNIFF */
+        if (pdPASS == xSemaphoreTake(xUserSemaphore, wait)) {
+            /* Drain the ring; events posted meanwhile are taken by the next
+             * batch, without another semaphore give */
+            while (0 != (count = user_event_take(batch))) {
+                for (index = 0; index < count; index++) {
+                    user_event_handle(&batch[index]);
                 }
             }
+        }
+    }
+}
+
+/**
+ * \fn      sdk_user_event_post
+ * \brief   Queue an event for the user task. Safe from any ISR or task; a
+ *          full ring drops the new event and counts it.
+ * \param   type        USER_EVENT_*
+ * \param   data        Event parameter
+ * \return  UCHAR       TRUE if the ring was empty: the caller gives the user
+ *                      semaphore, the user task drains the ring to empty so
+ *                      the other events need no give
+ */
+UCHAR sdk_user_event_post(UCHAR type, UCHAR data)
+{
+    unsigned short state;
+    UCHAR count;
+    UCHAR wake = FALSE;
+
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    count = (UCHAR) (user_event_wr - user_event_rd);
+    if (USER_EVENT_RING_SIZE == count) {
+        /* Keep the queued events, they are older */
+        if ((type > 0) && (type <= USER_EVENT_NUM_TYPES)) {
+            user_event_stats.overflows[type - 1]++;
+        }
+    } else {
+        user_event_ring[user_event_wr & (USER_EVENT_RING_SIZE - 1)].type = type;
+        user_event_ring[user_event_wr & (USER_EVENT_RING_SIZE - 1)].data = data;
+        user_event_wr++;
+        count++;
+        user_event_stats.posted++;
+        if (count > user_event_stats.peak) {
+            user_event_stats.peak = count;
+        }
+        wake = (1 == count) ? TRUE : FALSE;
+    }
+    __set_interrupt_state(state);
+
+    return wake;
+}
 
+/**
+ * \fn      sdk_user_event_get_stats
+ * \brief   Copy the user task event ring statistics
+ * \param   stats       Filled with the statistics
+ * \return  void
+ */
+void sdk_user_event_get_stats(SDK_USER_EVENT_STATS * stats)
+{
+    unsigned short state;
+
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    *stats = user_event_stats;
+    __set_interrupt_state(state);
+}
+
+/**
+ * \fn      user_event_take
+ * \brief   Move all the queued events out of the ring
+ * \param   batch       USER_EVENT_RING_SIZE events, filled in order
+ * \return  UCHAR       Number of events taken
+ */
+static UCHAR user_event_take(SDK_USER_EVENT * batch)
+{
+    unsigned short state;
+    UCHAR count, index;
+
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    count = (UCHAR) (user_event_wr - user_event_rd);
+    for (index = 0; index < count; index++) {
+        batch[index] =
+            user_event_ring[(UCHAR) (user_event_rd + index) &
+                            (USER_EVENT_RING_SIZE - 1)];
+    }
+    user_event_rd += count;
+    __set_interrupt_state(state);
+
+    return count;
+}
+
+/**
+ * \fn      user_event_handle
+ * \brief   Process one user task event
+ * \param   event       Event
+ * \return  void
+ */
+static void user_event_handle(const SDK_USER_EVENT * event)
+{
+    API_RESULT retval;
+
+    switch (event->type) {
+    case USER_EVENT_DISCOVERABLE:
+        TOGGLE_LED2();
+        break;
+    case USER_EVENT_SWITCH:
+        if (SWITCH_S1 == event->data) {
+            /*
+             * Switch SW1 is mapped to SPP connection/disconnection
+             * request. SW1 is a toggle switch.
+             */
+            sdk_bluetooth_menu_handler(OP_PEER_CONNECT);
+        } else if (SWITCH_S2 == event->data) {
+            /* Switch SW2 is mapped to contol datasend stop and pause
+             * functionality */
+            sdk_bluetooth_menu_handler(OP_PEER_DATASEND);
+        } else {
+            sdk_error_handler();
+        }
+        break;
+    case USER_EVENT_POWER_ON_RESET:
+        /* Turn ON the bluetooth */
+        retval = sdk_bluetooth_on();
+        if (retval != API_SUCCESS) {
+            sdk_display((const UCHAR *)"Failed to turn on Bluetooth\n");
         }
+        break;
+    case USER_EVENT_REPORT:
+        appl_spp_report_dump(event->data);
+        break;
+    default:
+        sdk_error_handler();
+        break;
     }
 }
 
 
 /**
- * \fn      sdk_config_timer
- * \brief   Configure the timers used by the application
+ * \fn      sdk_user_task_wakeup
+ * \brief   Unblock the user task to re-evaluate its timeouts
  * \param   void
  * \return  void
  */
-void sdk_config_timer(void)
+void sdk_user_task_wakeup(void)
 {
-    /* Configure Timer1_A3 which is used for menu and Led indication related
-     * functionalities */
-    configTimer1_A3();
+    if (NULL != xUserSemaphore) {
+        xSemaphoreGive(xUserSemaphore);
+    }
 }
 
+
 /**
- * \fn      TIMER1_A0_ISR
- * \brief   Interrupt routine for Timer1_A3.
- *          This handles the menu and LED indications related functionality
+ * \fn      sdk_config_timer
+ * \brief   Configure the timers used by the application: the Timer1_A3 job
+ *          scheduler and the housekeeping jobs
  * \param   void
  * \return  void
  */
-#ifndef __IAR_SYSTEMS_ICC__
-#pragma CODE_SECTION(TIMER1_A0_ISR, ".text:_isr");
-#endif /* __IAR_SYSTEMS_ICC__ */
-#pragma vector=TIMER1_A0_VECTOR
-__interrupt void TIMER1_A0_ISR(void)
+void sdk_config_timer(void)
 {
-    signed portBASE_TYPE xHigherPriorityTaskWoken;
+    appl_sched_init();
 
-    UART_DISABLE_BT_UART_RTS();
-    xHigherPriorityTaskWoken = pdFALSE;
+    appl_sched_job_init(&user_blink_job, user_blink_expired);
+    appl_sched_job_init(&user_inactivity_job, user_inactivity_expired);
+    appl_sched_job_init(&user_usb_job, user_usb_expired);
+    appl_sched_job_init(&user_debounce_job, user_debounce_expired);
 
-    TA1CCTL0 &= ~CCIFG;
-    __bis_SR_register(GIE);
+    appl_sched_start(&user_inactivity_job,
+                     APPL_SCHED_SEC(INACTIVITY_CHECK_PERIOD),
+                     APPL_SCHED_SEC(INACTIVITY_CHECK_PERIOD));
+    /* Stops itself once USB is detected, here or by sdk_init_bsp() */
+    appl_sched_start(&user_usb_job, APPL_SCHED_SEC(1), APPL_SCHED_SEC(1));
 
-    /* If the debounce flag is set, clear the flag to allow processing of next
-     * button interrupts */
-    if (1 == debounce) {
-        debounce = 0;
-    }
+    sdk_update_indication();
+}
 
-    /* Halting the Timer1_A3 */
-    TA1CTL &= ~MC_3;
+/**
+ * \fn      sdk_update_indication
+ * \brief   Start or stop the discoverable LED blink after a change of the
+ *          discoverable or connection in progress state. The LED blinks
+ *          every 0.25 sec while the device is trying to inquire and connect
+ *          to the BlueMSP demo device, every 1 sec otherwise.
+ * \param   void
+ * \return  void
+ */
+void sdk_update_indication(void)
+{
+    UINT32 period;
 
-    if (TRUE == sdk_connect_in_progress) {
-        /* Setting the inactivity timeout accordingly */
-        inactivity_timeout = (INACTIVITY_TIMEOUT << 2);
-        /* Reinitializing theTimer register value to generate interuupt every
-         * 0.25 sec. This is used to indicate the user that the device is
-         * trying to inquire and connect to BlueMSP demo device */
-        TA1CCR0 = 0x2000;
+    if (SDK_IS_BT_DISCOVERABLE()) {
+        if (TRUE == sdk_connect_in_progress) {
+            period = APPL_SCHED_MS(250);
+        } else {
+            period = APPL_SCHED_SEC(1);
+        }
+        appl_sched_start(&user_blink_job, period, period);
     } else {
-        /* Setting the inactivity timeout accordingly */
-        inactivity_timeout = INACTIVITY_TIMEOUT;
-        /* Reinitializing the Timer register value to generate interrupt every
-         * 1 sec */
-        TA1CCR0 = 0x8000;
+        appl_sched_stop(&user_blink_job);
     }
+}
 
-    /* Resume Timer1_A3 */
-    TA1CTL |= MC_1;
+/**
+ * \fn      user_blink_expired
+ * \brief   Timer1 job: post the discoverable LED event
+ * \param   woken       Set if a higher priority task was woken
+ * \return  void
+ */
+static void user_blink_expired(signed portBASE_TYPE * woken)
+{
+    if (SDK_IS_BT_DISCOVERABLE()) {
+        if (TRUE == sdk_user_event_post(USER_EVENT_DISCOVERABLE, 0)) {
+            /* Unblock the task by releasing the semaphore */
+            xSemaphoreGiveFromISR(xUserSemaphore, woken);
+        }
+    } else {
+        appl_sched_stop(&user_blink_job);
+    }
+}
 
+/**
+ * \fn      user_inactivity_expired
+ * \brief   Timer1 job: count the quiet check periods, the idle hook enters
+ *          LPM at inactivity_timeout. The UART, USB and switch interrupts
+ *          clear the count.
+ * \param   woken       Not used
+ * \return  void
+ */
+static void user_inactivity_expired(signed portBASE_TYPE * woken)
+{
     if (inactivity_counter < (inactivity_timeout + 1)) {
         inactivity_counter++;
     }
+}
 
-    if (SDK_IS_BT_DISCOVERABLE()) {
-        UPDATE_USER_BUFFER(BT_DISCOVERABLE_STATE);
-    }
-    /* If usb connection was not detected,during board initialisation, check
-     * now */
+/**
+ * \fn      user_usb_expired
+ * \brief   Timer1 job: if USB was not connected at board initialisation,
+ *          initialise the port once it is
+ * \param   woken       Not used
+ * \return  void
+ */
+static void user_usb_expired(signed portBASE_TYPE * woken)
+{
     if (FALSE == sdk_usb_detected) {
-        /* if the usb device is now connected, initialise the port */
         if (USB_PORT_IN & USB_PIN_RXD) {
             sdk_usb_detected = TRUE;
             halUsbInit();
         }
     }
 
-    /* Unlocking User Task */
-    if (bytes_to_be_processed_in_user_buf > 0) {
-        /* Unblock the task by releasing the semaphore */
-        xSemaphoreGiveFromISR(xUserSemaphore, &xHigherPriorityTaskWoken);
+    if (TRUE == sdk_usb_detected) {
+        appl_sched_stop(&user_usb_job);
     }
+}
 
-    /* Force a context switch if xHigherPriorityTaskWoken was set to true */
-    if (xHigherPriorityTaskWoken) {
-        portYIELD();
-    }
+/**
+ * \fn      user_debounce_expired
+ * \brief   Timer1 job: the debounce time is over, allow processing of the
+ *          next button interrupts
+ * \param   woken       Not used
+ * \return  void
+ */
+static void user_debounce_expired(signed portBASE_TYPE * woken)
+{
+    debounce = 0;
 }
 
 
@@ -234,11 +415,12 @@ __interrupt void PORT2_VECTOR_ISR(void)
         if (0 == debounce) {
             /* to take care of switch debounce */
             debounce = 1;
+            appl_sched_start(&user_debounce_job,
+                             APPL_SCHED_MS(SWITCH_DEBOUNCE_TIME), 0);
 
             if (FALSE == lpm_mode) {
-                UPDATE_USER_BUFFER(int_vect);
                 /* Unlocking User Task */
-                if (bytes_to_be_processed_in_user_buf > 0) {
+                if (TRUE == sdk_user_event_post(USER_EVENT_SWITCH, int_vect)) {
                     /* Unblock the user task by releasing the semaphore */
                     xSemaphoreGiveFromISR(xUserSemaphore,
                                           &xHigherPriorityTaskWoken);
@@ -257,6 +439,9 @@ __interrupt void PORT2_VECTOR_ISR(void)
     }
 #endif /* MSP430_LPM_ENABLE */
 
+    /* End a tickless idle sleep so the tick count is corrected */
+    portTICKLESS_EXIT_LPM();
+
     /* Force a context switch if xHigherPriorityTaskWoken was set to true */
     if (xHigherPriorityTaskWoken) {
         portYIELD();
@@ -271,7 +456,10 @@ __interrupt void PORT2_VECTOR_ISR(void)
  **/
 void init_buttons(void)
 {
+    /* Ignore the switches until the inputs settle */
     debounce = 1;
+    appl_sched_start(&user_debounce_job,
+                     APPL_SCHED_MS(SWITCH_DEBOUNCE_TIME), 0);
 
     BUTTON_PORT_DIR &= ~(BUTTON_S1 + BUTTON_S2);
     BUTTON_PORT_REN |= (BUTTON_S1 + BUTTON_S2);
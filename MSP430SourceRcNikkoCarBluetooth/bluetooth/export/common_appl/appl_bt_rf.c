@@ -15,6 +15,7 @@
 #include "vendor_specific_init.h"
 #include "msp430_uart.h"
 #include "bt_sdk_error.h"
+#include "wake_latency.h"
 
 
 /* Extern Function Declarations */
@@ -25,18 +26,13 @@ extern API_RESULT BT_hci_vendor_specific_command(UINT16 ocf, UCHAR * params,
 extern UINT32 sdk_error_code;
 
 #ifdef SDK_EHCILL_MODE
-volatile UINT32 msp430_state = SDK_MSP430_AWAKE_STATE;
-volatile UINT32 ehcill_rx_state = BT_RF_NO_EHCILL_DATA;
-volatile UINT32 ehcill_tx_state = BT_RF_NO_EHCILL_DATA;
-volatile UINT32 ehcill_data = 0x0;
-
-#define UPDATE_EHCILL_DATA()  { \
-    UINT32 temp; \
-    temp = (msp430_state << 16); \
-    temp |= (ehcill_rx_state << 8); \
-    temp |= (ehcill_tx_state); \
-    ehcill_data = temp; \
-}
+
+/* Timestamp used for the state machine transitions */
+#define EHCILL_TIMESTAMP()  portGET_TIMESTAMP()
+
+/* Static Function Declarations */
+static void ehcill_perform_actions(UINT16 actions, UCHAR event,
+                                   UCHAR error_code, UCHAR collision_code);
 
 
 /**
@@ -47,10 +43,9 @@ volatile UINT32 ehcill_data = 0x0;
  */
 void init_ehcill_params(void)
 {
-    msp430_state = SDK_MSP430_AWAKE_STATE;
-    ehcill_rx_state = BT_RF_NO_EHCILL_DATA;
-    ehcill_tx_state = BT_RF_NO_EHCILL_DATA;
-    UPDATE_EHCILL_DATA();
+    __disable_interrupt();
+    ehcill_sm_init(EHCILL_TIMESTAMP());
+    __enable_interrupt();
 }
 
 
@@ -109,194 +104,119 @@ __interrupt void BT_CTS_PIN_VECTOR_ISR(void)
 
 
     if (BT_UART_CTS_REG_PXIV == (BT_UART_CTS_REG_PXIV & int_vect)) {
-
-        ENABLE_UART();
-        UART_ENABLE_BT_UART_RTS();
-
+        WAKE_LATENCY_MARK(WAKE_LATENCY_MARK_CTS_EDGE);
+        ehcill_perform_actions(ehcill_sm_handle_event
+                               (EHCILL_EV_CTS_EDGE, EHCILL_TIMESTAMP()),
+                               EHCILL_EV_CTS_EDGE, SDK_EHCILL_RX_DEFAULT_CASE,
+                               SDK_EHCILL_COLLISION_CASE_2_RX);
     }
+
+    /* End a tickless idle sleep so the tick count is corrected */
+    portTICKLESS_EXIT_LPM();
 }
 
 
 
 
 /**
- * \fn      ehcill_tx_handler
- * \brief   Function to handle data ehcill transmission
- * \param   void
+ * \fn      ehcill_perform_actions
+ * \brief   Performs the UART side of a state machine transition
+ * \param   actions         EHCILL_ACT_* returned by the state machine
+ * \param   event           Event that caused the transition
+ * \param   error_code      Error reported for an invalid event
+ * \param   collision_code  Error reported for a collision
  * \return  void
  */
-void ehcill_tx_handler(void)
+static void ehcill_perform_actions(UINT16 actions, UCHAR event,
+                                   UCHAR error_code, UCHAR collision_code)
 {
-    UPDATE_EHCILL_DATA();
-    switch (ehcill_data) {
-
-    /** MSP430_state  = Awake = 0x1
-      * ehcill_rx_state = BT_RF_SLEEP_IND_RCVD
-      * ehcill_tx_state = BT_RF_SLEEP_ACK_SENT
-      */
-    case 0x13031:
+    if (EHCILL_ACT_NONE == actions) {
+        return;
+    }
+
+    if (actions & EHCILL_ACT_ENABLE_UART) {
+        ENABLE_UART();
+        UART_ENABLE_BT_UART_RTS();
+    }
+    if (actions & EHCILL_ACT_ENABLE_CTS_INT) {
         uart_enable_cts_interrupt();
-        ehcill_rx_state = BT_RF_NO_EHCILL_DATA;
-        ehcill_tx_state = BT_RF_NO_EHCILL_DATA;
-        msp430_state = SDK_MSP430_SLEEP_STATE;
+    }
+    if (actions & EHCILL_ACT_DISABLE_CTS_INT) {
+        uart_disable_cts_interrupt();
+    }
+    if (actions & EHCILL_ACT_SEND_SLEEP_ACK) {
         UART_TRANSMIT(SDK_BT_RF_SLEEP_ACK);
         while ((*(bt_uart_config.uart_reg_ucaxstat)) & UCBUSY);
+    }
+    if (actions & EHCILL_ACT_DISABLE_UART) {
         DISABLE_UART();
-        break;
-
-
-    /** MSP430_state  = Sleep = 0x0
-      * ehcill_rx_state = BT_RF_NO_EHCILL_DATA
-      * ehcill_tx_state = BT_RF_NO_EHCILL_DATA
-      */
-    case 0x0FFFF:
-        ehcill_tx_state = BT_RF_WAKE_UP_IND_SENT;
+    }
+    if (actions & EHCILL_ACT_SEND_WAKE_IND) {
+        WAKE_LATENCY_MARK(WAKE_LATENCY_MARK_WAKE_IND);
         UART_ENABLE_BT_UART_RTS();
         UART_TRANSMIT(SDK_BT_RF_WAKE_UP_IND);
-        break;
-
-    /** MSP430_state  = Sleep = 0x0
-      * ehcill_rx_state = BT_RF_NO_EHCILL_DATA
-      * ehcill_tx_state = BT_RF_WAKE_UP_IND_SENT
-      */
-    case 0x0FF32:
-        /* Ignore */
-        break;
-
-    /** MSP430_state  = Sleep = 0x0
-      * ehcill_rx_state = BT_RF_SLEEP_IND_RCVD
-      * ehcill_tx_state = BT_RF_WAKE_UP_IND_SENT
-      */
-    case 0x03032:              /* Collision Case 2 */
-        sdk_error_code = ((ehcill_data << 8) | SDK_EHCILL_COLLISION_CASE_2_TX);
-        sdk_error_handler();
-        break;
-
-    /** MSP430_state  = Sleep = 0x0
-      * ehcill_rx_state = BT_RF_WAKE_UP_IND_RCVD
-      * ehcill_tx_state = BT_RF_WAKE_UP_IND_SENT
-      */
-    case 0x03232:
-        /* Collision Case 1 */
-        ehcill_rx_state = BT_RF_NO_EHCILL_DATA;
-        ehcill_tx_state = BT_RF_NO_EHCILL_DATA;
-        msp430_state = SDK_MSP430_AWAKE_STATE;
-        uart_disable_cts_interrupt();
-        break;
-
-    /** MSP430_state  = Sleep = 0x0
-      * ehcill_rx_state = BT_RF_WAKE_UP_IND_RCVD
-      * ehcill_tx_state = BT_RF_WAKE_UP_ACK_SENT
-      */
-    case 0x03233:
-        ehcill_rx_state = BT_RF_NO_EHCILL_DATA;
-        ehcill_tx_state = BT_RF_NO_EHCILL_DATA;
-        msp430_state = SDK_MSP430_AWAKE_STATE;
+    }
+    if (actions & EHCILL_ACT_SEND_WAKE_ACK) {
         UART_TRANSMIT(SDK_BT_RF_WAKE_UP_ACK);
-        uart_disable_cts_interrupt();
-        break;
-
-    default:
-        sdk_error_code = ((ehcill_data << 8) | SDK_EHCILL_TX_DEFAULT_CASE);
+    }
+    if (actions & EHCILL_ACT_KICK_TX) {
+        /* Raise the TX interrupt; the TX ISR continues the handshake */
+        while ((*(bt_uart_config.uart_reg_ucaxstat)) & UCBUSY);
+        *(bt_uart_config.uart_reg_ucaxifg) |= UCTXIFG;
+    }
+    if (actions & (EHCILL_ACT_COLLISION | EHCILL_ACT_ERROR)) {
+        sdk_error_code = ((UINT32) ehcill_sm_get_state() << 16) |
+            ((UINT32) event << 8) |
+            ((actions & EHCILL_ACT_COLLISION) ? collision_code : error_code);
         sdk_error_handler();
-        break;
     }
-    UPDATE_EHCILL_DATA();
 }
 
 /**
- * \fn      ehcill_rx_handler
- * \brief   Function to handle data ehcill reception
- * \param   void
+ * \fn      ehcill_tx_handler
+ * \brief   Function to handle data ehcill transmission
+ * \param   event   EHCILL_EV_TX_IDLE when the UART TX drained at a packet
+ *                  boundary, EHCILL_EV_TX_DATA when data is queued while the
+ *                  host is asleep
  * \return  void
  */
-void ehcill_rx_handler(void)
+void ehcill_tx_handler(UCHAR event)
 {
-    UPDATE_EHCILL_DATA();
-
-    switch (ehcill_data) {
-
-    /** MSP430_state  = Awake = 0x1
-      * ehcill_rx_state = BT_RF_SLEEP_IND_RCVD
-      * ehcill_tx_state = BT_RF_NO_EHCILL_DATA
-      */
-    case 0x130FF:
-        ehcill_tx_state = BT_RF_SLEEP_ACK_SENT;
-        while ((*(bt_uart_config.uart_reg_ucaxstat)) & UCBUSY);
-        *(bt_uart_config.uart_reg_ucaxifg) |= UCTXIFG;
-        break;
-
-    case 0x132FF:
-        /* If we rx wake up indication, in awake state; This scenario is
-         * normally seen during debugging */
-        ehcill_rx_state = BT_RF_NO_EHCILL_DATA;
-        break;
-
-    /** MSP430_state  = Sleep = 0x0
-      * ehcill_rx_state = BT_RF_SLEEP_IND_RCVD
-      * ehcill_tx_state = BT_RF_WAKE_UP_IND_SENT
-      */
-    case 0x03032:              /* Collision Case 2 */
-        sdk_error_code = ((ehcill_data << 8) | SDK_EHCILL_COLLISION_CASE_2_RX);
-        sdk_error_handler();
-        break;
-
-    /** MSP430_state  = Sleep = 0x0
-      * ehcill_rx_state = BT_RF_WAKE_UP_IND_RCVD
-      * ehcill_tx_state = BT_RF_NO_EHCILL_DATA
-      */
-    case 0x032FF:
-        ehcill_rx_state = BT_RF_WAKE_UP_IND_RCVD;
-        ehcill_tx_state = BT_RF_WAKE_UP_ACK_SENT;
-        while ((*(bt_uart_config.uart_reg_ucaxstat)) & UCBUSY);
-        *(bt_uart_config.uart_reg_ucaxifg) |= UCTXIFG;
-        break;
-
-    /** MSP430_state  = Sleep = 0x0
-      * ehcill_rx_state = BT_RF_WAKE_UP_IND_RCVD
-      * ehcill_tx_state = BT_RF_WAKE_UP_IND_SENT
-      */
-    case 0x03232:
-        /* Collision Case 1 */
-        ehcill_rx_state = BT_RF_NO_EHCILL_DATA;
-        ehcill_tx_state = BT_RF_NO_EHCILL_DATA;
-        msp430_state = SDK_MSP430_AWAKE_STATE;
-        uart_disable_cts_interrupt();
-        break;
-
-    /** MSP430_state  = Sleep = 0x0
-      * ehcill_rx_state = BT_RF_WAKE_UP_IND_RCVD
-      * ehcill_tx_state = BT_RF_WAKE_UP_ACK_SENT
-      */
-    case 0x03233:
-        /* Since we have acknowledged wakeup , we need change the state to
-         * awake */
-        ehcill_rx_state = BT_RF_NO_EHCILL_DATA;
-        ehcill_tx_state = BT_RF_NO_EHCILL_DATA;
-        msp430_state = SDK_MSP430_AWAKE_STATE;
-        uart_disable_cts_interrupt();
-        break;
-
-    /** MSP430_state  = Sleep = 0x0
-      * ehcill_rx_state = BT_RF_WAKE_UP_ACK_RCVD
-      * ehcill_tx_state = BT_RF_WAKE_UP_IND_SENT
-      */
-    case 0x03332:
-        ehcill_rx_state = BT_RF_NO_EHCILL_DATA;
-        ehcill_tx_state = BT_RF_NO_EHCILL_DATA;
-        msp430_state = SDK_MSP430_AWAKE_STATE;
-        uart_disable_cts_interrupt();
-        while ((*(bt_uart_config.uart_reg_ucaxstat)) & UCBUSY);
-        *(bt_uart_config.uart_reg_ucaxifg) |= UCTXIFG;
-
-        break;
+    ehcill_perform_actions(ehcill_sm_handle_event(event, EHCILL_TIMESTAMP()),
+                           event, SDK_EHCILL_TX_DEFAULT_CASE,
+                           SDK_EHCILL_COLLISION_CASE_2_TX);
+}
 
-    default:
-        sdk_error_code = ((ehcill_data << 8) | SDK_EHCILL_RX_DEFAULT_CASE);
-        sdk_error_handler();
-        break;
+/**
+ * \fn      ehcill_rx_handler
+ * \brief   Function to handle data ehcill reception
+ * \param   rx_octet    First octet of a received packet
+ * \return  UCHAR       1 if the octet was an ehcill byte and has been consumed,
+ *                      0 if it starts an HCI packet
+ */
+UCHAR ehcill_rx_handler(UCHAR rx_octet)
+{
+    UCHAR event;
+
+    if ((rx_octet >= SDK_BT_RF_SLEEP_IND)
+        && (rx_octet <= SDK_BT_RF_WAKE_UP_ACK)) {
+        /* EHCILL_EV_RX_SLEEP_IND .. EHCILL_EV_RX_WAKE_ACK follow the byte
+         * values */
+        event = (UCHAR) (EHCILL_EV_RX_SLEEP_IND +
+                         (rx_octet - SDK_BT_RF_SLEEP_IND));
+    } else {
+        /* HCI packet; only of interest to the state machine while the link
+         * is not awake */
+        if (EHCILL_STATE_AWAKE != ehcill_sm_get_state()) {
+            ehcill_sm_handle_event(EHCILL_EV_RX_PACKET, EHCILL_TIMESTAMP());
+        }
+        return 0;
     }
-    UPDATE_EHCILL_DATA();
+
+    ehcill_perform_actions(ehcill_sm_handle_event(event, EHCILL_TIMESTAMP()),
+                           event, SDK_EHCILL_RX_DEFAULT_CASE,
+                           SDK_EHCILL_COLLISION_CASE_2_RX);
+    return 1;
 }
 
 
@@ -15,26 +15,8 @@
 #define SDK_EHCILL_RETRANSMISSION_TIMEOUT   0x0050  /* (x * 1.25 milli secs) */
 #define SDK_EHCILL_RTS_PULSE_WIDTH          0x96    /* (x micro secs) */
 
-/* States pertaining to ehcill mode */
-#define SDK_BT_RF_SLEEP_IND                 0x30
-#define SDK_BT_RF_SLEEP_ACK                 0x31
-#define SDK_BT_RF_WAKE_UP_IND               0x32
-#define SDK_BT_RF_WAKE_UP_ACK               0x33
-
-#define SDK_MSP430_SLEEP_STATE              0x0
-#define SDK_MSP430_AWAKE_STATE              0x1
-
-#define BT_RF_NO_EHCILL_DATA                0xFF
-
-#define BT_RF_SLEEP_IND_SENT                SDK_BT_RF_SLEEP_IND
-#define BT_RF_SLEEP_ACK_SENT                SDK_BT_RF_SLEEP_ACK
-#define BT_RF_WAKE_UP_IND_SENT              SDK_BT_RF_WAKE_UP_IND
-#define BT_RF_WAKE_UP_ACK_SENT              SDK_BT_RF_WAKE_UP_ACK
-
-#define BT_RF_SLEEP_IND_RCVD                SDK_BT_RF_SLEEP_IND
-#define BT_RF_SLEEP_ACK_RCVD                SDK_BT_RF_SLEEP_ACK
-#define BT_RF_WAKE_UP_IND_RCVD              SDK_BT_RF_WAKE_UP_IND
-#define BT_RF_WAKE_UP_ACK_RCVD              SDK_BT_RF_WAKE_UP_ACK
+/* ehcill protocol bytes and the sleep/wake state machine */
+#include "ehcill_sm.h"
 
 
 #ifdef __cplusplus
@@ -51,10 +33,10 @@ extern "C" {
     API_RESULT sdk_deep_sleep_disable(void);
 
     /* Function to handle ehcill data transmission */
-    void ehcill_tx_handler(void);
+    void ehcill_tx_handler(UCHAR event);
 
     /* Function to handle ehcill data reception */
-    void ehcill_rx_handler(void);
+    UCHAR ehcill_rx_handler(UCHAR rx_octet);
 
     /**
      * \fn      init_ehcill_params
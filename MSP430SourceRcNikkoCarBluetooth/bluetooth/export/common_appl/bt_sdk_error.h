@@ -72,4 +72,8 @@
 #define SDK_COMMAND_DISALLOWED              SDK_ERROR_CODE_VAL + 0x1C
 /* Received generic application error */
 #define SDK_APP_GENERIC_ERROR               SDK_ERROR_CODE_VAL + 0x1D
+/* Task stack overflow detected on a context switch */
+#define SDK_STACK_OVERFLOW                  SDK_ERROR_CODE_VAL + 0x1E
+/* More application scheduler jobs than APPL_SCHED_MAX_JOBS */
+#define SDK_SCHED_FULL                      SDK_ERROR_CODE_VAL + 0x1F
 #endif /* _H_BT_SDK_ERROR_ */
@@ -361,6 +361,12 @@ API_RESULT sdk_hci_event_indication_callback(UCHAR event_type,
         hci_mode_change_event_handler(event_data);
         break;
 
+#ifdef SDK_SNIFF_SUBRATING
+    case HCI_SNIFF_SUBRATING_EVENT:
+        hci_sniff_subrating_event_handler(event_data);
+        break;
+#endif /* SDK_SNIFF_SUBRATING */
+
     case HCI_LINK_KEY_NOTIFICATION_EVENT:
         hci_link_key_notification_event_handler(event_data);
         break;
@@ -373,6 +379,16 @@ API_RESULT sdk_hci_event_indication_callback(UCHAR event_type,
         hci_inquiry_result_event_handler(event_data);
         break;
 
+#ifdef SDK_EIR_DISCOVERY
+    case HCI_INQUIRY_RESULT_WITH_RSSI_EVENT:
+        hci_inquiry_result_rssi_event_handler(event_data);
+        break;
+
+    case HCI_EXTENDED_INQUIRY_RESULT_EVENT:
+        hci_extended_inquiry_result_event_handler(event_data);
+        break;
+#endif /* SDK_EIR_DISCOVERY */
+
     case HCI_REMOTE_NAME_REQUEST_COMPLETE_EVENT:
         hci_remote_name_request_complete_event_handler(event_data,
                                                        event_datalen);
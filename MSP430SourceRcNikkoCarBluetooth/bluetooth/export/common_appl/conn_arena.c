@@ -0,0 +1,59 @@
+/**
+ * Copyright (C) 2010. MindTree Ltd.  All rights reserved.
+ *
+ * \file    conn_arena.c
+ * \brief   This file contains the connection setup arena: one bump allocator
+ *          per SPP connection instance, reset at the end of each connection
+ *          attempt.
+ */
+
+/* Header File Inclusion */
+#include "conn_arena.h"
+
+/* Static variables */
+/* Arena storage, word aligned */
+static UINT16 conn_arena_buffer[SPP_MAX_ENTITY][(SDK_CONN_ARENA_SIZE + 1) / 2];
+/* Bytes taken from each arena */
+static UINT16 conn_arena_used[SPP_MAX_ENTITY];
+
+
+/**
+ * \fn      conn_arena_reset
+ * \brief   Release all the buffers of a connection instance
+ * \param   index       sdk_status[] index
+ * \return  void
+ */
+void conn_arena_reset(UCHAR index)
+{
+    if (index < SPP_MAX_ENTITY) {
+        conn_arena_used[index] = 0;
+    }
+}
+
+/**
+ * \fn      conn_arena_alloc
+ * \brief   Take a buffer from the arena of a connection instance; valid until
+ *          the next conn_arena_reset() of that instance
+ * \param   index       sdk_status[] index
+ * \param   size        Size in bytes
+ * \return  UCHAR *     Word aligned buffer, NULL if the arena is full
+ */
+UCHAR *conn_arena_alloc(UCHAR index, UINT16 size)
+{
+    UCHAR *buffer;
+
+    if ((index >= SPP_MAX_ENTITY) || (0 == size)) {
+        return NULL;
+    }
+
+    /* Keep the next buffer word aligned */
+    size = (size + 1) & ~1;
+    if (size > (sizeof(conn_arena_buffer[0]) - conn_arena_used[index])) {
+        return NULL;
+    }
+
+    buffer = (UCHAR *) conn_arena_buffer[index] + conn_arena_used[index];
+    conn_arena_used[index] += size;
+
+    return buffer;
+}
@@ -0,0 +1,51 @@
+/**
+ * Copyright (C) 2010. MindTree Ltd.  All rights reserved.
+ *
+ * \file    conn_arena.h
+ * \brief   This file contains the declarations of the connection setup
+ *          arena.
+ *
+ *          Each SPP connection instance (sdk_status[] index) owns a static
+ *          bump arena for the buffers of one connection attempt (SDP
+ *          attribute data). Allocation moves a pointer; nothing is freed one
+ *          by one, the whole arena is reset when the attempt ends: SPP
+ *          connected, ACL disconnected, or a new attempt started. Connection
+ *          setup so never takes the pool buffers the data path needs, and a
+ *          failed attempt cannot leak.
+ */
+
+#ifndef _H_CONN_ARENA_
+#define _H_CONN_ARENA_
+
+/* Header File Inclusion */
+#include "BT_common.h"
+#include "sdk_bluetooth_config.h"
+
+/* ----------------------------------------------- Functions */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * \fn      conn_arena_reset
+     * \brief   Release all the buffers of a connection instance
+     * \param   index       sdk_status[] index
+     * \return  void
+     */
+    void conn_arena_reset(UCHAR index);
+
+    /**
+     * \fn      conn_arena_alloc
+     * \brief   Take a buffer from the arena of a connection instance; valid
+     *          until the next conn_arena_reset() of that instance
+     * \param   index       sdk_status[] index
+     * \param   size        Size in bytes
+     * \return  UCHAR *     Word aligned buffer, NULL if the arena is full
+     */
+    UCHAR *conn_arena_alloc(UCHAR index, UINT16 size);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* _H_CONN_ARENA_ */
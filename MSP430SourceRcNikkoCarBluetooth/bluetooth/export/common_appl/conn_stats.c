@@ -0,0 +1,318 @@
+/**
+ * Copyright (C) 2010. MindTree Ltd.  All rights reserved.
+ *
+ * \file    conn_stats.c
+ * \brief   This file contains the connection setup statistics: time spent in
+ *          each connection state and the failure reasons, to tell where the
+ *          connection latency and the failed attempts come from.
+ */
+
+/* Header File Inclusion */
+#include "sdk_pl.h"
+#include "conn_stats.h"
+#include "hal_usb.h"
+
+#ifdef SDK_CONN_STATS
+
+/* Lock/unlock: states change in the BT read task and the user task */
+#define conn_stats_lock(state)          \
+    { (state) = __get_interrupt_state(); __disable_interrupt(); }
+#define conn_stats_unlock(state)        __set_interrupt_state(state)
+
+/* Extern variables */
+extern UCHAR sdk_usb_detected;
+
+/* Static variables */
+static CONN_STATS conn_stats;
+/**
+ * Tick at the entry of the current state, of the first setup state and of
+ * the first teardown state. The tick count is 16 bit: phases longer than
+ * 64 s are not measured correctly, none of the setup timeouts is that long.
+ */
+static portTickType conn_stats_state_start[SPP_MAX_ENTITY];
+static portTickType conn_stats_setup_start[SPP_MAX_ENTITY];
+static portTickType conn_stats_teardown_start[SPP_MAX_ENTITY];
+
+static const char *const conn_stats_phase_name[CONN_STATS_NUM_PHASES] = {
+    "acl     ",
+    "sdp     ",
+    "spp     ",
+    "setup   ",
+    "teardown"
+};
+
+static const char *const conn_stats_source_name[] = {
+    "acl ",
+    "sdp ",
+    "spp ",
+    "disc"
+};
+
+/* Static Function Declarations */
+static UCHAR conn_stats_is_setup(UCHAR state);
+static UCHAR conn_stats_is_teardown(UCHAR state);
+static void conn_stats_add(UCHAR phase, portTickType ticks);
+
+
+/**
+ * \fn      conn_stats_init
+ * \brief   Clear the statistics
+ * \param   void
+ * \return  void
+ */
+void conn_stats_init(void)
+{
+    unsigned short state;
+
+    conn_stats_lock(state);
+    memset(&conn_stats, 0, sizeof(conn_stats));
+    conn_stats_unlock(state);
+}
+
+/**
+ * \fn      conn_stats_state
+ * \brief   Time a connection state change
+ * \param   index       sdk_status[] index
+ * \param   from        State left
+ * \param   to          State entered
+ * \return  void
+ */
+void conn_stats_state(UCHAR index, UCHAR from, UCHAR to)
+{
+    unsigned short state;
+    portTickType now;
+    portTickType elapsed;
+
+    if ((SPP_MAX_ENTITY <= index) || (from == to)) {
+        return;
+    }
+
+    conn_stats_lock(state);
+
+    now = xTaskGetTickCount();
+    elapsed = now - conn_stats_state_start[index];
+    conn_stats_state_start[index] = now;
+
+    /* Phase left: a success if the next setup state is entered */
+    switch (from) {
+    case SDK_IN_ACL_CONNECTION:
+        if ((SDK_ACL_CONNECTED == to) || (SDK_IN_SDP_QUERY == to)) {
+            conn_stats_add(CONN_STATS_PHASE_ACL, elapsed);
+        } else {
+            conn_stats.phase[CONN_STATS_PHASE_ACL].failed++;
+        }
+        break;
+
+    case SDK_IN_SDP_QUERY:
+        if (SDK_IN_SPP_CONNECTION == to) {
+            conn_stats_add(CONN_STATS_PHASE_SDP, elapsed);
+        } else {
+            conn_stats.phase[CONN_STATS_PHASE_SDP].failed++;
+        }
+        break;
+
+    case SDK_IN_SPP_CONNECTION:
+        if (SDK_SPP_CONNECTED == to) {
+            conn_stats_add(CONN_STATS_PHASE_SPP, elapsed);
+        } else {
+            conn_stats.phase[CONN_STATS_PHASE_SPP].failed++;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    /* Whole setup, from the page or the peer connection */
+    if ((TRUE != conn_stats_is_setup(from)) &&
+        (TRUE == conn_stats_is_setup(to))) {
+        conn_stats_setup_start[index] = now;
+    } else if (TRUE == conn_stats_is_setup(from)) {
+        if (SDK_SPP_CONNECTED == to) {
+            conn_stats_add(CONN_STATS_PHASE_SETUP,
+                           now - conn_stats_setup_start[index]);
+        } else if (TRUE != conn_stats_is_setup(to)) {
+            conn_stats.phase[CONN_STATS_PHASE_SETUP].failed++;
+        }
+    }
+
+    /* Teardown, from the first disconnection step */
+    if ((TRUE != conn_stats_is_teardown(from)) &&
+        (TRUE == conn_stats_is_teardown(to))) {
+        conn_stats_teardown_start[index] = now;
+    } else if ((TRUE == conn_stats_is_teardown(from)) &&
+               (SDK_DISCONNECTED == to)) {
+        conn_stats_add(CONN_STATS_PHASE_TEARDOWN,
+                       now - conn_stats_teardown_start[index]);
+    }
+
+    conn_stats_unlock(state);
+}
+
+/**
+ * \fn      conn_stats_reason
+ * \brief   Count a failure or disconnection reason
+ * \param   source      CONN_STATS_SRC_*
+ * \param   code        HCI status/reason, SDP status or SPP result
+ * \return  void
+ */
+void conn_stats_reason(UCHAR source, UINT16 code)
+{
+    CONN_STATS_REASON_ENTRY *entry;
+    unsigned short state;
+    UCHAR index;
+
+    conn_stats_lock(state);
+
+    for (index = 0; index < CONN_STATS_MAX_REASONS; index++) {
+        entry = &conn_stats.reason[index];
+        if (0 == entry->count) {
+            /* First free entry: the pair was not seen before */
+            entry->source = source;
+            entry->code = code;
+        }
+        if ((source == entry->source) && (code == entry->code)) {
+            if (0xFFFF != entry->count) {
+                entry->count++;
+            }
+            break;
+        }
+    }
+    if (CONN_STATS_MAX_REASONS == index) {
+        conn_stats.reasons_dropped++;
+    }
+
+    conn_stats_unlock(state);
+}
+
+/**
+ * \fn      conn_stats_get
+ * \brief   Copy the statistics
+ * \param   stats       Filled with a snapshot
+ * \return  void
+ */
+void conn_stats_get(CONN_STATS * stats)
+{
+    unsigned short state;
+
+    conn_stats_lock(state);
+    memcpy(stats, &conn_stats, sizeof(CONN_STATS));
+    conn_stats_unlock(state);
+}
+
+/**
+ * \fn      conn_stats_dump
+ * \brief   Print the statistics on the USB serial port
+ * \param   void
+ * \return  void
+ */
+void conn_stats_dump(void)
+{
+    CONN_STATS_HIST *hist;
+    UCHAR index;
+    UCHAR n;
+
+    if (TRUE != sdk_usb_detected) {
+        return;
+    }
+
+    halUsbSendString("\nConnection setup (ms)\n");
+    for (index = 0; index < CONN_STATS_NUM_PHASES; index++) {
+        hist = &conn_stats.phase[index];
+        halUsbSendString((const UCHAR *)conn_stats_phase_name[index]);
+        halUsbSendNumber((const UCHAR *)" n=", hist->count);
+        halUsbSendNumber((const UCHAR *)" failed=", hist->failed);
+        halUsbSendNumber((const UCHAR *)" min=", hist->min);
+        halUsbSendNumber((const UCHAR *)" avg=",
+                         (0 == hist->count) ? 0 : (hist->sum / hist->count));
+        halUsbSendNumber((const UCHAR *)" max=", hist->max);
+        halUsbSendString("\n  log2:");
+        for (n = 0; n < CONN_STATS_NUM_BUCKETS; n++) {
+            halUsbSendNumber((const UCHAR *)" ", hist->bucket[n]);
+        }
+        halUsbSendChar('\n');
+    }
+
+    halUsbSendString("Failure reasons\n");
+    for (index = 0; index < CONN_STATS_MAX_REASONS; index++) {
+        if (0 == conn_stats.reason[index].count) {
+            break;
+        }
+        halUsbSendString((const UCHAR *)
+                         conn_stats_source_name[conn_stats.reason[index].
+                                                source]);
+        halUsbSendNumber((const UCHAR *)" code=",
+                         conn_stats.reason[index].code);
+        halUsbSendNumber((const UCHAR *)" n=", conn_stats.reason[index].count);
+        halUsbSendChar('\n');
+    }
+    halUsbSendNumber((const UCHAR *)"dropped=", conn_stats.reasons_dropped);
+    halUsbSendChar('\n');
+}
+
+
+/**
+ * \fn      conn_stats_is_setup
+ * \brief   Is the state one of the connection setup states ?
+ * \param   state       SDK_* connection state
+ * \return  UCHAR       TRUE/FALSE
+ */
+static UCHAR conn_stats_is_setup(UCHAR state)
+{
+    return ((SDK_IN_ACL_CONNECTION == state) || (SDK_ACL_CONNECTED == state) ||
+            (SDK_IN_SDP_QUERY == state) || (SDK_IN_SPP_CONNECTION == state)) ?
+        TRUE : FALSE;
+}
+
+/**
+ * \fn      conn_stats_is_teardown
+ * \brief   Is the state one of the disconnection states ?
+ * \param   state       SDK_* connection state
+ * \return  UCHAR       TRUE/FALSE
+ */
+static UCHAR conn_stats_is_teardown(UCHAR state)
+{
+    return ((SDK_IN_SPP_DISCONNECTION == state) ||
+            (SDK_SPP_DISCONNECTED == state) ||
+            (SDK_IN_ACL_DISCONNECTION == state)) ? TRUE : FALSE;
+}
+
+/**
+ * \fn      conn_stats_add
+ * \brief   Add a sample to the histogram of a phase
+ * \param   phase       CONN_STATS_PHASE_*
+ * \param   ticks       Duration in RTOS ticks
+ * \return  void
+ */
+static void conn_stats_add(UCHAR phase, portTickType ticks)
+{
+    CONN_STATS_HIST *hist = &conn_stats.phase[phase];
+    UINT32 ms;
+    UINT32 value;
+    UCHAR n = 0;
+
+    /* Saturate rather than wrap, the report is still meaningful */
+    if (0xFFFF == hist->count) {
+        return;
+    }
+
+    ms = ((UINT32)ticks * 1000UL) / configTICK_RATE_HZ;
+
+    value = ms;
+    while ((0 != value) && (n < (CONN_STATS_NUM_BUCKETS - 1))) {
+        value >>= 1;
+        n++;
+    }
+    hist->bucket[n]++;
+
+    if ((0 == hist->count) || (ms < hist->min)) {
+        hist->min = ms;
+    }
+    if (ms > hist->max) {
+        hist->max = ms;
+    }
+    hist->sum += ms;
+    hist->count++;
+}
+
+#endif /* SDK_CONN_STATS */
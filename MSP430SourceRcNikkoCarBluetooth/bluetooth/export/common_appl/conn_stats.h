@@ -0,0 +1,152 @@
+/**
+ * Copyright (C) 2010. MindTree Ltd.  All rights reserved.
+ *
+ * \file    conn_stats.h
+ * \brief   This file contains the declarations of the connection setup
+ *          statistics.
+ *
+ *          Every sdk_status[].connect_switch change made through
+ *          SDK_SPP_CHANGE_STATE() is timed. The time spent in each setup
+ *          state (ACL, SDP, SPP), the whole setup and the teardown are kept
+ *          in log2 histograms of milliseconds, with a count of the attempts
+ *          which left the state for anything but the next setup state. The
+ *          HCI, SDP and SPP failure codes and the HCI disconnection reasons
+ *          are counted in a table of reasons.
+ */
+
+#ifndef _H_CONN_STATS_
+#define _H_CONN_STATS_
+
+/* Header File Inclusion */
+#include "BT_common.h"
+#include "sdk_bluetooth_config.h"
+
+#ifdef SDK_CONN_STATS
+
+/* Number of log2 buckets per histogram; bucket n holds [2^(n-1), 2^n) ms */
+#define CONN_STATS_NUM_BUCKETS              16
+
+/* Phases */
+/* SDK_IN_ACL_CONNECTION: page and ACL setup */
+#define CONN_STATS_PHASE_ACL                0x00
+/* SDK_IN_SDP_QUERY: SDP connection and SPP server channel search */
+#define CONN_STATS_PHASE_SDP                0x01
+/* SDK_IN_SPP_CONNECTION: RFCOMM and SPP connection */
+#define CONN_STATS_PHASE_SPP                0x02
+/* First setup state to SDK_SPP_CONNECTED */
+#define CONN_STATS_PHASE_SETUP              0x03
+/* First teardown state to SDK_DISCONNECTED */
+#define CONN_STATS_PHASE_TEARDOWN           0x04
+#define CONN_STATS_NUM_PHASES               0x05
+
+/* Sources of the failure reasons */
+/* HCI Connection Complete status */
+#define CONN_STATS_SRC_ACL                  0x00
+/* SDP callback status */
+#define CONN_STATS_SRC_SDP                  0x01
+/* SPP_CONNECT_CNF result */
+#define CONN_STATS_SRC_SPP                  0x02
+/* HCI Disconnection Complete reason */
+#define CONN_STATS_SRC_DISCONNECT           0x03
+
+/* Number of distinct source/code pairs counted */
+#define CONN_STATS_MAX_REASONS              8
+
+/**
+ * Hooks; the state hook is called by SDK_SPP_CHANGE_STATE() before the new
+ * state is written.
+ */
+#define CONN_STATS_STATE(index, state)  \
+    conn_stats_state((index), sdk_status[(index)].connect_switch, (state))
+#define CONN_STATS_REASON(source, code) \
+    conn_stats_reason((source), (UINT16)(code))
+
+/* Histogram of one phase, in milliseconds */
+typedef struct {
+    UINT32 min;
+    UINT32 max;
+    UINT32 sum;
+    UINT16 count;
+    /* Attempts which left the phase on a failure */
+    UINT16 failed;
+    UINT16 bucket[CONN_STATS_NUM_BUCKETS];
+} CONN_STATS_HIST;
+
+/* Failure reason */
+typedef struct {
+    UINT16 code;
+    UINT16 count;
+    UCHAR source;
+    UCHAR reserved;
+} CONN_STATS_REASON_ENTRY;
+
+/* All the statistics, as sent on the SPP link */
+typedef struct {
+    CONN_STATS_HIST phase[CONN_STATS_NUM_PHASES];
+    CONN_STATS_REASON_ENTRY reason[CONN_STATS_MAX_REASONS];
+    /* Reasons not counted, the table being full */
+    UINT16 reasons_dropped;
+} CONN_STATS;
+
+#else /* SDK_CONN_STATS */
+
+#define CONN_STATS_STATE(index, state)      ((void)0)
+#define CONN_STATS_REASON(source, code)
+
+#endif /* SDK_CONN_STATS */
+
+
+#ifdef SDK_CONN_STATS
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * \fn      conn_stats_init
+     * \brief   Clear the statistics
+     * \param   void
+     * \return  void
+     */
+    void conn_stats_init(void);
+
+    /**
+     * \fn      conn_stats_state
+     * \brief   Time a connection state change
+     * \param   index       sdk_status[] index
+     * \param   from        State left
+     * \param   to          State entered
+     * \return  void
+     */
+    void conn_stats_state(UCHAR index, UCHAR from, UCHAR to);
+
+    /**
+     * \fn      conn_stats_reason
+     * \brief   Count a failure or disconnection reason
+     * \param   source      CONN_STATS_SRC_*
+     * \param   code        HCI status/reason, SDP status or SPP result
+     * \return  void
+     */
+    void conn_stats_reason(UCHAR source, UINT16 code);
+
+    /**
+     * \fn      conn_stats_get
+     * \brief   Copy the statistics
+     * \param   stats       Filled with a snapshot
+     * \return  void
+     */
+    void conn_stats_get(CONN_STATS * stats);
+
+    /**
+     * \fn      conn_stats_dump
+     * \brief   Print the statistics on the USB serial port
+     * \param   void
+     * \return  void
+     */
+    void conn_stats_dump(void);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* SDK_CONN_STATS */
+
+#endif /* _H_CONN_STATS_ */
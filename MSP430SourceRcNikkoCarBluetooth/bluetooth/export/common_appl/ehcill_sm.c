@@ -0,0 +1,251 @@
+/**
+ * Copyright (C) 2010. MindTree Ltd.  All rights reserved.
+ *
+ * \file    ehcill_sm.c
+ * \brief   This file contains the table driven ehcill sleep/wake state
+ *          machine. It has no platform dependency; the platform glue is in
+ *          appl_bt_rf.c.
+ */
+
+/* Header File Inclusion */
+#include "ehcill_sm.h"
+
+#ifndef NULL
+#define NULL ((void *)0)
+#endif /* NULL */
+
+/* Shorthand for the transition table */
+#define T(state, actions)   { EHCILL_STATE_##state, (actions) }
+#define ERR(state)          T(state, EHCILL_ACT_ERROR)
+
+/**
+ * Transition table: [current state][event] -> next state, actions.
+ * Keep the rows in EHCILL_STATE_* order and the columns in EHCILL_EV_* order.
+ */
+static const EHCILL_SM_TRANSITION
+    ehcill_sm_table[EHCILL_NUM_STATES][EHCILL_NUM_EVENTS] = {
+    /* EHCILL_STATE_AWAKE */
+    {
+     /* RX_SLEEP_IND: acknowledge once the TX path is free */
+     T(SLEEP_ACK_PENDING, EHCILL_ACT_KICK_TX),
+     ERR(AWAKE),
+     /* RX_WAKE_IND: seen while debugging, nothing to do */
+     T(AWAKE, EHCILL_ACT_NONE),
+     ERR(AWAKE),
+     T(AWAKE, EHCILL_ACT_NONE),
+     T(AWAKE, EHCILL_ACT_NONE),
+     T(AWAKE, EHCILL_ACT_NONE),
+     T(AWAKE, EHCILL_ACT_ENABLE_UART)
+     },
+    /* EHCILL_STATE_SLEEP_ACK_PENDING */
+    {
+     ERR(SLEEP_ACK_PENDING),
+     ERR(SLEEP_ACK_PENDING),
+     ERR(SLEEP_ACK_PENDING),
+     ERR(SLEEP_ACK_PENDING),
+     ERR(SLEEP_ACK_PENDING),
+     /* TX_IDLE: send SLEEP_ACK and shut the UART down */
+     T(ASLEEP,
+       EHCILL_ACT_ENABLE_CTS_INT | EHCILL_ACT_SEND_SLEEP_ACK |
+       EHCILL_ACT_DISABLE_UART),
+     /* TX_DATA: held back until the handshake is over */
+     T(SLEEP_ACK_PENDING, EHCILL_ACT_NONE),
+     T(SLEEP_ACK_PENDING, EHCILL_ACT_ENABLE_UART)
+     },
+    /* EHCILL_STATE_ASLEEP */
+    {
+     ERR(ASLEEP),
+     ERR(ASLEEP),
+     /* RX_WAKE_IND: controller initiated wake */
+     T(WAKE_ACK_PENDING, EHCILL_ACT_KICK_TX),
+     ERR(ASLEEP),
+     /* RX_PACKET: counted, the packet itself is still delivered */
+     T(ASLEEP, EHCILL_ACT_NONE),
+     T(ASLEEP, EHCILL_ACT_NONE),
+     /* TX_DATA: host initiated wake */
+     T(WAKE_IND_SENT, EHCILL_ACT_SEND_WAKE_IND),
+     T(ASLEEP, EHCILL_ACT_ENABLE_UART)
+     },
+    /* EHCILL_STATE_WAKE_IND_SENT */
+    {
+     /* RX_SLEEP_IND: collision case 2 */
+     T(WAKE_IND_SENT, EHCILL_ACT_COLLISION),
+     ERR(WAKE_IND_SENT),
+     /* RX_WAKE_IND: collision case 1, both sides woke up; no WAKE_ACK
+      * will come, resume the pending data now */
+     T(AWAKE, EHCILL_ACT_DISABLE_CTS_INT | EHCILL_ACT_KICK_TX),
+     /* RX_WAKE_ACK: resume the pending data */
+     T(AWAKE, EHCILL_ACT_DISABLE_CTS_INT | EHCILL_ACT_KICK_TX),
+     T(WAKE_IND_SENT, EHCILL_ACT_NONE),
+     T(WAKE_IND_SENT, EHCILL_ACT_NONE),
+     T(WAKE_IND_SENT, EHCILL_ACT_NONE),
+     T(WAKE_IND_SENT, EHCILL_ACT_ENABLE_UART)
+     },
+    /* EHCILL_STATE_WAKE_ACK_PENDING */
+    {
+     ERR(WAKE_ACK_PENDING),
+     ERR(WAKE_ACK_PENDING),
+     /* RX_WAKE_IND: repeated indication, treat the link as awake */
+     T(AWAKE, EHCILL_ACT_DISABLE_CTS_INT),
+     ERR(WAKE_ACK_PENDING),
+     T(WAKE_ACK_PENDING, EHCILL_ACT_NONE),
+     /* TX_IDLE / TX_DATA: send WAKE_ACK */
+     T(AWAKE, EHCILL_ACT_SEND_WAKE_ACK | EHCILL_ACT_DISABLE_CTS_INT),
+     T(AWAKE, EHCILL_ACT_SEND_WAKE_ACK | EHCILL_ACT_DISABLE_CTS_INT),
+     T(WAKE_ACK_PENDING, EHCILL_ACT_ENABLE_UART)
+     }
+};
+
+/* Current state */
+static volatile UCHAR ehcill_sm_state = EHCILL_STATE_AWAKE;
+
+/* Statistics */
+static EHCILL_SM_STATS ehcill_sm_stats;
+
+/* Time the current wake handshake started */
+static UINT32 ehcill_sm_wake_start;
+
+#ifdef EHCILL_SM_ENABLE_TRACE
+static EHCILL_SM_TRACE_ENTRY ehcill_sm_trace[EHCILL_SM_TRACE_SIZE];
+static UCHAR ehcill_sm_trace_wr = 0;
+static UCHAR ehcill_sm_trace_count = 0;
+#endif /* EHCILL_SM_ENABLE_TRACE */
+
+
+/**
+ * \fn      ehcill_sm_init
+ * \brief   Reset the state machine to awake and clear the statistics
+ * \param   timestamp   Current time
+ * \return  void
+ */
+void ehcill_sm_init(UINT32 timestamp)
+{
+    UCHAR *p = (UCHAR *) & ehcill_sm_stats;
+    UINT16 i;
+
+    for (i = 0; i < sizeof(ehcill_sm_stats); i++) {
+        p[i] = 0;
+    }
+    ehcill_sm_state = EHCILL_STATE_AWAKE;
+    ehcill_sm_stats.state_entry_time = timestamp;
+    ehcill_sm_wake_start = timestamp;
+
+#ifdef EHCILL_SM_ENABLE_TRACE
+    ehcill_sm_trace_wr = 0;
+    ehcill_sm_trace_count = 0;
+#endif /* EHCILL_SM_ENABLE_TRACE */
+}
+
+/**
+ * \fn      ehcill_sm_handle_event
+ * \brief   Run one event through the transition table
+ * \param   event       EHCILL_EV_* event
+ * \param   timestamp   Time of the event
+ * \return  UINT16      EHCILL_ACT_* actions to be performed
+ */
+UINT16 ehcill_sm_handle_event(UCHAR event, UINT32 timestamp)
+{
+    const EHCILL_SM_TRANSITION *transition;
+    UCHAR from_state;
+    UINT32 elapsed;
+
+    from_state = ehcill_sm_state;
+    if ((EHCILL_NUM_EVENTS <= event) || (EHCILL_NUM_STATES <= from_state)) {
+        ehcill_sm_stats.error_count++;
+        return EHCILL_ACT_ERROR;
+    }
+
+    transition = &ehcill_sm_table[from_state][event];
+
+    if (transition->actions & (EHCILL_ACT_ERROR | EHCILL_ACT_COLLISION)) {
+        ehcill_sm_stats.error_count++;
+    }
+    if ((EHCILL_EV_RX_PACKET == event) && (EHCILL_STATE_ASLEEP == from_state)) {
+        ehcill_sm_stats.rx_while_asleep++;
+    }
+
+    if (transition->next_state != from_state) {
+        elapsed = timestamp - ehcill_sm_stats.state_entry_time;
+
+        /* Sleep accounting */
+        if (EHCILL_STATE_ASLEEP == transition->next_state) {
+            ehcill_sm_stats.sleep_count++;
+        }
+        if (EHCILL_STATE_ASLEEP == from_state) {
+            ehcill_sm_stats.asleep_time += elapsed;
+            ehcill_sm_wake_start = timestamp;
+        }
+
+        /* Wake latency, measured from leaving the asleep state */
+        if (EHCILL_STATE_AWAKE == transition->next_state) {
+            elapsed = timestamp - ehcill_sm_wake_start;
+            if (EHCILL_STATE_WAKE_IND_SENT == from_state) {
+                ehcill_sm_stats.host_wake_count++;
+                if (elapsed > ehcill_sm_stats.max_host_wake_time) {
+                    ehcill_sm_stats.max_host_wake_time = elapsed;
+                }
+            } else if (EHCILL_STATE_WAKE_ACK_PENDING == from_state) {
+                ehcill_sm_stats.ctrl_wake_count++;
+                if (elapsed > ehcill_sm_stats.max_ctrl_wake_time) {
+                    ehcill_sm_stats.max_ctrl_wake_time = elapsed;
+                }
+            }
+        }
+
+        ehcill_sm_state = transition->next_state;
+        ehcill_sm_stats.state_entry_time = timestamp;
+
+#ifdef EHCILL_SM_ENABLE_TRACE
+        ehcill_sm_trace[ehcill_sm_trace_wr].timestamp = timestamp;
+        ehcill_sm_trace[ehcill_sm_trace_wr].from_state = from_state;
+        ehcill_sm_trace[ehcill_sm_trace_wr].event = event;
+        ehcill_sm_trace[ehcill_sm_trace_wr].to_state = transition->next_state;
+        ehcill_sm_trace_wr =
+            (ehcill_sm_trace_wr + 1) & (EHCILL_SM_TRACE_SIZE - 1);
+        if (ehcill_sm_trace_count < EHCILL_SM_TRACE_SIZE) {
+            ehcill_sm_trace_count++;
+        }
+#endif /* EHCILL_SM_ENABLE_TRACE */
+    }
+
+    return transition->actions;
+}
+
+/**
+ * \fn      ehcill_sm_get_state
+ * \brief   Returns the current state
+ * \param   void
+ * \return  UCHAR       EHCILL_STATE_*
+ */
+UCHAR ehcill_sm_get_state(void)
+{
+    return ehcill_sm_state;
+}
+
+/**
+ * \fn      ehcill_sm_get_stats
+ * \brief   Returns the state machine statistics
+ * \param   void
+ * \return  const EHCILL_SM_STATS *
+ */
+const EHCILL_SM_STATS *ehcill_sm_get_stats(void)
+{
+    return &ehcill_sm_stats;
+}
+
+#ifdef EHCILL_SM_ENABLE_TRACE
+/**
+ * \fn      ehcill_sm_get_trace
+ * \brief   Returns a recorded transition, 0 being the most recent
+ * \param   age     How many transitions back
+ * \return  const EHCILL_SM_TRACE_ENTRY *, NULL if not recorded
+ */
+const EHCILL_SM_TRACE_ENTRY *ehcill_sm_get_trace(UCHAR age)
+{
+    if (age >= ehcill_sm_trace_count) {
+        return NULL;
+    }
+    return &ehcill_sm_trace[(ehcill_sm_trace_wr - 1 - age) &
+                            (EHCILL_SM_TRACE_SIZE - 1)];
+}
+#endif /* EHCILL_SM_ENABLE_TRACE */
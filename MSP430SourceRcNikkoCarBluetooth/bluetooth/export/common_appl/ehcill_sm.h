@@ -0,0 +1,190 @@
+/**
+ * Copyright (C) 2010. MindTree Ltd.  All rights reserved.
+ *
+ * \file    ehcill_sm.h
+ * \brief   This file contains the declarations of the table driven ehcill
+ *          sleep/wake state machine.
+ *
+ *          The state machine has no MSP430 or UART dependency: it consumes
+ *          events and returns the actions the platform has to perform. Define
+ *          EHCILL_SM_HOST_BUILD to compile it on a host (Linux) build to run
+ *          scripted controller sleep/wake sequences against it.
+ */
+
+#ifndef _H_EHCILL_SM_
+#define _H_EHCILL_SM_
+
+/* Header File Inclusion */
+#ifdef EHCILL_SM_HOST_BUILD
+#include <stdint.h>
+typedef uint8_t UCHAR;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+#else
+#include "BT_common.h"
+#endif /* EHCILL_SM_HOST_BUILD */
+
+/* Flag to keep a trace of the last state machine transitions */
+#define EHCILL_SM_ENABLE_TRACE
+/* Number of transitions kept in the trace (power of 2) */
+#define EHCILL_SM_TRACE_SIZE                8
+
+/* ehcill protocol bytes */
+#define SDK_BT_RF_SLEEP_IND                 0x30
+#define SDK_BT_RF_SLEEP_ACK                 0x31
+#define SDK_BT_RF_WAKE_UP_IND               0x32
+#define SDK_BT_RF_WAKE_UP_ACK               0x33
+
+/* States */
+/* Host and controller awake, UART in use */
+#define EHCILL_STATE_AWAKE                  0x00
+/* SLEEP_IND received; SLEEP_ACK to be sent once the UART TX is idle */
+#define EHCILL_STATE_SLEEP_ACK_PENDING      0x01
+/* Both sides asleep, UART disabled, CTS armed as wake interrupt */
+#define EHCILL_STATE_ASLEEP                 0x02
+/* Host has data: WAKE_IND sent, waiting for WAKE_ACK */
+#define EHCILL_STATE_WAKE_IND_SENT          0x03
+/* Controller woke us: WAKE_IND received, WAKE_ACK to be sent */
+#define EHCILL_STATE_WAKE_ACK_PENDING       0x04
+#define EHCILL_NUM_STATES                   0x05
+
+/* Events */
+/* ehcill bytes received on the BT UART */
+#define EHCILL_EV_RX_SLEEP_IND              0x00
+#define EHCILL_EV_RX_SLEEP_ACK              0x01
+#define EHCILL_EV_RX_WAKE_IND               0x02
+#define EHCILL_EV_RX_WAKE_ACK               0x03
+/* First byte of an HCI packet received */
+#define EHCILL_EV_RX_PACKET                 0x04
+/* UART TX drained at a packet boundary */
+#define EHCILL_EV_TX_IDLE                   0x05
+/* Host has HCI data queued for transmission */
+#define EHCILL_EV_TX_DATA                   0x06
+/* Controller pulsed CTS */
+#define EHCILL_EV_CTS_EDGE                  0x07
+#define EHCILL_NUM_EVENTS                   0x08
+
+/* Actions, performed by the platform in the order listed */
+#define EHCILL_ACT_NONE                     0x0000
+/* Re-enable the UART after a CTS wake pulse and assert RTS */
+#define EHCILL_ACT_ENABLE_UART              0x0001
+/* Arm CTS as wake interrupt */
+#define EHCILL_ACT_ENABLE_CTS_INT           0x0002
+/* Return CTS to flow control */
+#define EHCILL_ACT_DISABLE_CTS_INT          0x0004
+/* Send SLEEP_ACK and wait for it to leave the shift register */
+#define EHCILL_ACT_SEND_SLEEP_ACK           0x0008
+/* Shut the UART down for sleep */
+#define EHCILL_ACT_DISABLE_UART             0x0010
+/* Assert RTS and send WAKE_IND */
+#define EHCILL_ACT_SEND_WAKE_IND            0x0020
+/* Send WAKE_ACK */
+#define EHCILL_ACT_SEND_WAKE_ACK            0x0040
+/* Raise a TX interrupt to continue the handshake or pending data */
+#define EHCILL_ACT_KICK_TX                  0x0080
+/* WAKE_IND sent while the controller asked to sleep */
+#define EHCILL_ACT_COLLISION                0x0100
+/* Event not valid in the current state */
+#define EHCILL_ACT_ERROR                    0x0200
+
+/* State machine queries */
+#define EHCILL_SM_IS_ASLEEP()  \
+    (EHCILL_STATE_ASLEEP == ehcill_sm_get_state())
+
+/* Host side is not allowed to transmit HCI data */
+#define EHCILL_SM_IS_HOST_ASLEEP()  \
+    (EHCILL_STATE_ASLEEP <= ehcill_sm_get_state())
+
+/* A handshake byte is waiting for the UART TX to drain */
+#define EHCILL_SM_HANDSHAKE_STATES  \
+    ((1 << EHCILL_STATE_SLEEP_ACK_PENDING) | \
+     (1 << EHCILL_STATE_WAKE_IND_SENT) | \
+     (1 << EHCILL_STATE_WAKE_ACK_PENDING))
+#define EHCILL_SM_IS_HANDSHAKE_PENDING()  \
+    (0 != ((1 << ehcill_sm_get_state()) & EHCILL_SM_HANDSHAKE_STATES))
+
+/* Transition table entry */
+typedef struct {
+    UCHAR next_state;
+    UINT16 actions;
+} EHCILL_SM_TRANSITION;
+
+/* Timestamped transition kept in the trace */
+typedef struct {
+    UINT32 timestamp;
+    UCHAR from_state;
+    UCHAR event;
+    UCHAR to_state;
+} EHCILL_SM_TRACE_ENTRY;
+
+/* State machine statistics */
+typedef struct {
+    /* Timestamp of the last state change */
+    UINT32 state_entry_time;
+    /* Time spent with the controller link asleep */
+    UINT32 asleep_time;
+    /* Longest host initiated wake (WAKE_IND sent to WAKE_ACK received) */
+    UINT32 max_host_wake_time;
+    /* Longest controller initiated wake (WAKE_IND received to awake) */
+    UINT32 max_ctrl_wake_time;
+    UINT16 sleep_count;
+    UINT16 host_wake_count;
+    UINT16 ctrl_wake_count;
+    /* HCI packets received while the link was asleep; must stay 0 */
+    UINT16 rx_while_asleep;
+    UINT16 error_count;
+} EHCILL_SM_STATS;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * \fn      ehcill_sm_init
+     * \brief   Reset the state machine to awake and clear the statistics
+     * \param   timestamp   Current time
+     * \return  void
+     */
+    void ehcill_sm_init(UINT32 timestamp);
+
+    /**
+     * \fn      ehcill_sm_handle_event
+     * \brief   Run one event through the transition table
+     * \param   event       EHCILL_EV_* event
+     * \param   timestamp   Time of the event
+     * \return  UINT16      EHCILL_ACT_* actions to be performed
+     */
+    UINT16 ehcill_sm_handle_event(UCHAR event, UINT32 timestamp);
+
+    /**
+     * \fn      ehcill_sm_get_state
+     * \brief   Returns the current state
+     * \param   void
+     * \return  UCHAR       EHCILL_STATE_*
+     */
+    UCHAR ehcill_sm_get_state(void);
+
+    /**
+     * \fn      ehcill_sm_get_stats
+     * \brief   Returns the state machine statistics
+     * \param   void
+     * \return  const EHCILL_SM_STATS *
+     */
+    const EHCILL_SM_STATS *ehcill_sm_get_stats(void);
+
+#ifdef EHCILL_SM_ENABLE_TRACE
+    /**
+     * \fn      ehcill_sm_get_trace
+     * \brief   Returns a recorded transition, 0 being the most recent
+     * \param   age     How many transitions back
+     * \return  const EHCILL_SM_TRACE_ENTRY *, NULL if not recorded
+     */
+    const EHCILL_SM_TRACE_ENTRY *ehcill_sm_get_trace(UCHAR age);
+#endif /* EHCILL_SM_ENABLE_TRACE */
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* _H_EHCILL_SM_ */
@@ -107,21 +107,3 @@ void sdkPlatformInit(void)
     sdk_appl_init();
 
 }
-
-/**
- * \fn      configTimer1_A3
- * \brief   This Function configures Timer1_A3, which is used by application as
- *          reference timer to handle menu and LED related functionalities.
- *          Timer1_A3 is configured for up mode, thus the timer overflows when
- *          TAR counts to CCR0 and interrupt is generated. ACLK(32768Hz) is used
- *          as clock source and CCR0 is set to 0x8000. So, output Time period
- *          is = 1sec.
- * \param   void
- * \return  void
- */
-void configTimer1_A3(void)
-{
-    TA1CCR0 = 0x8000;
-    TA1CCTL0 = CCIE;
-    TA1CTL = TASSEL_1 + MC_1 + TACLR;
-}
@@ -37,6 +37,14 @@
 
 /* Maximum number of devices discovered during Inquiry */
 #define SDK_INQ_MAX_DEVICES                 0x07
+/* Size of the BD_ADDR hash of the discovered devices, a power of two */
+#define SDK_INQ_HASH_SIZE                   16
+
+/**
+ * Size of the ACL handle, SPP handle and BD_ADDR lookup maps of the
+ * connection instances, a power of two of at least twice SPP_MAX_ENTITY
+ */
+#define SDK_STATUS_MAP_SIZE                 4
 
 /* SDK Class of Device Field */
 #define SDK_CONFIG_COD               BT_MSC_LIM_DISC_MODE|BT_MDC_TOY|BT_TMC_GAME
@@ -65,6 +73,12 @@
 /* SDP query buffer length for SPP */
 #define SDK_SPP_ATTRIB_DATA_LEN              32
 
+/**
+ * Connection setup arena of each SPP connection instance (conn_arena.h), in
+ * bytes: holds the buffers of one connection attempt, the SDP attribute data.
+ */
+#define SDK_CONN_ARENA_SIZE                  SDK_SPP_ATTRIB_DATA_LEN
+
 /**
  *  Output Power level related configuration.
  *  supported output power range for SDK_MAX_OUTPUT_POWER_LEVEL is
@@ -95,12 +109,52 @@
 /* Define the inactivity period for MSP430 to enter LPM */
 #define INACTIVITY_TIMEOUT                  30
 
+/* Period of the inactivity check (sec), a divisor of INACTIVITY_TIMEOUT */
+#define INACTIVITY_CHECK_PERIOD             10
+
 /* Enable MSP430 LPM feature */
 #define MSP430_LPM_ENABLE
 
 /* Define the low power mode for MSP430 */
 #define SDK_MSP430_LPM                      MSP430_LPM_3
 
+/**
+ * Enable the wake latency instrumentation (LPM exit / controller wake to the
+ * first HCI packet). Needs configUSE_TICKLESS_IDLE for the timestamps.
+ */
+#define SDK_WAKE_LATENCY_STATS
+
+/**
+ * Enable the residency profiler (CPU/LPM3/eHCILL/sniff/ACL and per task
+ * time, measurement.h). Needs configUSE_TICKLESS_IDLE and
+ * configUSE_RESIDENCY_PROFILER in FreeRTOSConfig.h.
+ */
+#define SDK_RESIDENCY_PROFILER
+
+/**
+ * Record the buffer pool allocations and frees in a RAM ring of
+ * SDK_POOL_TRACE_DEPTH entries (8 bytes each), drained on the USB serial
+ * port by the 't' SPP command and replayed by tools/pool_sizer.cpp.
+ */
+/* #define SDK_POOL_TRACE */
+#define SDK_POOL_TRACE_DEPTH                64
+
+/**
+ * Sample the stack high-water mark of each task from the idle hook and
+ * report the used and recommended stack sizes on the USB serial port ('k'
+ * SPP command, stack_monitor.h). Needs configUSE_STACK_MONITOR 1 in
+ * FreeRTOSConfig.h, checked by stack_monitor.c.
+ */
+#define SDK_STACK_MONITOR
+
+/**
+ * Time the connection setup states (ACL, SDP, SPP, whole setup, teardown)
+ * in histograms and count the HCI/SDP/SPP failure and disconnection
+ * reasons; printed on the USB serial port by the 'h' SPP command and sent
+ * back on the link by 'H' (conn_stats.h).
+ */
+#define SDK_CONN_STATS
+
 
 /* Macros for the debug messages */
 #ifdef DEBUG_TESTING
@@ -13,6 +13,8 @@
 #include "l2cap.h"
 #include "vendor_specific_init.h"
 #include "bt_sdk_error.h"
+#include "BT_buffer.h"
+#include "hal_usb.h"
 
 /* Extern variables */
 
@@ -38,6 +40,7 @@ extern UINT32 hci_vs_local_name_length_address;
 extern UCHAR hci_local_bd_addr[BT_BD_ADDR_SIZE];
 extern CHAR *hci_local_name;
 extern UINT32 sdk_error_code;
+extern UCHAR sdk_usb_detected;
 extern UCHAR vs_local_name_write_state;
 /* Change Local Name command parameter length */
 extern UCHAR vs_change_local_name_param_len;
@@ -54,9 +57,33 @@ BT_OS_THREAD_PROPERTY bt_os_thread_property[] = {
 
 CHAR *get_task_details(UCHAR index, volatile UINT16 * stack_size,
                        volatile UINT8 * priority);
+
+/* Static Function Declarations */
+static UCHAR appl_status_map_hash(UCHAR map, UCHAR id);
+static void appl_status_map_build(UCHAR map, UCHAR include, UCHAR exclude);
 /* spp connections status information */
 SDK_SPP_CONNECTION_STATUS sdk_status[SPP_MAX_ENTITY];
 
+#if ((SDK_STATUS_MAP_SIZE & (SDK_STATUS_MAP_SIZE - 1)) || \
+     (SDK_STATUS_MAP_SIZE < (2 * SPP_MAX_ENTITY)))
+#error "SDK_STATUS_MAP_SIZE: power of two of at least 2 * SPP_MAX_ENTITY"
+#endif
+
+/* sdk_status[] lookup maps */
+#define SDK_STATUS_MAP_ACL              0x00
+#define SDK_STATUS_MAP_SPP              0x01
+#define SDK_STATUS_MAP_ADDR             0x02
+#define SDK_STATUS_NUM_MAPS             0x03
+
+/**
+ * Open addressed, linearly probed maps from the ACL handle, the SPP handle
+ * and the peer BD_ADDR to the sdk_status[] instance. A slot holds the
+ * instance index + 1, 0 when free. The maps are rebuilt when a key is stored
+ * and when an instance is disconnected; a lookup checks the key and the
+ * state of the instance found, as the linear search did.
+ */
+static UCHAR sdk_status_map[SDK_STATUS_NUM_MAPS][SDK_STATUS_MAP_SIZE];
+
 /* Local Bluetooth Device Name */
 CHAR sdk_local_name[SDK_REM_BT_DEV_NAME_MAX_LEN] = "NAME            \0";
 
@@ -170,6 +197,69 @@ void sdk_uart_error_handler(void)
     fp();
 }
 
+/**
+ * \fn      sdk_pool_stats_dump
+ * \brief   Print the telemetry of the BT buffer pools on the USB serial port;
+ *          polled, usable with interrupts disabled
+ * \param   void
+ * \return  void
+ */
+void sdk_pool_stats_dump(void)
+{
+    OS_POOL_STATS stats;
+    UCHAR index;
+
+    if (TRUE != sdk_usb_detected) {
+        return;
+    }
+
+    halUsbSendString("\nBuffer pools\n");
+    for (index = 0; index < BT_POOL_MAX; index++) {
+        if (OK != OS_get_pool_stats(index, &stats)) {
+            continue;
+        }
+        halUsbSendNumber((const UCHAR *)"size=", stats.chunk_size);
+        halUsbSendNumber((const UCHAR *)" chunks=", stats.num_chunks);
+        halUsbSendNumber((const UCHAR *)" in_use=", stats.in_use);
+        halUsbSendNumber((const UCHAR *)" peak=", stats.peak_in_use);
+        halUsbSendNumber((const UCHAR *)" allocs=", stats.alloc_count);
+        halUsbSendNumber((const UCHAR *)" fails=", stats.fail_count);
+        halUsbSendNumber((const UCHAR *)" fallbacks=", stats.fallback_count);
+        halUsbSendNumber((const UCHAR *)" waste=", stats.fallback_waste);
+        halUsbSendChar('\n');
+    }
+}
+
+#ifdef SDK_POOL_TRACE
+/**
+ * \fn      sdk_pool_trace_dump
+ * \brief   Drain the buffer pool trace on the USB serial port, one
+ *          "T <timestamp> <op> <pool> <chunk> <size>" line per entry
+ * \param   void
+ * \return  void
+ */
+void sdk_pool_trace_dump(void)
+{
+    OS_POOL_TRACE_ENTRY entry;
+
+    if (TRUE != sdk_usb_detected) {
+        return;
+    }
+
+    halUsbSendNumber((const UCHAR *)"\nPool trace lost=",
+                     OS_pool_trace_lost());
+    halUsbSendChar('\n');
+    while (OK == OS_pool_trace_read(&entry)) {
+        halUsbSendNumber((const UCHAR *)"T ", entry.timestamp);
+        halUsbSendNumber((const UCHAR *)" ", entry.op_chunk >> 4);
+        halUsbSendNumber((const UCHAR *)" ", entry.pool);
+        halUsbSendNumber((const UCHAR *)" ", entry.op_chunk & 0x0F);
+        halUsbSendNumber((const UCHAR *)" ", entry.size);
+        halUsbSendChar('\n');
+    }
+}
+#endif /* SDK_POOL_TRACE */
+
 /**
  * \fn      appl_get_free_status_instance
  * \brief   Function to get free instance in sdk_status_array
@@ -413,14 +503,22 @@ void sdk_handle_init_sequence(UINT16 opcode, UCHAR status)
 API_RESULT appl_get_status_instance_acl(UCHAR * id,
                                         UINT16 acl_connection_handle)
 {
+    UCHAR slot;
+    UCHAR probe;
     UCHAR index;
 
-    for (index = 0; index < SPP_MAX_ENTITY; index++) {
+    slot = (UCHAR) (acl_connection_handle & (SDK_STATUS_MAP_SIZE - 1));
+    for (probe = 0; probe < SDK_STATUS_MAP_SIZE; probe++) {
+        if (0 == sdk_status_map[SDK_STATUS_MAP_ACL][slot]) {
+            break;
+        }
+        index = sdk_status_map[SDK_STATUS_MAP_ACL][slot] - 1;
         if ((acl_connection_handle == sdk_status[index].acl_connection_handle)
             && (!SDK_IS_DISCONNECTED(index))) {
             *id = index;
             return API_SUCCESS;
         }
+        slot = (slot + 1) & (SDK_STATUS_MAP_SIZE - 1);
     }
     sdk_display
         ("No Such SPP Connection instance available for this acl connection handle %04X\n",
@@ -439,14 +537,22 @@ API_RESULT appl_get_status_instance_acl(UCHAR * id,
 API_RESULT appl_get_status_instance_spp(UCHAR * id,
                                         UINT16 spp_connection_handle)
 {
+    UCHAR slot;
+    UCHAR probe;
     UCHAR index;
 
-    for (index = 0; index < SPP_MAX_ENTITY; index++) {
+    slot = (UCHAR) (spp_connection_handle & (SDK_STATUS_MAP_SIZE - 1));
+    for (probe = 0; probe < SDK_STATUS_MAP_SIZE; probe++) {
+        if (0 == sdk_status_map[SDK_STATUS_MAP_SPP][slot]) {
+            break;
+        }
+        index = sdk_status_map[SDK_STATUS_MAP_SPP][slot] - 1;
         if ((spp_connection_handle == sdk_status[index].spp_connection_handle)
             && (!SDK_IS_DISCONNECTED(index))) {
             *id = index;
             return API_SUCCESS;
         }
+        slot = (slot + 1) & (SDK_STATUS_MAP_SIZE - 1);
     }
     sdk_display
         ("No Such SPP Connection instance available for this SPP handle %04X\n",
@@ -463,21 +569,147 @@ API_RESULT appl_get_status_instance_spp(UCHAR * id,
  */
 API_RESULT appl_get_status_instance_bd_addr(UCHAR * id, UCHAR * rem_bd_addr)
 {
+    UCHAR slot;
+    UCHAR probe;
     UCHAR index;
 
-    for (index = 0; index < SPP_MAX_ENTITY; index++) {
+    slot = SDK_BD_ADDR_HASH(rem_bd_addr, SDK_STATUS_MAP_SIZE);
+    for (probe = 0; probe < SDK_STATUS_MAP_SIZE; probe++) {
+        if (0 == sdk_status_map[SDK_STATUS_MAP_ADDR][slot]) {
+            break;
+        }
+        index = sdk_status_map[SDK_STATUS_MAP_ADDR][slot] - 1;
         if (!memcmp(sdk_status[index].peer_bd_addr, rem_bd_addr, 6)
             && (!SDK_IS_DISCONNECTED(index))) {
             *id = index;
             return API_SUCCESS;
         }
+        slot = (slot + 1) & (SDK_STATUS_MAP_SIZE - 1);
     }
-    if (SPP_MAX_ENTITY == index) {
-        sdk_display("No Such SPP Connection instance available\n");
-    }
+    sdk_display("No Such SPP Connection instance available\n");
     return API_FAILURE;
 }
 
+/**
+ * \fn      appl_set_status_acl_handle
+ * \brief   Function to store the acl connection handle of an instance and
+ *          index it
+ * \param   id      sdk_status[] instance
+ * \param   acl_connection_handle Connection handle for ACL connection
+ * \return  void
+ */
+void appl_set_status_acl_handle(UCHAR id, UINT16 acl_connection_handle)
+{
+    sdk_status[id].acl_connection_handle = acl_connection_handle;
+    appl_status_map_build(SDK_STATUS_MAP_ACL, id, SPP_MAX_ENTITY);
+}
+
+/**
+ * \fn      appl_set_status_spp_handle
+ * \brief   Function to store the SPP connection handle of an instance and
+ *          index it
+ * \param   id      sdk_status[] instance
+ * \param   spp_connection_handle Connection handle for SPP connection
+ * \return  void
+ */
+void appl_set_status_spp_handle(UCHAR id, UINT16 spp_connection_handle)
+{
+    sdk_status[id].spp_connection_handle = spp_connection_handle;
+    appl_status_map_build(SDK_STATUS_MAP_SPP, id, SPP_MAX_ENTITY);
+}
+
+/**
+ * \fn      appl_set_status_bd_addr
+ * \brief   Function to store the peer bd address of an instance and index it
+ * \param   id      sdk_status[] instance
+ * \param   rem_bd_addr BT address of the peer
+ * \return  void
+ */
+void appl_set_status_bd_addr(UCHAR id, UCHAR * rem_bd_addr)
+{
+    BT_mem_copy(sdk_status[id].peer_bd_addr, rem_bd_addr, BT_BD_ADDR_SIZE);
+    appl_status_map_build(SDK_STATUS_MAP_ADDR, id, SPP_MAX_ENTITY);
+}
+
+/**
+ * \fn      appl_release_status_instance
+ * \brief   Function to drop a disconnected instance from the lookup maps
+ * \param   id      sdk_status[] instance
+ * \return  void
+ */
+void appl_release_status_instance(UCHAR id)
+{
+    UCHAR map;
+
+    for (map = 0; map < SDK_STATUS_NUM_MAPS; map++) {
+        appl_status_map_build(map, SPP_MAX_ENTITY, id);
+    }
+}
+
+/**
+ * \fn      appl_status_map_hash
+ * \brief   Function to get the home slot of an instance in a lookup map
+ * \param   map     SDK_STATUS_MAP_*
+ * \param   id      sdk_status[] instance
+ * \return  UCHAR   Slot
+ */
+static UCHAR appl_status_map_hash(UCHAR map, UCHAR id)
+{
+    switch (map) {
+    case SDK_STATUS_MAP_ACL:
+        return (UCHAR) (sdk_status[id].acl_connection_handle &
+                        (SDK_STATUS_MAP_SIZE - 1));
+
+    case SDK_STATUS_MAP_SPP:
+        return (UCHAR) (sdk_status[id].spp_connection_handle &
+                        (SDK_STATUS_MAP_SIZE - 1));
+
+    default:
+        return SDK_BD_ADDR_HASH(sdk_status[id].peer_bd_addr,
+                                SDK_STATUS_MAP_SIZE);
+    }
+}
+
+/**
+ * \fn      appl_status_map_build
+ * \brief   Function to rebuild a lookup map from the connected instances.
+ *          Called on connection setup and release only, never per packet.
+ * \param   map     SDK_STATUS_MAP_*
+ * \param   include Instance indexed even if disconnected, as its key is
+ *                  stored before its state changes; SPP_MAX_ENTITY for none
+ * \param   exclude Instance being released; SPP_MAX_ENTITY for none
+ * \return  void
+ */
+static void appl_status_map_build(UCHAR map, UCHAR include, UCHAR exclude)
+{
+    UCHAR table[SDK_STATUS_MAP_SIZE];
+    unsigned short state;
+    UCHAR index;
+    UCHAR slot;
+
+    memset(table, 0, sizeof(table));
+
+    /* In index order, the lookup finds the lowest instance first */
+    for (index = 0; index < SPP_MAX_ENTITY; index++) {
+        if ((exclude == index) ||
+            ((include != index) && (SDK_IS_DISCONNECTED(index)))) {
+            continue;
+        }
+        /* Never full, the map has twice as many slots as instances */
+        slot = appl_status_map_hash(map, index);
+        while (0 != table[slot]) {
+            slot = (slot + 1) & (SDK_STATUS_MAP_SIZE - 1);
+        }
+        table[slot] = index + 1;
+    }
+
+    /* The lookups run in both the BT read task and the user task */
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    memcpy(sdk_status_map[map], table, SDK_STATUS_MAP_SIZE);
+    __set_interrupt_state(state);
+}
+
 
 /**
  * \fn      sdk_shutdown_BL6450
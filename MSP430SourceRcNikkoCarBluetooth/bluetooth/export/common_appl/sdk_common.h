@@ -9,6 +9,8 @@
 #define _H_SDK_COMMON_
 
 #include "hal_MSP430F5438.h"
+#include "measurement.h"
+#include "conn_stats.h"
 
 #define SDK_SW_VERSION                  "5.16  \0"
 
@@ -26,6 +28,13 @@
 #define SDK_DISCONNECTED                0x09
 #define SDK_MAX_PAGE_TIMEOUT_VALUE      0x3200
 
+/**
+ * Hash of a BD_ADDR for tables of a power of two size: the LAP bytes, which
+ * differ most between devices
+ */
+#define SDK_BD_ADDR_HASH(bd_addr, size)   \
+    ((UCHAR)((bd_addr)[0] ^ (bd_addr)[1] ^ ((bd_addr)[2] << 1)) & ((size) - 1))
+
 /* Macro to check spp connection status */
 #define SDK_IS_SPP_CONNECTED(index)   \
     (SDK_SPP_CONNECTED == sdk_status[(index)].connect_switch)
@@ -67,13 +76,19 @@
 
 /* Change SPP Connection Status */
 #define SDK_SPP_CHANGE_STATE(index, state)   \
-    (sdk_status[(index)].connect_switch = (state))
+    (CONN_STATS_STATE((index), (state)), \
+     (sdk_status[(index)].connect_switch = (state)), \
+     SDK_STATUS_MAP_STATE((index), (state)), RESIDENCY_LINK_UPDATE())
+/* Drop a disconnected instance from the lookup maps */
+#define SDK_STATUS_MAP_STATE(index, state)   \
+    ((SDK_DISCONNECTED == (state)) ? \
+     appl_release_status_instance(index) : (void)0)
 /* Change SPP Data transfer state */
 #define SDK_SPP_CHANGE_TX_STATE(index, state)   \
     sdk_status[(index)].sdk_data_sending = (state);
 /* Change SPP Link state */
 #define SDK_SPP_CHANGE_LINK_STATE(index, state)   \
-    sdk_status[(index)].link_state = (state);
+    ((sdk_status[(index)].link_state = (state)), RESIDENCY_LINK_UPDATE())
 /* Change data to be sent flag state */
 #define SDK_SPP_CHANGE_DATA_STATE(index, state) \
     sdk_status[(index)].appl_spp_data_to_be_sent = (state);
@@ -225,6 +240,14 @@ extern "C" {
     /* Function to indicate uart error */
     void sdk_uart_error_handler(void);
 
+    /* Function to print the BT buffer pool telemetry on the USB port */
+    void sdk_pool_stats_dump(void);
+
+#ifdef SDK_POOL_TRACE
+    /* Function to drain the BT buffer pool trace on the USB port */
+    void sdk_pool_trace_dump(void);
+#endif /* SDK_POOL_TRACE */
+
     /* Function to get free instance in sdk_status array */
     API_RESULT appl_get_free_status_instance(UCHAR * id);
 
@@ -240,6 +263,18 @@ extern "C" {
     API_RESULT appl_get_status_instance_bd_addr(UCHAR * id,
                                                 UCHAR * rem_bd_addr);
 
+    /* Function to store the acl connection handle of an instance */
+    void appl_set_status_acl_handle(UCHAR id, UINT16 acl_connection_handle);
+
+    /* Function to store the SPP connection handle of an instance */
+    void appl_set_status_spp_handle(UCHAR id, UINT16 spp_connection_handle);
+
+    /* Function to store the peer bd address of an instance */
+    void appl_set_status_bd_addr(UCHAR id, UCHAR * rem_bd_addr);
+
+    /* Function to drop a disconnected instance from the lookup maps */
+    void appl_release_status_instance(UCHAR id);
+
     /* Function to shutdown BL6450 */
     void sdk_shutdown_BL6450(void);
 
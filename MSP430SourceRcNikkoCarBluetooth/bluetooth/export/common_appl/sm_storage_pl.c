@@ -1,19 +1,118 @@
-
 /**
  * Copyright (c) 2009-2010. MindTree Ltd.  All rights reserved.
  * \file    sm_storage_pl.c
  * \brief   This file contains the implementation for the storage related API's
- *          The example shows an implementation where the information is stored
- *          in the RAM and is maintained across BT on/off cycles without
- *          recycling the power.
- *          An empty region of the RAM is selected based on the map file output
- *          Similar implementation could be done for access to flash.
+ *          The Security Manager database is kept in the information memory
+ *          segments D, C and B, so the link keys survive a power cycle.
+ *
+ *          The three segments form a ring log. Each sm_ps_open(PS_WRITE) ...
+ *          sm_ps_close() sequence appends one record:
+ *
+ *              magic | sequence | length | CRC | data ...
+ *
+ *          The magic and sequence are programmed first, the data is streamed
+ *          behind, and the length and CRC are programmed last by
+ *          sm_ps_close(): that is the commit. A record cut by a reset has no
+ *          valid length or CRC and is ignored, the previous record is then
+ *          the current one. Records are packed one after the other, a
+ *          segment is erased when the log enters it, so the erase cycles are
+ *          spread over the three segments.
+ *
+ *          The position of the current record is kept in RAM; it is found by
+ *          scanning the log on the first open. Reads are copies from it.
+ *
+ *          A record that is too long or fails to program is counted and
+ *          dropped; the previous record stays the current one.
+ *
+ *          The flash address and the program/erase operations can be given
+ *          by a host build (tools/sm_storage_test.cpp) to run the log on a
+ *          simulated flash.
  */
 
 /* Header File Inclusion */
 #include "sm_storage_pl.h"
-#define SM_STORAGE_START_ADDR 0x4C00    /* Initialize to free RAM location */
-static volatile UCHAR *sm_storage_ptr;  /* location for storing SM info */
+#include "hal_MSP430F5438.h"
+#include "sdk_pl.h"
+
+/* Information memory segment D, the first of the log */
+#ifndef SM_PS_FLASH_START
+#define SM_PS_FLASH_START               0x1800
+#endif /* SM_PS_FLASH_START */
+/* Segments D, C and B; segment A holds the fast reconnect cache */
+#define SM_PS_NUM_SEGMENTS              3
+#define SM_PS_SEGMENT_SIZE              128
+#define SM_PS_SIZE                      (SM_PS_NUM_SEGMENTS * SM_PS_SEGMENT_SIZE)
+
+/* Record header, word aligned */
+#define SM_PS_MAGIC                     0x534D
+#define SM_PS_HEADER_SIZE               8
+#define SM_PS_MAGIC_OFFSET              0
+#define SM_PS_SEQ_OFFSET                2
+#define SM_PS_LENGTH_OFFSET             4
+#define SM_PS_CRC_OFFSET                6
+/* Longest data of a record: the current one must survive the next write */
+#define SM_PS_MAX_DATA                  (SM_PS_SEGMENT_SIZE - SM_PS_HEADER_SIZE)
+
+/* Erased flash word */
+#define SM_PS_ERASED                    0xFFFF
+
+/* Program one flash word, erase the segment holding an address */
+#ifndef SM_PS_FLASH_PROGRAM
+#define SM_PS_FLASH_PROGRAM(address, word) \
+    { \
+        FCTL3 = FWKEY; \
+        FCTL1 = FWKEY + WRT; \
+        *(address) = (word); \
+        FCTL1 = FWKEY; \
+        FCTL3 = FWKEY + LOCK; \
+    }
+#define SM_PS_FLASH_ERASE(address) \
+    { \
+        FCTL3 = FWKEY; \
+        FCTL1 = FWKEY + ERASE; \
+        *(address) = 0; \
+        FCTL1 = FWKEY; \
+        FCTL3 = FWKEY + LOCK; \
+    }
+#endif /* SM_PS_FLASH_PROGRAM */
+
+/* Log offset of a flash address and the reverse, with wrap around */
+#define SM_PS_WRAP(offset)              ((UINT16)((offset) % SM_PS_SIZE))
+#define SM_PS_ADDR(offset)              \
+    ((volatile UINT16 *)(SM_PS_FLASH_START + SM_PS_WRAP(offset)))
+
+/* Static variables */
+/* Is the log scanned ? */
+static UCHAR sm_ps_scanned = FALSE;
+/* Current record: log offset of the header, data length, sequence */
+static UCHAR sm_ps_valid = FALSE;
+static UINT16 sm_ps_valid_offset;
+static UINT16 sm_ps_valid_length;
+static UINT16 sm_ps_valid_seq;
+/* Log offset the next record starts at */
+static UINT16 sm_ps_head;
+
+/* Open mode and position in the data */
+static SDK_SM_PS_OPEN_MODES sm_ps_mode;
+static UINT16 sm_ps_position;
+
+/* Record being written: header offset, CRC, odd byte waiting for its pair */
+static UINT16 sm_ps_write_offset;
+static UINT16 sm_ps_write_crc;
+static UINT16 sm_ps_write_pending;
+static UCHAR sm_ps_write_failed;
+
+/* Records dropped: too long or failed to program */
+static UINT16 sm_ps_failure_count = 0;
+
+/* Static Function Declarations */
+static void sm_ps_scan(void);
+static UCHAR sm_ps_check_record(UINT16 offset, UINT16 * length);
+static UINT16 sm_ps_crc(UINT16 crc, UCHAR byte);
+static UCHAR sm_ps_read_byte(UINT16 offset);
+static UCHAR sm_ps_write_word(UINT16 offset, UINT16 word);
+static UCHAR sm_ps_erase_segment(UINT16 offset);
+static UCHAR sm_ps_is_blank(UINT16 offset, UINT16 length);
 
 /* Function definitions */
 
@@ -27,26 +126,112 @@ static volatile UCHAR *sm_storage_ptr;  /* location for storing SM info */
 
 void sm_ps_open(SDK_SM_PS_OPEN_MODES mode)
 {
-    sm_storage_ptr = (unsigned char *)SM_STORAGE_START_ADDR;
+    UINT16 rest;
+
+    if (FALSE == sm_ps_scanned) {
+        sm_ps_scan();
+        sm_ps_scanned = TRUE;
+    }
+
+    sm_ps_mode = mode;
+    sm_ps_position = 0;
+
+    if (PS_WRITE != mode) {
+        return;
+    }
+
+    /**
+     * Start in the next segment if the header would straddle two segments
+     * (the commit would erase the second one) or the rest of the head
+     * segment holds a record cut by a reset
+     */
+    rest = SM_PS_SEGMENT_SIZE - (sm_ps_head % SM_PS_SEGMENT_SIZE);
+    if ((SM_PS_SEGMENT_SIZE != rest) &&
+        ((rest < SM_PS_HEADER_SIZE) ||
+         (FALSE == sm_ps_is_blank(sm_ps_head, rest)))) {
+        sm_ps_head = SM_PS_WRAP(sm_ps_head + rest);
+    }
+
+    sm_ps_write_offset = sm_ps_head;
+    sm_ps_write_crc = SM_PS_ERASED;
+    sm_ps_write_pending = SM_PS_ERASED;
+    sm_ps_write_failed = FALSE;
+
+    /* Header start: the length and CRC stay erased until the commit */
+    if ((FALSE == sm_ps_write_word(sm_ps_write_offset + SM_PS_MAGIC_OFFSET,
+                                   SM_PS_MAGIC)) ||
+        (FALSE == sm_ps_write_word(sm_ps_write_offset + SM_PS_SEQ_OFFSET,
+                                   sm_ps_valid_seq + 1))) {
+        sm_ps_write_failed = TRUE;
+    }
 }
 
  /**
  * \fn      sm_ps_close
  * \brief   Function to close the operations on persistent storage
- *          The implemenation is platform specific.
+ *          The implemenation is platform specific. Commits the record
+ *          written since sm_ps_open(PS_WRITE).
  * \param   void
  * \return  void
  */
 
 void sm_ps_close(void)
 {
+    UINT16 seq;
+    UINT16 data_end;
+
+    if (PS_WRITE != sm_ps_mode) {
+        return;
+    }
+    sm_ps_mode = PS_READ;
+
+    /* Odd length: the last byte goes with an erased one */
+    if (SM_PS_ERASED != sm_ps_write_pending) {
+        if (FALSE ==
+            sm_ps_write_word(sm_ps_write_offset + SM_PS_HEADER_SIZE +
+                             sm_ps_position - 1,
+                             sm_ps_write_pending | 0xFF00)) {
+            sm_ps_write_failed = TRUE;
+        }
+    }
+
+    seq = sm_ps_valid_seq + 1;
+    sm_ps_write_crc = sm_ps_crc(sm_ps_write_crc, (UCHAR) seq);
+    sm_ps_write_crc = sm_ps_crc(sm_ps_write_crc, (UCHAR) (seq >> 8));
+    sm_ps_write_crc = sm_ps_crc(sm_ps_write_crc, (UCHAR) sm_ps_position);
+    sm_ps_write_crc = sm_ps_crc(sm_ps_write_crc,
+                                (UCHAR) (sm_ps_position >> 8));
+
+    /* Commit: length, then CRC */
+    if ((TRUE == sm_ps_write_failed) ||
+        (FALSE == sm_ps_write_word(sm_ps_write_offset + SM_PS_LENGTH_OFFSET,
+                                   sm_ps_position)) ||
+        (FALSE == sm_ps_write_word(sm_ps_write_offset + SM_PS_CRC_OFFSET,
+                                   sm_ps_write_crc))) {
+        /**
+         * The previous record stays the current one; the next record starts
+         * in the next segment, past the one cut here
+         */
+        sm_ps_failure_count++;
+        sdk_display("SM storage: record dropped (%d)\n", sm_ps_failure_count);
+        return;
+    }
+
+    sm_ps_valid = TRUE;
+    sm_ps_valid_offset = sm_ps_write_offset;
+    sm_ps_valid_length = sm_ps_position;
+    sm_ps_valid_seq = seq;
+
+    data_end = sm_ps_write_offset + SM_PS_HEADER_SIZE + sm_ps_position;
+    sm_ps_head = SM_PS_WRAP((data_end + 1) & ~1);
 }
 
 
  /**
  * \fn      sm_ps_write
  * \brief   Function to write to the persistent storage. The implemenation is
- *          platform specific.
+ *          platform specific. The interrupts are only disabled for each
+ *          flash word write or segment erase.
  * \param   p       Address of buffer
  * \param   nb      Number of bytes to be written to persistent storage
  * \return  void
@@ -56,23 +241,40 @@ void sm_ps_write(UCHAR * p, UINT16 nb)
 {
     UINT16 st_index;
 
-    __disable_interrupt();
-    UART_DISABLE_BT_UART_RTS();
+    if ((PS_WRITE != sm_ps_mode) || (TRUE == sm_ps_write_failed)) {
+        return;
+    }
+
+    if (nb > (SM_PS_MAX_DATA - sm_ps_position)) {
+        sm_ps_write_failed = TRUE;
+        return;
+    }
 
-    /* Copy information to SM storage location */
     for (st_index = 0; st_index < nb; st_index++) {
-        *sm_storage_ptr = *p;
-        sm_storage_ptr++;
-        p++;
+        sm_ps_write_crc = sm_ps_crc(sm_ps_write_crc, p[st_index]);
 
+        if (0 == (sm_ps_position & 1)) {
+            sm_ps_write_pending = p[st_index];
+        } else {
+            /* Little endian word: even byte low */
+            if (FALSE ==
+                sm_ps_write_word(sm_ps_write_offset + SM_PS_HEADER_SIZE +
+                                 sm_ps_position - 1,
+                                 sm_ps_write_pending |
+                                 ((UINT16) p[st_index] << 8))) {
+                sm_ps_write_failed = TRUE;
+                return;
+            }
+            sm_ps_write_pending = SM_PS_ERASED;
+        }
+        sm_ps_position++;
     }
-    __enable_interrupt();
 }
 
  /**
  * \fn      sm_ps_read
  * \brief   Function to read from the persistent storage. The implemenation is
- *          platform specific.
+ *          platform specific. Bytes past the current record read as 0.
  * \param   p       Address of buffer
  * \param   nb      Number of bytes to be read to persistent storage
  * \return  void
@@ -84,9 +286,222 @@ void sm_ps_read(UCHAR * p, UINT16 nb)
 
     /* Read information from SM storage */
     for (st_index = 0; st_index < nb; st_index++) {
-        *(p + st_index) = *(sm_storage_ptr + st_index);
+        if ((TRUE == sm_ps_valid) && (sm_ps_position < sm_ps_valid_length)) {
+            *(p + st_index) =
+                sm_ps_read_byte(sm_ps_valid_offset + SM_PS_HEADER_SIZE +
+                                sm_ps_position);
+        } else {
+            *(p + st_index) = 0x00;
+        }
+        sm_ps_position++;
+    }
+}
+
+/**
+ * \fn      sm_ps_get_failure_count
+ * \brief   Number of records dropped since boot, too long or failed to
+ *          program
+ * \param   void
+ * \return  UINT16
+ */
+UINT16 sm_ps_get_failure_count(void)
+{
+    return sm_ps_failure_count;
+}
+
+/**
+ * \fn      sm_ps_scan
+ * \brief   Find the current record: the valid record with the highest
+ *          sequence number
+ * \param   void
+ * \return  void
+ */
+static void sm_ps_scan(void)
+{
+    UINT16 offset;
+    UINT16 length;
+    UINT16 seq;
+
+    sm_ps_valid = FALSE;
+    sm_ps_valid_seq = 0;
+    sm_ps_head = 0;
+
+    for (offset = 0; offset < SM_PS_SIZE; offset += 2) {
+        if (FALSE == sm_ps_check_record(offset, &length)) {
+            continue;
+        }
+
+        seq = *SM_PS_ADDR(offset + SM_PS_SEQ_OFFSET);
+        if ((FALSE == sm_ps_valid) || ((INT16) (seq - sm_ps_valid_seq) > 0)) {
+            sm_ps_valid = TRUE;
+            sm_ps_valid_offset = offset;
+            sm_ps_valid_length = length;
+            sm_ps_valid_seq = seq;
+        }
+    }
+
+    if (TRUE == sm_ps_valid) {
+        sm_ps_head = SM_PS_WRAP((sm_ps_valid_offset + SM_PS_HEADER_SIZE +
+                                 sm_ps_valid_length + 1) & ~1);
+    }
+}
+
+/**
+ * \fn      sm_ps_check_record
+ * \brief   Check for a committed record with a good CRC
+ * \param   offset      Log offset of the header
+ * \param   length      [OUT] Data length
+ * \return  UCHAR       TRUE if valid
+ */
+static UCHAR sm_ps_check_record(UINT16 offset, UINT16 * length)
+{
+    UINT16 crc;
+    UINT16 seq;
+    UINT16 index;
+
+    if (SM_PS_MAGIC != *SM_PS_ADDR(offset + SM_PS_MAGIC_OFFSET)) {
+        return FALSE;
+    }
+
+    *length = *SM_PS_ADDR(offset + SM_PS_LENGTH_OFFSET);
+    if (*length > SM_PS_MAX_DATA) {
+        return FALSE;
+    }
+
+    crc = SM_PS_ERASED;
+    for (index = 0; index < *length; index++) {
+        crc = sm_ps_crc(crc, sm_ps_read_byte(offset + SM_PS_HEADER_SIZE +
+                                             index));
+    }
+    seq = *SM_PS_ADDR(offset + SM_PS_SEQ_OFFSET);
+    crc = sm_ps_crc(crc, (UCHAR) seq);
+    crc = sm_ps_crc(crc, (UCHAR) (seq >> 8));
+    crc = sm_ps_crc(crc, (UCHAR) * length);
+    crc = sm_ps_crc(crc, (UCHAR) (*length >> 8));
+
+    return (crc == *SM_PS_ADDR(offset + SM_PS_CRC_OFFSET)) ? TRUE : FALSE;
+}
+
+/**
+ * \fn      sm_ps_crc
+ * \brief   CRC-16-CCITT (x^16 + x^12 + x^5 + 1) of one more byte
+ * \param   crc         CRC so far, 0xFFFF to start
+ * \param   byte        Next byte
+ * \return  UINT16      CRC
+ */
+static UINT16 sm_ps_crc(UINT16 crc, UCHAR byte)
+{
+    crc = (UINT16) ((crc >> 8) | (crc << 8));
+    crc ^= byte;
+    crc ^= (crc & 0xFF) >> 4;
+    crc ^= crc << 12;
+    crc ^= (crc & 0xFF) << 5;
+
+    return crc;
+}
+
+/**
+ * \fn      sm_ps_read_byte
+ * \brief   Read one byte of the log
+ * \param   offset      Log offset
+ * \return  UCHAR       Byte
+ */
+static UCHAR sm_ps_read_byte(UINT16 offset)
+{
+    return *((volatile UCHAR *)(SM_PS_FLASH_START + SM_PS_WRAP(offset)));
+}
+
+/**
+ * \fn      sm_ps_write_word
+ * \brief   Program one flash word; the segment is erased first when the log
+ *          enters it, unless it holds the current record
+ * \param   offset      Log offset, even
+ * \param   word        Value
+ * \return  UCHAR       TRUE if programmed
+ */
+static UCHAR sm_ps_write_word(UINT16 offset, UINT16 word)
+{
+    volatile UINT16 *address;
+    unsigned short state;
+
+    offset = SM_PS_WRAP(offset);
+    if (0 == (offset % SM_PS_SEGMENT_SIZE)) {
+        if (FALSE == sm_ps_erase_segment(offset)) {
+            return FALSE;
+        }
     }
 
-    sm_storage_ptr += nb;
+    address = SM_PS_ADDR(offset);
+    if (SM_PS_ERASED != *address) {
+        return FALSE;
+    }
+
+    /* The CPU is held while the word is programmed (~85 us) */
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    UART_DISABLE_BT_UART_RTS();
+
+    SM_PS_FLASH_PROGRAM(address, word);
+
+    __set_interrupt_state(state);
+
+    return (word == *address) ? TRUE : FALSE;
+}
+
+/**
+ * \fn      sm_ps_erase_segment
+ * \brief   Erase a segment of the log, unless it holds the current record
+ * \param   offset      Log offset of the segment
+ * \return  UCHAR       TRUE if erased
+ */
+static UCHAR sm_ps_erase_segment(UINT16 offset)
+{
+    unsigned short state;
+    UINT16 start;
+    UINT16 end;
+
+    if (TRUE == sm_ps_valid) {
+        /* Current record, relative to the segment: does it reach into it ?
+         */
+        start = SM_PS_WRAP(sm_ps_valid_offset + SM_PS_SIZE - offset);
+        end = start + SM_PS_HEADER_SIZE + sm_ps_valid_length;
+        if ((start < SM_PS_SEGMENT_SIZE) || (end > SM_PS_SIZE)) {
+            return FALSE;
+        }
+    }
+
+    if (TRUE == sm_ps_is_blank(offset, SM_PS_SEGMENT_SIZE)) {
+        return TRUE;
+    }
+
+    /* The CPU is held while the segment is erased (~25 ms) */
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    UART_DISABLE_BT_UART_RTS();
+
+    SM_PS_FLASH_ERASE(SM_PS_ADDR(offset));
+
+    __set_interrupt_state(state);
+
+    return sm_ps_is_blank(offset, SM_PS_SEGMENT_SIZE);
+}
+
+/**
+ * \fn      sm_ps_is_blank
+ * \brief   Check that a part of the log is erased
+ * \param   offset      Log offset, even
+ * \param   length      Bytes, even
+ * \return  UCHAR       TRUE if erased
+ */
+static UCHAR sm_ps_is_blank(UINT16 offset, UINT16 length)
+{
+    UINT16 index;
+
+    for (index = 0; index < length; index += 2) {
+        if (SM_PS_ERASED != *SM_PS_ADDR(offset + index)) {
+            return FALSE;
+        }
+    }
 
+    return TRUE;
 }
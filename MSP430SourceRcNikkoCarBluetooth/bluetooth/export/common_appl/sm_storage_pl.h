@@ -36,4 +36,7 @@ extern void sm_ps_write(UCHAR * p, UINT16 nb);
  * specific */
 extern void sm_ps_read(UCHAR * p, UINT16 nb);
 
+/* Number of records dropped since boot, too long or failed to program */
+extern UINT16 sm_ps_get_failure_count(void);
+
 #endif /* _H_SM_STORAGE_PL_ */
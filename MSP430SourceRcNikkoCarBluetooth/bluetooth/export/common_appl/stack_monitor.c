@@ -0,0 +1,222 @@
+/**
+ * Copyright (C) 2010. MindTree Ltd.  All rights reserved.
+ *
+ * \file    stack_monitor.c
+ * \brief   This file contains the task stack monitor: high-water mark of each
+ *          task, sampled from the idle hook, recommended stack sizes and the
+ *          stack overflow hook.
+ */
+
+/* Header File Inclusion */
+#include "sdk_pl.h"
+#include "stack_monitor.h"
+#include "bt_sdk_error.h"
+#include "hal_usb.h"
+
+/* Extern variables */
+extern UINT32 sdk_error_code;
+extern UCHAR sdk_usb_detected;
+
+/**
+ * The task creation hook is enabled by FreeRTOSConfig.h, the monitor by the
+ * SDK configuration: one without the other leaves the monitor empty or the
+ * hook unresolved.
+ */
+#ifdef SDK_STACK_MONITOR
+#if ( configUSE_STACK_MONITOR != 1 )
+#error "SDK_STACK_MONITOR needs configUSE_STACK_MONITOR 1 in FreeRTOSConfig.h"
+#endif
+#else /* SDK_STACK_MONITOR */
+#if ( configUSE_STACK_MONITOR == 1 )
+#error "configUSE_STACK_MONITOR 1 needs SDK_STACK_MONITOR"
+#endif
+#endif /* SDK_STACK_MONITOR */
+
+#ifdef SDK_STACK_MONITOR
+
+/* Static variables */
+/* Task of each entry and its configured size */
+static xTaskHandle stack_monitor_task[STACK_MONITOR_MAX_TASKS];
+static const signed char *stack_monitor_name[STACK_MONITOR_MAX_TASKS];
+static UINT16 stack_monitor_size[STACK_MONITOR_MAX_TASKS];
+/* Least free words seen by the samples */
+static UINT16 stack_monitor_min_free[STACK_MONITOR_MAX_TASKS];
+static UINT16 stack_monitor_samples[STACK_MONITOR_MAX_TASKS];
+static UCHAR stack_monitor_num_tasks = 0;
+/* Next task to sample and time of the last sample */
+static UCHAR stack_monitor_next = 0;
+static UINT32 stack_monitor_last = 0;
+
+/* Static Function Declarations */
+static void stack_monitor_sample(UCHAR index);
+
+
+/**
+ * \fn      vStackMonitorTaskCreated
+ * \brief   Register a task; traceTASK_CREATE() from xTaskGenericCreate()
+ * \param   pxTask          Handle of the task
+ * \param   pcTaskName      Name of the task
+ * \param   usStackDepth    Stack size in words
+ * \return  void
+ */
+void vStackMonitorTaskCreated(void *pxTask, const signed char *pcTaskName,
+                              unsigned short usStackDepth)
+{
+    UCHAR index = stack_monitor_num_tasks;
+
+    if (STACK_MONITOR_MAX_TASKS <= index) {
+        return;
+    }
+    stack_monitor_task[index] = (xTaskHandle) pxTask;
+    stack_monitor_name[index] = pcTaskName;
+    stack_monitor_size[index] = usStackDepth;
+    stack_monitor_min_free[index] = usStackDepth;
+    stack_monitor_samples[index] = 0;
+    stack_monitor_num_tasks++;
+}
+
+/**
+ * \fn      stack_monitor_poll
+ * \brief   Sample the next task once per STACK_MONITOR_PERIOD; called from
+ *          the idle hook
+ * \param   void
+ * \return  void
+ */
+void stack_monitor_poll(void)
+{
+    UINT32 now;
+
+    if (0 == stack_monitor_num_tasks) {
+        return;
+    }
+
+    /* One task per period bounds the idle time spent scanning */
+    now = portGET_TIMESTAMP();
+    if ((now - stack_monitor_last) < STACK_MONITOR_PERIOD) {
+        return;
+    }
+    stack_monitor_last = now;
+
+    if (stack_monitor_next >= stack_monitor_num_tasks) {
+        stack_monitor_next = 0;
+    }
+    stack_monitor_sample(stack_monitor_next);
+    stack_monitor_next++;
+}
+
+/**
+ * \fn      stack_monitor_get_report
+ * \brief   Sample a task and compute its report
+ * \param   index       Task index, in creation order
+ * \param   report      Filled with the report
+ * \return  API_RESULT  API_SUCCESS, API_FAILURE if no such task
+ */
+API_RESULT stack_monitor_get_report(UCHAR index,
+                                    STACK_MONITOR_REPORT * report)
+{
+    UINT16 margin;
+
+    if ((stack_monitor_num_tasks <= index) || (NULL == report)) {
+        return API_FAILURE;
+    }
+
+    stack_monitor_sample(index);
+
+    report->name = stack_monitor_name[index];
+    report->size = stack_monitor_size[index];
+    report->used = stack_monitor_size[index] - stack_monitor_min_free[index];
+    report->samples = stack_monitor_samples[index];
+
+    margin = report->used / 8;
+    if (margin < STACK_MONITOR_MIN_MARGIN) {
+        margin = STACK_MONITOR_MIN_MARGIN;
+    }
+    report->recommended = report->used + margin + STACK_MONITOR_ROUNDING - 1;
+    report->recommended -= (report->recommended % STACK_MONITOR_ROUNDING);
+
+    return API_SUCCESS;
+}
+
+/**
+ * \fn      stack_monitor_dump
+ * \brief   Print the report of all the tasks on the USB serial port, with the
+ *          RAM the recommended sizes would give back
+ * \param   void
+ * \return  void
+ */
+void stack_monitor_dump(void)
+{
+    STACK_MONITOR_REPORT report;
+    UINT16 reclaim = 0;
+    UCHAR index;
+
+    if (TRUE != sdk_usb_detected) {
+        return;
+    }
+
+    halUsbSendString("\nTask stacks (words)\n");
+    for (index = 0; index < stack_monitor_num_tasks; index++) {
+        (void)stack_monitor_get_report(index, &report);
+        halUsbSendString((const UCHAR *)report.name);
+        halUsbSendNumber((const UCHAR *)" size=", report.size);
+        halUsbSendNumber((const UCHAR *)" used=", report.used);
+        halUsbSendNumber((const UCHAR *)" recommended=", report.recommended);
+        halUsbSendNumber((const UCHAR *)" samples=", report.samples);
+        halUsbSendChar('\n');
+        if (report.size > report.recommended) {
+            reclaim += (report.size - report.recommended);
+        }
+    }
+    /* The stacks come from the FreeRTOS heap: the bytes given back are
+     * available to the pools and UART buffers through configTOTAL_HEAP_SIZE */
+    halUsbSendNumber((const UCHAR *)"reclaimable bytes=",
+                     reclaim * sizeof(portSTACK_TYPE));
+    halUsbSendChar('\n');
+}
+
+
+/**
+ * \fn      stack_monitor_sample
+ * \brief   Read the high-water mark of a task
+ * \param   index       Task index
+ * \return  void
+ */
+static void stack_monitor_sample(UCHAR index)
+{
+    UINT16 free_words;
+
+    free_words =
+        (UINT16) uxTaskGetStackHighWaterMark(stack_monitor_task[index]);
+    if (free_words < stack_monitor_min_free[index]) {
+        stack_monitor_min_free[index] = free_words;
+    }
+    if (0xFFFF != stack_monitor_samples[index]) {
+        stack_monitor_samples[index]++;
+    }
+}
+
+#endif /* SDK_STACK_MONITOR */
+
+#if ( configCHECK_FOR_STACK_OVERFLOW > 0 )
+/**
+ * \fn      vApplicationStackOverflowHook
+ * \brief   A task ran past the end of its stack (checked by the scheduler at
+ *          each context switch); fatal
+ * \param   pxTask      Handle of the task
+ * \param   pcTaskName  Name of the task
+ * \return  void
+ */
+void vApplicationStackOverflowHook(xTaskHandle * pxTask,
+                                   signed char *pcTaskName)
+{
+    (void)pxTask;
+
+    if (TRUE == sdk_usb_detected) {
+        halUsbSendString("\nStack overflow: ");
+        halUsbSendString((const UCHAR *)pcTaskName);
+        halUsbSendChar('\n');
+    }
+    sdk_error_code = SDK_STACK_OVERFLOW;
+    sdk_error_handler();
+}
+#endif /* configCHECK_FOR_STACK_OVERFLOW */
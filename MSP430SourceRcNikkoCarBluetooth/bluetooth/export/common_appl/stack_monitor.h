@@ -0,0 +1,103 @@
+/**
+ * Copyright (C) 2010. MindTree Ltd.  All rights reserved.
+ *
+ * \file    stack_monitor.h
+ * \brief   This file contains the declarations of the task stack monitor.
+ *
+ *          The tasks are registered at creation (traceTASK_CREATE). The idle
+ *          hook samples the high-water mark of one task per
+ *          STACK_MONITOR_PERIOD, from the 0xA5 fill pattern left by
+ *          FreeRTOS. The ISRs run on the stack of the task they interrupt, so
+ *          the mark includes the deepest ISR path seen over that task.
+ */
+
+#ifndef _H_STACK_MONITOR_
+#define _H_STACK_MONITOR_
+
+/* Header File Inclusion */
+#include "BT_common.h"
+#include "sdk_bluetooth_config.h"
+
+#ifdef SDK_STACK_MONITOR
+
+/* Tasks tracked: ReadTask, WriteTask, UserTask, IDLE and spares */
+#define STACK_MONITOR_MAX_TASKS             6
+
+/* Sampling period of one task, in ACLK counts (250 ms) */
+#define STACK_MONITOR_PERIOD                8192UL
+
+/**
+ * Margin of the recommended stack size over the deepest use seen, in words:
+ * an eighth of the use, at least STACK_MONITOR_MIN_MARGIN, rounded up to
+ * STACK_MONITOR_ROUNDING.
+ */
+#define STACK_MONITOR_MIN_MARGIN            16
+#define STACK_MONITOR_ROUNDING              8
+
+/* Stack report of one task, in stack words (2 bytes) */
+typedef struct {
+    /* Task name, NUL terminated */
+    const signed char *name;
+    /* Configured size (usStackDepth) */
+    UINT16 size;
+    /* Most ever used, from the last sample */
+    UINT16 used;
+    /* Recommended size: used plus margin */
+    UINT16 recommended;
+    /* Samples taken */
+    UINT16 samples;
+} STACK_MONITOR_REPORT;
+
+#endif /* SDK_STACK_MONITOR */
+
+/* ----------------------------------------------- Functions */
+#ifdef SDK_STACK_MONITOR
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * \fn      vStackMonitorTaskCreated
+     * \brief   Register a task; traceTASK_CREATE() from xTaskGenericCreate()
+     * \param   pxTask          Handle of the task
+     * \param   pcTaskName      Name of the task
+     * \param   usStackDepth    Stack size in words
+     * \return  void
+     */
+    void vStackMonitorTaskCreated(void *pxTask, const signed char *pcTaskName,
+                                  unsigned short usStackDepth);
+
+    /**
+     * \fn      stack_monitor_poll
+     * \brief   Sample the next task once per STACK_MONITOR_PERIOD; called
+     *          from the idle hook
+     * \param   void
+     * \return  void
+     */
+    void stack_monitor_poll(void);
+
+    /**
+     * \fn      stack_monitor_get_report
+     * \brief   Sample a task and compute its report
+     * \param   index       Task index, in creation order
+     * \param   report      Filled with the report
+     * \return  API_RESULT  API_SUCCESS, API_FAILURE if no such task
+     */
+    API_RESULT stack_monitor_get_report(UCHAR index,
+                                        STACK_MONITOR_REPORT * report);
+
+    /**
+     * \fn      stack_monitor_dump
+     * \brief   Print the report of all the tasks on the USB serial port, with
+     *          the RAM the recommended sizes would give back
+     * \param   void
+     * \return  void
+     */
+    void stack_monitor_dump(void);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* SDK_STACK_MONITOR */
+
+#endif /* _H_STACK_MONITOR_ */
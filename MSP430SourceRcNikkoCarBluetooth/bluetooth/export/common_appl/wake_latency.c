@@ -0,0 +1,305 @@
+/**
+ * Copyright (C) 2010. MindTree Ltd.  All rights reserved.
+ *
+ * \file    wake_latency.c
+ * \brief   This file contains the wake latency instrumentation: the time from
+ *          MSP430 LPM exit / controller wake to the first HCI packet, split
+ *          into stages so a slow first command can be attributed.
+ */
+
+/* Header File Inclusion */
+#include "wake_latency.h"
+#include "hal_usb.h"
+
+#ifdef SDK_WAKE_LATENCY_STATS
+
+/* Marks the LPM exit time as valid for the restore stage */
+#define WAKE_LATENCY_ARMED_LPM_RESTORED     0x04
+/* Controller wake stage running (CTS pulse or WAKE_IND seen) */
+#define WAKE_LATENCY_ARMED_CTRL_WAKE        0x08
+
+/* Extern variables */
+extern UCHAR sdk_usb_detected;
+
+/* Global variables */
+volatile UCHAR wake_latency_armed = 0;
+
+/* Static variables */
+static WAKE_LATENCY_HIST wake_latency_hist[WAKE_LATENCY_NUM_STAGES];
+/* Start of the open wake cycle */
+static UINT32 wake_latency_cycle_start;
+/* CTS pulse or WAKE_IND of the open wake cycle */
+static UINT32 wake_latency_ctrl_wake_start;
+/* Entry of restore_peripheral_status() */
+static UINT32 wake_latency_lpm_exit;
+/* First byte received in the open wake cycle */
+static UINT32 wake_latency_rx_byte;
+/* Wake cycles dropped for not being closed within WAKE_LATENCY_WINDOW */
+static UINT16 wake_latency_dropped;
+
+static const char *const wake_latency_stage_name[WAKE_LATENCY_NUM_STAGES] = {
+    "lpm_restore ",
+    "ctrl_wake   ",
+    "first_packet",
+    "total       "
+};
+
+/* Static Function Declarations */
+static void wake_latency_open_cycle(UINT32 timestamp);
+static void wake_latency_add(UCHAR stage, UINT32 counts);
+static UINT32 wake_latency_to_us(UINT32 counts);
+
+
+/**
+ * \fn      wake_latency_init
+ * \brief   Clear the histograms and close any open wake cycle
+ * \param   void
+ * \return  void
+ */
+void wake_latency_init(void)
+{
+    unsigned short istate;
+
+    istate = __get_interrupt_state();
+    __disable_interrupt();
+    memset(wake_latency_hist, 0, sizeof(wake_latency_hist));
+    wake_latency_armed = 0;
+    wake_latency_dropped = 0;
+    __set_interrupt_state(istate);
+}
+
+/**
+ * \fn      wake_latency_mark
+ * \brief   Record a wake marker; to be called with interrupts disabled,
+ *          WAKE_LATENCY_MARK() does it
+ * \param   marker      WAKE_LATENCY_MARK_*
+ * \param   timestamp   portGET_TIMESTAMP() at the marker
+ * \return  void
+ */
+void wake_latency_mark(UCHAR marker, UINT32 timestamp)
+{
+    /* A cycle left open too long was not a BT wake; forget it */
+    if ((wake_latency_armed & WAKE_LATENCY_ARMED_RX_PACKET) &&
+        ((timestamp - wake_latency_cycle_start) > WAKE_LATENCY_WINDOW)) {
+        wake_latency_armed = 0;
+        wake_latency_dropped++;
+    }
+
+    switch (marker) {
+    case WAKE_LATENCY_MARK_LPM_EXIT:
+        wake_latency_open_cycle(timestamp);
+        wake_latency_lpm_exit = timestamp;
+        wake_latency_armed |= WAKE_LATENCY_ARMED_LPM_RESTORED;
+        break;
+
+    case WAKE_LATENCY_MARK_LPM_RESTORED:
+        if (wake_latency_armed & WAKE_LATENCY_ARMED_LPM_RESTORED) {
+            wake_latency_armed &= ~WAKE_LATENCY_ARMED_LPM_RESTORED;
+            wake_latency_add(WAKE_LATENCY_STAGE_LPM_RESTORE,
+                             timestamp - wake_latency_lpm_exit);
+        }
+        break;
+
+    case WAKE_LATENCY_MARK_CTS_EDGE:
+    case WAKE_LATENCY_MARK_WAKE_IND:
+        wake_latency_open_cycle(timestamp);
+        wake_latency_ctrl_wake_start = timestamp;
+        wake_latency_armed |=
+            (WAKE_LATENCY_ARMED_CTRL_WAKE | WAKE_LATENCY_ARMED_RX_BYTE);
+        break;
+
+    case WAKE_LATENCY_MARK_RX_BYTE:
+        if (wake_latency_armed & WAKE_LATENCY_ARMED_CTRL_WAKE) {
+            wake_latency_add(WAKE_LATENCY_STAGE_CTRL_WAKE,
+                             timestamp - wake_latency_ctrl_wake_start);
+        }
+        wake_latency_rx_byte = timestamp;
+        wake_latency_armed &=
+            ~(WAKE_LATENCY_ARMED_CTRL_WAKE | WAKE_LATENCY_ARMED_RX_BYTE);
+        break;
+
+    case WAKE_LATENCY_MARK_RX_PACKET:
+        if (wake_latency_armed & WAKE_LATENCY_ARMED_RX_PACKET) {
+            /* Packet completed without a marked first byte: the cycle was
+             * opened in the middle of the packet */
+            if (0 == (wake_latency_armed & WAKE_LATENCY_ARMED_RX_BYTE)) {
+                wake_latency_add(WAKE_LATENCY_STAGE_FIRST_PACKET,
+                                 timestamp - wake_latency_rx_byte);
+            }
+            wake_latency_add(WAKE_LATENCY_STAGE_TOTAL,
+                             timestamp - wake_latency_cycle_start);
+        }
+        wake_latency_armed &= WAKE_LATENCY_ARMED_LPM_RESTORED;
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * \fn      wake_latency_get_hist
+ * \brief   Returns the raw histogram of a stage
+ * \param   stage       WAKE_LATENCY_STAGE_*
+ * \return  const WAKE_LATENCY_HIST *, NULL for an invalid stage
+ */
+const WAKE_LATENCY_HIST *wake_latency_get_hist(UCHAR stage)
+{
+    if (WAKE_LATENCY_NUM_STAGES <= stage) {
+        return NULL;
+    }
+    return &wake_latency_hist[stage];
+}
+
+/**
+ * \fn      wake_latency_get_report
+ * \brief   Compute min/avg/p99/max of a stage
+ * \param   stage       WAKE_LATENCY_STAGE_*
+ * \param   report      Filled with the summary
+ * \return  API_RESULT  API_SUCCESS/API_FAILURE
+ */
+API_RESULT wake_latency_get_report(UCHAR stage, WAKE_LATENCY_REPORT * report)
+{
+    WAKE_LATENCY_HIST hist;
+    UINT32 rank, seen, p99;
+    UCHAR n;
+
+    if ((WAKE_LATENCY_NUM_STAGES <= stage) || (NULL == report)) {
+        return API_FAILURE;
+    }
+
+    /* Snapshot, the ISRs keep updating the histogram */
+    __disable_interrupt();
+    memcpy(&hist, &wake_latency_hist[stage], sizeof(hist));
+    __enable_interrupt();
+
+    memset(report, 0, sizeof(WAKE_LATENCY_REPORT));
+    report->count = hist.count;
+    if (0 == hist.count) {
+        return API_SUCCESS;
+    }
+
+    /* p99 is the upper bound of the bucket holding the 99th percentile
+     * sample, clipped to the max */
+    rank = ((UINT32) hist.count * 99 + 99) / 100;
+    seen = 0;
+    p99 = hist.max;
+    for (n = 0; n < WAKE_LATENCY_NUM_BUCKETS; n++) {
+        seen += hist.bucket[n];
+        if (seen >= rank) {
+            if (n < (WAKE_LATENCY_NUM_BUCKETS - 1)) {
+                p99 = (0 == n) ? 0 : ((1UL << n) - 1);
+                if (p99 > hist.max) {
+                    p99 = hist.max;
+                }
+            }
+            break;
+        }
+    }
+
+    report->min_us = wake_latency_to_us(hist.min);
+    report->avg_us = wake_latency_to_us(hist.sum / hist.count);
+    report->p99_us = wake_latency_to_us(p99);
+    report->max_us = wake_latency_to_us(hist.max);
+
+    return API_SUCCESS;
+}
+
+/**
+ * \fn      wake_latency_dump
+ * \brief   Print the report of all the stages on the USB serial port
+ * \param   void
+ * \return  void
+ */
+void wake_latency_dump(void)
+{
+    WAKE_LATENCY_REPORT report;
+    UCHAR stage;
+
+    if (TRUE != sdk_usb_detected) {
+        return;
+    }
+
+    halUsbSendString("\nWake latency (us)\n");
+    for (stage = 0; stage < WAKE_LATENCY_NUM_STAGES; stage++) {
+        (void)wake_latency_get_report(stage, &report);
+        halUsbSendString((const UCHAR *)wake_latency_stage_name[stage]);
+        halUsbSendNumber((const UCHAR *)" n=", report.count);
+        halUsbSendNumber((const UCHAR *)" min=", report.min_us);
+        halUsbSendNumber((const UCHAR *)" avg=", report.avg_us);
+        halUsbSendNumber((const UCHAR *)" p99=", report.p99_us);
+        halUsbSendNumber((const UCHAR *)" max=", report.max_us);
+        halUsbSendChar('\n');
+    }
+    halUsbSendNumber((const UCHAR *)"dropped=", wake_latency_dropped);
+    halUsbSendChar('\n');
+}
+
+
+/**
+ * \fn      wake_latency_open_cycle
+ * \brief   Start a wake cycle unless one is already open
+ * \param   timestamp   Time of the marker
+ * \return  void
+ */
+static void wake_latency_open_cycle(UINT32 timestamp)
+{
+    if (0 == (wake_latency_armed & WAKE_LATENCY_ARMED_RX_PACKET)) {
+        wake_latency_cycle_start = timestamp;
+        wake_latency_armed =
+            (wake_latency_armed & WAKE_LATENCY_ARMED_LPM_RESTORED) |
+            WAKE_LATENCY_ARMED_RX_BYTE | WAKE_LATENCY_ARMED_RX_PACKET;
+    }
+}
+
+/**
+ * \fn      wake_latency_add
+ * \brief   Add a sample to the histogram of a stage
+ * \param   stage       WAKE_LATENCY_STAGE_*
+ * \param   counts      Duration in ACLK counts
+ * \return  void
+ */
+static void wake_latency_add(UCHAR stage, UINT32 counts)
+{
+    WAKE_LATENCY_HIST *hist = &wake_latency_hist[stage];
+    UINT32 value = counts;
+    UCHAR n = 0;
+
+    /* Saturate rather than wrap, the report is still meaningful */
+    if (0xFFFF == hist->count) {
+        return;
+    }
+
+    while ((0 != value) && (n < (WAKE_LATENCY_NUM_BUCKETS - 1))) {
+        value >>= 1;
+        n++;
+    }
+    hist->bucket[n]++;
+
+    if ((0 == hist->count) || (counts < hist->min)) {
+        hist->min = counts;
+    }
+    if (counts > hist->max) {
+        hist->max = counts;
+    }
+    hist->sum += counts;
+    hist->count++;
+}
+
+/**
+ * \fn      wake_latency_to_us
+ * \brief   Convert ACLK counts to microseconds
+ * \param   counts      Duration in ACLK counts
+ * \return  UINT32      Duration in microseconds
+ */
+static UINT32 wake_latency_to_us(UINT32 counts)
+{
+    /* 1000000 / 32768 = 15625 / 512; split the division for large values to
+     * stay within 32 bits */
+    if (counts < 0x40000UL) {
+        return (counts * 15625UL) / 512;
+    }
+    return (counts / 512) * 15625UL;
+}
+
+#endif /* SDK_WAKE_LATENCY_STATS */
@@ -0,0 +1,172 @@
+/**
+ * Copyright (C) 2010. MindTree Ltd.  All rights reserved.
+ *
+ * \file    wake_latency.h
+ * \brief   This file contains the declarations of the wake latency
+ *          instrumentation.
+ *
+ *          A wake cycle starts at the first of: MSP430 LPM exit, controller
+ *          CTS wake pulse or host WAKE_IND. It is closed by the completion of
+ *          the first HCI packet received after it. Each stage of the cycle is
+ *          kept in a log2 histogram of ACLK counts (30.5us resolution), from
+ *          which min/avg/p99/max are reported.
+ */
+
+#ifndef _H_WAKE_LATENCY_
+#define _H_WAKE_LATENCY_
+
+/* Header File Inclusion */
+#include "BT_common.h"
+#include "sdk_bluetooth_config.h"
+
+#ifdef SDK_WAKE_LATENCY_STATS
+
+/* Number of log2 buckets per histogram; bucket n holds [2^(n-1), 2^n) counts */
+#define WAKE_LATENCY_NUM_BUCKETS            16
+
+/**
+ * A wake cycle which has not seen its first HCI packet after this many ACLK
+ * counts (1 s) is dropped; the wake was not caused by the BT link.
+ */
+#define WAKE_LATENCY_WINDOW                 32768UL
+
+/* Markers */
+/* Controller pulsed CTS (BT_CTS_PIN_VECTOR_ISR) */
+#define WAKE_LATENCY_MARK_CTS_EDGE          0x00
+/* Host sent WAKE_IND to the controller */
+#define WAKE_LATENCY_MARK_WAKE_IND          0x01
+/* restore_peripheral_status() entered */
+#define WAKE_LATENCY_MARK_LPM_EXIT          0x02
+/* restore_peripheral_status() returned */
+#define WAKE_LATENCY_MARK_LPM_RESTORED      0x03
+/* First byte received on the BT UART */
+#define WAKE_LATENCY_MARK_RX_BYTE           0x04
+/* First HCI packet handed to the read task */
+#define WAKE_LATENCY_MARK_RX_PACKET         0x05
+
+/* Stages */
+/* Peripheral restore on LPM exit (LED, sensor, Timer1, USB UART) */
+#define WAKE_LATENCY_STAGE_LPM_RESTORE      0x00
+/* Controller wake: CTS pulse or WAKE_IND to the first byte on the UART */
+#define WAKE_LATENCY_STAGE_CTRL_WAKE        0x01
+/* First byte to the first complete HCI packet */
+#define WAKE_LATENCY_STAGE_FIRST_PACKET     0x02
+/* Start of the wake cycle to the first complete HCI packet */
+#define WAKE_LATENCY_STAGE_TOTAL            0x03
+#define WAKE_LATENCY_NUM_STAGES             0x04
+
+/* Markers still expected in the current wake cycle */
+#define WAKE_LATENCY_ARMED_RX_BYTE          0x01
+#define WAKE_LATENCY_ARMED_RX_PACKET        0x02
+
+/**
+ * Hooks for the BT UART RX path, called from the RX ISR; a single test of the
+ * armed flags when no wake cycle is open.
+ */
+#define WAKE_LATENCY_RX_BYTE()  \
+    do { \
+        if (wake_latency_armed & WAKE_LATENCY_ARMED_RX_BYTE) { \
+            wake_latency_mark(WAKE_LATENCY_MARK_RX_BYTE, portGET_TIMESTAMP()); \
+        } \
+    } while (0)
+#define WAKE_LATENCY_RX_PACKET()  \
+    do { \
+        if (wake_latency_armed & WAKE_LATENCY_ARMED_RX_PACKET) { \
+            wake_latency_mark(WAKE_LATENCY_MARK_RX_PACKET, \
+                              portGET_TIMESTAMP()); \
+        } \
+    } while (0)
+/* From any context: the timestamp and the marker are taken masked */
+#define WAKE_LATENCY_MARK(marker)  \
+    do { \
+        unsigned short wake_latency_istate = __get_interrupt_state(); \
+        __disable_interrupt(); \
+        wake_latency_mark((marker), portGET_TIMESTAMP()); \
+        __set_interrupt_state(wake_latency_istate); \
+    } while (0)
+
+/* Histogram of one stage, in ACLK counts */
+typedef struct {
+    UINT32 min;
+    UINT32 max;
+    UINT32 sum;
+    UINT16 count;
+    UINT16 bucket[WAKE_LATENCY_NUM_BUCKETS];
+} WAKE_LATENCY_HIST;
+
+/* Summary of one stage, in microseconds */
+typedef struct {
+    UINT32 min_us;
+    UINT32 avg_us;
+    UINT32 p99_us;
+    UINT32 max_us;
+    UINT16 count;
+} WAKE_LATENCY_REPORT;
+
+/* Extern variables */
+extern volatile UCHAR wake_latency_armed;
+
+#else /* SDK_WAKE_LATENCY_STATS */
+
+#define WAKE_LATENCY_RX_BYTE()              do { } while (0)
+#define WAKE_LATENCY_RX_PACKET()            do { } while (0)
+#define WAKE_LATENCY_MARK(marker)           do { } while (0)
+
+#endif /* SDK_WAKE_LATENCY_STATS */
+
+
+#ifdef SDK_WAKE_LATENCY_STATS
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * \fn      wake_latency_init
+     * \brief   Clear the histograms and close any open wake cycle
+     * \param   void
+     * \return  void
+     */
+    void wake_latency_init(void);
+
+    /**
+     * \fn      wake_latency_mark
+     * \brief   Record a wake marker; to be called with interrupts disabled,
+     *          WAKE_LATENCY_MARK() does it
+     * \param   marker      WAKE_LATENCY_MARK_*
+     * \param   timestamp   portGET_TIMESTAMP() at the marker
+     * \return  void
+     */
+    void wake_latency_mark(UCHAR marker, UINT32 timestamp);
+
+    /**
+     * \fn      wake_latency_get_report
+     * \brief   Compute min/avg/p99/max of a stage
+     * \param   stage       WAKE_LATENCY_STAGE_*
+     * \param   report      Filled with the summary
+     * \return  API_RESULT  API_SUCCESS/API_FAILURE
+     */
+    API_RESULT wake_latency_get_report(UCHAR stage,
+                                       WAKE_LATENCY_REPORT * report);
+
+    /**
+     * \fn      wake_latency_get_hist
+     * \brief   Returns the raw histogram of a stage
+     * \param   stage       WAKE_LATENCY_STAGE_*
+     * \return  const WAKE_LATENCY_HIST *, NULL for an invalid stage
+     */
+    const WAKE_LATENCY_HIST *wake_latency_get_hist(UCHAR stage);
+
+    /**
+     * \fn      wake_latency_dump
+     * \brief   Print the report of all the stages on the USB serial port
+     * \param   void
+     * \return  void
+     */
+    void wake_latency_dump(void);
+
+#ifdef __cplusplus
+};
+#endif
+#endif /* SDK_WAKE_LATENCY_STATS */
+
+#endif /* _H_WAKE_LATENCY_ */
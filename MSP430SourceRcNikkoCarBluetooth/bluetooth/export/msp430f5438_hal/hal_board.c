@@ -229,9 +229,26 @@ void halBoardStartXT1(void)
     }
 }
 
+/**
+ * \fn      halBoardGetSystemClockMHz
+ * \brief   Get function for the frequency of a system clock setting.
+ * \param   systemClockSpeed    Frequency of operation - SYSCLK_xxMHZ.
+ * \return  The frequency in MHz, 0 for an unknown setting
+ */
+unsigned char halBoardGetSystemClockMHz(unsigned char systemClockSpeed)
+{
+    static const unsigned char sysClkMHz[] = { 1, 4, 8, 12, 16, 18, 20, 25 };
+
+    if (systemClockSpeed > SYSCLK_25MHZ)
+        return 0;
+    return sysClkMHz[systemClockSpeed];
+}
+
 /**
  * \fn      halBoardSetSystemClock
- * \brief   Set function for MCLK frequency.
+ * \brief   Set function for MCLK frequency. May be called again at run time:
+ *          VCore is raised before a frequency increase and lowered only once
+ *          the DCO runs at the lower frequency.
  * \param   systemClockSpeed    Intended frequency of operation - SYSCLK_xxMHZ.
  * \return  void
  */
@@ -239,11 +256,13 @@ void halBoardSetSystemClock(unsigned char systemClockSpeed)
 {
     unsigned char setDcoRange, setVCore;
     unsigned int setMultiplier;
+    unsigned int settleLoops;
 
     halBoardGetSystemClockSettings(systemClockSpeed, &setDcoRange, &setVCore,
                                    &setMultiplier);
 
-    halBoardSetVCore(setVCore);
+    if (setVCore > (PMMCTL0_L & PMMCOREV_3))
+        halBoardSetVCore(setVCore);
 
     __bis_SR_register(SCG0);    // Disable the FLL control loop
     UCSCTL0 = 0x00;             // Set lowest possible DCOx, MODx
@@ -264,8 +283,13 @@ void halBoardSetSystemClock(unsigned char systemClockSpeed)
     // changed is n x 32 x 32 x f_FLL_reference. See UCS chapter in 5xx UG
     // for optimization.
     // 32 x 32 x / f_FLL_reference (32,768 Hz) = .03125 = t_DCO_settle
-    // t_DCO_settle / (1 / 25 MHz) = 781250 = counts_DCO_settle
-    __delay_cycles(781250);
+    // Wait 32 ms in steps of 1000 cycles at the new frequency, so the delay
+    // does not stretch to ~100 ms when switching down to a low frequency.
+    for (settleLoops = halBoardGetSystemClockMHz(systemClockSpeed) * 32;
+         settleLoops > 0; settleLoops--)
+        __delay_cycles(1000);
+
+    halBoardSetVCore(setVCore);
 }
 
 /**
@@ -90,6 +90,7 @@ void halBoardDisableSVS(void);
 void halBoardEnableSVS(void);
 void halBoardStartXT1(void);
 void halBoardSetSystemClock(unsigned char systemClockSpeed);
+unsigned char halBoardGetSystemClockMHz(unsigned char systemClockSpeed);
 void halBoardOutputSystemClock(void);
 void halBoardStopOutputSystemClock(void);
 void halBoardInit(void);
@@ -21,6 +21,7 @@
 #define USB_MCTL            UCA3MCTL
 #define USB_IE              UCA3IE
 #define USB_IFG             UCA3IFG
+#define USB_STAT            UCA3STAT
 #define USB_TXBUF           UCA3TXBUF
 #define USB_RXBUF           UCA3RXBUF
 #else /* MSP-EXP430F5438 Platform */
@@ -32,10 +33,18 @@
 #define USB_MCTL            UCA1MCTL
 #define USB_IE              UCA1IE
 #define USB_IFG             UCA1IFG
+#define USB_STAT            UCA1STAT
 #define USB_TXBUF           UCA1TXBUF
 #define USB_RXBUF           UCA1RXBUF
 #endif /* EZ430_PLATFORM */
 
+/* Baud rate of the USB serial port */
+#ifdef EZ430_PLATFORM
+#define USB_BAUDRATE        SDK_BAUDRATE_9600
+#else
+#define USB_BAUDRATE        SDK_BAUDRATE_115200
+#endif /* EZ430_PLATFORM */
+
 
 /* Extern variables */
 /* Current CPU frequency */
@@ -76,16 +85,31 @@ void halUsbInit(void)
     USB_CTL0 &= ~UC7BIT;        /* 8bit char */
 
     /* Set the baud rate for Serial port */
-#ifdef EZ430_PLATFORM
-    halusb_set_baudrate(SDK_BAUDRATE_9600);
-#else
-    halusb_set_baudrate(SDK_BAUDRATE_115200);
-#endif
+    halusb_set_baudrate(USB_BAUDRATE);
 
     USB_CTL1 &= ~UCSWRST;
     USB_IE |= UCRXIE;
 }
 
+/**
+ * \fn      halUsbReclock
+ * \brief   Re-derives the baud rate of an initialized serial port after a
+ *          system clock change, keeping the received data. To be called with
+ *          interrupts disabled.
+ * \param   void
+ * \return  void
+ */
+void halUsbReclock(void)
+{
+    /* Let the last character leave at the old rate */
+    while (USB_STAT & UCBUSY);
+
+    USB_CTL1 |= UCSWRST;
+    halusb_set_baudrate(USB_BAUDRATE);
+    USB_CTL1 &= ~UCSWRST;
+    USB_IE |= UCRXIE;
+}
+
 /**
  * \fn      halUsbShutDown
  * \brief   Disables the serial communications peripheral and clears the GPIO
@@ -132,6 +156,28 @@ void halUsbSendString(const unsigned char string[])
     }
 }
 
+/**
+ * \fn      halUsbSendNumber
+ * \brief   Sends a label followed by an unsigned decimal value
+ * \param   label[] The label to be sent before the value.
+ * \param   value The value to be sent.
+ * \return  void
+ */
+void halUsbSendNumber(const unsigned char label[], unsigned long value)
+{
+    unsigned char digits[11];
+    unsigned char i = sizeof(digits) - 1;
+
+    digits[i] = '\0';
+    do {
+        digits[--i] = '0' + (unsigned char)(value % 10);
+        value /= 10;
+    } while (0 != value);
+
+    halUsbSendString(label);
+    halUsbSendString(&digits[i]);
+}
+
 /**
  * \fn      USB_UART_VECTOR
  * \brief   This is the USB interrupt handler.The byte received on the USB is
@@ -156,6 +202,8 @@ __interrupt void USB_UART_ISR(void)
         EXIT_MSP430_LPM();
     }
 #endif /* MSP430_LPM_ENABLE */
+    /* End a tickless idle sleep so the tick count is corrected */
+    portTICKLESS_EXIT_LPM();
 #ifdef DEBUG_TESTING
     halUsbSendString("~\n");
 #endif
@@ -27,8 +27,10 @@
 
 void halUsbInit(void);
 void halusb_set_baudrate(unsigned long int baudrate);
+void halUsbReclock(void);
 void halUsbShutDown(void);
 void halUsbSendChar(const unsigned char character);
 void halUsbSendString(const unsigned char string[]);
+void halUsbSendNumber(const unsigned char label[], unsigned long value);
 
 #endif /* HAL_USB_H */
@@ -27,4 +27,71 @@
 #define BT_MEM_SIZE_128       128   /* Memory pool of size 128 bytes */
 #define BT_MEM_SIZE_260       260   /* Memory pool of size 256 bytes */
 
+/* Telemetry of one buffer pool since boot */
+typedef struct {
+    /* Requests of the size class, whichever pool served them */
+    UINT32 alloc_count;
+    /* Bytes lost to requests served by a larger class */
+    UINT32 fallback_waste;
+    UINT16 chunk_size;
+    /* Requests of the class no pool could serve */
+    UINT16 fail_count;
+    /* Requests of the class served by a larger one */
+    UINT16 fallback_count;
+    UINT8 num_chunks;
+    /* Chunks of the pool currently allocated, and the most ever */
+    UINT8 in_use;
+    UINT8 peak_in_use;
+    /* BT_POOL_* */
+    UINT8 pool_type;
+} OS_POOL_STATS;
+
+/* Pool trace operations */
+#define OS_POOL_TRACE_ALLOC   0x00
+#define OS_POOL_TRACE_FREE    0x01
+/* No pool could serve the request; pool is the requested class */
+#define OS_POOL_TRACE_FAIL    0x02
+/**
+ * Flag on an allocation or a failure through OS_allocate_buffer(): the
+ * request size is not known, size is the chunk size of the class
+ */
+#define OS_POOL_TRACE_CLASS_SIZE    0x08
+
+/* Pool trace entry (SDK_POOL_TRACE) */
+typedef struct {
+    /* portGET_TIMESTAMP() of the operation (1/32768 s) */
+    UINT32 timestamp;
+    /* Requested bytes, 0 on free; chunk size of the class when not known
+     * (OS_POOL_TRACE_CLASS_SIZE) */
+    UINT16 size;
+    /* BT_POOL_* of the chunk */
+    UINT8 pool;
+    /* OS_POOL_TRACE_* and flags in the upper nibble, chunk index in the
+     * lower one */
+    UINT8 op_chunk;
+} OS_POOL_TRACE_ENTRY;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /* Get the telemetry of a pool (BT_POOL_*); OK, or ERROR for an invalid
+     * pool */
+    OS_STATUS OS_get_pool_stats(UINT8 pool_type, OS_POOL_STATS * stats);
+
+    /* Pop the oldest pool trace entry; OK, or ERROR when the trace is
+     * empty. The number of entries overwritten before being read is
+     * returned and cleared by OS_pool_trace_lost(). SDK_POOL_TRACE only. */
+    OS_STATUS OS_pool_trace_read(OS_POOL_TRACE_ENTRY * entry);
+    UINT16 OS_pool_trace_lost(void);
+
+    /* Allocate from the smallest size class holding "bytes", falling back
+     * to a larger class when it is exhausted; freed with BT_free_mem().
+     * Like all the pool operations, it can be called from an ISR. */
+    void *OS_allocate_size(UINT32 bytes);
+
+#ifdef __cplusplus
+};
+#endif
+
 #endif /* _H_BT_BUFFER_ */
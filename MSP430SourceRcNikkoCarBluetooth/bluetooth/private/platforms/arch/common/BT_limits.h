@@ -98,6 +98,16 @@
  */
 #define TIMER_MAX_ENTITIES                              5
 
+/*
+ *  Callback arguments of a Timer Entity, stored in the entity itself;
+ *  BT_start_timer() fails for larger ones. The stack library starts its
+ *  timers with up to BT_STATIC_DATA_SIZE bytes.
+ *
+ *  Minimum Value: BT_STATIC_DATA_SIZE  (Do NOT change it !)
+ *  Maximum Value: anything
+ */
+#define BT_TIMER_STATIC_DATA_SIZE                       BT_STATIC_DATA_SIZE
+
 
 /* ----------------------------------------------------------------------- */
 /* ============================= Write Task ============================ */
@@ -13,16 +13,19 @@
 #define READ_TASK_PRIORITY    3
 #define WRITE_TASK_PRIORITY   2
 #define USER_TASK_PRIORITY    1
+#define TIMER_TASK_PRIORITY   READ_TASK_PRIORITY
 
 /* Stack size for each task */
 #define READ_TASK_STACK_SIZE  350
 #define WRITE_TASK_STACK_SIZE 300
 #define USER_TASK_STACK_SIZE  275
+#define TIMER_TASK_STACK_SIZE 200
 
 /* Task name */
 #define READ_TASK_NAME        "ReadTask"
 #define WRITE_TASK_NAME       "WriteTask"
 #define USER_TASK_NAME        "UserTask"
+#define TIMER_TASK_NAME       "TimerTask"
 
 typedef struct {
     CHAR *name;
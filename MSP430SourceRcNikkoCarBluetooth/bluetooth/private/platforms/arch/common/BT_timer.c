@@ -0,0 +1,824 @@
+
+/**
+ *  @file BT_timer.c
+ *
+ *  This File contains source codes for the EtherMind Timer Library
+ *  Implementation for MSP430: a hashed timing wheel on the ACLK timestamp,
+ *  run by its own task at the priority of the read task.
+ *
+ *  A timer goes to the slot of its expiry time, rounded up to the slot
+ *  time, or to the slot after the last one processed if that is later. The
+ *  service walks the slots from the last one it processed to the one after
+ *  the current one (at most one lap) and runs the timers of those slots
+ *  which have expired; the others are for a later lap. Between two services the
+ *  timer task blocks until the earliest expiry.
+ */
+
+/*
+ *  Copyright (C) 2000-2010. MindTree Ltd.
+ *  All rights reserved.
+ */
+
+/* --------------------------------------------- Header File Inclusion */
+#include "sdk_pl.h"
+#include "BT_task.h"
+#include "BT_timer_internal.h"
+
+/* --------------------------------------------- External Global Variables */
+
+/* --------------------------------------------- Exported Global Variables */
+/* Timer Entities of BT_start_timer() */
+TIMER_ENTITY timer_entity[TIMER_MAX_ENTITIES];
+
+/* --------------------------------------------- Static Global Variables */
+/* Slot lists, unordered */
+static BT_TIMER_ENTRY *timer_wheel[TIMER_WHEEL_SLOTS];
+/* Slot time (timestamp >> TIMER_WHEEL_SLOT_SHIFT) processed last */
+static UINT32 timer_wheel_pos;
+/* Timers in the wheel */
+static UCHAR timer_wheel_count;
+/* Time the timer task wakes up at, if timer_wheel_wake_set */
+static UINT32 timer_wheel_wake_at;
+static UCHAR timer_wheel_wake_set;
+/* Timer task wake up, given by timer_signal() */
+static xSemaphoreHandle timer_wheel_sem = NULL;
+
+
+/* --------------------------------------------- Functions */
+
+/**
+ *  \fn timer_init
+ *
+ *  \par Description:
+ *  This function initializes the Timer Library and creates the timer task.
+ *  Called at boot, before the scheduler starts.
+ *
+ *  \return None
+ */
+void timer_init ( void )
+{
+    UCHAR index;
+
+    BT_TIMER_TRC("[TIMER] Initializing EtherMind Timer Library\n");
+
+    for (index = 0; index < TIMER_WHEEL_SLOTS; index++)
+    {
+        timer_wheel[index] = NULL;
+    }
+    timer_wheel_count = 0;
+    timer_wheel_wake_set = FALSE;
+
+    for (index = 0; index < TIMER_MAX_ENTITIES; index++)
+    {
+        timer_init_entity (&timer_entity[index]);
+    }
+
+    timer_wheel_pos = timer_get_current_time() >> TIMER_WHEEL_SLOT_SHIFT;
+
+    if (NULL != timer_wheel_sem)
+    {
+        return;
+    }
+
+    vSemaphoreCreateBinary (timer_wheel_sem);
+    if ((NULL == timer_wheel_sem) ||
+        (pdPASS != xTaskCreate ((pdTASK_CODE) timer_task_routine,
+                                (const signed portCHAR *) TIMER_TASK_NAME,
+                                TIMER_TASK_STACK_SIZE, NULL,
+                                (unsigned portBASE_TYPE) TIMER_TASK_PRIORITY,
+                                (xTaskHandle *) NULL)))
+    {
+        BT_TIMER_ERR("[TIMER] Could not create the Timer Task\n");
+    }
+}
+
+
+/**
+ *  \fn timer_task_routine
+ *
+ *  \par Description:
+ *  Timer task: run the expired timers, then block until the earliest
+ *  expiry or until timer_signal() reports an earlier one.
+ *
+ *  \param args (IN) Unused
+ *
+ *  \return None
+ */
+void timer_task_routine ( void *args )
+{
+    UINT16 wait;
+
+    (void) args;
+
+    while (1)
+    {
+        wait = BT_timer_service();
+        (void) xSemaphoreTake (timer_wheel_sem, (portTickType) wait);
+    }
+}
+
+
+/**
+ *  \fn timer_bt_init
+ *
+ *  \par Description:
+ *  Bluetooth ON: nothing to do, the wheel runs from boot.
+ *
+ *  \return None
+ */
+void timer_bt_init ( void )
+{
+    BT_TIMER_TRC("[TIMER] Bluetooth ON Initialization\n");
+}
+
+
+/**
+ *  \fn timer_bt_shutdown
+ *
+ *  \par Description:
+ *  Bluetooth OFF: stop all the Timer Entities of the stack.
+ *
+ *  \return None
+ */
+void timer_bt_shutdown ( void )
+{
+    UCHAR index;
+
+    BT_TIMER_TRC("[TIMER] Bluetooth OFF Shutdown\n");
+
+    for (index = 0; index < TIMER_MAX_ENTITIES; index++)
+    {
+        if (TRUE == timer_entity[index].in_use)
+        {
+            (void) BT_stop_timer (&timer_entity[index]);
+        }
+    }
+}
+
+
+/**
+ *  \fn BT_start_timer
+ *
+ *  \par Description:
+ *  This function starts a Timer Entity. The arguments, up to
+ *  BT_TIMER_STATIC_DATA_SIZE bytes, are copied and given back to the
+ *  callback on expiry; the handle is invalid from then on.
+ *
+ *  \param handle (OUT) Timer Handle
+ *  \param timeout (IN) Timeout in seconds
+ *  \param callback (IN) Callback
+ *  \param args (IN) Callback arguments, copied
+ *  \param size_args (IN) Size of the arguments
+ *
+ *  \return API_SUCCESS or an Error Code
+ */
+API_RESULT BT_start_timer
+           (
+               BT_timer_handle *handle,
+               UINT16 timeout,
+               void (* callback) (void *, UINT16),
+               void *args, UINT16 size_args
+           )
+{
+    return timer_start_entity
+           (handle, timer_s_to_aclk(timeout), callback, args, size_args);
+}
+
+
+/**
+ *  \fn BT_start_timer_ms
+ *
+ *  \par Description:
+ *  BT_start_timer() with a timeout in milliseconds.
+ *
+ *  \param handle (OUT) Timer Handle
+ *  \param timeout_ms (IN) Timeout in milliseconds
+ *  \param callback (IN) Callback
+ *  \param args (IN) Callback arguments, copied
+ *  \param size_args (IN) Size of the arguments
+ *
+ *  \return API_SUCCESS or an Error Code
+ */
+API_RESULT BT_start_timer_ms
+           (
+               BT_timer_handle *handle,
+               UINT16 timeout_ms,
+               void (* callback) (void *, UINT16),
+               void *args, UINT16 size_args
+           )
+{
+    return timer_start_entity
+           (handle, timer_ms_to_aclk(timeout_ms), callback, args, size_args);
+}
+
+
+/**
+ *  \fn BT_restart_timer
+ *
+ *  \par Description:
+ *  This function restarts a running Timer Entity with a new timeout.
+ *
+ *  \param handle (IN) Timer Handle
+ *  \param new_timeout (IN) Timeout in seconds
+ *
+ *  \return API_SUCCESS or an Error Code
+ */
+API_RESULT BT_restart_timer
+           (
+               BT_timer_handle handle,
+               UINT16 new_timeout
+           )
+{
+    return timer_restart_entity (handle, timer_s_to_aclk(new_timeout));
+}
+
+
+/**
+ *  \fn BT_restart_timer_ms
+ *
+ *  \par Description:
+ *  BT_restart_timer() with a timeout in milliseconds.
+ *
+ *  \param handle (IN) Timer Handle
+ *  \param new_timeout_ms (IN) Timeout in milliseconds
+ *
+ *  \return API_SUCCESS or an Error Code
+ */
+API_RESULT BT_restart_timer_ms
+           (
+               BT_timer_handle handle,
+               UINT16 new_timeout_ms
+           )
+{
+    return timer_restart_entity (handle, timer_ms_to_aclk(new_timeout_ms));
+}
+
+
+/**
+ *  \fn BT_stop_timer
+ *
+ *  \par Description:
+ *  This function stops a Timer Entity and frees it.
+ *
+ *  \param handle (IN) Timer Handle
+ *
+ *  \return API_SUCCESS or an Error Code
+ */
+API_RESULT BT_stop_timer ( BT_timer_handle handle )
+{
+    unsigned short state;
+
+    timer_null_check (handle);
+
+    timer_lock(state);
+    if ((TRUE != handle->in_use) || (handle != handle->handle))
+    {
+        timer_unlock(state);
+        BT_TIMER_ERR("[TIMER] Stop: Invalid Handle %p\n", handle);
+        return API_FAILURE;
+    }
+
+    timer_wheel_del (&handle->entry);
+    timer_init_entity (handle);
+    timer_unlock(state);
+
+    return API_SUCCESS;
+}
+
+
+/**
+ *  \fn BT_is_active_timer
+ *
+ *  \par Description:
+ *  This function checks whether a Timer Entity is running.
+ *
+ *  \param handle (IN) Timer Handle
+ *
+ *  \return API_SUCCESS if running, API_FAILURE otherwise
+ */
+API_RESULT BT_is_active_timer ( BT_timer_handle handle )
+{
+    timer_null_check (handle);
+
+    if ((TRUE == handle->in_use) && (handle == handle->handle) &&
+        (TRUE == handle->entry.active))
+    {
+        return API_SUCCESS;
+    }
+
+    return API_FAILURE;
+}
+
+
+/**
+ *  \fn BT_list_timer
+ *
+ *  \par Description:
+ *  Debug Routine: trace the running Timer Entities.
+ *
+ *  \return API_SUCCESS
+ */
+API_RESULT BT_list_timer ( void )
+{
+    UCHAR index;
+
+    for (index = 0; index < TIMER_MAX_ENTITIES; index++)
+    {
+        if (TRUE == timer_entity[index].in_use)
+        {
+            BT_TIMER_TRC("[TIMER] %p: Timeout %d, Expires at %lu\n",
+            &timer_entity[index], timer_entity[index].timeout,
+            timer_entity[index].entry.expire_at);
+        }
+    }
+
+    return API_SUCCESS;
+}
+
+
+/**
+ *  \fn BT_timer_entry_init
+ *
+ *  \par Description:
+ *  This function sets up an intrusive timer, stopped.
+ *
+ *  \param entry (IN) Timer, owned by the caller
+ *  \param callback (IN) Callback, from the timer task
+ *  \param context (IN) Callback argument
+ *
+ *  \return None
+ */
+void BT_timer_entry_init
+     (
+         BT_TIMER_ENTRY *entry,
+         void (* callback) (void *),
+         void *context
+     )
+{
+    entry->next = NULL;
+    entry->prev = NULL;
+    entry->callback = callback;
+    entry->context = context;
+    entry->expire_at = 0;
+    entry->slot = 0;
+    entry->active = FALSE;
+}
+
+
+/**
+ *  \fn BT_timer_entry_start
+ *
+ *  \par Description:
+ *  This function starts an intrusive timer, or restarts it if running.
+ *
+ *  \param entry (IN) Timer
+ *  \param timeout_ms (IN) Timeout in milliseconds
+ *
+ *  \return None
+ */
+void BT_timer_entry_start ( BT_TIMER_ENTRY *entry, UINT16 timeout_ms )
+{
+    unsigned short state;
+
+    timer_lock(state);
+    timer_wheel_del (entry);
+    timer_wheel_add (entry, timer_ms_to_aclk(timeout_ms));
+    timer_unlock(state);
+
+    timer_signal (entry->expire_at);
+}
+
+
+/**
+ *  \fn BT_timer_entry_stop
+ *
+ *  \par Description:
+ *  This function stops an intrusive timer; no effect if not running.
+ *
+ *  \param entry (IN) Timer
+ *
+ *  \return None
+ */
+void BT_timer_entry_stop ( BT_TIMER_ENTRY *entry )
+{
+    unsigned short state;
+
+    timer_lock(state);
+    timer_wheel_del (entry);
+    timer_unlock(state);
+}
+
+
+/**
+ *  \fn BT_timer_entry_is_active
+ *
+ *  \par Description:
+ *  This function checks whether an intrusive timer is running.
+ *
+ *  \param entry (IN) Timer
+ *
+ *  \return TRUE if running
+ */
+UCHAR BT_timer_entry_is_active ( BT_TIMER_ENTRY *entry )
+{
+    return entry->active;
+}
+
+
+/**
+ *  \fn BT_timer_service
+ *
+ *  \par Description:
+ *  This function runs the callbacks of the expired timers and returns the
+ *  time to the next expiry. Called by the timer task, which blocks for that
+ *  time at most; starting an earlier timer wakes it up.
+ *
+ *  \return OS ticks to the next expiry, BT_TIMER_NO_EXPIRY if none
+ */
+UINT16 BT_timer_service ( void )
+{
+    BT_TIMER_ENTRY *entry;
+    UINT32 now, now_pos, expire_at;
+    INT32 remaining;
+    UCHAR steps, slot, found;
+    void (* callback) (void *);
+    void *context;
+    unsigned short state;
+
+    timer_lock(state);
+    now = timer_get_current_time();
+    now_pos = now >> TIMER_WHEEL_SLOT_SHIFT;
+
+    /*
+     * Visit up to the slot after the current one, which holds the timers
+     * started already expired; past one lap, every slot is visited once.
+     */
+    if (TIMER_WHEEL_POS_DIFF(now_pos, timer_wheel_pos) >=
+        (INT32)TIMER_WHEEL_SLOTS)
+    {
+        timer_wheel_pos = now_pos + 1 - TIMER_WHEEL_SLOTS;
+    }
+    steps = (UCHAR)(now_pos + 1 - timer_wheel_pos);
+
+    while ((0 != steps) && (0 != timer_wheel_count))
+    {
+        slot = (UCHAR)(timer_wheel_pos + 1) & (TIMER_WHEEL_SLOTS - 1);
+
+        /* Rescan from the head after each callback, it may change the list */
+        entry = timer_wheel[slot];
+        while (NULL != entry)
+        {
+            if ((INT32)(now - entry->expire_at) < 0)
+            {
+                /* Later lap */
+                entry = entry->next;
+                continue;
+            }
+
+            timer_wheel_del (entry);
+            callback = entry->callback;
+            context = entry->context;
+            timer_unlock(state);
+
+            callback (context);
+
+            timer_lock(state);
+            entry = timer_wheel[slot];
+        }
+
+        timer_wheel_pos++;
+        steps--;
+    }
+    timer_wheel_pos = now_pos;
+
+    /* Earliest expiry, for the wait of the timer task */
+    found = FALSE;
+    expire_at = 0;
+    for (slot = 0; (slot < TIMER_WHEEL_SLOTS) && (0 != timer_wheel_count);
+         slot++)
+    {
+        for (entry = timer_wheel[slot]; NULL != entry; entry = entry->next)
+        {
+            if ((FALSE == found) ||
+                ((INT32)(entry->expire_at - expire_at) < 0))
+            {
+                expire_at = entry->expire_at;
+                found = TRUE;
+            }
+        }
+    }
+    timer_wheel_wake_at = expire_at;
+    timer_wheel_wake_set = found;
+    timer_unlock(state);
+
+    if (FALSE == found)
+    {
+        return BT_TIMER_NO_EXPIRY;
+    }
+
+    /* Timers started from the callbacks may be due already */
+    remaining = (INT32)(expire_at - now);
+    if (remaining <= 0)
+    {
+        return 0;
+    }
+    if ((UINT32)remaining >= ((UINT32)(BT_TIMER_NO_EXPIRY - 1) *
+                              TIMER_ACLK_PER_TICK))
+    {
+        return BT_TIMER_NO_EXPIRY - 1;
+    }
+
+    return (UINT16)(((UINT32)remaining + TIMER_ACLK_PER_TICK - 1) /
+                    TIMER_ACLK_PER_TICK);
+}
+
+
+/**
+ *  \fn timer_start_entity
+ *
+ *  \par Description:
+ *  This function takes a free Timer Entity and starts it.
+ *
+ *  \param handle (OUT) Timer Handle
+ *  \param timeout (IN) Timeout in ACLK counts
+ *  \param callback (IN) Callback
+ *  \param args (IN) Callback arguments, copied
+ *  \param size_args (IN) Size of the arguments
+ *
+ *  \return API_SUCCESS or an Error Code
+ */
+API_RESULT timer_start_entity
+           (
+               BT_timer_handle *handle,
+               UINT32 timeout,
+               void (* callback) (void *, UINT16),
+               void *args, UINT16 size_args
+           )
+{
+    TIMER_ENTITY *timer;
+    UCHAR index;
+    unsigned short state;
+
+    timer_null_check (handle);
+    timer_null_check (callback);
+
+    if (size_args > BT_TIMER_STATIC_DATA_SIZE)
+    {
+        BT_TIMER_ERR("[TIMER] Arguments too large: %d bytes\n", size_args);
+        return API_FAILURE;
+    }
+
+    timer_lock(state);
+    for (index = 0; index < TIMER_MAX_ENTITIES; index++)
+    {
+        if (TRUE != timer_entity[index].in_use)
+        {
+            break;
+        }
+    }
+    if (TIMER_MAX_ENTITIES == index)
+    {
+        timer_unlock(state);
+        BT_TIMER_ERR("[TIMER] No free Timer Entity\n");
+        return API_FAILURE;
+    }
+
+    timer = &timer_entity[index];
+    timer->in_use = TRUE;
+    timer->handle = timer;
+    timer->callback = callback;
+    timer->timeout = (UINT16)(timeout >> 15);
+    timer->data_length = size_args;
+    if (0 != size_args)
+    {
+        BT_mem_copy (timer->static_data, args, size_args);
+    }
+
+    BT_timer_entry_init (&timer->entry, timer_entity_expired, timer);
+    timer_wheel_add (&timer->entry, timeout);
+    timer_unlock(state);
+
+    *handle = timer;
+    timer_signal (timer->entry.expire_at);
+
+    return API_SUCCESS;
+}
+
+
+/**
+ *  \fn timer_restart_entity
+ *
+ *  \par Description:
+ *  This function restarts a running Timer Entity.
+ *
+ *  \param handle (IN) Timer Handle
+ *  \param timeout (IN) Timeout in ACLK counts
+ *
+ *  \return API_SUCCESS or an Error Code
+ */
+API_RESULT timer_restart_entity ( BT_timer_handle handle, UINT32 timeout )
+{
+    unsigned short state;
+
+    timer_null_check (handle);
+
+    timer_lock(state);
+    if ((TRUE != handle->in_use) || (handle != handle->handle) ||
+        (TRUE != handle->entry.active))
+    {
+        timer_unlock(state);
+        BT_TIMER_ERR("[TIMER] Restart: Invalid Handle %p\n", handle);
+        return API_FAILURE;
+    }
+
+    timer_wheel_del (&handle->entry);
+    timer_wheel_add (&handle->entry, timeout);
+    handle->timeout = (UINT16)(timeout >> 15);
+    timer_unlock(state);
+
+    timer_signal (handle->entry.expire_at);
+
+    return API_SUCCESS;
+}
+
+
+/**
+ *  \fn timer_init_entity
+ *
+ *  \par Description:
+ *  This function marks a Timer Entity free.
+ *
+ *  \param timer (IN) Timer Entity
+ *
+ *  \return None
+ */
+void timer_init_entity ( TIMER_ENTITY *timer )
+{
+    BT_timer_entry_init (&timer->entry, NULL, NULL);
+    timer->handle = NULL;
+    timer->callback = NULL;
+    timer->timeout = 0;
+    timer->data_length = 0;
+    timer->in_use = FALSE;
+}
+
+
+/**
+ *  \fn timer_entity_expired
+ *
+ *  \par Description:
+ *  Wheel callback of a Timer Entity: free the entity, then call the user
+ *  callback with a copy of its arguments, so it may start a timer again.
+ *
+ *  \param context (IN) Timer Entity
+ *
+ *  \return None
+ */
+void timer_entity_expired ( void *context )
+{
+    TIMER_ENTITY *timer;
+    UCHAR static_data[BT_TIMER_STATIC_DATA_SIZE];
+    UINT16 length;
+    void (* callback) (void *, UINT16);
+    unsigned short state;
+
+    timer = (TIMER_ENTITY *) context;
+
+    timer_lock(state);
+    callback = timer->callback;
+    length = timer->data_length;
+    BT_mem_copy (static_data, timer->static_data, length);
+    timer_init_entity (timer);
+    timer_unlock(state);
+
+    callback (static_data, length);
+}
+
+
+/**
+ *  \fn timer_wheel_add
+ *
+ *  \par Description:
+ *  This function puts a stopped timer in the slot of its expiry. Called
+ *  locked.
+ *
+ *  \param entry (IN) Timer
+ *  \param timeout (IN) Timeout in ACLK counts
+ *
+ *  \return None
+ */
+void timer_wheel_add ( BT_TIMER_ENTRY *entry, UINT32 timeout )
+{
+    UINT32 expire_pos;
+    UCHAR slot;
+
+    entry->expire_at = timer_get_current_time() + timeout;
+
+    /* Rounded up; never at or before the slot processed last */
+    expire_pos = (entry->expire_at + TIMER_WHEEL_SLOT_TIME - 1) >>
+                 TIMER_WHEEL_SLOT_SHIFT;
+    if (TIMER_WHEEL_POS_DIFF(expire_pos, timer_wheel_pos) <= 0)
+    {
+        expire_pos = timer_wheel_pos + 1;
+    }
+    slot = (UCHAR)expire_pos & (TIMER_WHEEL_SLOTS - 1);
+
+    entry->slot = slot;
+    entry->prev = NULL;
+    entry->next = timer_wheel[slot];
+    if (NULL != entry->next)
+    {
+        entry->next->prev = entry;
+    }
+    timer_wheel[slot] = entry;
+    entry->active = TRUE;
+    timer_wheel_count++;
+}
+
+
+/**
+ *  \fn timer_wheel_del
+ *
+ *  \par Description:
+ *  This function takes a timer out of the wheel; no effect if not in it.
+ *  Called locked.
+ *
+ *  \param entry (IN) Timer
+ *
+ *  \return None
+ */
+void timer_wheel_del ( BT_TIMER_ENTRY *entry )
+{
+    if (TRUE != entry->active)
+    {
+        return;
+    }
+
+    if (NULL != entry->prev)
+    {
+        entry->prev->next = entry->next;
+    }
+    else
+    {
+        timer_wheel[entry->slot] = entry->next;
+    }
+    if (NULL != entry->next)
+    {
+        entry->next->prev = entry->prev;
+    }
+
+    entry->next = NULL;
+    entry->prev = NULL;
+    entry->active = FALSE;
+    timer_wheel_count--;
+}
+
+
+/**
+ *  \fn timer_get_current_time
+ *
+ *  \par Description:
+ *  Current time for the wheel. Called locked.
+ *
+ *  \return ACLK counts
+ */
+UINT32 timer_get_current_time ( void )
+{
+    return portGET_TIMESTAMP();
+}
+
+
+/**
+ *  \fn timer_signal
+ *
+ *  \par Description:
+ *  Wake the timer task up if a timer was started before its planned wake.
+ *  The planned wake is checked and moved under the lock, so two tasks
+ *  starting timers cannot both miss the wake up.
+ *
+ *  \param expire_at (IN) Expiry time of the timer started
+ *
+ *  \return None
+ */
+void timer_signal ( UINT32 expire_at )
+{
+    UCHAR wakeup;
+    unsigned short state;
+
+    wakeup = FALSE;
+
+    timer_lock(state);
+    if ((TRUE != timer_wheel_wake_set) ||
+        ((INT32)(expire_at - timer_wheel_wake_at) < 0))
+    {
+        timer_wheel_wake_at = expire_at;
+        timer_wheel_wake_set = TRUE;
+        wakeup = TRUE;
+    }
+    timer_unlock(state);
+
+    if ((TRUE == wakeup) && (NULL != timer_wheel_sem))
+    {
+        (void) xSemaphoreGive (timer_wheel_sem);
+    }
+}
@@ -3,7 +3,18 @@
  *  @file BT_timer.h
  *
  *  This Header File contains the APIs and the ADTs exported by the
- *  EtherMind Timer Library for Windows (User-mode).
+ *  EtherMind Timer Library for MSP430.
+ *
+ *  The timers are kept in a hashed timing wheel of TIMER_WHEEL_SLOTS slots
+ *  of TIMER_WHEEL_SLOT_TIME ACLK counts (3.9 ms), run by the timer task
+ *  (BT_timer_service). Start, stop and restart are O(1).
+ *
+ *  Two kinds of timers:
+ *    - BT_TIMER_ENTRY: intrusive, owned by the caller, callback with a
+ *      context pointer, no data copy. Millisecond timeouts.
+ *    - TIMER_ENTITY (BT_start_timer): from a pool of TIMER_MAX_ENTITIES,
+ *      the callback arguments are copied. Used by the stack, second
+ *      timeouts; BT_start_timer_ms() for millisecond ones.
  */
 
 /*
@@ -23,29 +34,54 @@
  */
 #define BT_TIMER_HANDLE_INIT_VAL    NULL
 
+/* Wheel geometry: a power of two number of slots, slot time in ACLK counts */
+#define TIMER_WHEEL_SLOTS           32
+#define TIMER_WHEEL_SLOT_SHIFT      7
+#define TIMER_WHEEL_SLOT_TIME       (1UL << TIMER_WHEEL_SLOT_SHIFT)
+
+/* BT_timer_service() return value when no timer is running */
+#define BT_TIMER_NO_EXPIRY          0xFFFF
+
 
 /* ----------------------------------------------- Structures/Data Types */
 
+/* Intrusive timer, owned by the caller; set up by BT_timer_entry_init() */
+typedef struct bt_timer_entry_struct
+{
+    /* Slot list links */
+    struct bt_timer_entry_struct *next;
+    struct bt_timer_entry_struct *prev;
+
+    /* Callback to call when the timer expires, from the timer task */
+    void (* callback) (void *);
+    void *context;
+
+    /* Expiry time, ACLK counts */
+    UINT32 expire_at;
+
+    /* Wheel slot holding the entry */
+    UCHAR slot;
+
+    /* Is this Entry in the wheel ? */
+    UCHAR active;
+
+} BT_TIMER_ENTRY;
+
 /* Timer Entity */
 typedef struct timer_entity_struct
 {
+    /* Wheel entry, context: this entity */
+    BT_TIMER_ENTRY entry;
+
     /* The Timer Handle */
     struct timer_entity_struct *handle;
 
     /* Callback to call when Timer expires */
     void (* callback) (void *, UINT16);
 
-    UCHAR  *allocated_data;
-
-    /* Next Element in the Timer Q */
-    struct timer_entity_struct *next;
-
-    UCHAR  static_data[BT_STATIC_DATA_SIZE];
-
-    /* Time at which it is supposed to expire */
-    UINT32 expire_at;
+    UCHAR  static_data[BT_TIMER_STATIC_DATA_SIZE];
 
-    /* Timeout Value asked by the User */
+    /* Timeout Value asked by the User, in seconds (debug) */
     UINT16 timeout;
 
     UINT16 data_length;
@@ -65,6 +101,7 @@ void timer_init ( void );
 void timer_bt_init ( void );
 void timer_bt_shutdown ( void );
 
+/* Timeout in seconds */
 API_RESULT BT_start_timer
            (
                BT_timer_handle *handle,
@@ -73,12 +110,27 @@ API_RESULT BT_start_timer
                void *args, UINT16 size_args
            );
 
+/* Timeout in milliseconds */
+API_RESULT BT_start_timer_ms
+           (
+               BT_timer_handle *handle,
+               UINT16 timeout_ms,
+               void (* callback) (void *, UINT16),
+               void *args, UINT16 size_args
+           );
+
 API_RESULT BT_restart_timer
            (
                BT_timer_handle handle,
                UINT16 new_timeout
            );
 
+API_RESULT BT_restart_timer_ms
+           (
+               BT_timer_handle handle,
+               UINT16 new_timeout_ms
+           );
+
 API_RESULT BT_stop_timer ( BT_timer_handle handle );
 
 API_RESULT BT_is_active_timer ( BT_timer_handle handle );
@@ -86,5 +138,21 @@ API_RESULT BT_is_active_timer ( BT_timer_handle handle );
 /* Debug Routine - Internal Use Only */
 API_RESULT BT_list_timer ( void );
 
-#endif /* _H_BT_TIMER_ */
+void BT_timer_entry_init
+     (
+         BT_TIMER_ENTRY *entry,
+         void (* callback) (void *),
+         void *context
+     );
+
+/* Start, or restart if running */
+void BT_timer_entry_start ( BT_TIMER_ENTRY *entry, UINT16 timeout_ms );
 
+void BT_timer_entry_stop ( BT_TIMER_ENTRY *entry );
+
+UCHAR BT_timer_entry_is_active ( BT_TIMER_ENTRY *entry );
+
+/* Run the expired timers; returns the OS ticks to the next expiry */
+UINT16 BT_timer_service ( void );
+
+#endif /* _H_BT_TIMER_ */
@@ -3,7 +3,7 @@
  *  @file BT_timer_internal.h
  *
  *  This Header File contains Internal Declarations of Structures,
- *  Functions and Global Definitions for Windows (User-mode).
+ *  Functions and Global Definitions for MSP430.
  */
 
 /*
@@ -51,45 +51,61 @@
 
 /* ----------------------------------------------- Global Definitions */
 
-/* Timer Malloc/Free Related --------- */
-#define timer_malloc            BT_alloc_mem
-#define timer_free              BT_free_mem
-
-/* Lock/Unlock Timer Library */
-#define timer_lock()            BT_thread_mutex_lock(&timer_mutex)
-#define timer_unlock()          BT_thread_mutex_unlock(&timer_mutex)
+/*
+ * Lock/Unlock Timer Library: the wheel is changed by the BT tasks, the
+ * user task and the timer task, the lock masks the interrupts for a few
+ * list operations.
+ */
+#define timer_lock(state)       \
+    { (state) = __get_interrupt_state(); __disable_interrupt(); }
+#define timer_unlock(state)     __set_interrupt_state(state)
 
 /* Null Check for Timer Handles */
-#define timer_null_check(p)     if ((p) == NULL) return -1;
+#define timer_null_check(p)     if ((p) == NULL) return API_FAILURE;
+
+/* Timeouts to ACLK counts, rounded up so a timer never expires early */
+#define timer_ms_to_aclk(ms)    \
+    ((((UINT32)(ms) << 15) + 999) / 1000)
+#define timer_s_to_aclk(s)      ((UINT32)(s) << 15)
 
-/* Timer Task State Values */
-#define TIMER_INIT              0x00
-#define TIMER_WAITING           0x01
-#define TIMER_RUNNING           0x02
-#define TIMER_SHUTDOWN          0x03
-#define TIMER_IMMEDIATE         0x04
+/* ACLK counts per OS tick */
+#define TIMER_ACLK_PER_TICK     (portTIMESTAMP_HZ / configTICK_RATE_HZ)
 
-/* One Timer Tick => 1 Second */
-#define TIMER_TICK              1
+/*
+ * Signed distance between two slot times. They are timestamps shifted
+ * right, so they wrap with TIMER_WHEEL_SLOT_SHIFT bits less.
+ */
+#define TIMER_WHEEL_POS_DIFF(a, b)  \
+    ((INT32)(((a) - (b)) << TIMER_WHEEL_SLOT_SHIFT) / (INT32)TIMER_WHEEL_SLOT_TIME)
+
+/* Wheel slot of an expiry time */
+#define TIMER_WHEEL_SLOT_OF(t)  \
+    ((UCHAR)((t) >> TIMER_WHEEL_SLOT_SHIFT) & (TIMER_WHEEL_SLOTS - 1))
 
 /* ----------------------------------------------- Structures/Data Types */
 
 
 /* ----------------------------------------------- Internal Functions */
 
-void * timer_start_routine(void *);
-void timer_service_queue (void);
+API_RESULT timer_start_entity
+           (
+               BT_timer_handle *handle,
+               UINT32 timeout,
+               void (* callback) (void *, UINT16),
+               void *args, UINT16 size_args
+           );
+API_RESULT timer_restart_entity ( BT_timer_handle handle, UINT32 timeout );
+void timer_init_entity ( TIMER_ENTITY *timer );
+void timer_entity_expired ( void *context );
 
-API_RESULT timer_add_entity ( TIMER_ENTITY *timer );
-API_RESULT timer_del_entity ( TIMER_ENTITY *timer, UCHAR free );
-API_RESULT timer_search_entity ( TIMER_ENTITY *timer );
-API_RESULT timer_init_entity ( TIMER_ENTITY *timer );
+void timer_wheel_add ( BT_TIMER_ENTRY *entry, UINT32 timeout );
+void timer_wheel_del ( BT_TIMER_ENTRY *entry );
 
 UINT32 timer_get_current_time ( void );
 
-void timer_wait ( void );
-void timer_signal ( void );
-void timer_sleep (UINT16 seconds);
+void timer_task_routine ( void *args );
+
+void timer_signal ( UINT32 expire_at );
 
 #endif /* _H_BT_TIMER_INTERNAL_ */
 
@@ -15,8 +15,17 @@
 
 /* Define the UART Transport transmit and receive buffer sizes */
 #define UART_TX_BUFFER_SIZE                 128
+/* Largest HCI packet accepted from the controller (BT_MEM_SIZE_260) */
 #define UART_RX_BUFFER_SIZE                 260
-#define MAX_DATA_RX_PACKETS                 10
+/* Received packets holding a pool buffer: one being processed by the read
+ * task, one being received */
+#define MAX_DATA_RX_PACKETS                 2
+/* Bytes still on the line after RTS is held for want of a buffer. The
+ * CC256x checks RTS between bytes and finishes the byte it is shifting out,
+ * and RTS is raised from the ISR of the last header byte, so 2 bytes can
+ * follow; the rest is margin for an ISR delayed by another interrupt. Past
+ * it, the packet is dropped. */
+#define UART_RX_SPILL_SIZE                  8
 #define MAX_PKT_HDR_LEN                     5
 
 #define HCI_EVENT_PACKET_HEADER_LEN	        3
@@ -115,10 +124,14 @@ extern const UART_CONFIG_PARAMS bt_uart_config;
 }
 
 
+/* RTS held by the receive path until a packet buffer is available */
+extern volatile UCHAR hci_uart_rx_rts_hold;
+
 /* Enable RTS only if UART RX interrupt is not pending */
 #define UART_ENABLE_BT_UART_RTS() \
 { \
-    if ((!(*(bt_uart_config.uart_reg_ucaxifg) & UCRXIFG)) && (!(ADC12IFG)))  {\
+    if ((!(*(bt_uart_config.uart_reg_ucaxifg) & UCRXIFG)) && (!(ADC12IFG)) && \
+        (FALSE == hci_uart_rx_rts_hold))  {\
 	 *(bt_uart_config.uart_rts_port_out) &= ~(bt_uart_config.uart_rts_pin);\
     }\
 }
@@ -185,6 +198,18 @@ extern "C" {
 
     void sdk_set_controller_uart_baudrate(UINT32 baudarate);
 
+    /* Assemble a received byte into the HCI packet being received; called
+     * through hci_uart_rx_byte(). Returns TRUE when a packet is ready for the
+     * read task. */
+    UCHAR hci_uart_rx_octet(UCHAR octet);
+
+    /* Handle a byte received from the controller, eHCILL included; returns
+     * TRUE when a packet is ready for the read task */
+    UCHAR hci_uart_rx_byte(UCHAR rx_octet);
+
+    /* Packets dropped because the controller overran the spill area */
+    UINT16 hci_uart_rx_get_spill_overflows(void);
+
 #ifdef __cplusplus
 };
 #endif
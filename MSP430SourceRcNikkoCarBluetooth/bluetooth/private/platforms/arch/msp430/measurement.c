@@ -0,0 +1,265 @@
+/**
+ *  @file measurement.c
+ *
+ *  This file contains the residency profiler: time spent with the CPU active,
+ *  in LPM3, with the eHCILL link asleep, with the ACL links in sniff or
+ *  active, and the run time of each task.
+ */
+
+/*
+ *  Copyright (C) 2009-2010. MindTree Ltd.
+ *  All rights reserved.
+ */
+
+/* Header File Inclusion */
+#include "appl_sdk.h"
+#include "appl_bt_rf.h"
+#include "measurement.h"
+
+#ifdef SDK_RESIDENCY_PROFILER
+
+/* Link residency classes */
+#define RESIDENCY_LINK_NONE         0x00
+#define RESIDENCY_LINK_SNIFF        0x01
+#define RESIDENCY_LINK_ACTIVE       0x02
+
+/* Extern variables */
+/* spp connections status information */
+extern SDK_SPP_CONNECTION_STATUS sdk_status[];
+
+/* Static variables */
+/* Start of the session */
+static UINT32 residencyStart;
+static UINT32 residencyLpm3;
+static UINT32 residencySniff;
+static UINT32 residencyAclActive;
+/* Link class and start of the open link period */
+static UCHAR residencyLinkClass = RESIDENCY_LINK_NONE;
+static UINT32 residencyLinkSince;
+#ifdef SDK_EHCILL_MODE
+/* eHCILL asleep time at the start of the session */
+static UINT32 residencyEhcillBase;
+#endif /* SDK_EHCILL_MODE */
+
+/* Tasks are identified by the address of their TCB name */
+static const signed char *residencyTaskName[RESIDENCY_MAX_TASKS];
+static UINT32 residencyTaskRun[RESIDENCY_MAX_TASKS];
+static UCHAR residencyNumTasks = 0;
+/* Running task, RESIDENCY_MAX_TASKS if not tracked */
+static UCHAR residencyCurrentTask = RESIDENCY_MAX_TASKS;
+static UINT32 residencyTaskSince;
+
+/* Static Function Declarations */
+static UCHAR residencyGetLinkClass(void);
+#ifdef SDK_EHCILL_MODE
+static UINT32 residencyEhcillAsleep(UINT32 now);
+#endif /* SDK_EHCILL_MODE */
+
+
+/**
+ * \fn      residencyReset
+ * \brief   Start a new session: clear all the counters
+ * \param   void
+ * \return  void
+ */
+void residencyReset(void)
+{
+    UINT32 now;
+    UCHAR index;
+
+    __disable_interrupt();
+    now = portGET_TIMESTAMP();
+
+    residencyStart = now;
+    residencyLpm3 = 0;
+    residencySniff = 0;
+    residencyAclActive = 0;
+    residencyLinkClass = residencyGetLinkClass();
+    residencyLinkSince = now;
+#ifdef SDK_EHCILL_MODE
+    residencyEhcillBase = residencyEhcillAsleep(now);
+#endif /* SDK_EHCILL_MODE */
+
+    /* Keep the task table, the tasks never go away */
+    for (index = 0; index < RESIDENCY_MAX_TASKS; index++) {
+        residencyTaskRun[index] = 0;
+    }
+    residencyTaskSince = now;
+    __enable_interrupt();
+}
+
+/**
+ * \fn      residencySnapshot
+ * \brief   Take a consistent copy of the counters, open periods included
+ * \param   snapshot    Filled with the counters
+ * \return  void
+ */
+void residencySnapshot(residencyMeasurement_t *snapshot)
+{
+    UINT32 now;
+    UCHAR index, len;
+
+    memset(snapshot, 0, sizeof(residencyMeasurement_t));
+
+    __disable_interrupt();
+    now = portGET_TIMESTAMP();
+
+    snapshot->session = now - residencyStart;
+    snapshot->lpm3 = residencyLpm3;
+    snapshot->sniff = residencySniff;
+    snapshot->aclActive = residencyAclActive;
+    if (RESIDENCY_LINK_SNIFF == residencyLinkClass) {
+        snapshot->sniff += (now - residencyLinkSince);
+    } else if (RESIDENCY_LINK_ACTIVE == residencyLinkClass) {
+        snapshot->aclActive += (now - residencyLinkSince);
+    }
+#ifdef SDK_EHCILL_MODE
+    snapshot->ehcillSleep = residencyEhcillAsleep(now) - residencyEhcillBase;
+#endif /* SDK_EHCILL_MODE */
+
+    for (index = 0; index < residencyNumTasks; index++) {
+        snapshot->taskRun[index] = residencyTaskRun[index];
+        for (len = 0; len < RESIDENCY_TASK_NAME_LEN; len++) {
+            if ('\0' == residencyTaskName[index][len]) {
+                break;
+            }
+            snapshot->taskName[index][len] =
+                (UCHAR) residencyTaskName[index][len];
+        }
+    }
+    if (residencyCurrentTask < RESIDENCY_MAX_TASKS) {
+        snapshot->taskRun[residencyCurrentTask] += (now - residencyTaskSince);
+    }
+    snapshot->numTasks = residencyNumTasks;
+    __enable_interrupt();
+
+    /* The LPM3 time is added on wake; a snapshot is never taken asleep */
+    if (snapshot->lpm3 > snapshot->session) {
+        snapshot->lpm3 = snapshot->session;
+    }
+    snapshot->cpuActive = snapshot->session - snapshot->lpm3;
+    snapshot->version = RESIDENCY_VERSION;
+}
+
+/**
+ * \fn      residencyLinkUpdate
+ * \brief   Close the open link period if the link class changed; called
+ *          whenever sdk_status[] connection or link state changes
+ * \param   void
+ * \return  void
+ */
+void residencyLinkUpdate(void)
+{
+    UINT32 now;
+    UCHAR linkClass;
+    unsigned short state;
+
+    linkClass = residencyGetLinkClass();
+
+    /* The state macros may be used with interrupts already disabled */
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    if (linkClass != residencyLinkClass) {
+        now = portGET_TIMESTAMP();
+        if (RESIDENCY_LINK_SNIFF == residencyLinkClass) {
+            residencySniff += (now - residencyLinkSince);
+        } else if (RESIDENCY_LINK_ACTIVE == residencyLinkClass) {
+            residencyAclActive += (now - residencyLinkSince);
+        }
+        residencyLinkClass = linkClass;
+        residencyLinkSince = now;
+    }
+    __set_interrupt_state(state);
+}
+
+/**
+ * \fn      vResidencyTaskSwitchedIn
+ * \brief   Charge the time since the last switch to the outgoing task;
+ *          traceTASK_SWITCHED_IN() from vTaskSwitchContext()
+ * \param   pcTaskName  Name of the task switched in
+ * \return  void
+ */
+void vResidencyTaskSwitchedIn(const signed char *pcTaskName)
+{
+    UINT32 now;
+    UCHAR index;
+
+    now = portGET_TIMESTAMP();
+    if (residencyCurrentTask < RESIDENCY_MAX_TASKS) {
+        residencyTaskRun[residencyCurrentTask] += (now - residencyTaskSince);
+    }
+    residencyTaskSince = now;
+
+    for (index = 0; index < residencyNumTasks; index++) {
+        if (pcTaskName == residencyTaskName[index]) {
+            break;
+        }
+    }
+    if ((index == residencyNumTasks) && (index < RESIDENCY_MAX_TASKS)) {
+        residencyTaskName[index] = pcTaskName;
+        residencyTaskRun[index] = 0;
+        residencyNumTasks++;
+    }
+    residencyCurrentTask = index;
+}
+
+/**
+ * \fn      vResidencyLowPowerIdleEnd
+ * \brief   Add the time slept by the tickless idle;
+ *          traceLOW_POWER_IDLE_END() from vPortSuppressTicksAndSleep()
+ * \param   ulSleptCount    ACLK counts spent in LPM3
+ * \return  void
+ */
+void vResidencyLowPowerIdleEnd(unsigned long ulSleptCount)
+{
+    residencyLpm3 += ulSleptCount;
+}
+
+
+/**
+ * \fn      residencyGetLinkClass
+ * \brief   Classify the ACL links from sdk_status[]
+ * \param   void
+ * \return  UCHAR       RESIDENCY_LINK_*
+ */
+static UCHAR residencyGetLinkClass(void)
+{
+    UCHAR linkClass = RESIDENCY_LINK_NONE;
+    UCHAR state;
+    UCHAR index;
+
+    for (index = 0; index < SPP_MAX_ENTITY; index++) {
+        state = sdk_status[index].connect_switch;
+        /* ACL up from its completion until its disconnection complete */
+        if ((state < SDK_ACL_CONNECTED) || (state > SDK_SPP_DISCONNECTED)) {
+            continue;
+        }
+        if (SDK_IS_IN_SNIFF_MODE(index)) {
+            linkClass = RESIDENCY_LINK_SNIFF;
+        } else {
+            return RESIDENCY_LINK_ACTIVE;
+        }
+    }
+    return linkClass;
+}
+
+#ifdef SDK_EHCILL_MODE
+/**
+ * \fn      residencyEhcillAsleep
+ * \brief   eHCILL asleep time since boot, open asleep period included
+ * \param   now         Current timestamp
+ * \return  UINT32      ACLK counts
+ */
+static UINT32 residencyEhcillAsleep(UINT32 now)
+{
+    const EHCILL_SM_STATS *stats = ehcill_sm_get_stats();
+    UINT32 asleep = stats->asleep_time;
+
+    if (EHCILL_SM_IS_ASLEEP()) {
+        asleep += (now - stats->state_entry_time);
+    }
+    return asleep;
+}
+#endif /* SDK_EHCILL_MODE */
+
+#endif /* SDK_RESIDENCY_PROFILER */
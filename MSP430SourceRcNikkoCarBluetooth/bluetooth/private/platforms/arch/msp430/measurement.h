@@ -3,6 +3,14 @@
  *  @file measurement.h
  *
  *  This file contains macros/datatype specific to CPU utilization calculation
+ *  and to the residency profiler.
+ *
+ *  The residency profiler is always on with SDK_RESIDENCY_PROFILER: it adds
+ *  up the time spent with the CPU active, in LPM3, with the eHCILL link
+ *  asleep, with an ACL link in sniff or active, and the run time of each
+ *  task. All times are ACLK counts (1/32768 s) since the last reset, so a
+ *  driving session is bracketed by a reset at its start and a snapshot at
+ *  its end.
  */
 
 /* 
@@ -13,6 +21,9 @@
 #ifndef _H_MEASUREMENT_
 #define _H_MEASUREMENT_
 
+#include "BT_common.h"
+#include "sdk_bluetooth_config.h"
+
 typedef struct cpuUtilMeasurement {
     volatile UINT32 taskStart;
     volatile UINT32 taskEnd;
@@ -68,4 +79,53 @@ void configMSP430Timers(void);
 void LcdDisplay(void);
 void LCD_disp_utilz(UINT32 util_count);
 
+#ifdef SDK_RESIDENCY_PROFILER
+
+/* Version of residencyMeasurement_t, bumped on any layout change */
+#define RESIDENCY_VERSION           0x01
+
+/* Tasks tracked by name; later ones are not accounted */
+#define RESIDENCY_MAX_TASKS         6
+/* Leading characters of the task name kept in the snapshot */
+#define RESIDENCY_TASK_NAME_LEN     4
+
+/**
+ * Residency snapshot, sent as is over SPP (little endian, 74 bytes).
+ * cpuActive + lpm3 == session. The link times overlap the CPU times;
+ * sniff is counted while every ACL link is in sniff, aclActive while at
+ * least one is active.
+ */
+typedef struct residencyMeasurement {
+    UINT32 session;
+    UINT32 cpuActive;
+    UINT32 lpm3;
+    UINT32 ehcillSleep;
+    UINT32 sniff;
+    UINT32 aclActive;
+    /* Run time of each task, idle task sleep included */
+    UINT32 taskRun[RESIDENCY_MAX_TASKS];
+    UCHAR taskName[RESIDENCY_MAX_TASKS][RESIDENCY_TASK_NAME_LEN];
+    UCHAR numTasks;
+    UCHAR version;
+} residencyMeasurement_t;
+
+/* Re-evaluate the ACL link residency after a connection/link state change */
+#define RESIDENCY_LINK_UPDATE()     residencyLinkUpdate()
+
+/* Start a new session: clear all the counters */
+void residencyReset(void);
+/* Take a consistent copy of the counters, open periods included */
+void residencySnapshot(residencyMeasurement_t *snapshot);
+/* Called whenever sdk_status[] connection or link state changes */
+void residencyLinkUpdate(void);
+/* FreeRTOS trace hooks, see FreeRTOSConfig.h */
+void vResidencyTaskSwitchedIn(const signed char *pcTaskName);
+void vResidencyLowPowerIdleEnd(unsigned long ulSleptCount);
+
+#else /* SDK_RESIDENCY_PROFILER */
+
+#define RESIDENCY_LINK_UPDATE()     ((void)0)
+
+#endif /* SDK_RESIDENCY_PROFILER */
+
 #endif /* _H_MEASUREMENT */
@@ -13,63 +13,27 @@
 #include "msp430_uart.h"
 #include "vendor_specific_init.h"
 #include "bt_sdk_error.h"
+#include "wake_latency.h"
 
 
-#define HCI_ACL_DATA_PACKET                         0x02
-#define HCI_EVENT_PACKET                            0x04
-
-/* Macro definitions */
-#define UPDATE_RX_BUFFER(data) \
-      { \
-        uart_rx_buffer[uart_rx_wr] = data;\
-        uart_rx_wr++;\
-        if (UART_RX_BUFFER_SIZE == uart_rx_wr) {\
-                uart_rx_wr = 0;\
-        }\
-      }
-
 /* External Global Variables */
-extern INT16 uart_rx_rd;
 extern volatile UCHAR sem_flag;
-/* Variable to store the packet header length */
-extern UINT8 packet_header_len;
-
-/* Buffer to store the header data */
-extern UCHAR temp_header_buffer[MAX_PKT_HDR_LEN];
-
-/* Index used in the temp_header_buffer */
-extern UCHAR temp_header_buffer_idx;
-
-/* Variable used to store current packet length */
-extern volatile UINT16 current_pkt_len;
-
-extern DATA_RX_QUEUE data_rx_queue;
 
 /* External Global Variables */
 extern volatile UINT16 bytes_available_in_tx_buffer;
-extern volatile UINT16 bytes_to_be_processed;
 
-extern INT16 uart_rx_wr;        /* Write pointer of uart rx buffer */
 extern UINT8 uart_tx_wr;
 extern volatile UINT16 bytes_expected;
 extern xSemaphoreHandle xReadSemaphore, xWritePlSemaphore;
-extern UCHAR uart_rx_buffer[];
 extern UCHAR uart_tx_buffer[UART_TX_BUFFER_SIZE];
 extern UINT8 uart_tx_rd;
 
-#ifdef SDK_EHCILL_MODE
-extern volatile UINT32 ehcill_rx_state;
-extern volatile UINT32 ehcill_tx_state;
-extern volatile UINT32 msp430_state;
-#endif /* SDK_EHCILL_MODE */
-
 extern volatile UCHAR packet_complete;
 extern UCHAR expected_uart_data_type;
 
 extern UINT32 sdk_error_code;
 extern void sdk_uart_error_handler(void);
 
-extern UCHAR read_task_buffer[UART_RX_BUFFER_SIZE];
 /* The variable is used to hold the current BT UART baud rate value */
 extern UINT32 current_bt_uart_baudrate;
 
@@ -143,7 +107,6 @@ __interrupt void BT_UART_ISR(void)
     volatile UCHAR uart_rx_val;
     volatile UCHAR uart_err_val;
     volatile UCHAR ehcill_data_flag = 0;
-    UINT16 temp_ptr, i;
 
     UART_DISABLE_BT_UART_RTS();
 
@@ -155,7 +118,6 @@ __interrupt void BT_UART_ISR(void)
     /* RX interrupt handler */
     if (int_vect & 0x02) {
         UCHAR rx_octet;
-        ehcill_data_flag = 0;
         if (FALSE == sdk_update_uart_baudrate_flag) {
             if (((*(bt_uart_config.uart_reg_ucaxstat)) & UCRXERR)) {
                 /* Handle UART error */
@@ -179,208 +141,25 @@ __interrupt void BT_UART_ISR(void)
                 sdk_uart_error_handler();
             } else {
                 rx_octet = *(bt_uart_config.uart_reg_ucaxrxbuf);
-#ifdef SDK_EHCILL_MODE
-                /* Check if the data is the first byte of the packet;
-                 * bytes_expected will be set to 1 and the
-                 * expected_uart_data_type will be set to BT_HEADER_FIRST_BYTE */
-                if ((1 == bytes_expected)
-                    && (BT_HEADER_FIRST_BYTE == expected_uart_data_type)) {
-                    /* Validating if the received octet is ehcill data : 0x30
-                     * to 0x33 */
-                    if ((rx_octet >= SDK_BT_RF_SLEEP_IND)
-                        && (rx_octet <= SDK_BT_RF_WAKE_UP_ACK)) {
-                        /* Setting the flag for ehcill data */
-                        ehcill_data_flag = 1;
-                        ehcill_rx_state = rx_octet;
-                        /* Calling ehcill rx_handler for handling received
-                         * ehcill byte */
-                        ehcill_rx_handler();
-                    }
-                }
-#endif /* SDK_EHCILL_MODE */
-                /* Checking if the data received is not ehcill data */
-                if (0 == ehcill_data_flag) {
-                    /* Updating the uart rx buffer; this updates the uart_rx_wr
-                     * pointer */
-                    UPDATE_RX_BUFFER(rx_octet);
-                    /* Decrementing bytes_expected on receiving the data */
-                    bytes_expected--;
-                    bytes_to_be_processed++;
-
-                    /* On reception of expected data, decoding of the received
-                     * bytes is done here */
-                    if (0 == bytes_expected) {
-                        while (bytes_to_be_processed) {
-                            bytes_to_be_processed--;
-                            switch (expected_uart_data_type) {
-                            case BT_HEADER_FIRST_BYTE:
-                                data_rx_queue.start_idx = uart_rx_rd;
-                                /* Copying the header details from the uart tx
-                                 * buffer */
-                                temp_header_buffer[temp_header_buffer_idx] =
-                                    uart_rx_buffer[uart_rx_rd];
-
-                                temp_header_buffer_idx++;
-                                /* Incrementing the current packet length and
-                                 * updating the uart_rx_rd pointer */
-                                current_pkt_len++;
-                                uart_rx_rd++;
-                                if (UART_RX_BUFFER_SIZE == uart_rx_rd) {
-                                    uart_rx_rd = 0;
-                                }
-                                /* Setting the bytes_expected based on the
-                                 * Packet header length */
-                                switch (temp_header_buffer[0]) {
-                                case HCI_EVENT_PACKET:
-                                    bytes_expected =
-                                        HCI_EVENT_PACKET_HEADER_LEN - 1;
-                                    break;
-                                case HCI_ACL_DATA_PACKET:
-                                    bytes_expected =
-                                        HCI_ACL_DATA_PACKET_HEADER_LEN - 1;
-                                    break;
-                                default:
-                                    sdk_error_code =
-                                        SDK_ERROR_IN_HEADER_FIRST_BYTE;
-                                    sdk_error_handler();
-                                    break;
-
-                                }
-                                /* Setting the expected_uart_data_type to
-                                 * BT_HEADER, on reception of first byte of
-                                 * header */
-                                expected_uart_data_type = BT_HEADER;
-                                break;
-                            case BT_HEADER:
-                                /* Copying the header details from the uart tx
-                                 * buffer */
-                                temp_header_buffer[temp_header_buffer_idx] =
-                                    uart_rx_buffer[uart_rx_rd];
-
-                                /* Incrementing the current packet lenght and
-                                 * updating the uart_rx_rd pointer */
-                                temp_header_buffer_idx++;
-                                current_pkt_len++;
-                                uart_rx_rd++;
-                                if (UART_RX_BUFFER_SIZE == uart_rx_rd) {
-                                    uart_rx_rd = 0;
-                                }
-                                switch (temp_header_buffer[0]) {
-                                    /* Case to handler HCI Event Packet */
-                                case HCI_EVENT_PACKET:
-                                    /* Updating the bytes_expected based on the
-                                     * packet header length */
-                                    if (temp_header_buffer_idx >=
-                                        HCI_EVENT_PACKET_HEADER_LEN) {
-                                        data_rx_queue.length =
-                                            temp_header_buffer[2] +
-                                            HCI_EVENT_PACKET_HEADER_LEN;
-                                        data_rx_queue.pkt_type =
-                                            HCI_EVENT_PACKET;
-                                        /* Updating the header length of HCI
-                                         * Event */
-                                        packet_header_len =
-                                            HCI_EVENT_PACKET_HEADER_LEN;
-                                        bytes_expected =
-                                            data_rx_queue.length -
-                                            HCI_EVENT_PACKET_HEADER_LEN;
-                                        expected_uart_data_type = BT_PAYLOAD;
-                                    }
-                                    break;
-
-                                    /* Case to handler ACL Data Packet */
-                                case HCI_ACL_DATA_PACKET:
-                                    /* If ACL packet, then the length of
-                                     * payload will the 3rd and 4th byte of the
-                                     * header */
-                                    if (temp_header_buffer_idx >=
-                                        HCI_ACL_DATA_PACKET_HEADER_LEN) {
-                                        data_rx_queue.length =
-                                            (temp_header_buffer[4] << 8) |
-                                            (temp_header_buffer[3]);
-                                        data_rx_queue.length +=
-                                            HCI_ACL_DATA_PACKET_HEADER_LEN;
-                                        data_rx_queue.pkt_type =
-                                            HCI_ACL_DATA_PACKET;
-                                        /* Updating the header length of ACL
-                                         * Data packet */
-                                        packet_header_len =
-                                            HCI_ACL_DATA_PACKET_HEADER_LEN;
-                                        bytes_expected =
-                                            data_rx_queue.length -
-                                            HCI_ACL_DATA_PACKET_HEADER_LEN;
-                                        expected_uart_data_type = BT_PAYLOAD;
-                                    }
-                                    break;
-                                default:
-                                    /* Handling error case */
-                                    sdk_error_code = SDK_ERROR_IN_HEADER;
-                                    sdk_error_handler();
-                                    break;
-                                }
-                                break;
-
-                                /* Case to handle Payload */
-                            case BT_PAYLOAD:
-                                current_pkt_len++;
-
-                                /* Updating the parameters, on receiving the
-                                 * entire payload */
-                                if (current_pkt_len >= data_rx_queue.length) {
-                                    expected_uart_data_type =
-                                        BT_HEADER_FIRST_BYTE;
-                                    current_pkt_len = 0;
-                                    temp_header_buffer_idx = 0;
-                                    bytes_expected = 1;
-                                    temp_ptr = data_rx_queue.start_idx;
-                                    for (i = 0; i < data_rx_queue.length; i++) {
-                                        /* Copying the entire packet from uart
-                                         * rx buffer to the read_task_buffer */
-                                        read_task_buffer[i] =
-                                            uart_rx_buffer[temp_ptr];
-                                        if (i >= packet_header_len) {
-                                            uart_rx_rd++;
-                                            if (UART_RX_BUFFER_SIZE ==
-                                                uart_rx_rd) {
-                                                uart_rx_rd = 0;
-                                            }
-                                        }
-                                        temp_ptr++;
-                                        if (UART_RX_BUFFER_SIZE == temp_ptr) {
-                                            temp_ptr = 0;
-                                        }
-                                    }
-
-                                    /* Checking if the sem flag is set to 1;
-                                     * This flag is set to 1 in the read task,
-                                     * after semaphore acquisition */
-                                    if (1 == sem_flag) {
-                                        /* Releasing the semaphore for read
-                                         * task to continue further processing */
-                                        if (pdPASS !=
-                                            xSemaphoreGiveFromISR
-                                            (xReadSemaphore,
-                                             &xHigherPriorityTaskWoken)) {
-                                            /* Error condition if the Sem
-                                             * release returns failure */
-                                            sdk_error_code =
-                                                SDK_ERROR_IN_READ_SEM_GIVE;
-                                            sdk_error_handler();
-                                        } else {
-                                            sem_flag = 0;
-                                        }
-                                    }
-                                }
-                                break;
-
-                            default:
-                                sdk_error_code = SDK_ERROR_IN_DATA_RECV;
-                                sdk_error_handler();
-                                break;
-
-                            }
+                /* On a complete packet, the read task is woken */
+                if (TRUE == hci_uart_rx_byte(rx_octet)) {
+                    /* Checking if the sem flag is set to 1; This flag
+                     * is set to 1 in the read task, after semaphore
+                     * acquisition */
+                    if (1 == sem_flag) {
+                        /* Releasing the semaphore for read task to
+                         * continue further processing */
+                        if (pdPASS !=
+                            xSemaphoreGiveFromISR(xReadSemaphore,
+                                                  &xHigherPriorityTaskWoken))
+                        {
+                            /* Error condition if the Sem release
+                             * returns failure */
+                            sdk_error_code = SDK_ERROR_IN_READ_SEM_GIVE;
+                            sdk_error_handler();
+                        } else {
+                            sem_flag = 0;
                         }
-
                     }
                 }
             }
@@ -401,10 +180,9 @@ __interrupt void BT_UART_ISR(void)
             if (0 == bytes_available_in_tx_buffer) {
 #ifdef SDK_EHCILL_MODE
                 if (TRUE == packet_complete) {
-                    if ((BT_RF_NO_EHCILL_DATA != ehcill_rx_state)
-                        || (BT_RF_NO_EHCILL_DATA != ehcill_tx_state)) {
+                    if (EHCILL_SM_IS_HANDSHAKE_PENDING()) {
                         ehcill_data_flag = 1;
-                        ehcill_tx_handler();
+                        ehcill_tx_handler(EHCILL_EV_TX_IDLE);
                     }
                 }
 #endif /* SDK_EHCILL_MODE */
@@ -417,8 +195,8 @@ __interrupt void BT_UART_ISR(void)
             } else {
 #ifdef SDK_EHCILL_MODE
                 /* Condition to handle wake up from Host */
-                if (SDK_MSP430_SLEEP_STATE == msp430_state) {
-                    ehcill_tx_handler();
+                if (EHCILL_SM_IS_HOST_ASLEEP()) {
+                    ehcill_tx_handler(EHCILL_EV_TX_DATA);
 
                 } else
 #endif /* SDK_EHCILL_MODE */
@@ -479,11 +257,48 @@ __interrupt void BT_UART_ISR(void)
     }
 #endif /* MSP430_LPM_ENABLE */
 
+    /* End a tickless idle sleep so the tick count is corrected */
+    portTICKLESS_EXIT_LPM();
+
     if (xHigherPriorityTaskWoken) {
         portYIELD();
     }
 }
 
+/**
+ * \fn      hci_uart_rx_byte
+ * \brief   Handle a byte received from the controller: eHCILL state machine
+ *          between packets, HCI packet assembly and wake latency stats.
+ *          Called from the BT UART ISR, and with interrupts disabled for the
+ *          bytes received while RTS was held.
+ * \param   rx_octet    Received byte
+ * \return  UCHAR       TRUE when a packet is ready for the read task
+ */
+UCHAR hci_uart_rx_byte(UCHAR rx_octet)
+{
+    /* First byte after a wake, for the wake latency stats */
+    WAKE_LATENCY_RX_BYTE();
+#ifdef SDK_EHCILL_MODE
+    /* Check if the data is the first byte of the packet; bytes_expected will
+     * be set to 1 and the expected_uart_data_type will be set to
+     * BT_HEADER_FIRST_BYTE. ehcill data (0x30 to 0x33) is consumed by the
+     * ehcill state machine. */
+    if ((1 == bytes_expected)
+        && (BT_HEADER_FIRST_BYTE == expected_uart_data_type)
+        && (0 != ehcill_rx_handler(rx_octet))) {
+        return FALSE;
+    }
+#endif /* SDK_EHCILL_MODE */
+    /* The packet is assembled straight into its pool buffer */
+    if (TRUE != hci_uart_rx_octet(rx_octet)) {
+        return FALSE;
+    }
+    /* First packet after a wake, for the wake latency stats */
+    WAKE_LATENCY_RX_PACKET();
+
+    return TRUE;
+}
+
 
 /**
  * \fn      sdk_msp430_uart_init
@@ -671,3 +486,63 @@ void sdk_set_host_uart_baudrate(UINT32 baudrate)
         UART_ENABLE_BT_UART_RX();
     }
 }
+
+
+/**
+ * \fn      sdk_host_uart_baudrate_supported
+ * \brief   Check that sdk_set_host_uart_baudrate() has divisors for a baud
+ *          rate at a system clock
+ * \param   baudrate    The value of baudrate
+ * \param   clock       System clock - SYSCLK_xxMHZ
+ * \return  TRUE/FALSE
+ */
+UCHAR sdk_host_uart_baudrate_supported(UINT32 baudrate, UCHAR clock)
+{
+    switch (baudrate) {
+    case SDK_BAUDRATE_115200:
+    case SDK_BAUDRATE_230400:
+        if ((SYSCLK_8MHZ == clock) || (SYSCLK_12MHZ == clock) ||
+            (SYSCLK_18MHZ == clock) || (SYSCLK_25MHZ == clock)) {
+            return TRUE;
+        }
+        break;
+    case SDK_BAUDRATE_921600:
+        if (SYSCLK_25MHZ == clock) {
+            return TRUE;
+        }
+        break;
+    default:
+        break;
+    }
+    return FALSE;
+}
+
+/**
+ * \fn      sdk_host_uart_reclock
+ * \brief   Re-derive the BT UART divisors after a system clock change. A UART
+ *          shut down for ehcill sleep stays in reset, otherwise it is
+ *          restarted with its interrupt enables. To be called with interrupts
+ *          disabled, RTS deasserted and the transmitter idle.
+ * \param   void
+ * \return  void
+ */
+void sdk_host_uart_reclock(void)
+{
+    UCHAR uart_ctl1, uart_ie;
+
+    uart_ctl1 = *(bt_uart_config.uart_reg_ucaxctl1);
+    uart_ie = *(bt_uart_config.uart_reg_ucaxie);
+
+    /* Divisors are only written in reset; keep the reset and interrupt
+     * enables under our control rather than sdk_set_host_uart_baudrate() */
+    *(bt_uart_config.uart_reg_ucaxctl1) |= UCSWRST;
+    msp430_uart_init_flag = TRUE;
+    sdk_set_host_uart_baudrate(current_bt_uart_baudrate);
+    msp430_uart_init_flag = FALSE;
+
+    if (0 == (uart_ctl1 & UCSWRST)) {
+        *(bt_uart_config.uart_reg_ucaxctl1) &= ~UCSWRST;
+        /* Leaving reset clears UCAxIE */
+        *(bt_uart_config.uart_reg_ucaxie) = uart_ie;
+    }
+}
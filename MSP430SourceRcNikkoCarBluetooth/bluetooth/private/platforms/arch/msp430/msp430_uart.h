@@ -28,6 +28,12 @@ extern "C" {
     /* This function is used to set the uart baudrate */
     void sdk_set_host_uart_baudrate(UINT32 baudrate);
 
+    /* Check that a baudrate can be set at a system clock (SYSCLK_xxMHZ) */
+    UCHAR sdk_host_uart_baudrate_supported(UINT32 baudrate, UCHAR clock);
+
+    /* Re-derive the uart baudrate after a system clock change */
+    void sdk_host_uart_reclock(void);
+
     /* Initialize UART ports and registers */
     void sdk_msp430_uart_init(void);
 
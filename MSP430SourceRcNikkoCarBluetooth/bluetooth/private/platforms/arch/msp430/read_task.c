@@ -0,0 +1,453 @@
+/**
+ * Copyright (C) 2009. MindTree Ltd. All rights reserved.
+ * \file    read_task.c
+ * \brief   Contains the HCI UART receive path: the packets are assembled by
+ *          the BT UART ISR straight into a buffer of the BT pools, sized from
+ *          the packet header, and handed to the stack by the read task.
+ *
+ *          When no buffer is available, RTS is held until the read task
+ *          frees one; the few bytes still on the line are kept aside and
+ *          replayed into the new buffer. If the controller sends more than
+ *          the spill area holds, the held packet is dropped and the receive
+ *          path resyncs at its end.
+ */
+
+/* Header File Inclusion */
+#include "sdk_pl.h"
+#include "hci_uart.h"
+#include "BT_buffer.h"
+#include "bt_sdk_error.h"
+
+#define HCI_ACL_DATA_PACKET                         0x02
+#define HCI_EVENT_PACKET                            0x04
+
+/* Retry period of the buffer allocation while RTS is held (ms) */
+#define HCI_UART_RX_RETRY_MS                        10
+
+/* Received packet waiting for the read task */
+typedef struct {
+    UCHAR *buffer;
+    UINT16 length;
+} HCI_UART_RX_PACKET;
+
+/* Extern variables */
+extern xSemaphoreHandle xReadSemaphore;
+extern UINT32 sdk_error_code;
+
+/* Creates the read task running ht_read_task_start_routine() */
+extern void ht_read_task_create_pl(void);
+/* Stack entry for a received packet, without its H4 packet type */
+extern API_RESULT hci_transport_read_data(UCHAR packet_type, UCHAR * buf,
+                                          UINT16 length);
+
+/* Global variables */
+/* Receive state, also reset by hci_uart_bt_init() */
+volatile UINT16 bytes_expected = 1;
+volatile UINT16 current_pkt_len = 0;
+UCHAR expected_uart_data_type = BT_HEADER_FIRST_BYTE;
+UINT8 packet_header_len = 0;
+UCHAR temp_header_buffer[MAX_PKT_HDR_LEN];
+UCHAR temp_header_buffer_idx = 0;
+/* Type and total length of the packet being received */
+DATA_RX_QUEUE data_rx_queue;
+/* UART ring indexes reset by hci_uart_bt_init(); the packets no longer go
+ * through a ring */
+INT16 uart_rx_rd = 0;
+INT16 uart_rx_wr = 0;
+volatile UINT16 bytes_to_be_processed = 0;
+
+/* Set by the read task once it has taken the read semaphore */
+volatile UCHAR sem_flag = 0;
+
+volatile UCHAR hci_uart_rx_rts_hold = FALSE;
+
+/* Static variables */
+/* Completed packets, oldest at hci_uart_rx_rd */
+static HCI_UART_RX_PACKET hci_uart_rx_queue[MAX_DATA_RX_PACKETS];
+static UCHAR hci_uart_rx_rd = 0;
+static UCHAR hci_uart_rx_count = 0;
+/* Buffer of the packet being received, NULL while RTS is held */
+static UCHAR *hci_uart_rx_packet = NULL;
+/* Bytes received while RTS is held */
+static UCHAR hci_uart_rx_spill[UART_RX_SPILL_SIZE];
+static UCHAR hci_uart_rx_spill_len = 0;
+/* Packets dropped because the spill area overflowed */
+static UINT16 hci_uart_rx_spill_overflows = 0;
+
+/* Static Function Declarations */
+static UCHAR hci_uart_rx_begin(void);
+static UCHAR hci_uart_rx_complete(void);
+static UCHAR hci_uart_rx_drop(UCHAR octet);
+static void hci_uart_rx_resync(void);
+static UCHAR hci_uart_rx_dequeue(HCI_UART_RX_PACKET * packet);
+static UCHAR hci_uart_rx_resume(void);
+static void hci_uart_rx_reset(void);
+
+
+/**
+ * \fn      hci_transport_init
+ * \brief   Creates the read task
+ * \param   void
+ * \return  void
+ */
+void hci_transport_init(void)
+{
+    ht_read_task_create_pl();
+}
+
+/**
+ * \fn      hci_transport_bt_init
+ * \brief   Drops any packet left from the previous bluetooth session
+ * \param   void
+ * \return  void
+ */
+void hci_transport_bt_init(void)
+{
+    hci_uart_rx_reset();
+}
+
+/**
+ * \fn      hci_transport_bt_shutdown
+ * \brief   Releases the buffers of the packets not yet processed
+ * \param   void
+ * \return  void
+ */
+void hci_transport_bt_shutdown(void)
+{
+    hci_uart_rx_reset();
+}
+
+/**
+ * \fn      ht_read_task_start_routine
+ * \brief   Read task: hands the received packets to the stack and frees
+ *          their buffers
+ * \param   args        Not used
+ * \return  void *
+ */
+void *ht_read_task_start_routine(void *args)
+{
+    HCI_UART_RX_PACKET packet;
+    portTickType wait;
+
+    /* Start from an empty semaphore: the ISR gives it once per sem_flag */
+    (void)xSemaphoreTake(xReadSemaphore, 0);
+    sem_flag = 1;
+
+    while (1) {
+        do {
+            while (TRUE == hci_uart_rx_dequeue(&packet)) {
+                (void)hci_transport_read_data(packet.buffer[0],
+                                              &packet.buffer[1],
+                                              packet.length - 1);
+                BT_free_mem(packet.buffer);
+            }
+        } while (TRUE == hci_uart_rx_resume());
+
+        /* While RTS is held, buffers may also be freed by other tasks */
+        wait = (TRUE == hci_uart_rx_rts_hold) ?
+            (HCI_UART_RX_RETRY_MS / portTICK_RATE_MS) : portMAX_DELAY;
+        (void)xSemaphoreTake(xReadSemaphore, wait);
+        sem_flag = 1;
+    }
+}
+
+/**
+ * \fn      hci_uart_rx_octet
+ * \brief   Assemble a received byte into the HCI packet being received;
+ *          called through hci_uart_rx_byte()
+ * \param   octet       Received byte
+ * \return  UCHAR       TRUE when a packet is ready for the read task
+ */
+UCHAR hci_uart_rx_octet(UCHAR octet)
+{
+    if (TRUE == hci_uart_rx_rts_hold) {
+        if (UART_RX_SPILL_SIZE == hci_uart_rx_spill_len) {
+            return hci_uart_rx_drop(octet);
+        }
+        hci_uart_rx_spill[hci_uart_rx_spill_len] = octet;
+        hci_uart_rx_spill_len++;
+        return FALSE;
+    }
+
+    switch (expected_uart_data_type) {
+    case BT_HEADER_FIRST_BYTE:
+        temp_header_buffer[0] = octet;
+        temp_header_buffer_idx = 1;
+        current_pkt_len = 1;
+        switch (octet) {
+        case HCI_EVENT_PACKET:
+            packet_header_len = HCI_EVENT_PACKET_HEADER_LEN;
+            break;
+        case HCI_ACL_DATA_PACKET:
+            packet_header_len = HCI_ACL_DATA_PACKET_HEADER_LEN;
+            break;
+        default:
+            sdk_error_code = SDK_ERROR_IN_HEADER_FIRST_BYTE;
+            sdk_error_handler();
+            return FALSE;
+        }
+        bytes_expected = packet_header_len - 1;
+        expected_uart_data_type = BT_HEADER;
+        break;
+
+    case BT_HEADER:
+        temp_header_buffer[temp_header_buffer_idx] = octet;
+        temp_header_buffer_idx++;
+        current_pkt_len++;
+        bytes_expected--;
+        if (0 != bytes_expected) {
+            break;
+        }
+
+        /* Header complete: the total length is known */
+        if (HCI_EVENT_PACKET == temp_header_buffer[0]) {
+            data_rx_queue.length =
+                temp_header_buffer[2] + HCI_EVENT_PACKET_HEADER_LEN;
+        } else {
+            data_rx_queue.length =
+                ((temp_header_buffer[4] << 8) | temp_header_buffer[3]) +
+                HCI_ACL_DATA_PACKET_HEADER_LEN;
+        }
+        data_rx_queue.pkt_type = temp_header_buffer[0];
+        if (UART_RX_BUFFER_SIZE < data_rx_queue.length) {
+            sdk_error_code = SDK_ERROR_IN_HEADER;
+            sdk_error_handler();
+            return FALSE;
+        }
+        bytes_expected = data_rx_queue.length - packet_header_len;
+        expected_uart_data_type = BT_PAYLOAD;
+        return hci_uart_rx_begin();
+
+    case BT_PAYLOAD:
+        /* The payload of a dropped packet is only counted */
+        if (NULL != hci_uart_rx_packet) {
+            hci_uart_rx_packet[current_pkt_len] = octet;
+        }
+        current_pkt_len++;
+        bytes_expected--;
+        if (0 != bytes_expected) {
+            break;
+        }
+        if (NULL == hci_uart_rx_packet) {
+            hci_uart_rx_resync();
+            break;
+        }
+        return hci_uart_rx_complete();
+
+    default:
+        sdk_error_code = SDK_ERROR_IN_DATA_RECV;
+        sdk_error_handler();
+        break;
+    }
+
+    return FALSE;
+}
+
+
+/**
+ * \fn      hci_uart_rx_begin
+ * \brief   Get the buffer of the packet whose header was just received, or
+ *          hold RTS if none is available; interrupts disabled
+ * \param   void
+ * \return  UCHAR       TRUE when the packet has no payload and is ready
+ */
+static UCHAR hci_uart_rx_begin(void)
+{
+    if (MAX_DATA_RX_PACKETS > hci_uart_rx_count) {
+        hci_uart_rx_packet = OS_allocate_size(data_rx_queue.length);
+    }
+    if (NULL == hci_uart_rx_packet) {
+        UART_DISABLE_BT_UART_RTS();
+        hci_uart_rx_rts_hold = TRUE;
+        return FALSE;
+    }
+
+    memcpy(hci_uart_rx_packet, temp_header_buffer, packet_header_len);
+    if (0 == bytes_expected) {
+        return hci_uart_rx_complete();
+    }
+    return FALSE;
+}
+
+/**
+ * \fn      hci_uart_rx_complete
+ * \brief   Queue the packet just received for the read task and wait for
+ *          the next one; interrupts disabled
+ * \param   void
+ * \return  UCHAR       TRUE
+ */
+static UCHAR hci_uart_rx_complete(void)
+{
+    UCHAR index;
+
+    index = hci_uart_rx_rd + hci_uart_rx_count;
+    if (MAX_DATA_RX_PACKETS <= index) {
+        index -= MAX_DATA_RX_PACKETS;
+    }
+    hci_uart_rx_queue[index].buffer = hci_uart_rx_packet;
+    hci_uart_rx_queue[index].length = data_rx_queue.length;
+    hci_uart_rx_count++;
+    hci_uart_rx_packet = NULL;
+    hci_uart_rx_resync();
+
+    return TRUE;
+}
+
+/**
+ * \fn      hci_uart_rx_drop
+ * \brief   Drop the packet held off by RTS once the spill area is full, and
+ *          go on with the bytes received meanwhile; interrupts disabled
+ * \param   octet       Byte that did not fit in the spill area
+ * \return  UCHAR       TRUE when a packet is ready for the read task
+ */
+static UCHAR hci_uart_rx_drop(UCHAR octet)
+{
+    UCHAR spill[UART_RX_SPILL_SIZE];
+    UCHAR spill_len, index;
+    UCHAR ready = FALSE;
+
+    hci_uart_rx_spill_overflows++;
+    hci_uart_rx_rts_hold = FALSE;
+    /* The rest of the payload is counted up to the next packet boundary */
+    if (0 == bytes_expected) {
+        hci_uart_rx_resync();
+    }
+
+    /* A replayed byte may start a packet held off again: it spills anew */
+    spill_len = hci_uart_rx_spill_len;
+    memcpy(spill, hci_uart_rx_spill, spill_len);
+    hci_uart_rx_spill_len = 0;
+    for (index = 0; index < spill_len; index++) {
+        if (TRUE == hci_uart_rx_byte(spill[index])) {
+            ready = TRUE;
+        }
+    }
+    if (TRUE == hci_uart_rx_byte(octet)) {
+        ready = TRUE;
+    }
+
+    return ready;
+}
+
+/**
+ * \fn      hci_uart_rx_resync
+ * \brief   Wait for the first byte of the next packet; interrupts disabled
+ * \param   void
+ * \return  void
+ */
+static void hci_uart_rx_resync(void)
+{
+    expected_uart_data_type = BT_HEADER_FIRST_BYTE;
+    current_pkt_len = 0;
+    temp_header_buffer_idx = 0;
+    bytes_expected = 1;
+}
+
+/**
+ * \fn      hci_uart_rx_dequeue
+ * \brief   Take the oldest received packet
+ * \param   packet      Filled with the packet
+ * \return  UCHAR       TRUE if a packet was taken, FALSE if none is queued
+ */
+static UCHAR hci_uart_rx_dequeue(HCI_UART_RX_PACKET * packet)
+{
+    unsigned short state;
+    UCHAR taken = FALSE;
+
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    if (0 != hci_uart_rx_count) {
+        *packet = hci_uart_rx_queue[hci_uart_rx_rd];
+        hci_uart_rx_rd++;
+        if (MAX_DATA_RX_PACKETS == hci_uart_rx_rd) {
+            hci_uart_rx_rd = 0;
+        }
+        hci_uart_rx_count--;
+        taken = TRUE;
+    }
+    __set_interrupt_state(state);
+
+    return taken;
+}
+
+/**
+ * \fn      hci_uart_rx_resume
+ * \brief   Retry the buffer allocation of a packet held off by RTS, and
+ *          replay the bytes received meanwhile as the ISR would have
+ *          handled them
+ * \param   void
+ * \return  UCHAR       TRUE if the packet got its buffer; the read task
+ *                      then dequeues the packets completed by the replay
+ */
+static UCHAR hci_uart_rx_resume(void)
+{
+    UCHAR spill[UART_RX_SPILL_SIZE];
+    UCHAR spill_len, index;
+    unsigned short state;
+
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    if (TRUE != hci_uart_rx_rts_hold) {
+        __set_interrupt_state(state);
+        return FALSE;
+    }
+
+    hci_uart_rx_rts_hold = FALSE;
+    (void)hci_uart_rx_begin();
+    if (TRUE == hci_uart_rx_rts_hold) {
+        __set_interrupt_state(state);
+        return FALSE;
+    }
+
+    /* A replayed byte may start a packet held off again: it spills anew */
+    spill_len = hci_uart_rx_spill_len;
+    memcpy(spill, hci_uart_rx_spill, spill_len);
+    hci_uart_rx_spill_len = 0;
+    for (index = 0; index < spill_len; index++) {
+        (void)hci_uart_rx_byte(spill[index]);
+    }
+    __set_interrupt_state(state);
+
+    /* RTS is asserted again by the idle hook */
+    return TRUE;
+}
+
+/**
+ * \fn      hci_uart_rx_reset
+ * \brief   Free the packets received and not processed, and wait for the
+ *          first byte of a packet
+ * \param   void
+ * \return  void
+ */
+static void hci_uart_rx_reset(void)
+{
+    HCI_UART_RX_PACKET packet;
+    unsigned short state;
+
+    while (TRUE == hci_uart_rx_dequeue(&packet)) {
+        BT_free_mem(packet.buffer);
+    }
+
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    if (NULL != hci_uart_rx_packet) {
+        BT_free_mem(hci_uart_rx_packet);
+        hci_uart_rx_packet = NULL;
+    }
+    hci_uart_rx_rts_hold = FALSE;
+    hci_uart_rx_spill_len = 0;
+    hci_uart_rx_resync();
+    __set_interrupt_state(state);
+}
+
+/**
+ * \fn      hci_uart_rx_get_spill_overflows
+ * \brief   Number of packets dropped because the controller sent more bytes
+ *          than the spill area holds after RTS was held
+ * \param   void
+ * \return  UINT16      Dropped packet count
+ */
+UINT16 hci_uart_rx_get_spill_overflows(void)
+{
+    return hci_uart_rx_spill_overflows;
+}
@@ -0,0 +1,358 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    bt_timer_test.cpp
+ * \brief   Host test of the timer wheel (BT_timer.c) on a fake ACLK clock.
+ *
+ *          Build:  make -C tools bt_timer_test
+ *          Usage:  bt_timer_test [seed]
+ *
+ *          Random start, restart and stop of intrusive timers and Timer
+ *          Entities, from the test and from the callbacks, with the clock
+ *          starting just before the 32-bit wrap. The timer task is played
+ *          by the test: it runs BT_timer_service() when a timer start gives
+ *          its semaphore, or when the wait returned last time is over.
+ *          Checked:
+ *            - no timer expires early, none is left expired after a service;
+ *            - the service wakes up at most one OS tick after the earliest
+ *              expiry;
+ *            - stopped timers never expire, the others expire once;
+ *            - the Timer Entity arguments come back intact;
+ *            - starting a timer before the planned wake up gives the
+ *              semaphore;
+ *            - every call leaves the interrupts enabled.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" {
+#include "BT_common.h"
+}
+
+UINT32 host_timestamp;
+unsigned short host_interrupt_state = 1;
+unsigned int host_semaphore_gives;
+
+namespace {
+
+const int ENTRY_COUNT = 12;
+const UINT32 ACLK_PER_TICK = portTIMESTAMP_HZ / configTICK_RATE_HZ;
+
+struct Tracked {
+    bool active;
+    UINT32 started;
+    /* Timeout in ACLK counts, exact (may be fractional: ms * 32768 / 1000) */
+    unsigned long long timeout_ms_x32768;
+    UINT32 deadline;
+};
+
+BT_TIMER_ENTRY entries[ENTRY_COUNT];
+Tracked entry_state[ENTRY_COUNT];
+
+BT_timer_handle entity_handle[TIMER_MAX_ENTITIES];
+Tracked entity_state[TIMER_MAX_ENTITIES];
+
+unsigned long failures;
+unsigned long expiries;
+
+void fail(const char *what, long detail)
+{
+    if (failures < 20) {
+        std::fprintf(stderr, "FAIL at %08lx: %s (%ld)\n",
+                     (unsigned long)host_timestamp, what, detail);
+    }
+    failures++;
+}
+
+void check_interrupts(const char *where)
+{
+    if (host_interrupt_state != 1) {
+        fail(where, host_interrupt_state);
+        host_interrupt_state = 1;
+    }
+}
+
+UINT32 ms_to_aclk(UINT16 ms)
+{
+    return (UINT32)((((UINT32)ms << 15) + 999) / 1000);
+}
+
+void track_start(Tracked *t, UINT16 ms)
+{
+    t->active = true;
+    t->started = host_timestamp;
+    t->timeout_ms_x32768 = (unsigned long long)ms * 32768ULL;
+    t->deadline = host_timestamp + ms_to_aclk(ms);
+}
+
+void track_expired(Tracked *t, const char *kind, int index)
+{
+    UINT32 elapsed = host_timestamp - t->started;
+
+    if (!t->active) {
+        fail(kind, index);
+        return;
+    }
+    if ((unsigned long long)elapsed * 1000ULL < t->timeout_ms_x32768) {
+        fail("early expiry", (long)(t->deadline - host_timestamp));
+    }
+    t->active = false;
+    expiries++;
+}
+
+void entry_expired(void *context)
+{
+    int index = (int)((BT_TIMER_ENTRY *)context - entries);
+
+    check_interrupts("interrupts masked in callback");
+    track_expired(&entry_state[index], "stopped entry expired", index);
+
+    /* Periodic use: restart from the callback (a zero timeout would only
+     * run at the next service) */
+    if (0 == (std::rand() % 4)) {
+        UINT16 ms = (UINT16)(1 + std::rand() % 300);
+        BT_timer_entry_start(&entries[index], ms);
+        track_start(&entry_state[index], ms);
+    }
+}
+
+void entity_expired(void *args, UINT16 length)
+{
+    UCHAR *data = (UCHAR *)args;
+    int index = data[0];
+    UINT16 i;
+
+    check_interrupts("interrupts masked in entity callback");
+    if ((length != BT_TIMER_STATIC_DATA_SIZE) || (index >= TIMER_MAX_ENTITIES)) {
+        fail("entity arguments length", length);
+        return;
+    }
+    for (i = 1; i < length; i++) {
+        if (data[i] != (UCHAR)(index * 31 + i)) {
+            fail("entity arguments corrupted", i);
+            break;
+        }
+    }
+    entity_handle[index] = BT_TIMER_HANDLE_INIT_VAL;
+    track_expired(&entity_state[index], "stopped entity expired", index);
+}
+
+/* Earliest deadline of the running timers, false if none */
+bool earliest_deadline(UINT32 *earliest)
+{
+    bool found = false;
+    int index;
+
+    for (index = 0; index < ENTRY_COUNT; index++) {
+        if (entry_state[index].active &&
+            (!found || (INT32)(entry_state[index].deadline - *earliest) < 0)) {
+            *earliest = entry_state[index].deadline;
+            found = true;
+        }
+    }
+    for (index = 0; index < TIMER_MAX_ENTITIES; index++) {
+        if (entity_state[index].active &&
+            (!found || (INT32)(entity_state[index].deadline - *earliest) < 0)) {
+            *earliest = entity_state[index].deadline;
+            found = true;
+        }
+    }
+    return found;
+}
+
+/* One run of the timer task; returns the time it blocks until */
+UINT32 run_service(bool *blocked_forever)
+{
+    UINT16 wait;
+    UINT32 earliest = 0;
+    int index;
+
+    wait = BT_timer_service();
+    check_interrupts("interrupts masked after service");
+
+    for (index = 0; index < ENTRY_COUNT; index++) {
+        if (entry_state[index].active &&
+            ((INT32)(host_timestamp - entry_state[index].deadline) >= 0)) {
+            fail("entry left expired", index);
+        }
+    }
+    for (index = 0; index < TIMER_MAX_ENTITIES; index++) {
+        if (entity_state[index].active &&
+            ((INT32)(host_timestamp - entity_state[index].deadline) >= 0)) {
+            fail("entity left expired", index);
+        }
+    }
+
+    *blocked_forever = (BT_TIMER_NO_EXPIRY == wait);
+    if (!earliest_deadline(&earliest)) {
+        if (!*blocked_forever) {
+            fail("wait with no timer", wait);
+        }
+        return host_timestamp;
+    }
+    if (*blocked_forever) {
+        fail("no wait with a timer running", 0);
+        return host_timestamp;
+    }
+    if ((INT32)(host_timestamp + (UINT32)wait * ACLK_PER_TICK - earliest) < 0) {
+        fail("wake up before the earliest expiry", wait);
+    }
+    if ((INT32)(host_timestamp + (UINT32)wait * ACLK_PER_TICK - earliest) >=
+        (INT32)ACLK_PER_TICK) {
+        fail("wake up late", wait);
+    }
+    return host_timestamp + (UINT32)wait * ACLK_PER_TICK;
+}
+
+void random_operation(UINT32 wake_at, bool blocked_forever)
+{
+    unsigned int gives = host_semaphore_gives;
+    UINT32 deadline = 0;
+    bool started = false;
+    int index;
+
+    switch (std::rand() % 6) {
+    case 0:
+    case 1: {
+        /* Start or restart an intrusive timer, short ones mostly */
+        UINT16 ms = (UINT16)((0 == (std::rand() % 8)) ?
+                             (std::rand() % 6000) : (std::rand() % 200));
+        index = std::rand() % ENTRY_COUNT;
+        BT_timer_entry_start(&entries[index], ms);
+        track_start(&entry_state[index], ms);
+        deadline = entry_state[index].deadline;
+        started = true;
+        break;
+    }
+    case 2:
+        index = std::rand() % ENTRY_COUNT;
+        BT_timer_entry_stop(&entries[index]);
+        entry_state[index].active = false;
+        if (BT_timer_entry_is_active(&entries[index])) {
+            fail("stopped entry still active", index);
+        }
+        break;
+    case 3: {
+        /* Start a Timer Entity with full size arguments */
+        UCHAR args[BT_TIMER_STATIC_DATA_SIZE];
+        UINT16 ms = (UINT16)(std::rand() % 1000);
+        UINT16 i;
+
+        index = std::rand() % TIMER_MAX_ENTITIES;
+        if (BT_TIMER_HANDLE_INIT_VAL != entity_handle[index]) {
+            break;
+        }
+        args[0] = (UCHAR)index;
+        for (i = 1; i < sizeof(args); i++) {
+            args[i] = (UCHAR)(index * 31 + i);
+        }
+        if (API_SUCCESS != BT_start_timer_ms(&entity_handle[index], ms,
+                                             entity_expired, args,
+                                             sizeof(args))) {
+            fail("entity start", index);
+            break;
+        }
+        track_start(&entity_state[index], ms);
+        deadline = entity_state[index].deadline;
+        started = true;
+        break;
+    }
+    case 4:
+        index = std::rand() % TIMER_MAX_ENTITIES;
+        if (BT_TIMER_HANDLE_INIT_VAL == entity_handle[index]) {
+            break;
+        }
+        if (API_SUCCESS != BT_stop_timer(entity_handle[index])) {
+            fail("entity stop", index);
+        }
+        entity_handle[index] = BT_TIMER_HANDLE_INIT_VAL;
+        entity_state[index].active = false;
+        break;
+    default: {
+        UINT16 ms = (UINT16)(std::rand() % 500);
+
+        index = std::rand() % TIMER_MAX_ENTITIES;
+        if (BT_TIMER_HANDLE_INIT_VAL == entity_handle[index]) {
+            break;
+        }
+        if (API_SUCCESS != BT_restart_timer_ms(entity_handle[index], ms)) {
+            fail("entity restart", index);
+        }
+        track_start(&entity_state[index], ms);
+        deadline = entity_state[index].deadline;
+        started = true;
+        break;
+    }
+    }
+    check_interrupts("interrupts masked after operation");
+
+    /* The wait is rounded up to a tick: a timer due in that tick needs no
+     * wake up */
+    if (started &&
+        (blocked_forever ||
+         (INT32)(deadline - (wake_at - ACLK_PER_TICK + 1)) < 0) &&
+        (gives == host_semaphore_gives)) {
+        fail("earlier timer started without a wake up",
+             (long)(wake_at - deadline));
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    UCHAR big[BT_TIMER_STATIC_DATA_SIZE + 1] = { 0 };
+    BT_timer_handle handle = BT_TIMER_HANDLE_INIT_VAL;
+    UINT32 wake_at;
+    bool blocked_forever;
+    unsigned int gives;
+    long step;
+    int index;
+
+    std::srand((argc > 1) ? (unsigned int)std::atoi(argv[1]) : 1);
+
+    /* Cross the 32-bit wrap (and the 25-bit slot count wrap) early on */
+    host_timestamp = 0xFFFFFFFFUL - 40000UL;
+    timer_init();
+    for (index = 0; index < ENTRY_COUNT; index++) {
+        BT_timer_entry_init(&entries[index], entry_expired, &entries[index]);
+    }
+
+    if (API_SUCCESS == BT_start_timer_ms(&handle, 10, entity_expired, big,
+                                         sizeof(big))) {
+        fail("oversized arguments accepted", sizeof(big));
+    }
+
+    gives = host_semaphore_gives;
+    wake_at = run_service(&blocked_forever);
+    for (step = 0; step < 2000000L; step++) {
+        if (0 == (std::rand() % 3)) {
+            gives = host_semaphore_gives;
+            random_operation(wake_at, blocked_forever);
+        }
+
+        if (gives != host_semaphore_gives) {
+            /* Woken up by a timer start */
+            gives = host_semaphore_gives;
+        } else {
+            /* Blocked until the wait is over, or until the next operation */
+            UINT32 advance = (UINT32)(1 + std::rand() % 400);
+
+            if (!blocked_forever &&
+                ((INT32)(wake_at - host_timestamp) < (INT32)advance)) {
+                advance = wake_at - host_timestamp;
+            }
+            host_timestamp += advance;
+            if (blocked_forever || (INT32)(wake_at - host_timestamp) > 0) {
+                continue;
+            }
+        }
+        wake_at = run_service(&blocked_forever);
+    }
+
+    std::printf("bt_timer_test: %ld steps, %lu expiries, clock at %08lx, "
+                "%lu failures\n", step, expiries,
+                (unsigned long)host_timestamp, failures);
+    return (0 == failures) ? 0 : 1;
+}
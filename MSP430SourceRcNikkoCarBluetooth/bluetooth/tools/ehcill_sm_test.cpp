@@ -0,0 +1,420 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    ehcill_sm_test.cpp
+ * \brief   Host test of the eHCILL sleep/wake state machine (ehcill_sm.c).
+ *
+ *          Build:  make -C tools ehcill_sm_test
+ *          Usage:  ehcill_sm_test [seed]
+ *
+ *          The host side replays the platform glue around the state
+ *          machine: the TX interrupt of msp430_uart.c, the RX handler, the
+ *          CTS interrupt and the actions of appl_bt_rf.c. The controller
+ *          side is a model of the eHCILL controller. Both exchange bytes
+ *          over two in-order wires, and the steps are interleaved at
+ *          random: HCI packets queued on either side, sleep requests and
+ *          wake ups from the controller, and byte deliveries.
+ *          The clock starts just before the 32-bit wrap.
+ *          Checked:
+ *            - every HCI byte arrives, in order, on a side that is awake
+ *              with its UART enabled;
+ *            - no invalid event and no collision is reported;
+ *            - the transition trace holds the time of each transition;
+ *            - the statistics (sleep time, wake latencies, counts) match
+ *              the ones measured by the test;
+ *            - the link drains at the end: nothing left stuck in a queue.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "ehcill_sm.h"
+
+namespace {
+
+/* Wire token for the controller CTS pulse, kept in order with the bytes */
+const int CTS_PULSE = 0x100;
+
+/* HCI data bytes never take the eHCILL values */
+const UCHAR DATA_MIN = 0x40;
+
+enum ControllerState {
+    CTRL_AWAKE,
+    CTRL_SLEEP_IND_SENT,
+    CTRL_ASLEEP,
+    CTRL_WAKE_IND_SENT
+};
+
+UINT32 now;
+unsigned long failures;
+
+/* Host side */
+std::deque<std::vector<UCHAR> > host_tx_packets;
+size_t host_tx_offset;
+bool host_packet_complete = true;
+bool host_tx_pending;
+bool host_uart_enabled = true;
+bool host_cts_armed;
+std::deque<UCHAR> host_sent_data;
+std::deque<UCHAR> host_received_data;
+
+/* Controller side */
+ControllerState ctrl_state = CTRL_AWAKE;
+std::deque<UCHAR> ctrl_sent_data;
+std::deque<UCHAR> ctrl_received_data;
+
+/* Wires */
+std::deque<int> host_to_ctrl;
+std::deque<int> ctrl_to_host;
+
+/* Expected statistics */
+UINT32 asleep_since;
+UINT32 wake_since;
+UINT32 asleep_time;
+UINT32 max_host_wake;
+UINT32 max_ctrl_wake;
+UINT16 sleep_count;
+UINT16 host_wake_count;
+UINT16 ctrl_wake_count;
+unsigned long transitions;
+/* Both sides sent WAKE_IND */
+unsigned long wake_collisions;
+
+void fail(const char *what, long detail)
+{
+    if (failures < 20) {
+        std::fprintf(stderr, "FAIL at %08lx (state %u): %s (%ld)\n",
+                     (unsigned long)now, ehcill_sm_get_state(), what, detail);
+    }
+    failures++;
+}
+
+/* Run an event and check the transition it makes */
+UINT16 sm_event(UCHAR event)
+{
+    UCHAR from = ehcill_sm_get_state();
+    UINT16 actions = ehcill_sm_handle_event(event, now);
+    UCHAR to = ehcill_sm_get_state();
+
+    if (actions & (EHCILL_ACT_ERROR | EHCILL_ACT_COLLISION)) {
+        fail("error or collision action", event);
+    }
+    if (from == to) {
+        return actions;
+    }
+
+    transitions++;
+    const EHCILL_SM_TRACE_ENTRY *trace = ehcill_sm_get_trace(0);
+    if ((NULL == trace) || (trace->timestamp != now) ||
+        (trace->from_state != from) || (trace->event != event) ||
+        (trace->to_state != to)) {
+        fail("trace entry", event);
+    }
+    if (ehcill_sm_get_stats()->state_entry_time != now) {
+        fail("state entry time", (long)ehcill_sm_get_stats()->state_entry_time);
+    }
+
+    if (EHCILL_STATE_ASLEEP == to) {
+        sleep_count++;
+        asleep_since = now;
+    }
+    if (EHCILL_STATE_ASLEEP == from) {
+        asleep_time += now - asleep_since;
+        wake_since = now;
+    }
+    if (EHCILL_STATE_AWAKE == to) {
+        if (EHCILL_STATE_WAKE_IND_SENT == from) {
+            if (EHCILL_EV_RX_WAKE_IND == event) {
+                wake_collisions++;
+            }
+            host_wake_count++;
+            if (now - wake_since > max_host_wake) {
+                max_host_wake = now - wake_since;
+            }
+        } else if (EHCILL_STATE_WAKE_ACK_PENDING == from) {
+            ctrl_wake_count++;
+            if (now - wake_since > max_ctrl_wake) {
+                max_ctrl_wake = now - wake_since;
+            }
+        }
+    }
+    return actions;
+}
+
+void host_transmit(int byte)
+{
+    host_to_ctrl.push_back(byte);
+    host_tx_pending = true;
+}
+
+/* ehcill_perform_actions() */
+void host_perform(UINT16 actions)
+{
+    if (actions & EHCILL_ACT_ENABLE_UART) {
+        host_uart_enabled = true;
+    }
+    if (actions & EHCILL_ACT_ENABLE_CTS_INT) {
+        host_cts_armed = true;
+    }
+    if (actions & EHCILL_ACT_DISABLE_CTS_INT) {
+        host_cts_armed = false;
+    }
+    if (actions & EHCILL_ACT_SEND_SLEEP_ACK) {
+        host_transmit(SDK_BT_RF_SLEEP_ACK);
+    }
+    if (actions & EHCILL_ACT_DISABLE_UART) {
+        host_uart_enabled = false;
+    }
+    if (actions & EHCILL_ACT_SEND_WAKE_IND) {
+        host_transmit(SDK_BT_RF_WAKE_UP_IND);
+    }
+    if (actions & EHCILL_ACT_SEND_WAKE_ACK) {
+        host_transmit(SDK_BT_RF_WAKE_UP_ACK);
+    }
+    if (actions & EHCILL_ACT_KICK_TX) {
+        host_tx_pending = true;
+    }
+
+    /* Queued data must not wait for the next packet to be sent */
+    if ((EHCILL_STATE_AWAKE == ehcill_sm_get_state()) &&
+        !host_tx_packets.empty() && !host_tx_pending) {
+        fail("host data stalled after a wake up", (long)actions);
+    }
+}
+
+/* TX interrupt of msp430_uart.c */
+void host_tx_isr(void)
+{
+    host_tx_pending = false;
+
+    if (host_tx_packets.empty()) {
+        if (host_packet_complete && EHCILL_SM_IS_HANDSHAKE_PENDING()) {
+            host_perform(sm_event(EHCILL_EV_TX_IDLE));
+        }
+        return;
+    }
+    if (EHCILL_SM_IS_HOST_ASLEEP()) {
+        host_perform(sm_event(EHCILL_EV_TX_DATA));
+        return;
+    }
+
+    std::vector<UCHAR> &packet = host_tx_packets.front();
+    UCHAR byte = packet[host_tx_offset++];
+    host_packet_complete = (host_tx_offset == packet.size());
+    if (host_packet_complete) {
+        host_tx_packets.pop_front();
+        host_tx_offset = 0;
+    }
+    host_transmit(byte);
+}
+
+/* Byte or CTS pulse from the controller */
+void host_receive(int token)
+{
+    if (CTS_PULSE == token) {
+        if (host_cts_armed) {
+            host_perform(sm_event(EHCILL_EV_CTS_EDGE));
+        }
+        return;
+    }
+    if (!host_uart_enabled) {
+        fail("byte lost by the host, UART disabled", token);
+        return;
+    }
+    if ((token >= SDK_BT_RF_SLEEP_IND) && (token <= SDK_BT_RF_WAKE_UP_ACK)) {
+        host_perform(sm_event((UCHAR)(EHCILL_EV_RX_SLEEP_IND +
+                                      (token - SDK_BT_RF_SLEEP_IND))));
+        return;
+    }
+    if (EHCILL_STATE_AWAKE != ehcill_sm_get_state()) {
+        host_perform(sm_event(EHCILL_EV_RX_PACKET));
+    }
+    host_received_data.push_back((UCHAR)token);
+}
+
+/* eHCILL controller */
+void ctrl_receive(int byte)
+{
+    switch (byte) {
+    case SDK_BT_RF_SLEEP_ACK:
+        if (CTRL_SLEEP_IND_SENT != ctrl_state) {
+            fail("unexpected SLEEP_ACK", ctrl_state);
+        }
+        ctrl_state = CTRL_ASLEEP;
+        return;
+    case SDK_BT_RF_WAKE_UP_IND:
+        if (CTRL_ASLEEP == ctrl_state) {
+            /* Wake up: the CTS change comes before the acknowledge */
+            ctrl_to_host.push_back(CTS_PULSE);
+            ctrl_to_host.push_back(SDK_BT_RF_WAKE_UP_ACK);
+            ctrl_state = CTRL_AWAKE;
+        } else if (CTRL_WAKE_IND_SENT == ctrl_state) {
+            /* Both sides woke up */
+            ctrl_state = CTRL_AWAKE;
+        } else {
+            fail("unexpected WAKE_IND", ctrl_state);
+        }
+        return;
+    case SDK_BT_RF_WAKE_UP_ACK:
+        if (CTRL_WAKE_IND_SENT != ctrl_state) {
+            fail("unexpected WAKE_ACK", ctrl_state);
+        }
+        ctrl_state = CTRL_AWAKE;
+        return;
+    default:
+        break;
+    }
+
+    if ((CTRL_ASLEEP == ctrl_state) || (CTRL_WAKE_IND_SENT == ctrl_state)) {
+        fail("byte lost by the controller, asleep", byte);
+        return;
+    }
+    ctrl_received_data.push_back((UCHAR)byte);
+}
+
+std::vector<UCHAR> random_packet(std::deque<UCHAR> *sent)
+{
+    std::vector<UCHAR> packet(1 + std::rand() % 8);
+
+    for (size_t i = 0; i < packet.size(); i++) {
+        packet[i] = (UCHAR)(DATA_MIN + std::rand() % 0xB0);
+        sent->push_back(packet[i]);
+    }
+    return packet;
+}
+
+/* One random step; returns false if it had nothing to do */
+bool random_step(bool traffic)
+{
+    switch (std::rand() % 8) {
+    case 0:
+        /* Host application queues a packet now and then; the write task
+         * kicks TX */
+        if (!traffic || (host_tx_packets.size() > 4) ||
+            (0 != (std::rand() % 64))) {
+            return false;
+        }
+        host_tx_packets.push_back(random_packet(&host_sent_data));
+        host_tx_pending = true;
+        return true;
+    case 1:
+        if (!host_tx_pending) {
+            return false;
+        }
+        host_tx_isr();
+        return true;
+    case 2:
+    case 3:
+        if (host_to_ctrl.empty()) {
+            return false;
+        }
+        ctrl_receive(host_to_ctrl.front());
+        host_to_ctrl.pop_front();
+        return true;
+    case 4:
+    case 5:
+        if (ctrl_to_host.empty()) {
+            return false;
+        }
+        host_receive(ctrl_to_host.front());
+        ctrl_to_host.pop_front();
+        return true;
+    case 6:
+        /* Controller data now and then, or a sleep request */
+        if (!traffic || (CTRL_AWAKE != ctrl_state) ||
+            (0 != (std::rand() % 16))) {
+            return false;
+        }
+        if (0 == (std::rand() % 2)) {
+            ctrl_to_host.push_back(SDK_BT_RF_SLEEP_IND);
+            ctrl_state = CTRL_SLEEP_IND_SENT;
+        } else {
+            std::vector<UCHAR> packet = random_packet(&ctrl_sent_data);
+            ctrl_to_host.insert(ctrl_to_host.end(), packet.begin(),
+                                packet.end());
+        }
+        return true;
+    default:
+        /* Controller initiated wake */
+        if (!traffic || (CTRL_ASLEEP != ctrl_state) ||
+            (0 != (std::rand() % 32))) {
+            return false;
+        }
+        ctrl_to_host.push_back(CTS_PULSE);
+        ctrl_to_host.push_back(SDK_BT_RF_WAKE_UP_IND);
+        ctrl_state = CTRL_WAKE_IND_SENT;
+        return true;
+    }
+}
+
+void check_data(const char *what, const std::deque<UCHAR> &sent,
+                const std::deque<UCHAR> &received)
+{
+    if (sent.size() != received.size()) {
+        fail(what, (long)sent.size() - (long)received.size());
+        return;
+    }
+    for (size_t i = 0; i < sent.size(); i++) {
+        if (sent[i] != received[i]) {
+            fail(what, (long)i);
+            return;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const EHCILL_SM_STATS *stats;
+    long step;
+    int idle;
+
+    std::srand((argc > 1) ? (unsigned int)std::atoi(argv[1]) : 1);
+
+    now = 0xFFFFFFFFUL - 100000UL;
+    ehcill_sm_init(now);
+
+    for (step = 0; step < 1000000L; step++) {
+        now += (UINT32)(1 + std::rand() % 64);
+        (void)random_step(true);
+    }
+
+    /* Drain: only deliveries and the TX interrupt from here */
+    for (idle = 0; idle < 1000; ) {
+        now += (UINT32)(1 + std::rand() % 64);
+        idle = random_step(false) ? 0 : idle + 1;
+    }
+    if (!host_tx_packets.empty() || host_tx_pending ||
+        !host_to_ctrl.empty() || !ctrl_to_host.empty() ||
+        EHCILL_SM_IS_HANDSHAKE_PENDING()) {
+        fail("link stuck", (long)host_tx_packets.size());
+    }
+
+    check_data("host to controller data", host_sent_data, ctrl_received_data);
+    check_data("controller to host data", ctrl_sent_data, host_received_data);
+
+    stats = ehcill_sm_get_stats();
+    if ((stats->asleep_time != asleep_time) ||
+        (stats->max_host_wake_time != max_host_wake) ||
+        (stats->max_ctrl_wake_time != max_ctrl_wake)) {
+        fail("sleep and wake times", (long)(stats->asleep_time - asleep_time));
+    }
+    if ((stats->sleep_count != sleep_count) ||
+        (stats->host_wake_count != host_wake_count) ||
+        (stats->ctrl_wake_count != ctrl_wake_count)) {
+        fail("sleep and wake counts", (long)stats->sleep_count - sleep_count);
+    }
+    if ((0 != stats->rx_while_asleep) || (0 != stats->error_count)) {
+        fail("packets while asleep or errors", stats->error_count);
+    }
+
+    std::printf("ehcill_sm_test: %ld steps, %lu transitions, %u sleeps, "
+                "%u host wakes, %u controller wakes, %lu collisions, "
+                "%lu bytes, %lu failures\n", step, transitions, sleep_count,
+                host_wake_count, ctrl_wake_count, wake_collisions,
+                (unsigned long)(host_sent_data.size() + ctrl_sent_data.size()),
+                failures);
+    return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,37 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    BT_common.h
+ * \brief   Host (Linux) replacement of BT_common.h for the tools tests: the
+ *          types and helpers the platform sources use, without the stack
+ *          and MSP430 headers.
+ */
+
+#ifndef _H_BT_COMMON_
+#define _H_BT_COMMON_
+
+#include <stdint.h>
+#include <string.h>
+
+typedef char CHAR;
+typedef uint8_t UCHAR;
+typedef uint8_t UINT8;
+typedef int16_t INT16;
+typedef uint16_t UINT16;
+typedef int32_t INT32;
+typedef uint32_t UINT32;
+
+typedef UINT16 API_RESULT;
+
+#define FALSE                   0
+#define TRUE                    1
+
+#define API_SUCCESS             0x0000
+#define API_FAILURE             0xFFFF
+
+#define BT_mem_copy(d, s, n)    memcpy((d), (s), (n))
+
+#include "BT_limits.h"
+#include "host_rtos.h"
+#include "BT_timer.h"
+
+#endif /* _H_BT_COMMON_ */
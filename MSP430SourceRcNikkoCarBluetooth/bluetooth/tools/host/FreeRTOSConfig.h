@@ -0,0 +1,12 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    FreeRTOSConfig.h
+ * \brief   Host (Linux) replacement of FreeRTOSConfig.h for the tools tests.
+ */
+
+#ifndef _H_HOST_FREERTOSCONFIG_
+#define _H_HOST_FREERTOSCONFIG_
+
+#include "BT_common.h"
+
+#endif /* _H_HOST_FREERTOSCONFIG_ */
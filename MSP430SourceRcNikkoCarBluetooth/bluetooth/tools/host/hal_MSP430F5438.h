@@ -0,0 +1,13 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    hal_MSP430F5438.h
+ * \brief   Host (Linux) replacement of hal_MSP430F5438.h for the tools
+ *          tests: no registers, the tests simulate the peripherals they use.
+ */
+
+#ifndef _H_HOST_HAL_MSP430F5438_
+#define _H_HOST_HAL_MSP430F5438_
+
+#include "BT_common.h"
+
+#endif /* _H_HOST_HAL_MSP430F5438_ */
@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    host_rtos.h
+ * \brief   Host (Linux) fakes of the FreeRTOS, port and intrinsic calls used
+ *          by the platform sources under test. The test owns the clock and
+ *          the interrupt state; tasks are not run, the test calls their
+ *          bodies itself.
+ */
+
+#ifndef _H_HOST_RTOS_
+#define _H_HOST_RTOS_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ACLK timestamp, set by the test */
+extern UINT32 host_timestamp;
+/* Interrupt enable, checked by the test */
+extern unsigned short host_interrupt_state;
+/* Semaphore gives */
+extern unsigned int host_semaphore_gives;
+
+typedef unsigned short portTickType;
+typedef void *xSemaphoreHandle;
+typedef void *xTaskHandle;
+typedef void (* pdTASK_CODE) (void *);
+
+#define pdPASS                          1
+#define pdFAIL                          0
+#define portCHAR                        char
+#define portBASE_TYPE                   int
+
+#define configTICK_RATE_HZ              1024
+#define portTIMESTAMP_HZ                32768UL
+#define portGET_TIMESTAMP()             (host_timestamp)
+
+#define __get_interrupt_state()         (host_interrupt_state)
+#define __disable_interrupt()           (host_interrupt_state = 0)
+#define __set_interrupt_state(s)        (host_interrupt_state = (s))
+
+#define vSemaphoreCreateBinary(s)       \
+    ((s) = (xSemaphoreHandle) &host_semaphore_gives)
+#define xSemaphoreGive(s)               ((void)(s), host_semaphore_gives++, pdPASS)
+#define xSemaphoreTake(s, t)            ((void)(s), (void)(t), pdPASS)
+
+#define xTaskCreate(code, name, stack, params, prio, handle) \
+    ((void)(code), (void)(name), (void)(stack), (void)(params), \
+     (void)(prio), (void)(handle), pdPASS)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _H_HOST_RTOS_ */
@@ -0,0 +1,12 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    portmacro.h
+ * \brief   Host (Linux) replacement of portmacro.h for the tools tests.
+ */
+
+#ifndef _H_HOST_PORTMACRO_
+#define _H_HOST_PORTMACRO_
+
+#include "BT_common.h"
+
+#endif /* _H_HOST_PORTMACRO_ */
@@ -0,0 +1,15 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    sdk_pl.h
+ * \brief   Host (Linux) replacement of sdk_pl.h for the tools tests.
+ */
+
+#ifndef _H_SDK_PL_
+#define _H_SDK_PL_
+
+#include "BT_common.h"
+
+#define sdk_display(...)
+#define UART_DISABLE_BT_UART_RTS()
+
+#endif /* _H_SDK_PL_ */
@@ -0,0 +1,31 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    sm_storage_host.h
+ * \brief   Host (Linux) flash of sm_storage_pl.c, forced in with -include:
+ *          the log lives in a simulated flash owned by the test.
+ */
+
+#ifndef _H_SM_STORAGE_HOST_
+#define _H_SM_STORAGE_HOST_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Information memory segments D, C and B */
+extern uint8_t host_flash[3 * 128];
+
+void host_flash_program(volatile uint16_t * address, uint16_t word);
+void host_flash_erase(volatile uint16_t * address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define SM_PS_FLASH_START                   ((uintptr_t) host_flash)
+#define SM_PS_FLASH_PROGRAM(address, word)  host_flash_program((address), (word))
+#define SM_PS_FLASH_ERASE(address)          host_flash_erase(address)
+
+#endif /* _H_SM_STORAGE_HOST_ */
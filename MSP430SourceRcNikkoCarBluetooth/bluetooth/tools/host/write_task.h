@@ -0,0 +1,10 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    write_task.h
+ * \brief   Host (Linux) replacement of write_task.h for the tools tests.
+ */
+
+#ifndef _H_WRITE_TASK_
+#define _H_WRITE_TASK_
+
+#endif /* _H_WRITE_TASK_ */
@@ -0,0 +1,390 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    pool_sizer.cpp
+ * \brief   Host tool replaying BT buffer pool traces (SDK_POOL_TRACE) against
+ *          candidate pool configurations, to find the smallest RAM
+ *          configuration with no allocation failure.
+ *
+ *          Build:  g++ -O2 -std=c++11 -o pool_sizer pool_sizer.cpp
+ *          Usage:  pool_sizer [--sizes 8,16,32,128,260]... [--max-chunks 15]
+ *                             trace.log...
+ *
+ *          Each trace is a capture of the USB serial port while the 't' SPP
+ *          command drains the trace; only the "T <timestamp> <op> <pool>
+ *          <chunk> <size>" lines are used, so a whole session log can be
+ *          given as is. Use one trace per workload (pairing, reconnect
+ *          storm, telemetry streaming): a configuration has to pass all of
+ *          them.
+ *
+ *          The replay follows heap_bt.c: a request goes to the smallest
+ *          class holding it and falls back to the next larger non empty
+ *          class. RAM per chunk is its size plus its free stack entry, as in
+ *          OS_MAX_HEAP_MEMORY. A FAIL entry has no matching free; it is
+ *          replayed as a request released at once. The device trace does
+ *          not see buffers allocated before it was last drained; frees of
+ *          those are ignored and reported.
+ *
+ *          The stack library allocates through OS_allocate_buffer(), which
+ *          does not get the request size: its entries carry the chunk size
+ *          of the class asked for (OS_POOL_TRACE_CLASS_SIZE). They are
+ *          replayed at that size, so the tool can not move them to a
+ *          smaller class; their count is reported with each trace.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+/* OS_POOL_TRACE_* of BT_buffer.h */
+const int kOpAlloc = 0;
+const int kOpFree = 1;
+const int kOpFail = 2;
+const unsigned kOpClassSize = 8;
+
+/* Free stack entry per chunk, as counted in OS_MAX_HEAP_MEMORY */
+const unsigned kChunkOverhead = 4;
+
+/* OS_MAX_STACK_ITEMS of heap_bt.c */
+const unsigned kDefaultMaxChunks = 15;
+
+/* BT_MEM_SIZE_* of BT_buffer.h */
+const unsigned kDefaultSizes[] = { 8, 16, 32, 128, 260 };
+
+struct TraceEvent {
+    int op;
+    /* Chunk identity on the device: (pool, chunk) */
+    unsigned key;
+    unsigned size;
+};
+
+struct Workload {
+    std::string name;
+    std::vector<TraceEvent> events;
+    unsigned unmatched_frees;
+    /* Requests of which only the class size is known */
+    unsigned class_size_requests;
+};
+
+struct Config {
+    std::vector<unsigned> sizes;
+    std::vector<unsigned> counts;
+};
+
+unsigned ram_of(const Config &config)
+{
+    unsigned ram = 0;
+
+    for (size_t n = 0; n < config.sizes.size(); n++) {
+        ram += config.counts[n] * (config.sizes[n] + kChunkOverhead);
+    }
+    return ram;
+}
+
+/* Smallest class holding size, sizes.size() if none */
+size_t class_of(const std::vector<unsigned> &sizes, unsigned size)
+{
+    size_t n = 0;
+
+    while ((n < sizes.size()) && (sizes[n] < size)) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * Replay a workload; returns the number of failed requests. peak, if not
+ * NULL, gets the most chunks of each class in use at once.
+ */
+unsigned replay(const Workload &workload, const Config &config,
+                std::vector<unsigned> *peak)
+{
+    std::vector<unsigned> in_use(config.sizes.size(), 0);
+    std::map<unsigned, size_t> live;
+    unsigned failures = 0;
+
+    if (NULL != peak) {
+        peak->assign(config.sizes.size(), 0);
+    }
+
+    for (size_t e = 0; e < workload.events.size(); e++) {
+        const TraceEvent &event = workload.events[e];
+
+        if (kOpFree == event.op) {
+            std::map<unsigned, size_t>::iterator it = live.find(event.key);
+            if (it != live.end()) {
+                in_use[it->second]--;
+                live.erase(it);
+            }
+            continue;
+        }
+
+        size_t from = class_of(config.sizes, event.size);
+        while ((from < config.sizes.size()) &&
+               (in_use[from] >= config.counts[from])) {
+            from++;
+        }
+        if (from == config.sizes.size()) {
+            failures++;
+            continue;
+        }
+
+        in_use[from]++;
+        if ((NULL != peak) && (in_use[from] > (*peak)[from])) {
+            (*peak)[from] = in_use[from];
+        }
+        if (kOpFail == event.op) {
+            in_use[from]--;
+        } else {
+            live[event.key] = from;
+        }
+    }
+    return failures;
+}
+
+bool passes(const std::vector<Workload> &workloads, const Config &config)
+{
+    for (size_t w = 0; w < workloads.size(); w++) {
+        if (0 != replay(workloads[w], config, NULL)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Depth first search over the counts, largest class first, bounded by the
+ * per class peak of the no fallback replay (always feasible) and by the
+ * best RAM found so far.
+ */
+void search(const std::vector<Workload> &workloads,
+            const std::vector<unsigned> &limit, size_t depth, Config &config,
+            unsigned ram, Config &best, unsigned &best_ram)
+{
+    if (ram >= best_ram) {
+        return;
+    }
+    if (depth == config.sizes.size()) {
+        if (passes(workloads, config)) {
+            best = config;
+            best_ram = ram;
+        }
+        return;
+    }
+
+    size_t n = config.sizes.size() - 1 - depth;
+    for (unsigned count = 0; count <= limit[n]; count++) {
+        config.counts[n] = count;
+        search(workloads, limit, depth + 1, config,
+               ram + count * (config.sizes[n] + kChunkOverhead), best,
+               best_ram);
+    }
+    config.counts[n] = 0;
+}
+
+bool load_trace(const std::string &path, Workload &workload)
+{
+    std::ifstream file(path.c_str());
+    std::map<unsigned, bool> live;
+    std::string line;
+
+    if (!file) {
+        std::cerr << "cannot open " << path << "\n";
+        return false;
+    }
+
+    workload.name = path;
+    workload.unmatched_frees = 0;
+    workload.class_size_requests = 0;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string tag;
+        unsigned long timestamp;
+        unsigned op, pool, chunk, size;
+
+        if (!(fields >> tag >> timestamp >> op >> pool >> chunk >> size) ||
+            ("T" != tag)) {
+            continue;
+        }
+
+        TraceEvent event;
+        event.op = static_cast<int>(op & ~kOpClassSize);
+        event.key = (pool << 4) | chunk;
+        event.size = size;
+
+        if (kOpFree == event.op) {
+            if (!live.erase(event.key)) {
+                workload.unmatched_frees++;
+                continue;
+            }
+        } else if (kOpAlloc == event.op) {
+            live[event.key] = true;
+        } else if (kOpFail != event.op) {
+            continue;
+        }
+        if (0 != (op & kOpClassSize)) {
+            workload.class_size_requests++;
+        }
+        workload.events.push_back(event);
+    }
+    return true;
+}
+
+bool parse_sizes(const std::string &text, std::vector<unsigned> &sizes)
+{
+    std::istringstream fields(text);
+    std::string field;
+
+    sizes.clear();
+    while (std::getline(fields, field, ',')) {
+        unsigned long size = std::strtoul(field.c_str(), NULL, 0);
+        if ((0 == size) || (!sizes.empty() && (size <= sizes.back()))) {
+            return false;
+        }
+        sizes.push_back(static_cast<unsigned>(size));
+    }
+    return !sizes.empty();
+}
+
+void print_config(const Config &config)
+{
+    for (size_t n = 0; n < config.sizes.size(); n++) {
+        std::cout << "    BT_NUM_SIZE_BLK_" << config.sizes[n] << "  "
+                  << config.counts[n] << "\n";
+    }
+    std::cout << "    RAM " << ram_of(config) << " bytes\n";
+}
+
+}                               /* namespace */
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::vector<unsigned> > size_sets;
+    std::vector<Workload> workloads;
+    unsigned max_chunks = kDefaultMaxChunks;
+
+    for (int arg = 1; arg < argc; arg++) {
+        std::string option(argv[arg]);
+
+        if (("--sizes" == option) && (arg + 1 < argc)) {
+            std::vector<unsigned> sizes;
+            if (!parse_sizes(argv[++arg], sizes)) {
+                std::cerr << "invalid --sizes " << argv[arg]
+                          << ": increasing sizes expected\n";
+                return 2;
+            }
+            size_sets.push_back(sizes);
+        } else if (("--max-chunks" == option) && (arg + 1 < argc)) {
+            max_chunks = static_cast<unsigned>(std::atoi(argv[++arg]));
+        } else {
+            Workload workload;
+            if (!load_trace(option, workload)) {
+                return 2;
+            }
+            workloads.push_back(workload);
+        }
+    }
+
+    if (workloads.empty()) {
+        std::cerr << "usage: pool_sizer [--sizes 8,16,32,128,260]... "
+                  << "[--max-chunks 15] trace.log...\n";
+        return 2;
+    }
+    if (size_sets.empty()) {
+        size_sets.push_back(std::vector<unsigned>(kDefaultSizes,
+                                                  kDefaultSizes +
+                                                  sizeof(kDefaultSizes) /
+                                                  sizeof(kDefaultSizes[0])));
+    }
+
+    for (size_t w = 0; w < workloads.size(); w++) {
+        std::cout << workloads[w].name << ": "
+                  << workloads[w].events.size() << " events";
+        if (0 != workloads[w].unmatched_frees) {
+            std::cout << ", " << workloads[w].unmatched_frees
+                      << " frees of buffers allocated before the trace";
+        }
+        if (0 != workloads[w].class_size_requests) {
+            std::cout << ", " << workloads[w].class_size_requests
+                      << " requests with only their class size known";
+        }
+        std::cout << "\n";
+        if (0 != workloads[w].class_size_requests) {
+            std::cerr << "warning: " << workloads[w].name
+                      << ": OS_allocate_buffer() requests are replayed at "
+                      << "the chunk size of their class, not at their real "
+                      << "size\n";
+        }
+    }
+
+    Config overall;
+    unsigned overall_ram = std::numeric_limits<unsigned>::max();
+
+    for (size_t s = 0; s < size_sets.size(); s++) {
+        const std::vector<unsigned> &sizes = size_sets[s];
+        Config config;
+        std::vector<unsigned> limit(sizes.size(), 0);
+
+        /* With as many chunks as ever requested, no request falls back:
+         * the per class peaks bound the search */
+        config.sizes = sizes;
+        config.counts.assign(sizes.size(), max_chunks * 64);
+        for (size_t w = 0; w < workloads.size(); w++) {
+            std::vector<unsigned> peak;
+            if (0 != replay(workloads[w], config, &peak)) {
+                std::cerr << workloads[w].name
+                          << ": requests larger than the largest class\n";
+                limit.clear();
+                break;
+            }
+            for (size_t n = 0; n < sizes.size(); n++) {
+                limit[n] = std::max(limit[n], peak[n]);
+            }
+        }
+        if (limit.empty()) {
+            continue;
+        }
+        for (size_t n = 0; n < sizes.size(); n++) {
+            if (limit[n] > max_chunks) {
+                std::cerr << "class " << sizes[n] << " needs " << limit[n]
+                          << " chunks without fallback, above --max-chunks\n";
+                limit[n] = max_chunks;
+            }
+        }
+
+        Config best;
+        unsigned best_ram = std::numeric_limits<unsigned>::max();
+        config.counts.assign(sizes.size(), 0);
+        search(workloads, limit, 0, config, 0, best, best_ram);
+
+        if (best.sizes.empty()) {
+            std::cout << "no configuration within --max-chunks for sizes set "
+                      << s << "\n";
+            continue;
+        }
+        std::cout << "best for sizes set " << s << ":\n";
+        print_config(best);
+        if (best_ram < overall_ram) {
+            overall = best;
+            overall_ram = best_ram;
+        }
+    }
+
+    if (overall.sizes.empty()) {
+        return 1;
+    }
+    if (size_sets.size() > 1) {
+        std::cout << "overall best:\n";
+        print_config(overall);
+    }
+    return 0;
+}
@@ -0,0 +1,256 @@
+/**
+ * Copyright (c) 2010 MindTree Ltd.  All rights reserved.
+ * \file    sm_storage_test.cpp
+ * \brief   Host test of the Security Manager flash log (sm_storage_pl.c) on
+ *          a simulated information memory.
+ *
+ *          Build:  make -C tools sm_storage_test
+ *          Usage:  sm_storage_test [seed]
+ *
+ *          Databases of random length and content are committed one after
+ *          the other. Some commits are cut by a power cut at a random flash
+ *          operation: the word being programmed keeps part of its bits, the
+ *          segment being erased part of its bytes, and the device reboots.
+ *          Some flash programs fail. Checked:
+ *            - after each reboot, the database read back is the last one
+ *              committed (or the one being committed, if its CRC was
+ *              programmed before the cut);
+ *            - a record too long or failing to program is counted and the
+ *              previous database stays readable;
+ *            - the erases are spread evenly over the three segments.
+ *
+ *          sm_storage_pl.c is built into this file, so a reboot can reset
+ *          its RAM state.
+ */
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "sm_storage_host.h"
+
+extern "C" {
+#include "../export/common_appl/sm_storage_pl.c"
+}
+
+uint8_t host_flash[3 * 128];
+unsigned short host_interrupt_state = 1;
+
+namespace {
+
+const int SEGMENTS = 3;
+const int SEGMENT_SIZE = 128;
+const UINT16 MAX_DATA = 120;
+
+/* Flash operations left before the power cut, 0: no cut armed */
+long cut_countdown;
+/* Flash programs left before a failed one, 0: none armed */
+long fail_countdown;
+std::jmp_buf power_cut;
+
+unsigned long erase_count[SEGMENTS];
+unsigned long failures;
+
+void fail(const char *what, long detail)
+{
+    if (failures < 20) {
+        std::fprintf(stderr, "FAIL: %s (%ld)\n", what, detail);
+    }
+    failures++;
+}
+
+bool power_cut_now(void)
+{
+    return (0 != cut_countdown) && (0 == --cut_countdown);
+}
+
+/* Offset in host_flash of a flash address */
+size_t flash_offset(volatile uint16_t *address)
+{
+    return (size_t)((volatile uint8_t *)address - host_flash);
+}
+
+} // namespace
+
+/* Programming only clears bits; a cut leaves part of them cleared */
+void host_flash_program(volatile uint16_t *address, uint16_t word)
+{
+    uint16_t cleared = (uint16_t)(*address & ~word);
+
+    if (power_cut_now()) {
+        *address = (uint16_t)(*address & ~(cleared & (uint16_t)std::rand()));
+        std::longjmp(power_cut, 1);
+    }
+    if ((0 != fail_countdown) && (0 == --fail_countdown)) {
+        return;
+    }
+    *address = (uint16_t)(*address & word);
+}
+
+/* A cut leaves part of the bytes erased */
+void host_flash_erase(volatile uint16_t *address)
+{
+    size_t segment = flash_offset(address) / SEGMENT_SIZE;
+    uint8_t *start = &host_flash[segment * SEGMENT_SIZE];
+    int index;
+
+    if (power_cut_now()) {
+        for (index = 0; index < SEGMENT_SIZE; index++) {
+            if (0 != (std::rand() & 1)) {
+                start[index] = 0xFF;
+            }
+        }
+        std::longjmp(power_cut, 1);
+    }
+    std::memset(start, 0xFF, SEGMENT_SIZE);
+    erase_count[segment]++;
+}
+
+namespace {
+
+/* Power on: the RAM state of sm_storage_pl.c is lost */
+void reboot(void)
+{
+    sm_ps_scanned = FALSE;
+    sm_ps_valid = FALSE;
+    sm_ps_mode = PS_READ;
+}
+
+bool read_back_is(const std::vector<UCHAR> &expected)
+{
+    UCHAR data[MAX_DATA + 4];
+    size_t index;
+
+    sm_ps_open(PS_READ);
+    sm_ps_read(data, sizeof(data));
+    sm_ps_close();
+
+    for (index = 0; index < sizeof(data); index++) {
+        UCHAR byte = (index < expected.size()) ? expected[index] : 0x00;
+        if (data[index] != byte) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void commit(const std::vector<UCHAR> &data)
+{
+    size_t offset = 0;
+
+    sm_ps_open(PS_WRITE);
+    /* Written in pieces, as the Security Manager does */
+    while (offset < data.size()) {
+        size_t piece = 1 + std::rand() % 16;
+        if (piece > data.size() - offset) {
+            piece = data.size() - offset;
+        }
+        sm_ps_write((UCHAR *)&data[offset], (UINT16)piece);
+        offset += piece;
+    }
+    sm_ps_close();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    static std::vector<UCHAR> committed;
+    static std::vector<UCHAR> attempt;
+    static long round;
+    static unsigned long cuts;
+    static unsigned long drops;
+    static UINT16 drop_base;
+    const long rounds = 200000L;
+    unsigned long min_erases;
+    unsigned long max_erases;
+    int segment;
+
+    std::srand((argc > 1) ? (unsigned int)std::atoi(argv[1]) : 1);
+    std::memset(host_flash, 0xFF, sizeof(host_flash));
+    reboot();
+
+    for (round = 0; round < rounds; round++) {
+        if (0 != setjmp(power_cut)) {
+            cut_countdown = 0;
+            fail_countdown = 0;
+            cuts++;
+            reboot();
+            drop_base = sm_ps_get_failure_count();
+            if (read_back_is(attempt)) {
+                committed = attempt;
+            } else if (!read_back_is(committed)) {
+                fail("database lost by a power cut", round);
+            }
+            continue;
+        }
+
+        /* Mostly the size of the two device database, some others */
+        attempt.resize((0 == (std::rand() % 4)) ?
+                       (size_t)(1 + std::rand() % MAX_DATA) : 100);
+        for (size_t index = 0; index < attempt.size(); index++) {
+            attempt[index] = (UCHAR)std::rand();
+        }
+
+        if (0 == (std::rand() % 500)) {
+            /* Too long: dropped */
+            std::vector<UCHAR> large(MAX_DATA + 1 + std::rand() % 8, 0x5A);
+            drop_base = sm_ps_get_failure_count();
+            commit(large);
+            if (sm_ps_get_failure_count() != (UINT16)(drop_base + 1)) {
+                fail("too long record not counted", (long)large.size());
+            }
+            drops++;
+        } else if (0 == (std::rand() % 100)) {
+            /* A flash program fails */
+            fail_countdown = 1 + std::rand() % 60;
+            drop_base = sm_ps_get_failure_count();
+            commit(attempt);
+            /* A failed program of an all ones word goes unnoticed, and is
+             * harmless */
+            if (sm_ps_get_failure_count() != drop_base) {
+                drops++;
+            } else {
+                committed = attempt;
+            }
+            fail_countdown = 0;
+        } else {
+            if (0 == (std::rand() % 4)) {
+                cut_countdown = 1 + std::rand() % 70;
+            }
+            commit(attempt);
+            cut_countdown = 0;
+            committed = attempt;
+        }
+
+        if (!read_back_is(committed)) {
+            fail("database not read back", round);
+        }
+        if (0 == (round % 50)) {
+            reboot();
+            if (!read_back_is(committed)) {
+                fail("database not read back after a reboot", round);
+            }
+        }
+    }
+
+    min_erases = max_erases = erase_count[0];
+    for (segment = 1; segment < SEGMENTS; segment++) {
+        if (erase_count[segment] < min_erases) {
+            min_erases = erase_count[segment];
+        }
+        if (erase_count[segment] > max_erases) {
+            max_erases = erase_count[segment];
+        }
+    }
+    if ((max_erases - min_erases) > (max_erases / 20 + 2)) {
+        fail("erases not spread", (long)(max_erases - min_erases));
+    }
+
+    std::printf("sm_storage_test: %ld commits, %lu power cuts, %lu dropped, "
+                "erases %lu/%lu/%lu, %lu failures\n", round, cuts, drops,
+                erase_count[0], erase_count[1], erase_count[2], failures);
+    return (0 == failures) ? 0 : 1;
+}